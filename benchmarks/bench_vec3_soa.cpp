@@ -0,0 +1,248 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+// Compares the SIMD kernels on the structure-of-arrays (SoA) layout (see easy3d/core/vec3_soa.h) against the same
+// operations on the interleaved layout (i.e., the current code) for the points of a PointCloud and the points and
+// normals of a SurfaceMesh. Both columns run on the shared thread pool with the same number of threads (and the same
+// chunks), so the speedup is due to the layout and the SIMD instructions only.
+//
+// Usage: Benchmark_Vec3SoA [-t num_threads] [num_elements ...]    (default: 1000000 10000000)
+//
+// For each operation, the best time of a few runs is reported for the current code, the SoA kernels, and the
+// conversion between the two layouts. Use "-t 1" to compare the single-threaded code.
+
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <functional>
+
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/core/vec3_soa.h>
+#include <easy3d/util/stop_watch.h>
+#include <easy3d/util/parallel.h>
+#include <easy3d/util/logging.h>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    const int num_runs = 3;
+
+    // returns the best time (in milliseconds) of a few runs. 'prepare' is called before each run and is not timed.
+    double best_time(const std::function<void()> &task, const std::function<void()> &prepare = nullptr) {
+        double best = 1e30;
+        for (int i = 0; i < num_runs; ++i) {
+            if (prepare)
+                prepare();
+            StopWatch w;
+            task();
+            best = std::min(best, w.elapsed_seconds(6) * 1000.0);
+        }
+        return best;
+    }
+
+
+    // a negative 'current' means the operation has no counterpart in the current code
+    void report(const std::string &model, const std::string &operation, std::size_t n, double current, double soa) {
+        std::cout << std::left << std::setw(12) << model << std::setw(22) << operation
+                  << std::right << std::setw(12) << n << std::fixed << std::setprecision(2);
+        if (current < 0)
+            std::cout << std::setw(14) << "-" << std::setw(14) << soa << std::setw(11) << "-" << std::endl;
+        else {
+            std::cout << std::setw(14) << current << std::setw(14) << soa
+                      << std::setw(10) << std::setprecision(1) << (soa > 0 ? current / soa : 0.0) << "x" << std::endl;
+        }
+    }
+
+
+    // the current code: scalar loops on the interleaved layout, split into chunks by the parallel runtime (in the
+    // same way as the SoA kernels)
+    namespace current {
+        Box3 bounding_box(const std::vector<vec3> &points) {
+            return parallel::reduce(0, points.size(), Box3(), [&](std::size_t begin, std::size_t end) -> Box3 {
+                Box3 box;
+                for (std::size_t i = begin; i < end; ++i)
+                    box.grow(points[i]);
+                return box;
+            }, [](const Box3 &a, const Box3 &b) { return a + b; });
+        }
+
+        void translate(std::vector<vec3> &points, const vec3 &t) {
+            parallel::for_each_range(0, points.size(), [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    points[i] += t;
+            });
+        }
+
+        void transform(std::vector<vec3> &points, const mat4 &m) {
+            parallel::for_each_range(0, points.size(), [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    points[i] = m * points[i];
+            });
+        }
+
+        void transform(std::vector<vec3> &vectors, const mat3 &m) {
+            parallel::for_each_range(0, vectors.size(), [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    vectors[i] = m * vectors[i];
+            });
+        }
+
+        void normalize(std::vector<vec3> &vectors) {
+            parallel::for_each_range(0, vectors.size(), [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    vectors[i].normalize();
+            });
+        }
+
+        dvec3 centroid(const std::vector<vec3> &points) {
+            const dvec3 sum = parallel::reduce(0, points.size(), dvec3(0, 0, 0),
+                                               [&](std::size_t begin, std::size_t end) -> dvec3 {
+                dvec3 result(0, 0, 0);
+                for (std::size_t i = begin; i < end; ++i)
+                    result += dvec3(points[i].x, points[i].y, points[i].z);
+                return result;
+            }, [](const dvec3 &a, const dvec3 &b) { return a + b; });
+            return sum / static_cast<double>(points.size());
+        }
+
+        dmat3 covariance(const std::vector<vec3> &points, const dvec3 &c) {
+            dmat3 cov = parallel::reduce(0, points.size(), dmat3(0.0), [&](std::size_t begin, std::size_t end) {
+                dmat3 result(0.0);
+                for (std::size_t k = begin; k < end; ++k) {
+                    const dvec3 d(points[k].x - c.x, points[k].y - c.y, points[k].z - c.z);
+                    for (int i = 0; i < 3; ++i)
+                        for (int j = 0; j < 3; ++j)
+                            result(i, j) += d[i] * d[j];
+                }
+                return result;
+            }, [](const dmat3 &a, const dmat3 &b) { return a + b; });
+            cov /= static_cast<double>(points.size());
+            return cov;
+        }
+    }
+
+
+    // runs all the operations on the points (and the normals if provided) of a model
+    void run(const std::string &model, std::vector<vec3> &points, std::vector<vec3> *normals) {
+        const std::size_t n = points.size();
+        const std::vector<vec3> original_points = points;
+        const mat4 m = mat4::translation(vec3(1.0f, 2.0f, 3.0f)) * mat4::rotation(vec3(1, 1, 1), 0.3f);
+        const vec3 t(0.1f, 0.2f, 0.3f);
+
+        Vec3SoA soa_points;
+        report(model, "AoS -> SoA (points)", n, -1.0, best_time([&]() { soa_points.assign(points); }));
+        report(model, "SoA -> AoS (points)", n, -1.0, best_time([&]() { soa_points.copy_to(points); }));
+
+        volatile float sink = 0.0f;   // prevents the compiler from removing the computations
+        report(model, "bounding box", n,
+               best_time([&]() { sink = sink + current::bounding_box(points).diagonal_length(); }),
+               best_time([&]() { sink = sink + simd::bounding_box(soa_points).diagonal_length(); }));
+        report(model, "translate", n,
+               best_time([&]() { current::translate(points, t); }),
+               best_time([&]() { simd::translate(soa_points, t); }));
+        report(model, "affine transform", n,
+               best_time([&]() { current::transform(points, m); }),
+               best_time([&]() { simd::transform(soa_points, m); }));
+
+        // restores the points such that the centroid and covariance are computed on the same data
+        points = original_points;
+        soa_points.assign(points);
+        dvec3 c1, c2;
+        report(model, "centroid", n,
+               best_time([&]() { c1 = current::centroid(points); }),
+               best_time([&]() { c2 = simd::centroid(soa_points); }));
+        dmat3 cov1, cov2;
+        report(model, "covariance", n,
+               best_time([&]() { cov1 = current::covariance(points, c1); }),
+               best_time([&]() { cov2 = simd::covariance(soa_points, c2); }));
+        LOG_IF(distance(c1, c2) > 1e-4 * length(c1) + 1e-6, WARNING) << "different centroids: " << c1 << " vs. " << c2;
+
+        if (normals) {
+            const std::vector<vec3> original_normals = *normals;
+            Vec3SoA soa_normals(*normals);
+            report(model, "normalize (normals)", n,
+                   best_time([&]() { current::normalize(*normals); }, [&]() { *normals = original_normals; }),
+                   best_time([&]() { simd::normalize(soa_normals); }, [&]() { soa_normals.assign(original_normals); }));
+            report(model, "transform (normals)", n,
+                   best_time([&]() { current::transform(*normals, mat3(m)); }),
+                   best_time([&]() { simd::transform(soa_normals, mat3(m)); }));
+            *normals = original_normals;
+        }
+
+        points = original_points;
+    }
+
+}
+
+
+int main(int argc, char **argv) {
+    logging::initialize();
+
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "-t" && i + 1 < argc)
+            parallel::set_num_threads(static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10)));
+        else
+            sizes.push_back(static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10)));
+    }
+    if (sizes.empty())
+        sizes = {1000000, 10000000};
+
+    std::cout << "instruction set: " << simd::instruction_set() << ", threads: " << parallel::num_threads()
+              << ", best of " << num_runs << " runs (ms)" << std::endl;
+    std::cout << std::left << std::setw(12) << "model" << std::setw(22) << "operation"
+              << std::right << std::setw(12) << "elements" << std::setw(14) << "current" << std::setw(14) << "SoA+SIMD"
+              << std::setw(11) << "speedup" << std::endl;
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> uniform(-1000.0f, 1000.0f);
+    for (auto n : sizes) {
+        {
+            PointCloud cloud;
+            cloud.resize(static_cast<unsigned int>(n));
+            for (auto &p : cloud.points())
+                p = vec3(uniform(generator), uniform(generator), uniform(generator));
+            run("PointCloud", cloud.points(), nullptr);
+        }
+        {
+            SurfaceMesh mesh;
+            mesh.resize(static_cast<unsigned int>(n), 0, 0);
+            for (auto &p : mesh.points())
+                p = vec3(uniform(generator), uniform(generator), uniform(generator));
+            auto normals = mesh.add_vertex_property<vec3>("v:normal");
+            for (auto &v : normals.vector())
+                v = vec3(uniform(generator), uniform(generator), uniform(generator));
+            run("SurfaceMesh", mesh.points(), &normals.vector());
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,490 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+// A headless benchmark suite for the core, fileio, kdtree, and algo modules. All the models are synthetic, so no
+// datasets are needed, and the results are written in JSON such that they can be compared across versions.
+//
+// Usage: easy3d_benchmarks [options]
+//      --scale <s>         scales the sizes of the synthetic models (default: 1.0, i.e., 200k points and 80k faces)
+//      --runs <n>          the number of runs of each benchmark (default: 3)
+//      --filter <text>     runs only the benchmarks whose names contain the text
+//      --output <file>     the JSON file to write the results to (default: easy3d_benchmarks.json)
+//
+// Each benchmark is named as "module/subject/operation", e.g., "kdtree/nanoflann/knn_16". For each benchmark, the
+// best and the median time (in milliseconds) of the runs are reported. The preparation of each run (e.g., copying
+// the model that will be modified) is not timed.
+
+#include <random>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <functional>
+
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/fileio/point_cloud_io.h>
+#include <easy3d/fileio/surface_mesh_io.h>
+#include <easy3d/kdtree/kdtree_search_ann.h>
+#include <easy3d/kdtree/kdtree_search_eth.h>
+#include <easy3d/kdtree/kdtree_search_flann.h>
+#include <easy3d/kdtree/kdtree_search_nanoflann.h>
+#include <easy3d/algo/point_cloud_normals.h>
+#include <easy3d/algo/point_cloud_poisson_reconstruction.h>
+#include <easy3d/algo/surface_mesh_factory.h>
+#include <easy3d/algo/surface_mesh_simplification.h>
+#include <easy3d/algo/surface_mesh_remeshing.h>
+#include <easy3d/algo/surface_mesh_curvature.h>
+#include <easy3d/algo/delaunay_2d.h>
+#include <easy3d/algo/delaunay_3d.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/stop_watch.h>
+#include <easy3d/util/parallel.h>
+#include <easy3d/util/version.h>
+#include <easy3d/util/logging.h>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    struct Options {
+        double scale = 1.0;
+        int runs = 3;
+        std::string filter;
+        std::string output = "easy3d_benchmarks.json";
+    };
+
+
+    struct Result {
+        std::string name;
+        std::size_t size;       // the number of elements processed
+        std::string unit;       // what the elements are, e.g., "points", "faces", "queries"
+        double best_ms;
+        double median_ms;
+    };
+
+
+    class Suite {
+    public:
+        explicit Suite(const Options &options) : options_(options) {}
+
+        bool enabled(const std::string &name) const {
+            return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+        }
+
+        // Runs a benchmark. 'prepare' is called before each run and is not timed. 'task' returns false on failure.
+        void run(const std::string &name, std::size_t size, const std::string &unit,
+                 const std::function<bool()> &task, const std::function<void()> &prepare = nullptr) {
+            if (!enabled(name))
+                return;
+
+            std::vector<double> times;
+            for (int i = 0; i < options_.runs; ++i) {
+                if (prepare)
+                    prepare();
+                StopWatch w;
+                const bool success = task();
+                const double t = w.elapsed_seconds(6) * 1000.0;
+                if (!success) {
+                    LOG(ERROR) << "benchmark '" << name << "' failed";
+                    ++num_failures_;
+                    return;
+                }
+                times.push_back(t);
+            }
+            std::sort(times.begin(), times.end());
+            const Result r{name, size, unit, times.front(), times[times.size() / 2]};
+            std::cout << std::left << std::setw(44) << r.name << std::right << std::setw(10) << r.size << " "
+                      << std::left << std::setw(8) << r.unit << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << r.best_ms << std::setw(12) << r.median_ms << std::endl;
+            results_.push_back(r);
+        }
+
+        int num_failures() const { return num_failures_; }
+
+        bool save(const std::string &file_name) const {
+            std::ofstream output(file_name.c_str());
+            if (output.fail()) {
+                LOG(ERROR) << "could not open file: " << file_name;
+                return false;
+            }
+
+            output << "{\n"
+                   << "  \"easy3d_version\": \"" << version() << "\",\n"
+                   << "  \"threads\": " << parallel::num_threads() << ",\n"
+                   << "  \"scale\": " << options_.scale << ",\n"
+                   << "  \"runs\": " << options_.runs << ",\n"
+                   << "  \"results\": [";
+            output << std::fixed << std::setprecision(3);
+            for (std::size_t i = 0; i < results_.size(); ++i) {
+                const Result &r = results_[i];
+                output << (i == 0 ? "\n" : ",\n")
+                       << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size << ", \"unit\": \"" << r.unit
+                       << "\", \"best_ms\": " << r.best_ms << ", \"median_ms\": " << r.median_ms << "}";
+            }
+            output << "\n  ]\n}\n";
+            return !output.fail();
+        }
+
+    private:
+        const Options &options_;
+        std::vector<Result> results_;
+        int num_failures_ = 0;
+    };
+
+
+    //------------------------------------ synthetic models ------------------------------------
+
+    // A point cloud sampling a bumpy sphere, with the exact normals stored as "v:normal".
+    PointCloud *bumpy_sphere_cloud(std::size_t num_points) {
+        std::mt19937 generator(42);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        auto cloud = new PointCloud;
+        cloud->resize(static_cast<unsigned int>(num_points));
+        auto normals = cloud->add_vertex_property<vec3>("v:normal");
+        for (auto v : cloud->vertices()) {
+            const vec3 d = normalize(vec3(normal(generator), normal(generator), normal(generator)));
+            const float r = 1.0f + 0.05f * std::sin(8.0f * d.x) * std::sin(8.0f * d.y) * std::sin(8.0f * d.z);
+            cloud->position(v) = d * r;
+            normals[v] = d;
+        }
+        return cloud;
+    }
+
+
+    // A triangle mesh of a bumpy sphere with (about) the given number of faces.
+    SurfaceMesh *bumpy_sphere_mesh(std::size_t num_faces) {
+        // an icosphere has 20 * 4^n faces
+        std::size_t subdivisions = 0;
+        while (20 * (std::size_t(1) << (2 * (subdivisions + 1))) <= num_faces)
+            ++subdivisions;
+        auto mesh = new SurfaceMesh(SurfaceMeshFactory::icosphere(subdivisions));
+        for (auto &p : mesh->points()) {
+            const vec3 d = normalize(p);
+            p = d * (1.0f + 0.05f * std::sin(8.0f * d.x) * std::sin(8.0f * d.y) * std::sin(8.0f * d.z));
+        }
+        return mesh;
+    }
+
+
+    //------------------------------------ benchmarks ------------------------------------
+
+    void benchmark_io(Suite &suite, const PointCloud *cloud, const SurfaceMesh *mesh, const std::string &dir) {
+        // LAS doesn't support normals
+        PointCloud points_only = *cloud;
+        points_only.remove_vertex_property("v:normal");
+
+        for (const auto &ext : {"ply", "bin", "pcb", "xyz", "bxyz", "las"}) {
+            const PointCloud *model = (std::string(ext) == "las") ? &points_only : cloud;
+            const std::string file = dir + "/cloud." + ext;
+            const std::string name = std::string("fileio/point_cloud/") + ext;
+            suite.run(name + "/save", cloud->n_vertices(), "points", [&]() {
+                return PointCloudIO::save(file, model);
+            });
+            if (file_system::is_file(file)) {
+                suite.run(name + "/load", cloud->n_vertices(), "points", [&]() {
+                    std::unique_ptr<PointCloud> result(PointCloudIO::load(file));
+                    return result && result->n_vertices() == cloud->n_vertices();
+                });
+                file_system::delete_file(file);
+            }
+        }
+
+        for (const auto &ext : {"ply", "sm", "obj", "off", "stl"}) {
+            const std::string file = dir + "/mesh." + ext;
+            const std::string name = std::string("fileio/surface_mesh/") + ext;
+            suite.run(name + "/save", mesh->n_faces(), "faces", [&]() {
+                return SurfaceMeshIO::save(file, mesh);
+            });
+            if (file_system::is_file(file)) {
+                suite.run(name + "/load", mesh->n_faces(), "faces", [&]() {
+                    std::unique_ptr<SurfaceMesh> result(SurfaceMeshIO::load(file));
+                    return result && result->n_faces() == mesh->n_faces();
+                });
+                file_system::delete_file(file);
+            }
+        }
+    }
+
+
+    void benchmark_kdtree(Suite &suite, const PointCloud *cloud) {
+        const std::vector<vec3> &points = cloud->points();
+
+        // queries are perturbed copies of the points
+        std::mt19937 generator(7);
+        std::uniform_real_distribution<float> uniform(-0.01f, 0.01f);
+        std::vector<vec3> queries(points);
+        for (auto &q : queries)
+            q += vec3(uniform(generator), uniform(generator), uniform(generator));
+
+        // the radius that includes about 16 points on average (the sphere has an area of about 4 * pi)
+        const float squared_radius = 16.0f * 4.0f / static_cast<float>(points.size());
+
+        typedef std::function<KdTreeSearch *()> Builder;
+        const std::vector<std::pair<std::string, Builder> > backends = {
+                {"ann",       [&]() -> KdTreeSearch * { return new KdTreeSearch_ANN(points); }},
+                {"eth",       [&]() -> KdTreeSearch * { return new KdTreeSearch_ETH(points); }},
+                {"flann",     [&]() -> KdTreeSearch * { return new KdTreeSearch_FLANN(points); }},
+                {"nanoflann", [&]() -> KdTreeSearch * { return new KdTreeSearch_NanoFLANN(points); }}
+        };
+
+        for (const auto &backend : backends) {
+            const std::string name = "kdtree/" + backend.first;
+            suite.run(name + "/build", points.size(), "points", [&]() {
+                std::unique_ptr<KdTreeSearch> tree(backend.second());
+                return tree != nullptr;
+            });
+
+            if (!suite.enabled(name + "/"))
+                continue;
+            std::unique_ptr<KdTreeSearch> tree(backend.second());
+            suite.run(name + "/closest_point", queries.size(), "queries", [&]() {
+                std::size_t sum = 0;
+                for (const auto &q : queries)
+                    sum += static_cast<std::size_t>(tree->find_closest_point(q));
+                return sum > 0;
+            });
+            KdTreeSearch::Neighbors neighbors;
+            suite.run(name + "/knn_16", queries.size(), "queries", [&]() {
+                tree->find_closest_k_points(queries, 16, neighbors);
+                return neighbors.size() == queries.size();
+            });
+            suite.run(name + "/radius", queries.size(), "queries", [&]() {
+                tree->find_points_in_range(queries, squared_radius, neighbors);
+                return neighbors.size() == queries.size();
+            });
+        }
+    }
+
+
+    // Point location in Delaunay triangulations. The time per query is the time divided by the number of queries.
+    void benchmark_delaunay(Suite &suite, const PointCloud *cloud) {
+        // a terrain-like 2D point set, and random (incoherent) and grid (coherent) queries
+        std::mt19937 generator(11);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::vector<vec2> points(cloud->n_vertices());
+        for (auto &p : points)
+            p = vec2(uniform(generator), uniform(generator));
+        std::vector<vec2> random_queries(points.size() / 4);
+        for (auto &q : random_queries)
+            q = vec2(uniform(generator), uniform(generator));
+        const int grid_size = static_cast<int>(std::sqrt(static_cast<float>(random_queries.size())));
+        std::vector<vec2> grid_queries;
+        for (int y = 0; y < grid_size; ++y) {
+            for (int x = 0; x < grid_size; ++x)
+                grid_queries.emplace_back((x + 0.5f) / grid_size, (y + 0.5f) / grid_size);
+        }
+
+        if (suite.enabled("algo/delaunay_2d/")) {
+            Delaunay2 delaunay;
+            suite.run("algo/delaunay_2d/build", points.size(), "points", [&]() {
+                delaunay.set_vertices(points);
+                return delaunay.nb_triangles() > 0;
+            });
+            delaunay.nearest_vertex(random_queries[0]);  // builds the kd-tree (not timed)
+            std::vector<unsigned int> vertices;
+            suite.run("algo/delaunay_2d/nearest_vertex", random_queries.size(), "queries", [&]() {
+                std::size_t sum = 0;
+                for (const auto &q : random_queries)
+                    sum += delaunay.nearest_vertex(q);
+                return sum > 0;
+            });
+            suite.run("algo/delaunay_2d/nearest_vertices", random_queries.size(), "queries", [&]() {
+                delaunay.nearest_vertices(random_queries, vertices);
+                return vertices.size() == random_queries.size();
+            });
+            std::vector<int> cells;
+            suite.run("algo/delaunay_2d/locate_random", random_queries.size(), "queries", [&]() {
+                delaunay.locate(random_queries, cells);
+                return cells.size() == random_queries.size();
+            });
+            suite.run("algo/delaunay_2d/locate_grid", grid_queries.size(), "queries", [&]() {
+                delaunay.locate(grid_queries, cells);
+                return cells.size() == grid_queries.size();
+            });
+        }
+
+        if (suite.enabled("algo/delaunay_3d/")) {
+            const std::vector<vec3> &points_3d = cloud->points();
+            std::vector<vec3> queries(points_3d.begin(), points_3d.begin() + points_3d.size() / 4);
+            std::uniform_real_distribution<float> perturbation(-0.01f, 0.01f);
+            for (auto &q : queries)
+                q = q * 0.95f + vec3(perturbation(generator), perturbation(generator), perturbation(generator));
+            Delaunay3 delaunay;
+            suite.run("algo/delaunay_3d/build", points_3d.size(), "points", [&]() {
+                delaunay.set_vertices(points_3d);
+                return delaunay.nb_tets() > 0;
+            });
+            delaunay.nearest_vertex(queries[0]);  // builds the kd-tree (not timed)
+            std::vector<unsigned int> vertices;
+            suite.run("algo/delaunay_3d/nearest_vertices", queries.size(), "queries", [&]() {
+                delaunay.nearest_vertices(queries, vertices);
+                return vertices.size() == queries.size();
+            });
+            std::vector<int> cells;
+            suite.run("algo/delaunay_3d/locate", queries.size(), "queries", [&]() {
+                delaunay.locate(queries, cells);
+                return cells.size() == queries.size();
+            });
+        }
+    }
+
+
+    void benchmark_algo(Suite &suite, const PointCloud *cloud, const SurfaceMesh *mesh) {
+        PointCloud points;
+        suite.run("algo/point_cloud/normals", cloud->n_vertices(), "points", [&]() {
+            return PointCloudNormals::estimate(&points, 16);
+        }, [&]() { points = *cloud; points.remove_vertex_property("v:normal"); });
+
+        suite.run("algo/point_cloud/poisson_depth_8", cloud->n_vertices(), "points", [&]() {
+            PoissonReconstruction poisson;
+            poisson.set_depth(8);
+            std::unique_ptr<SurfaceMesh> result(poisson.apply(cloud));
+            return result && result->n_faces() > 0;
+        });
+
+        SurfaceMesh model;
+        suite.run("algo/surface_mesh/simplification", mesh->n_faces(), "faces", [&]() {
+            SurfaceMeshSimplification simplifier(&model);
+            simplifier.initialize(5.0f);
+            simplifier.simplify(mesh->n_vertices() / 10);
+            return model.n_vertices() < mesh->n_vertices();
+        }, [&]() { model = *mesh; });
+
+        float mean_edge_length = 0.0f;
+        for (auto e : mesh->edges())
+            mean_edge_length += mesh->edge_length(e);
+        mean_edge_length /= static_cast<float>(mesh->n_edges());
+        suite.run("algo/surface_mesh/uniform_remeshing", mesh->n_faces(), "faces", [&]() {
+            SurfaceMeshRemeshing(&model).uniform_remeshing(mean_edge_length, 3);
+            return model.n_faces() > 0;
+        }, [&]() { model = *mesh; });
+        suite.run("algo/surface_mesh/uniform_remeshing_parallel", mesh->n_faces(), "faces", [&]() {
+            SurfaceMeshRemeshing(&model).uniform_remeshing(mean_edge_length, 3, true, true);
+            return model.n_faces() > 0;
+        }, [&]() { model = *mesh; });
+
+        suite.run("algo/surface_mesh/curvature_tensor", mesh->n_faces(), "faces", [&]() {
+            SurfaceMeshCurvature(&model).analyze_tensor(1);
+            return true;
+        }, [&]() { model = *mesh; });
+    }
+
+
+    void benchmark_connectivity(Suite &suite, const SurfaceMesh *mesh) {
+        suite.run("core/surface_mesh/vertex_one_rings", mesh->n_vertices(), "vertices", [&]() {
+            std::size_t sum = 0;
+            for (auto v : mesh->vertices()) {
+                for (auto vv : mesh->vertices(v))
+                    sum += vv.idx();
+            }
+            return sum > 0;
+        });
+
+        suite.run("core/surface_mesh/face_vertices", mesh->n_faces(), "faces", [&]() {
+            std::size_t sum = 0;
+            for (auto f : mesh->faces()) {
+                for (auto v : mesh->vertices(f))
+                    sum += v.idx();
+            }
+            return sum > 0;
+        });
+
+        suite.run("core/surface_mesh/vertex_normals", mesh->n_vertices(), "vertices", [&]() {
+            vec3 sum(0, 0, 0);
+            for (auto v : mesh->vertices())
+                sum += mesh->compute_vertex_normal(v);
+            return !std::isnan(sum.x);
+        });
+
+        SurfaceMesh copy;
+        suite.run("core/surface_mesh/copy_and_modify", mesh->n_vertices(), "vertices", [&]() {
+            copy = *mesh;
+            for (auto &p : copy.points())
+                p *= 2.0f;
+            return copy.n_vertices() == mesh->n_vertices();
+        });
+    }
+
+}
+
+
+int main(int argc, char **argv) {
+    // no informative messages: they would disturb the timing
+    logging::initialize(false, true, true, false, "", 0);
+
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--scale")
+            options.scale = std::max(0.001, std::atof(argv[++i]));
+        else if (i + 1 < argc && arg == "--runs")
+            options.runs = std::max(1, std::atoi(argv[++i]));
+        else if (i + 1 < argc && arg == "--filter")
+            options.filter = argv[++i];
+        else if (i + 1 < argc && arg == "--output")
+            options.output = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--scale <s>] [--runs <n>] [--filter <text>] [--output <file>]"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string dir = file_system::current_working_directory() + "/easy3d_benchmarks_data";
+    if (!file_system::is_directory(dir) && !file_system::create_directory(dir)) {
+        LOG(ERROR) << "could not create directory: " << dir;
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<PointCloud> cloud(bumpy_sphere_cloud(static_cast<std::size_t>(200000 * options.scale)));
+    std::unique_ptr<SurfaceMesh> mesh(bumpy_sphere_mesh(static_cast<std::size_t>(80000 * options.scale)));
+
+    std::cout << "Easy3D " << version() << ", threads: " << parallel::num_threads() << ", runs: " << options.runs
+              << std::endl;
+    std::cout << std::left << std::setw(44) << "benchmark" << std::right << std::setw(10) << "size" << " "
+              << std::left << std::setw(8) << "unit" << std::right << std::setw(12) << "best (ms)"
+              << std::setw(12) << "median (ms)" << std::endl;
+
+    Suite suite(options);
+    benchmark_io(suite, cloud.get(), mesh.get(), dir);
+    benchmark_kdtree(suite, cloud.get());
+    benchmark_connectivity(suite, mesh.get());
+    benchmark_algo(suite, cloud.get(), mesh.get());
+    benchmark_delaunay(suite, cloud.get());
+    file_system::delete_directory(dir);
+
+    if (!suite.save(options.output))
+        return EXIT_FAILURE;
+    std::cout << "results saved to '" << options.output << "'" << std::endl;
+
+    return suite.num_failures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
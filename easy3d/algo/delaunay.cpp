@@ -12,6 +12,9 @@
 #include <easy3d/algo/delaunay.h>
 #include <algorithm>
 
+#include <easy3d/kdtree/kdtree_search_nanoflann.h>
+#include <easy3d/util/parallel.h>
+
 
 namespace easy3d {
 
@@ -27,6 +30,21 @@ namespace easy3d {
             }
             return result;
         }
+
+        // The orientation (i.e., the sign of the signed volume) of a simplex in dimension 2 or 3.
+        inline double orientation(unsigned int dim, const float *const *p) {
+            double a[3] = {0, 0, 0}, b[3] = {0, 0, 0}, c[3] = {0, 0, 0};
+            for (unsigned int i = 0; i < dim; ++i) {
+                a[i] = double(p[1][i]) - p[0][i];
+                b[i] = double(p[2][i]) - p[0][i];
+                if (dim > 2)
+                    c[i] = double(p[3][i]) - p[0][i];
+            }
+            if (dim == 2)
+                return a[0] * b[1] - a[1] * b[0];
+            return a[0] * (b[1] * c[2] - b[2] * c[1]) + a[1] * (b[2] * c[0] - b[0] * c[2]) +
+                   a[2] * (b[0] * c[1] - b[1] * c[0]);
+        }
     }
     // \endcond
 
@@ -42,10 +60,14 @@ namespace easy3d {
         cell_to_v_ = nullptr;
         cell_to_cell_ = nullptr;
         is_locked_ = false;
+        kdtree_ = nullptr;
+        kdtree_once_.reset(new std::once_flag);
     }
 
 
-    Delaunay::~Delaunay() = default;
+    Delaunay::~Delaunay() {
+        delete kdtree_;
+    }
 
 
     void Delaunay::set_vertices(unsigned int nb_vertices, const float *vertices) {
@@ -61,6 +83,13 @@ namespace easy3d {
         nb_cells_ = nb_cells;
         cell_to_v_ = cell_to_v;
         cell_to_cell_ = cell_to_cell;
+
+        // the kd-tree will be rebuilt for the new vertices on the next query
+        delete kdtree_;
+        kdtree_ = nullptr;
+        std::vector<vec3>().swap(kdtree_points_);
+        kdtree_once_.reset(new std::once_flag);
+
         if (cell_to_cell != nullptr) {
             update_v_to_cell();
             update_cicl();
@@ -71,22 +100,149 @@ namespace easy3d {
     }
 
 
+    const KdTreeSearch *Delaunay::kdtree() const {
+        std::call_once(*kdtree_once_, [this]() {
+            kdtree_points_.resize(nb_vertices());
+            for (unsigned int i = 0; i < nb_vertices(); ++i) {
+                const float *p = vertex_ptr(i);
+                kdtree_points_[i] = vec3(p[0], p[1], dimension() > 2 ? p[2] : 0.0f);
+            }
+            kdtree_ = new KdTreeSearch_NanoFLANN(kdtree_points_);
+        });
+        return kdtree_;
+    }
+
+
     unsigned int Delaunay::nearest_vertex(const float *p) const {
-        // Inefficient implementation (but at least it works).
-        std::cerr << "TODO: replace with line walk (or maybe we could use kd-tree here)" << std::endl;
         assert(nb_vertices() > 0);
-        unsigned int result = 0;
-        float d = internal::squared_distance(dimension(), vertex_ptr(0), p);
-        for (unsigned int i = 1; i < nb_vertices(); i++) {
-            float cur_d = internal::squared_distance(dimension(), vertex_ptr(i), p);
-            if (cur_d < d) {
-                d = cur_d;
-                result = i;
+        const vec3 q(p[0], p[1], dimension() > 2 ? p[2] : 0.0f);
+        return static_cast<unsigned int>(kdtree()->find_closest_point(q));
+    }
+
+
+    void Delaunay::nearest_vertices(unsigned int nb_points, const float *points,
+                                    std::vector<unsigned int> &vertices) const {
+        vertices.resize(nb_points);
+        if (nb_points == 0 || nb_vertices() == 0)
+            return;
+        const KdTreeSearch *tree = kdtree();
+        parallel::for_each(0, nb_points, [&](std::size_t i) {
+            const float *p = points + i * dimension();
+            const vec3 q(p[0], p[1], dimension() > 2 ? p[2] : 0.0f);
+            vertices[i] = static_cast<unsigned int>(tree->find_closest_point(q));
+        });
+    }
+
+
+    int Delaunay::locate(const float *p, int hint) const {
+        if (nb_cells() == 0 || cell_to_cell_ == nullptr)
+            return -1;
+
+        int c = hint;
+        if (c < 0 || c >= static_cast<int>(nb_cells())) {
+            const int v = v_to_cell_[nearest_vertex(p)];
+            c = (v >= 0) ? v : 0;   // a duplicated vertex has no incident cell
+        }
+
+        const float *pts[4];
+        unsigned int random = 2463534242u;  // a xorshift generator to randomize the order of the facets
+        int previous = -1;
+        // a walk in a Delaunay triangulation always terminates, the bound is only a safeguard for degenerate input
+        for (unsigned int step = 0; step < nb_cells(); ++step) {
+            for (unsigned int lv = 0; lv < cell_size(); ++lv)
+                pts[lv] = vertex_ptr(cell_vertex(c, lv));
+            const double sign = internal::orientation(dimension(), pts);
+
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            const unsigned int start = random % cell_size();
+
+            int next = -1;
+            bool outside = false;
+            for (unsigned int k = 0; k < cell_size(); ++k) {
+                const unsigned int lf = (start + k) % cell_size();
+                const int neighbor = cell_adjacent(c, lf);
+                if (neighbor == previous && previous >= 0)
+                    continue;   // never go back through the facet we came from
+                // p is beyond the facet opposite to vertex lf if replacing lf by p flips the orientation
+                const float *q = pts[lf];
+                pts[lf] = p;
+                const double o = internal::orientation(dimension(), pts);
+                pts[lf] = q;
+                if (o * sign < 0) {
+                    if (neighbor < 0)
+                        outside = true;
+                    else {
+                        next = neighbor;
+                        break;
+                    }
+                }
             }
+            if (next < 0)
+                return outside ? -1 : c;
+            previous = c;
+            c = next;
         }
-        return result;
+
+        // the walk didn't terminate
+        return locate_exhaustively(p);
+    }
+
+
+    int Delaunay::locate_exhaustively(const float *p) const {
+        // p is in a cell if it is not beyond any of its facets
+        const float *pts[4];
+        for (unsigned int cell = 0; cell < nb_cells(); ++cell) {
+            for (unsigned int lv = 0; lv < cell_size(); ++lv)
+                pts[lv] = vertex_ptr(cell_vertex(cell, lv));
+            const double sign = internal::orientation(dimension(), pts);
+            if (sign == 0)
+                continue;   // a flat cell
+            bool inside = true;
+            for (unsigned int lf = 0; inside && lf < cell_size(); ++lf) {
+                const float *q = pts[lf];
+                pts[lf] = p;
+                inside = (internal::orientation(dimension(), pts) * sign >= 0);
+                pts[lf] = q;
+            }
+            if (inside)
+                return static_cast<int>(cell);
+        }
+        return -1;
     }
 
+
+    void Delaunay::locate(unsigned int nb_points, const float *points, std::vector<int> &cells) const {
+        cells.resize(nb_points);
+        if (nb_points == 0)
+            return;
+        parallel::for_each_range(0, nb_points, [&](std::size_t begin, std::size_t end) {
+            int hint = -1;
+            float hint_size = 0.0f;  // the squared length of the longest edge of the hint cell
+            const float *previous = nullptr;
+            for (std::size_t i = begin; i < end; ++i) {
+                const float *p = points + i * dimension();
+                // walk from the cell of the previous point only if it is close, otherwise seed from the kd-tree
+                const bool coherent = previous && internal::squared_distance(dimension(), p, previous) < 16.0f * hint_size;
+                cells[i] = locate(p, coherent ? hint : -1);
+                if (cells[i] >= 0) {
+                    hint = cells[i];
+                    hint_size = 0.0f;
+                    for (unsigned int a = 0; a < cell_size(); ++a) {
+                        for (unsigned int b = a + 1; b < cell_size(); ++b) {
+                            const float d = internal::squared_distance(dimension(), vertex_ptr(cell_vertex(hint, a)),
+                                                                       vertex_ptr(cell_vertex(hint, b)));
+                            hint_size = std::max(hint_size, d);
+                        }
+                    }
+                    previous = p;
+                }
+            }
+        });
+    }
+
+
     void Delaunay::get_neighbors(unsigned int v, std::vector<unsigned int> &neighbors) const {
         assert(v < nb_vertices());
         if (neighbors_.empty()) {
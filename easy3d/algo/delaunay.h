@@ -12,12 +12,17 @@
 #define EASY3D_ALGO_DELAUNAY_H
 
 #include <cassert>
+#include <vector>
+#include <memory>
+#include <mutex>
 
 #include <easy3d/core/types.h>
 
 
 namespace easy3d {
 
+    class KdTreeSearch;
+
     /// \brief Base class for Delaunay triangulation.
     /// \class Delaunay easy3d/algo/delaunay.h
     /// \see Delaunay2D, Delaunay3D.
@@ -59,8 +64,51 @@ namespace easy3d {
 
         const int *cell_to_cell() const { return cell_to_cell_; }
 
+        /**
+         * \brief Returns the index of the vertex nearest to the point \p p.
+         * \details The query uses a kd-tree of the vertices, which is built on the first query. It is thread-safe.
+         */
         virtual unsigned int nearest_vertex(const float *p) const;
 
+        /**
+         * \brief Queries the nearest vertex of each point (in parallel).
+         * \param nb_points The number of query points.
+         * \param points The coordinates of the query points (dimension() floats per point).
+         * \param vertices Returns the index of the nearest vertex of each point.
+         */
+        void nearest_vertices(unsigned int nb_points, const float *points, std::vector<unsigned int> &vertices) const;
+
+        /**
+         * \brief Locates the cell containing the point \p p.
+         * \details The cell is found by a remembering stochastic walk: starting from the \p hint cell, the walk moves
+         *      to a neighbor cell through a facet separating the cell from \p p, testing the facets in a random order
+         *      and never going back through the facet it came from. Without a valid hint, the walk starts from a cell
+         *      incident to the nearest vertex given by the kd-tree, so only a few steps are needed. If the walk doesn't
+         *      terminate within nb_cells() steps (which can only happen with degenerate input), it falls back to
+         *      locate_exhaustively(). It is thread-safe.
+         * \param p The query point.
+         * \param hint The cell from which the walk starts, e.g., the cell of a nearby query point.
+         * \return The index of the cell containing \p p, or -1 if \p p is outside the convex hull of the vertices.
+         */
+        int locate(const float *p, int hint = -1) const;
+
+        /**
+         * \brief Locates the cell containing the point \p p by testing all the cells, i.e., in O(nb_cells()) time.
+         * \details This is the fallback of locate() for degenerate input. Flat cells are skipped. It is thread-safe.
+         * \return The index of the cell containing \p p, or -1 if \p p is outside the convex hull of the vertices.
+         */
+        int locate_exhaustively(const float *p) const;
+
+        /**
+         * \brief Locates the cells containing the points (in parallel).
+         * \details Consecutive points are located by walks starting from the cell of the previous point, so spatially
+         *      coherent queries (e.g., the samples of a grid) are very cheap.
+         * \param nb_points The number of query points.
+         * \param points The coordinates of the query points (dimension() floats per point).
+         * \param cells Returns the cell containing each point (-1 for the points outside the convex hull).
+         */
+        void locate(unsigned int nb_points, const float *points, std::vector<int> &cells) const;
+
         /// \brief Returns the index of the \p lv_th vertex in the \p c_th cell.
         int cell_vertex(unsigned int c, unsigned int lv) const {
             assert(c < nb_cells());
@@ -157,6 +205,15 @@ namespace easy3d {
         std::vector<int> cicl_;
         std::vector <std::vector<unsigned int>> neighbors_;
         bool is_locked_;
+
+    private:
+        // builds the kd-tree of the vertices (only once until the triangulation changes)
+        const KdTreeSearch *kdtree() const;
+
+        // the kd-tree of the vertices for nearest vertex queries, built on demand
+        mutable KdTreeSearch *kdtree_;
+        mutable std::vector<vec3> kdtree_points_;
+        std::unique_ptr<std::once_flag> kdtree_once_;
     };
 
 }   // namespace easy3d
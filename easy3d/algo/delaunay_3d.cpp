@@ -48,8 +48,10 @@ namespace easy3d {
             tetgenbehavior tetgen_args_;
             // Q: quiet
             // n: output tet neighbors
+            // J: keep the duplicated vertices, so the tets index the input vertices (a duplicated vertex is not
+            //    used by any tet)
             // V: verbose
-            tetgen_args_.parse_commandline((char *) ("Qn"));
+            tetgen_args_.parse_commandline((char *) ("QnJ"));
             ::tetrahedralize(&tetgen_args_, tetgen_in_, tetgen_out_);
         } catch (const std::exception& e) {
             LOG(ERROR) << "encountered a problem: " << e.what();
@@ -64,6 +64,29 @@ namespace easy3d {
             return nearest_vertex(p.data());
         }
 
+        using Delaunay::nearest_vertices;
+
+        /// \brief Queries the nearest vertex of each point (in parallel).
+        void nearest_vertices(const std::vector<vec3> &points, std::vector<unsigned int> &vertices) const {
+            const float *data = points.empty() ? nullptr : points[0].data();
+            nearest_vertices(static_cast<unsigned int>(points.size()), data, vertices);
+        }
+
+        using Delaunay::locate;
+
+        /// \brief Locates the tetrahedron containing the point \p p (-1 if outside the convex hull).
+        /// \sa Delaunay::locate().
+        int locate(const vec3 &p, int hint = -1) const {
+            return locate(p.data(), hint);
+        }
+
+        /// \brief Locates the tetrahedra containing the points (in parallel).
+        /// \sa Delaunay::locate().
+        void locate(const std::vector<vec3> &points, std::vector<int> &cells) const {
+            const float *data = points.empty() ? nullptr : points[0].data();
+            locate(static_cast<unsigned int>(points.size()), data, cells);
+        }
+
         const vec3 &vertex(unsigned int i) const {
             return *(const vec3 *) vertex_ptr(i);
         }
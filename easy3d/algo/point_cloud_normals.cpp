@@ -25,11 +25,15 @@
  ********************************************************************/
 
 #include <easy3d/algo/point_cloud_normals.h>
+
+#include <algorithm>
+
 #include <easy3d/core/point_cloud.h>
 #include <easy3d/core/principal_axes.h>
 #include <easy3d/kdtree/kdtree_search_nanoflann.h>
 
 #include <easy3d/util/stop_watch.h>
+#include <easy3d/util/parallel.h>
 
 
 #ifdef HAS_BOOST
@@ -64,7 +68,7 @@ namespace easy3d {
         KdTreeSearch_NanoFLANN kdtree(cloud);
         LOG(INFO) << "done. " << w.time_string();
 
-        int num = static_cast<int>(cloud->n_vertices());
+        const std::size_t num = cloud->n_vertices();
         const std::vector<vec3> &points = cloud->points();
         std::vector<vec3> &normals = cloud->vertex_property<vec3>("v:normal").vector();
 
@@ -75,26 +79,33 @@ namespace easy3d {
         w.restart();
         LOG(INFO) << "estimating normals...";
 
-#pragma omp parallel for
-        for (int i = 0; i < num; ++i) {
-            const vec3 &p = points[i];
-            std::vector<int> neighbors;
-            kdtree.find_closest_k_points(p, static_cast<int>(k), neighbors);
-
-            PrincipalAxes<3> pca;
-            pca.begin();
-            for (auto idx : neighbors)
-                pca.add(points[idx]);
-            pca.end();
-
-            // the eigen vector corresponding to the smallest eigen value
-            normals[i] = pca.axis<float>(2);
-            if (normals[i].z < 0) // almost have positive Z
-                normals[i] = -normals[i];
-
-            if (compute_curvature)
-                (*curvatures)[i] = float(
-                        pca.eigen_value(2) / (pca.eigen_value(0) + pca.eigen_value(1) + pca.eigen_value(2)));
+        // the neighbors are queried (in parallel) block by block to bound the memory used for the results
+        const std::size_t block_size = 65536;
+        std::vector<vec3> queries;
+        KdTreeSearch::Neighbors neighbors;
+        for (std::size_t block = 0; block < num; block += block_size) {
+            const std::size_t block_end = std::min(block + block_size, num);
+            queries.assign(points.begin() + block, points.begin() + block_end);
+            kdtree.find_closest_k_points(queries, static_cast<int>(k), neighbors);
+
+            parallel::for_each(0, queries.size(), [&](std::size_t q) {
+                PrincipalAxes<3> pca;
+                pca.begin();
+                const int *indices = neighbors.indices_of(q);
+                for (std::size_t j = 0; j < neighbors.count(q); ++j)
+                    pca.add(points[indices[j]]);
+                pca.end();
+
+                // the eigen vector corresponding to the smallest eigen value
+                const std::size_t i = block + q;
+                normals[i] = pca.axis<float>(2);
+                if (normals[i].z < 0) // almost have positive Z
+                    normals[i] = -normals[i];
+
+                if (compute_curvature)
+                    (*curvatures)[i] = float(
+                            pca.eigen_value(2) / (pca.eigen_value(0) + pca.eigen_value(1) + pca.eigen_value(2)));
+            });
         }
 
         LOG(INFO) << "done. " << w.time_string();
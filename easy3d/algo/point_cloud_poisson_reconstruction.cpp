@@ -27,11 +27,14 @@
 #include <easy3d/algo/point_cloud_poisson_reconstruction.h>
 
 #include <algorithm>
+#include <mutex>
 
 #include <easy3d/core/surface_mesh.h>
+#include <easy3d/core/surface_mesh_builder.h>
 #include <easy3d/core/point_cloud.h>
 #include <easy3d/util/file_system.h>
 #include <easy3d/util/stop_watch.h>
+#include <easy3d/util/parallel.h>
 
 #include <3rd_party/poisson/MyTime.h>
 #include <3rd_party/poisson/MemoryUsage.h>
@@ -110,74 +113,182 @@ namespace easy3d {
     // \cond
     namespace internal {
 
+        /**
+         * An in-memory sink for the output of the marching cubes. The out-of-core vertices and the polygons are stored
+         * in fixed-size chunks (so no reallocation copies the data collected so far) instead of the temporary files
+         * used by CoredFileMeshData. The polygons are kept as flat index arrays, such that the connectivity of the
+         * surface mesh can be built in bulk.
+         */
+        template<class Vertex>
+        class ChunkedMeshData : public CoredMeshData<Vertex> {
+        public:
+            ChunkedMeshData() : num_points_(0), num_polygons_(0), point_index_(0), polygon_index_(0), index_offset_(0) {}
+
+            void resetIterator() override { point_index_ = polygon_index_ = index_offset_ = 0; }
+
+            int addOutOfCorePoint(const Vertex &p) override {
+                std::lock_guard<std::mutex> lock(point_mutex_);
+                return add_point(p);
+            }
+
+            int addOutOfCorePoint_s(const Vertex &p) override {
+                std::lock_guard<std::mutex> lock(point_mutex_);
+                return add_point(p);
+            }
+
+            int addPolygon_s(const std::vector<CoredVertexIndex> &vertices) override {
+                std::lock_guard<std::mutex> lock(polygon_mutex_);
+                for (const auto &v : vertices)  // the out-of-core vertices are encoded as negative indices
+                    push_back(indices_, v.inCore ? v.idx : -v.idx - 1);
+                push_back(sizes_, static_cast<int>(vertices.size()));
+                return num_polygons_++;
+            }
+
+            int addPolygon_s(const std::vector<int> &vertices) override {
+                std::lock_guard<std::mutex> lock(polygon_mutex_);
+                for (auto id : vertices)
+                    push_back(indices_, id);
+                push_back(sizes_, static_cast<int>(vertices.size()));
+                return num_polygons_++;
+            }
+
+            int nextOutOfCorePoint(Vertex &p) override {
+                if (point_index_ >= num_points_)
+                    return 0;
+                p = points_[point_index_ / chunk_size][point_index_ % chunk_size];
+                ++point_index_;
+                return 1;
+            }
+
+            int nextPolygon(std::vector<CoredVertexIndex> &vertices) override {
+                if (polygon_index_ >= num_polygons_)
+                    return 0;
+                const int size = sizes_[polygon_index_ / chunk_size][polygon_index_ % chunk_size];
+                vertices.resize(size);
+                for (int i = 0; i < size; ++i, ++index_offset_) {
+                    const int id = indices_[index_offset_ / chunk_size][index_offset_ % chunk_size];
+                    vertices[i].idx = id < 0 ? -id - 1 : id;
+                    vertices[i].inCore = id >= 0;
+                }
+                ++polygon_index_;
+                return 1;
+            }
+
+            int outOfCorePointCount() override { return num_points_; }
+
+            int polygonCount() override { return num_polygons_; }
+
+            /// The out-of-core vertices, chunk by chunk.
+            const std::vector<std::vector<Vertex> > &out_of_core_points() const { return points_; }
+
+            /// Moves the polygons into flat arrays and releases the chunks. The out-of-core vertices are numbered after
+            /// the in-core ones.
+            void extract_polygons(std::vector<int> &indices, std::vector<int> &sizes) {
+                const int num_ic_pts = static_cast<int>(this->inCorePoints.size());
+                indices.clear();
+                sizes.clear();
+                sizes.reserve(num_polygons_);
+                for (auto &chunk : sizes_) {
+                    sizes.insert(sizes.end(), chunk.begin(), chunk.end());
+                    std::vector<int>().swap(chunk);
+                }
+                std::size_t num_indices = 0;
+                for (const auto &chunk : indices_)
+                    num_indices += chunk.size();
+                indices.reserve(num_indices);
+                for (auto &chunk : indices_) {
+                    for (auto id : chunk)
+                        indices.push_back(id < 0 ? num_ic_pts - id - 1 : id);
+                    std::vector<int>().swap(chunk);
+                }
+                sizes_.clear();
+                indices_.clear();
+                num_polygons_ = 0;
+            }
+
+        private:
+            static const std::size_t chunk_size = 1 << 16;
+
+            template<typename T>
+            static void push_back(std::vector<std::vector<T> > &chunks, const T &value) {
+                if (chunks.empty() || chunks.back().size() == chunk_size) {
+                    chunks.emplace_back();
+                    chunks.back().reserve(chunk_size);
+                }
+                chunks.back().push_back(value);
+            }
+
+            int add_point(const Vertex &p) {
+                push_back(points_, p);
+                return num_points_++;
+            }
+
+        private:
+            std::vector<std::vector<Vertex> > points_;
+            std::vector<std::vector<int> > indices_;
+            std::vector<std::vector<int> > sizes_;
+            int num_points_;
+            int num_polygons_;
+
+            // for the iterators
+            int point_index_;
+            int polygon_index_;
+            std::size_t index_offset_;
+
+            std::mutex point_mutex_;
+            std::mutex polygon_mutex_;
+        };
+
+
         template<class Vertex>
         SurfaceMesh *
-        convert_to_mesh(CoredFileMeshData<Vertex> &mesh, const XForm4x4<REAL> &iXForm,
+        convert_to_mesh(ChunkedMeshData<Vertex> &mesh, const XForm4x4<REAL> &iXForm,
                         const std::string &density_attr_name,
                         bool has_colors) {
-            std::size_t num_ic_pts = mesh.inCorePoints.size();
-            int num_ooc_pts = mesh.outOfCorePointCount();
-            int num_face = mesh.polygonCount();
+            const std::size_t num_ic_pts = mesh.inCorePoints.size();
+            const std::size_t num_ooc_pts = mesh.outOfCorePointCount();
+            const int num_face = mesh.polygonCount();
             if (num_face <= 0) {
                 LOG(ERROR) << "reconstructed mesh has 0 facet";
                 return nullptr;
             }
 
             auto result = new SurfaceMesh;
+            result->reserve(num_ic_pts + num_ooc_pts, static_cast<unsigned int>(num_face) * 3 / 2, num_face);
             SurfaceMesh::VertexProperty<float> density = result->add_vertex_property<float>(density_attr_name);
             SurfaceMesh::VertexProperty<vec3> color;
             if (has_colors)
                 color = result->add_vertex_property<vec3>("v:color");
 
-            std::vector<SurfaceMesh::Vertex> all_vertices;
+            SurfaceMeshBuilder builder(result);
+            builder.begin_surface();
 
             REAL min_density = FLT_MAX;
             REAL max_density = -FLT_MAX;
-            mesh.resetIterator();
-            for (std::size_t i = 0; i < num_ic_pts; ++i) {
-                const Vertex &v = mesh.inCorePoints[i];
+            auto add_vertex = [&](const Vertex &v) {
                 const Point3D<REAL> &pt = iXForm * v.point;
-                SurfaceMesh::Vertex vv = result->add_vertex(vec3(pt.coords[0], pt.coords[1], pt.coords[2]));
-                all_vertices.push_back(vv);
+                SurfaceMesh::Vertex vv = builder.add_vertex(vec3(pt.coords[0], pt.coords[1], pt.coords[2]));
                 density[vv] = v.value;
                 min_density = std::min(min_density, v.value);
                 max_density = std::max(max_density, v.value);
-
                 if (has_colors) {
                     vec3 c(v.color);
                     color[vv] = c / 255.0f;
                 }
-            }
-
-            for (int i = 0; i < num_ooc_pts; ++i) {
-                Vertex v;
-                mesh.nextOutOfCorePoint(v);
-                const Point3D<REAL> &pt = iXForm * v.point;
-                SurfaceMesh::Vertex vv = result->add_vertex(vec3(pt.coords[0], pt.coords[1], pt.coords[2]));
-                all_vertices.push_back(vv);
-                density[vv] = v.value;
-                min_density = std::min(min_density, v.value);
-                max_density = std::max(max_density, v.value);
+            };
 
-                if (has_colors) {
-                    vec3 c(v.color);
-                    color[vv] = c / 255.0f;
-                }
+            for (const auto &v : mesh.inCorePoints)
+                add_vertex(v);
+            for (const auto &chunk : mesh.out_of_core_points()) {
+                for (const auto &v : chunk)
+                    add_vertex(v);
             }
 
-            for (int i = 0; i < num_face; ++i) {
-                std::vector<CoredVertexIndex> vertices;
-                mesh.nextPolygon(vertices);
-
-                std::vector<SurfaceMesh::Vertex> face_vts;
-                for (auto v : vertices) {
-                    std::size_t id = v.idx;
-                    if (!v.inCore)
-                        id += num_ic_pts;
-                    face_vts.push_back(all_vertices[id]);
-                }
-                result->add_face(face_vts);
-            }
+            // the vertex properties must be ready before the faces are added (non-manifold vertices are copied)
+            std::vector<int> indices, sizes;
+            mesh.extract_polygons(indices, sizes);
+            builder.add_faces(indices, sizes);
+            builder.end_surface(false);
 
             LOG(INFO)
                     << "vertex property \'" << density_attr_name << "\' added with range ["
@@ -397,9 +508,9 @@ namespace easy3d {
             }
         }
 
-        // 	CoredFileMeshData< PlyVertex< Real > > mesh;		// no depth recorded, so can not trim
-        // 	CoredFileMeshData< PlyColorVertex< Real > > mesh;	// no depth, but has color
-        CoredFileMeshData<PlyColorAndValueVertex<REAL> > mesh;
+        // The extracted iso-surface is collected in memory (instead of being spilled to temporary files) and then
+        // converted into a surface mesh in bulk. The vertices carry the density values (for trimming) and colors.
+        internal::ChunkedMeshData<PlyColorAndValueVertex<REAL> > mesh;
         {
             t.restart();
             profiler.start();
@@ -570,4 +681,275 @@ namespace easy3d {
         return trimmed_mesh;
     }
 
+
+
+    // -----------------------------------------------------------------------------------------------------------------
+
+
+    PoissonTrimmer::PoissonTrimmer(SurfaceMesh *mesh, const std::string &density_attr_name, int smooth_iterations)
+            : mesh_(mesh), density_attr_name_(density_attr_name), min_density_(0), max_density_(0), total_area_(0) {
+        if (!mesh || mesh->n_faces() == 0) {
+            LOG(ERROR) << "empty mesh";
+            return;
+        }
+        if (mesh->has_garbage()) {
+            LOG(ERROR) << "the mesh has garbage (call collect_garbage() first)";
+            return;
+        }
+        auto density = mesh->get_vertex_property<float>(density_attr_name);
+        if (!density) {
+            LOG(ERROR) << "density is not available";
+            return;
+        }
+
+        // smooth the density values (the same as the surface trimmer)
+        std::vector<float> values(density.vector().begin(), density.vector().end());
+        std::vector<float> smoothed(values.size());
+        for (int iter = 0; iter < smooth_iterations; ++iter) {
+            parallel::for_each(0, mesh->vertices_size(), [&](std::size_t i) {
+                const SurfaceMesh::Vertex v(static_cast<int>(i));
+                float sum = values[i];
+                int count = 1;
+                for (auto h : mesh->halfedges(v)) {
+                    const float value = values[mesh->target(h).idx()];
+                    // each polygon edge contributes once (the smoothing of the trimmer is per polygon)
+                    if (!mesh->is_border(h))
+                        sum += value, ++count;
+                    if (!mesh->is_border(mesh->opposite(h)))
+                        sum += value, ++count;
+                }
+                smoothed[i] = sum / static_cast<float>(count);
+            });
+            values.swap(smoothed);
+        }
+        const auto range = std::minmax_element(values.begin(), values.end());
+        min_density_ = *range.first;
+        max_density_ = *range.second;
+
+        // the key and area of each face
+        const std::size_t num_faces = mesh->faces_size();
+        std::vector<float> face_keys(num_faces);
+        face_areas_.resize(num_faces);
+        parallel::for_each(0, num_faces, [&](std::size_t i) {
+            const SurfaceMesh::Face f(static_cast<int>(i));
+            float key = FLT_MAX;
+            vec3 center(0, 0, 0);
+            int n = 0;
+            for (auto v : mesh->vertices(f)) {
+                key = std::min(key, values[v.idx()]);
+                center += mesh->position(v);
+                ++n;
+            }
+            center /= static_cast<float>(n);
+            float area = 0.0f;
+            for (auto h : mesh->halfedges(f)) {
+                const vec3 &a = mesh->position(mesh->source(h));
+                const vec3 &b = mesh->position(mesh->target(h));
+                area += 0.5f * length(cross(a - center, b - center));
+            }
+            face_keys[i] = key;
+            face_areas_[i] = area;
+        });
+        total_area_ = parallel::reduce(0, num_faces, 0.0f, [&](std::size_t begin, std::size_t end) {
+            float sum = 0.0f;
+            for (std::size_t i = begin; i < end; ++i)
+                sum += face_areas_[i];
+            return sum;
+        }, std::plus<float>());
+
+        // order the faces by their keys
+        faces_.resize(num_faces);
+        for (std::size_t i = 0; i < num_faces; ++i)
+            faces_[i] = static_cast<int>(i);
+        std::stable_sort(faces_.begin(), faces_.end(), [&](int a, int b) { return face_keys[a] > face_keys[b]; });
+        keys_.resize(num_faces);
+        for (std::size_t i = 0; i < num_faces; ++i)
+            keys_[i] = face_keys[faces_[i]];
+
+        // the kept faces grow as the trim value decreases, and the trimmed faces grow as it increases
+        build(faces_, face_keys, kept_tree_);
+        build(std::vector<int>(faces_.rbegin(), faces_.rend()), face_keys, trimmed_tree_);
+
+        // the roots of the (complete) tree of the kept faces are the connected components of the mesh
+        const std::size_t num_nodes = kept_tree_.parent.size();
+        std::vector<int> roots(num_nodes);
+        for (std::size_t i = num_nodes; i-- > 0;) {
+            const int p = kept_tree_.parent[i];
+            roots[i] = (p < 0) ? static_cast<int>(i) : roots[p];
+        }
+        component_sizes_.resize(num_faces);
+        for (std::size_t i = 0; i < num_faces; ++i)
+            component_sizes_[i] = kept_tree_.count[roots[kept_tree_.leaf[i]]];
+    }
+
+
+    void PoissonTrimmer::build(const std::vector<int> &order, const std::vector<float> &face_keys,
+                               MergeTree &tree) const {
+        const std::size_t num_faces = order.size();
+        tree.time.reserve(num_faces * 2);
+        tree.parent.reserve(num_faces * 2);
+        tree.area.reserve(num_faces * 2);
+        tree.count.reserve(num_faces * 2);
+        tree.leaf.assign(num_faces, -1);
+
+        auto add_node = [&](float time, float area, int count) -> int {
+            tree.time.push_back(time);
+            tree.parent.push_back(-1);
+            tree.area.push_back(area);
+            tree.count.push_back(count);
+            return static_cast<int>(tree.time.size()) - 1;
+        };
+
+        // a union-find of the added faces, and the current top node of the component rooted at each face
+        std::vector<int> set(num_faces, -1);
+        std::vector<int> top(num_faces, -1);
+        auto find = [&set](int f) -> int {
+            while (set[f] != f) {
+                set[f] = set[set[f]];
+                f = set[f];
+            }
+            return f;
+        };
+
+        for (auto f : order) {
+            const float key = face_keys[f];
+            tree.leaf[f] = top[f] = add_node(key, face_areas_[f], 1);
+            set[f] = f;
+            for (auto h : mesh_->halfedges(SurfaceMesh::Face(f))) {
+                const SurfaceMesh::Face g = mesh_->face(mesh_->opposite(h));
+                if (!g.is_valid() || set[g.idx()] < 0)
+                    continue;
+                const int rf = find(f), rg = find(g.idx());
+                if (rf == rg)
+                    continue;
+                const int a = top[rf], b = top[rg];
+                const int node = add_node(key, tree.area[a] + tree.area[b], tree.count[a] + tree.count[b]);
+                tree.parent[a] = tree.parent[b] = node;
+                set[rg] = rf;
+                top[rf] = node;
+            }
+        }
+    }
+
+
+    void PoissonTrimmer::mark_small_islands(const MergeTree &tree, std::size_t num_nodes, float min_area,
+                                            const int *faces, std::size_t num_faces, bool value,
+                                            std::vector<bool> &keep) const {
+        // the root of each node among the existing nodes (a parent always comes after its children)
+        std::vector<int> roots(num_nodes);
+        for (std::size_t i = num_nodes; i-- > 0;) {
+            const int p = tree.parent[i];
+            roots[i] = (p < 0 || p >= static_cast<int>(num_nodes)) ? static_cast<int>(i) : roots[p];
+        }
+        for (std::size_t i = 0; i < num_faces; ++i) {
+            const int f = faces[i];
+            const int root = roots[tree.leaf[f]];
+            if (tree.area[root] < min_area && tree.count[root] < component_sizes_[f])
+                keep[f] = value;
+        }
+    }
+
+
+    std::size_t PoissonTrimmer::num_faces_above(float trim_value) const {
+        return std::partition_point(keys_.begin(), keys_.end(), [trim_value](float key) {
+            return key >= trim_value;
+        }) - keys_.begin();
+    }
+
+
+    std::size_t PoissonTrimmer::mask(float trim_value, float area_ratio, std::vector<bool> &keep) const {
+        keep.assign(faces_.size(), false);
+        if (!is_valid())
+            return 0;
+
+        const std::size_t num_kept = num_faces_above(trim_value);
+        for (std::size_t i = 0; i < num_kept; ++i)
+            keep[faces_[i]] = true;
+
+        if (area_ratio > 0) {
+            const float min_area = total_area_ * area_ratio;
+            // remove the small islands of the kept faces
+            const std::size_t num_kept_nodes = std::partition_point(
+                    kept_tree_.time.begin(), kept_tree_.time.end(), [trim_value](float t) { return t >= trim_value; }
+            ) - kept_tree_.time.begin();
+            mark_small_islands(kept_tree_, num_kept_nodes, min_area, faces_.data(), num_kept, false, keep);
+            // fill the small holes (i.e., the small islands of the trimmed faces)
+            const std::size_t num_trimmed_nodes = std::partition_point(
+                    trimmed_tree_.time.begin(), trimmed_tree_.time.end(), [trim_value](float t) { return t < trim_value; }
+            ) - trimmed_tree_.time.begin();
+            mark_small_islands(trimmed_tree_, num_trimmed_nodes, min_area, faces_.data() + num_kept,
+                               faces_.size() - num_kept, true, keep);
+        }
+
+        return static_cast<std::size_t>(std::count(keep.begin(), keep.end(), true));
+    }
+
+
+    std::size_t PoissonTrimmer::apply(float trim_value, float area_ratio, const std::string &mask_name) {
+        std::vector<bool> keep;
+        const std::size_t num = mask(trim_value, area_ratio, keep);
+        if (!is_valid())
+            return 0;
+
+        auto trimmed = mesh_->face_property<bool>(mask_name);
+        for (auto f : mesh_->faces())
+            trimmed[f] = !keep[f.idx()];
+        return num;
+    }
+
+
+    SurfaceMesh *PoissonTrimmer::extract(float trim_value, float area_ratio) const {
+        std::vector<bool> keep;
+        if (mask(trim_value, area_ratio, keep) == 0) {
+            LOG(ERROR) << "all faces have been trimmed";
+            return nullptr;
+        }
+
+        auto density = mesh_->get_vertex_property<float>(density_attr_name_);
+        auto color = mesh_->get_vertex_property<vec3>("v:color");
+
+        auto result = new SurfaceMesh;
+        auto new_density = result->add_vertex_property<float>(density_attr_name_);
+        SurfaceMesh::VertexProperty<vec3> new_color;
+        if (color)
+            new_color = result->add_vertex_property<vec3>("v:color");
+
+        SurfaceMeshBuilder builder(result);
+        builder.begin_surface();
+
+        // the vertices of the kept faces, in their original order
+        std::vector<int> vertex_map(mesh_->vertices_size(), -1);
+        for (auto f : mesh_->faces()) {
+            if (keep[f.idx()]) {
+                for (auto v : mesh_->vertices(f))
+                    vertex_map[v.idx()] = 0;
+            }
+        }
+        for (auto v : mesh_->vertices()) {
+            if (vertex_map[v.idx()] < 0)
+                continue;
+            const SurfaceMesh::Vertex vv = builder.add_vertex(mesh_->position(v));
+            vertex_map[v.idx()] = vv.idx();
+            new_density[vv] = density[v];
+            if (color)
+                new_color[vv] = color[v];
+        }
+
+        std::vector<int> indices, sizes;
+        for (auto f : mesh_->faces()) {
+            if (!keep[f.idx()])
+                continue;
+            int size = 0;
+            for (auto v : mesh_->vertices(f)) {
+                indices.push_back(vertex_map[v.idx()]);
+                ++size;
+            }
+            sizes.push_back(size);
+        }
+        builder.add_faces(indices, sizes);
+        builder.end_surface(false);
+
+        return result;
+    }
+
 } // namespace easy3d
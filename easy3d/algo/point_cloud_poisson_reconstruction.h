@@ -29,6 +29,7 @@
 
 
 #include <string>
+#include <vector>
 
 
 namespace easy3d {
@@ -64,7 +65,11 @@ namespace easy3d {
         /// \brief reconstruction
         SurfaceMesh *apply(const PointCloud *cloud, const std::string &density_attr_name = "v:density") const;
 
-        /// \brief Trim the reconstructed surface model based on the density attribute.
+        /**
+         * \brief Trim the reconstructed surface model based on the density attribute.
+         * \details The polygons are split along the iso-contour of the trim value, so each call rebuilds the mesh. To
+         *      explore different trim values interactively, use PoissonTrimmer instead.
+         */
         static SurfaceMesh *trim(
                 SurfaceMesh *mesh,
                 const std::string &density_attr_name,
@@ -127,6 +132,111 @@ namespace easy3d {
         bool verbose_;
     };
 
+
+    /**
+     * \brief Incremental density-based trimming of a surface reconstructed by PoissonReconstruction.
+     * \class PoissonTrimmer easy3d/algo/point_cloud_poisson_reconstruction.h
+     * \details All the work that does not depend on the trim value is done once in the constructor: the densities are
+     *      smoothed (as in PoissonReconstruction::trim()), the faces are ordered by the minimum density of their
+     *      vertices, and the merging of the connected components as the trim value sweeps the density range is
+     *      recorded in two merge trees (one for the kept faces and one for the trimmed faces). Then trimming with any
+     *      value, including the removal of small islands and the filling of small holes, is a linear pass over the
+     *      faces without any component analysis. Unlike PoissonReconstruction::trim(), whole faces are kept or
+     *      removed (i.e., the faces are not split along the iso-contour of the trim value).
+     *      The mesh must not be modified during the lifetime of the trimmer.
+     * Example use:
+     * \code
+     *      PoissonTrimmer trimmer(mesh);
+     *      // while the user is scrubbing the trim value
+     *      trimmer.apply(trim_value, area_ratio);  // updates the face property "f:trimmed"
+     *      // when the user is satisfied
+     *      SurfaceMesh* result = trimmer.extract(trim_value, area_ratio);
+     * \endcode
+     */
+    class PoissonTrimmer {
+    public:
+        /**
+         * \brief Prepares a mesh for trimming.
+         * \param mesh The surface mesh reconstructed by PoissonReconstruction. It must not have garbage.
+         * \param density_attr_name The name of the vertex property storing the density values.
+         * \param smooth_iterations The number of smoothing iterations applied to the density values.
+         */
+        explicit PoissonTrimmer(SurfaceMesh *mesh, const std::string &density_attr_name = "v:density",
+                                int smooth_iterations = 5);
+
+        /// \brief Returns whether the trimmer has been successfully initialized.
+        bool is_valid() const { return !keys_.empty(); }
+
+        /// \brief The range of the (smoothed) density values.
+        float min_density() const { return min_density_; }
+        float max_density() const { return max_density_; }
+
+        /// \brief Returns the number of faces whose vertices all have a density not smaller than \p trim_value.
+        /// \details This is a binary search (small islands and holes are not considered).
+        std::size_t num_faces_above(float trim_value) const;
+
+        /**
+         * \brief Computes the faces to keep for a trim value.
+         * \param trim_value The faces with a vertex of a density smaller than this value are trimmed.
+         * \param area_ratio The islands (resp. holes) that are smaller than this ratio of the surface area are removed
+         *      (resp. filled). Islands and holes that are entire connected components of the mesh are not changed.
+         * \param keep Returns a flag for each face (indexed by the face index) telling if it is kept.
+         * \return The number of kept faces.
+         */
+        std::size_t mask(float trim_value, float area_ratio, std::vector<bool> &keep) const;
+
+        /**
+         * \brief Computes the faces to keep for a trim value, and stores the result in a face property.
+         * \param mask_name The name of the boolean face property, in which true indicates a trimmed face.
+         * \return The number of kept faces.
+         * \sa mask().
+         */
+        std::size_t apply(float trim_value, float area_ratio, const std::string &mask_name = "f:trimmed");
+
+        /**
+         * \brief Extracts the trimmed surface as a new mesh.
+         * \details The positions, the (original) densities, and the colors of the vertices are copied.
+         * \sa mask().
+         */
+        SurfaceMesh *extract(float trim_value, float area_ratio) const;
+
+    private:
+        // The components of a set of faces as a threshold sweeps the density range, recorded as a merge tree. Each
+        // face is a leaf, and a node is added each time two components merge. Nodes are created in sweep order, so
+        // the nodes that exist at a threshold are a prefix of the nodes, and a parent always comes after its children.
+        struct MergeTree {
+            std::vector<float> time;    // the density value at which a node is created
+            std::vector<int> parent;    // -1 for the roots
+            std::vector<float> area;
+            std::vector<int> count;     // number of faces
+            std::vector<int> leaf;      // the leaf node of each face
+        };
+
+        // Builds the merge tree while adding the faces in the given order (with monotonic keys).
+        void build(const std::vector<int> &order, const std::vector<float> &face_keys, MergeTree &tree) const;
+
+        // Sets 'keep' to 'value' for the faces in [faces, faces + num_faces) that belong to small islands, i.e.,
+        // components (made of the first 'num_nodes' nodes of the tree) that are smaller than 'min_area' and are not
+        // entire connected components of the mesh.
+        void mark_small_islands(const MergeTree &tree, std::size_t num_nodes, float min_area,
+                                const int *faces, std::size_t num_faces, bool value, std::vector<bool> &keep) const;
+
+    private:
+        SurfaceMesh *mesh_;
+        std::string density_attr_name_;
+        float min_density_;
+        float max_density_;
+
+        std::vector<float> keys_;           // the minimum (smoothed) vertex density of each face, sorted (descending)
+        std::vector<int> faces_;            // the faces sorted by their keys (descending)
+        std::vector<float> face_areas_;
+        std::vector<int> component_sizes_;  // the number of faces of the connected component containing each face
+        float total_area_;
+
+        MergeTree kept_tree_;               // the faces added in descending order of their keys
+        MergeTree trimmed_tree_;            // the faces added in ascending order of their keys
+    };
+
 } // namespace easy3d
 
 #endif  // EASY3D_ALGO_POISSON_RECONSTRUCTION_H
@@ -28,10 +28,11 @@
 
 #include <set>
 #include <cassert>
+#include <algorithm>
 
 #include <easy3d/core/point_cloud.h>
 #include <easy3d/util/logging.h>
-#include <easy3d/kdtree/kdtree_search_eth.h>
+#include <easy3d/kdtree/kdtree_search_nanoflann.h>
 
 
 namespace easy3d {
@@ -41,33 +42,40 @@ namespace easy3d {
         KdTreeSearch *kdtree = tree;
         bool need_delete(false);
         if (!kdtree) {
-            kdtree = new KdTreeSearch_ETH(cloud);
+            kdtree = new KdTreeSearch_NanoFLANN(cloud);
             need_delete = true;
         }
 
-        double total = 0.0;
         const std::vector<vec3> &points = cloud->points();
         int num = static_cast<int>(cloud->n_vertices());
 
         int step = 1;
         if (!accurate && num > samples)
             step = num / samples;
+
+        // query the neighbors of all the samples at once
+        std::vector<vec3> queries;
+        queries.reserve(num / step + 1);
+        for (int i = 0; i < num; i += step)
+            queries.push_back(points[i]);
+        KdTreeSearch::Neighbors neighbors;
+        kdtree->find_closest_k_points(queries, k + 1, neighbors);  // k+1 to exclude itself
+
+        double total = 0.0;
         int count = 0;
-        for (int i = 0; i < num; i += step) {
-            const vec3 &p = points[i];
-            std::vector<int> neighbors;
-            std::vector<float> sqr_distances;
-            kdtree->find_closest_k_points(p, k + 1, neighbors, sqr_distances);  // k+1 to exclude itself
-            if (neighbors.size() <= 1) {// in case we get less than k+1 neighbors
+        for (std::size_t i = 0; i < neighbors.size(); ++i) {
+            const std::size_t num_neighbors = neighbors.count(i);
+            if (num_neighbors <= 1) {// in case we get less than k+1 neighbors
                 continue;
             }
 
+            const float *sqr_distances = neighbors.squared_distances_of(i);
             double avg = 0.0;
-            for (unsigned int j = 1; j < sqr_distances.size(); ++j) { // starts from 1 to exclude itself
+            for (std::size_t j = 1; j < num_neighbors; ++j) { // starts from 1 to exclude itself
                 avg += std::sqrt(sqr_distances[j]);
             }
 
-            total += (avg / static_cast<double>(neighbors.size()));
+            total += (avg / static_cast<double>(num_neighbors));
             ++count;
         }
 
@@ -161,24 +169,42 @@ namespace easy3d {
         KdTreeSearch *kdtree = tree;
         bool need_delete(false);
         if (!kdtree) {
-            kdtree = new KdTreeSearch_ETH(cloud);
+            kdtree = new KdTreeSearch_NanoFLANN(cloud);
             need_delete = true;
         }
 
         std::vector<bool> keep(cloud->n_vertices(), true);
         const std::vector<vec3> &points = cloud->points();
 
-        float sqr_dist = epsilon * epsilon;
-        for (std::size_t i = 0; i < points.size(); ++i) {
-            if (keep[i]) {
-                const vec3 &p = points[i];
-                std::vector<int> neighbors;
-                kdtree->find_points_in_range(p, sqr_dist, neighbors);
-                if (neighbors.size() > 1) {
-                    for (std::size_t j = 1; j < neighbors.size(); ++j) {
-                        int idx = neighbors[j];
+        // The points are processed block by block: the neighbors of the points (that are still kept) of a block are
+        // queried at once, and then the points of the block are visited sequentially. This gives exactly the same
+        // result as visiting the points one by one.
+        const std::size_t block_size = 4096;
+        const float sqr_dist = epsilon * epsilon;
+        std::vector<vec3> queries;
+        std::vector<std::size_t> query_points;
+        KdTreeSearch::Neighbors neighbors;
+        for (std::size_t block = 0; block < points.size(); block += block_size) {
+            const std::size_t block_end = std::min(block + block_size, points.size());
+            queries.clear();
+            query_points.clear();
+            for (std::size_t i = block; i < block_end; ++i) {
+                if (keep[i]) {
+                    queries.push_back(points[i]);
+                    query_points.push_back(i);
+                }
+            }
+            kdtree->find_points_in_range(queries, sqr_dist, neighbors);
+
+            for (std::size_t q = 0; q < query_points.size(); ++q) {
+                const std::size_t i = query_points[q];
+                if (!keep[i])   // removed by a point processed earlier in this block
+                    continue;
+                const int *indices = neighbors.indices_of(q);
+                for (std::size_t j = 0; j < neighbors.count(q); ++j) {
+                    const int idx = indices[j];
+                    if (idx != static_cast<int>(i))   // exclude itself
                         keep[idx] = false;
-                    }
                 }
             }
         }
@@ -238,21 +264,22 @@ namespace easy3d {
             if (expected_num >= num)
                 return points_to_delete;    // expected num is greater than / equal to given number.
 
-            KdTreeSearch_ETH kdtree(cloud);
+            KdTreeSearch_NanoFLANN kdtree(cloud);
+            KdTreeSearch::Neighbors neighbors;
+            kdtree.find_closest_k_points(points, 2, neighbors); // one of them is itself
 
             // the average squared distance to its nearest neighbor; smaller value means highter density
             std::vector<float> sqr_distance(cloud->n_vertices());
             std::set<internal::PointPair, internal::LessDistPointPair> point_pairs;
             for (unsigned int i = 0; i < num; ++i) {
-                const vec3 &p = points[i];
-                std::vector<int> neighbors;
-                std::vector<float> sqr_dists;
-                kdtree.find_closest_k_points(p, 2, neighbors, sqr_dists); // the first one is itself
-                if (neighbors.size() == 2) {
-                    sqr_distance[i] = sqr_dists[1];
+                if (neighbors.count(i) == 2) {
+                    const int *indices = neighbors.indices_of(i);
+                    const int j = (indices[0] == static_cast<int>(i)) ? 1 : 0; // for duplicated points
+                    const float sqr_dist = neighbors.squared_distances_of(i)[j];
+                    sqr_distance[i] = sqr_dist;
 
                     // now we get a pair of points
-                    internal::PointPair pair(i, neighbors[1], sqr_dists[1]);
+                    internal::PointPair pair(i, indices[j], sqr_dist);
                     point_pairs.insert(pair);
                 } else {
                     // ignore, no point will not be deleted
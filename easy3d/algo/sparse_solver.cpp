@@ -0,0 +1,202 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/algo/sparse_solver.h>
+
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <algorithm>
+
+
+namespace easy3d {
+
+
+    SparseSolver::SparseSolver() : key_(0), analyzed_(false), factorized_(false) {
+    }
+
+
+    namespace internal {
+
+        // the most recently used solvers, front is the latest
+        struct SolverCache {
+            typedef std::tuple<const SurfaceMesh *, std::string, std::shared_ptr<SparseSolver> > Entry;
+            std::list<Entry> entries;
+            std::mutex mutex;
+            // a handful of meshes x kinds is enough, each entry may hold a large factorization
+            static const std::size_t capacity = 8;
+        };
+
+        SolverCache &solver_cache() {
+            static SolverCache cache;
+            return cache;
+        }
+
+    }
+
+
+    std::shared_ptr<SparseSolver> SparseSolver::shared(const SurfaceMesh *mesh, const std::string &kind) {
+        internal::SolverCache &cache = internal::solver_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (auto it = cache.entries.begin(); it != cache.entries.end(); ++it) {
+            if (std::get<0>(*it) == mesh && std::get<1>(*it) == kind) {
+                cache.entries.splice(cache.entries.begin(), cache.entries, it);
+                return std::get<2>(cache.entries.front());
+            }
+        }
+
+        std::shared_ptr<SparseSolver> solver = std::make_shared<SparseSolver>();
+        cache.entries.emplace_front(mesh, kind, solver);
+        if (cache.entries.size() > internal::SolverCache::capacity)
+            cache.entries.pop_back();
+        return solver;
+    }
+
+
+    void SparseSolver::clear_cache() {
+        internal::SolverCache &cache = internal::solver_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.entries.clear();
+    }
+
+
+    void SparseSolver::clear() {
+        matrix_ = Matrix();
+        slots_.clear();
+        analyzed_ = false;
+        factorized_ = false;
+    }
+
+
+    void SparseSolver::analyze(std::size_t key, int n, const std::vector<Triplet> &triplets) {
+        matrix_.resize(n, n);
+        matrix_.setFromTriplets(triplets.begin(), triplets.end());
+        matrix_.makeCompressed();
+
+        // the row indices within each column are sorted after setFromTriplets()
+        const int *outer = matrix_.outerIndexPtr();
+        const int *inner = matrix_.innerIndexPtr();
+        slots_.resize(triplets.size());
+        for (std::size_t i = 0; i < triplets.size(); ++i) {
+            const Triplet &t = triplets[i];
+            const int *pos = std::lower_bound(inner + outer[t.col()], inner + outer[t.col() + 1], t.row());
+            slots_[i] = static_cast<int>(pos - inner);
+        }
+
+        ldlt_.analyzePattern(matrix_);
+        key_ = key;
+        analyzed_ = (ldlt_.info() == Eigen::Success);
+    }
+
+
+    bool SparseSolver::scatter(const std::vector<Triplet> &triplets) {
+        if (triplets.size() != slots_.size())
+            return false;
+
+        const int *outer = matrix_.outerIndexPtr();
+        const int *inner = matrix_.innerIndexPtr();
+        double *values = matrix_.valuePtr();
+        std::fill(values, values + matrix_.nonZeros(), 0.0);
+        for (std::size_t i = 0; i < triplets.size(); ++i) {
+            const Triplet &t = triplets[i];
+            const int s = slots_[i];
+            if (s < outer[t.col()] || s >= outer[t.col() + 1] || inner[s] != t.row())
+                return false;
+            values[s] += t.value();
+        }
+        return true;
+    }
+
+
+    bool SparseSolver::factorize(std::size_t key, int n, const std::vector<Triplet> &triplets) {
+        factorized_ = false;
+
+        // reuse the pattern if it is still the same, otherwise analyze the new one
+        if (!analyzed_ || key != key_ || n != matrix_.rows() || !scatter(triplets))
+            analyze(key, n, triplets);
+        if (!analyzed_)
+            return false;
+
+        ldlt_.factorize(matrix_);
+        factorized_ = (ldlt_.info() == Eigen::Success);
+        return factorized_;
+    }
+
+
+    bool SparseSolver::solve(const Eigen::MatrixXd &B, Eigen::MatrixXd &X) const {
+        if (!factorized_)
+            return false;
+        X = ldlt_.solve(B);
+        return ldlt_.info() == Eigen::Success;
+    }
+
+
+    bool SparseSolver::solve_cg(const Operator &A, const Eigen::VectorXd &diagonal, const Eigen::MatrixXd &B,
+                                Eigen::MatrixXd &X, double tolerance, int max_iterations) {
+        const Eigen::Index n = B.rows(), m = B.cols();
+        if (X.rows() != n || X.cols() != m)
+            X.setZero(n, m);
+
+        // the Jacobi preconditioner
+        Eigen::VectorXd inv_diagonal(n);
+        for (Eigen::Index i = 0; i < n; ++i)
+            inv_diagonal[i] = (diagonal[i] != 0.0) ? 1.0 / diagonal[i] : 1.0;
+
+        // all the right-hand sides are iterated together (so each iteration needs a single product with A), but
+        // each of them has its own step sizes and stops once it has converged
+        const Eigen::ArrayXd threshold = tolerance * tolerance * B.colwise().squaredNorm().transpose().array();
+        Eigen::MatrixXd R, Z, P, Q;
+        A(X, Q);
+        R = B - Q;
+        Z = inv_diagonal.asDiagonal() * R;
+        P = Z;
+        Eigen::ArrayXd rz = R.cwiseProduct(Z).colwise().sum().transpose().array();
+        Eigen::ArrayXd alpha(m), beta(m);
+
+        for (int iter = 0; iter < max_iterations; ++iter) {
+            const Eigen::ArrayXd residual = R.colwise().squaredNorm().transpose().array();
+            if ((residual <= threshold).all())
+                return true;
+
+            A(P, Q);
+            const Eigen::ArrayXd pq = P.cwiseProduct(Q).colwise().sum().transpose().array();
+            for (Eigen::Index c = 0; c < m; ++c)
+                alpha[c] = (residual[c] > threshold[c] && pq[c] != 0.0) ? rz[c] / pq[c] : 0.0;
+            X += P * alpha.matrix().asDiagonal();
+            R -= Q * alpha.matrix().asDiagonal();
+
+            Z = inv_diagonal.asDiagonal() * R;
+            const Eigen::ArrayXd rz_new = R.cwiseProduct(Z).colwise().sum().transpose().array();
+            for (Eigen::Index c = 0; c < m; ++c)
+                beta[c] = (alpha[c] != 0.0 && rz[c] != 0.0) ? rz_new[c] / rz[c] : 0.0;
+            P = Z + P * beta.matrix().asDiagonal();
+            rz = rz_new;
+        }
+
+        return (R.colwise().squaredNorm().transpose().array() <= threshold).all();
+    }
+
+}
@@ -0,0 +1,146 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_ALGO_SPARSE_SOLVER_H
+#define EASY3D_ALGO_SPARSE_SOLVER_H
+
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+
+#include <Eigen/Sparse>
+
+
+namespace easy3d {
+
+    class SurfaceMesh;
+
+    /**
+     * \brief A sparse linear solver that caches the analysis of the sparsity pattern of the system matrix.
+     * \class SparseSolver easy3d/algo/sparse_solver.h
+     * \details The solver is meant for the linear systems built on the connectivity of a surface mesh (e.g., the
+     *      Laplacian systems of smoothing, fairing, hole filling, and parameterization), which are solved again and
+     *      again with different values but the same sparsity pattern. The matrix is given as triplets together with
+     *      a key identifying its sparsity pattern, typically SurfaceMesh::connectivity_revision(). As long as the
+     *      key does not change, the values of the triplets are scattered directly into the cached pattern and only
+     *      the numeric factorization is redone, i.e., the symbolic analysis (fill-reducing ordering and elimination
+     *      tree) is computed only once.
+     *
+     *      For very large meshes, for which a factorization is too expensive, solve_cg() solves symmetric positive
+     *      definite systems by matrix-free, Jacobi preconditioned conjugate gradients.
+     *
+     *      The algorithms do not own their solvers. They get them from a small cache by shared(), keyed by the mesh
+     *      and the kind of the system, so a factorization survives the algorithm object and is reused by any later
+     *      algorithm solving the same kind of system on the same mesh (with the same connectivity).
+     *
+     *      Example usage:
+     *      \code
+     *          std::shared_ptr<SparseSolver> solver = SparseSolver::shared(mesh, "smoothing");
+     *          ...
+     *          // in each iteration
+     *          if (solver->factorize(mesh->connectivity_revision(), n, triplets))
+     *              solver->solve(B, X);
+     *      \endcode
+     */
+    class SparseSolver {
+    public:
+        typedef Eigen::SparseMatrix<double> Matrix;
+        typedef Eigen::Triplet<double> Triplet;
+
+        //! \brief The product of a (not explicitly stored) matrix with a block of vectors: Y = A * X.
+        typedef std::function<void(const Eigen::MatrixXd &X, Eigen::MatrixXd &Y)> Operator;
+
+    public:
+        SparseSolver();
+
+        //! \brief Returns the solver for the systems of \p kind (e.g., "smoothing", "fairing") built on \p mesh.
+        //! \details The solvers are kept in a process-wide cache of the most recently used ones, so the same solver
+        //!     (and its factorization) is returned as long as it has not been evicted. The cache only keys on the
+        //!     mesh address: the connectivity revision passed to factorize() guards against a different mesh reusing
+        //!     the address. The cache itself is thread-safe, but a returned solver is not, i.e., the same kind of
+        //!     system must not be solved concurrently on the same mesh.
+        static std::shared_ptr<SparseSolver> shared(const SurfaceMesh *mesh, const std::string &kind);
+
+        //! \brief Releases all the cached solvers (the solvers still in use stay valid).
+        static void clear_cache();
+
+        //! \brief Assembles the n x n system matrix from \p triplets (duplicated entries are summed up) and computes
+        //!     its factorization. Only the lower triangular part of the matrix is used, i.e., the matrix is assumed
+        //!     to be symmetric.
+        //! \param key The key identifying the sparsity pattern, e.g., the connectivity revision of the mesh. The
+        //!     pattern is analyzed again only if the key, the size, or the positions of the triplets change.
+        //! \return true on success.
+        bool factorize(std::size_t key, int n, const std::vector<Triplet> &triplets);
+
+        //! \brief Solves A * X = B using the current factorization. Each column of \p B is a right-hand side.
+        //! \return true on success.
+        bool solve(const Eigen::MatrixXd &B, Eigen::MatrixXd &X) const;
+
+        //! \brief The current system matrix.
+        const Matrix &matrix() const { return matrix_; }
+
+        //! \brief Discards the cached pattern and factorization.
+        void clear();
+
+        //! \brief Solves A * X = B by matrix-free, Jacobi preconditioned conjugate gradients. A must be symmetric
+        //!     positive definite.
+        //! \param A Computes the product of the system matrix with the columns of a matrix. All the right-hand sides
+        //!     are iterated together, so it is called once per iteration.
+        //! \param diagonal The diagonal of the system matrix (for the preconditioner).
+        //! \param B The right-hand sides, one per column.
+        //! \param X The solutions. If it has the size of \p B, it is used as the initial guess.
+        //! \param tolerance The relative residual at which the iterations stop.
+        //! \param max_iterations The maximum number of iterations for each right-hand side.
+        //! \return true if all the solutions reached the tolerance.
+        static bool solve_cg(const Operator &A, const Eigen::VectorXd &diagonal, const Eigen::MatrixXd &B,
+                             Eigen::MatrixXd &X, double tolerance = 1e-8, int max_iterations = 1000);
+
+    private:
+        // (re)builds the matrix, its pattern, and the positions of the triplets in its nonzeros
+        void analyze(std::size_t key, int n, const std::vector<Triplet> &triplets);
+
+        // scatters the values of the triplets into the cached pattern. Returns false if the positions of the
+        // triplets do not match the pattern.
+        bool scatter(const std::vector<Triplet> &triplets);
+
+    private:
+        Matrix matrix_;
+        Eigen::SimplicialLDLT<Matrix> ldlt_;
+
+        std::size_t key_;
+        bool analyzed_;
+        bool factorized_;
+
+        // the index of each triplet in the nonzeros of the matrix
+        std::vector<int> slots_;
+    };
+
+}
+
+
+#endif  // EASY3D_ALGO_SPARSE_SOLVER_H
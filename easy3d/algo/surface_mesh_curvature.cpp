@@ -12,6 +12,7 @@
 #include <easy3d/algo/surface_mesh_curvature.h>
 #include <easy3d/algo/surface_mesh_geometry.h>
 #include <easy3d/core/eigen_solver.h>
+#include <easy3d/util/parallel.h>
 
 
 namespace easy3d {
@@ -126,38 +127,35 @@ namespace easy3d {
         auto evec = mesh_->add_edge_property<dvec3>("curv:evec", dvec3(0, 0, 0));
         auto angle = mesh_->add_edge_property<double>("curv:angle", 0.0);
 
-        dvec3 p0, p1, n0, n1, ev;
-        double l, A, beta, a1, a2, a3;
-        dmat3 tensor;
-
-        double eval1, eval2, eval3, kmin, kmax;
-        dvec3 evec1, evec2, evec3;
-
-        std::vector<SurfaceMesh::Vertex> neighborhood;
-        neighborhood.reserve(15);
-
         // precompute Voronoi area per vertex
-        for (auto v : mesh_->vertices()) {
-            area[v] = geom::voronoi_area(mesh_, v);
-        }
+        parallel::for_each(0, mesh_->vertices_size(), [&](std::size_t i) {
+            SurfaceMesh::Vertex v(static_cast<int>(i));
+            if (!mesh_->is_deleted(v))
+                area[v] = geom::voronoi_area(mesh_, v);
+        });
 
         // precompute face normals
-        for (auto f : mesh_->faces()) {
-            normal[f] = (dvec3) mesh_->compute_face_normal(f);
-        }
+        parallel::for_each(0, mesh_->faces_size(), [&](std::size_t i) {
+            SurfaceMesh::Face f(static_cast<int>(i));
+            if (!mesh_->is_deleted(f))
+                normal[f] = (dvec3) mesh_->compute_face_normal(f);
+        });
 
         // precompute dihedralAngle*edge_length*edge per edge
-        for (auto e : mesh_->edges()) {
+        parallel::for_each(0, mesh_->edges_size(), [&](std::size_t i) {
+            SurfaceMesh::Edge e(static_cast<int>(i));
+            if (mesh_->is_deleted(e))
+                return;
             auto h0 = mesh_->halfedge(e, 0);
             auto h1 = mesh_->halfedge(e, 1);
             auto f0 = mesh_->face(h0);
             auto f1 = mesh_->face(h1);
             if (f0.is_valid() && f1.is_valid()) {
-                n0 = normal[f0];
-                n1 = normal[f1];
-                ev = (dvec3) mesh_->position(mesh_->target(h0));
+                const dvec3 &n0 = normal[f0];
+                const dvec3 &n1 = normal[f1];
+                dvec3 ev = (dvec3) mesh_->position(mesh_->target(h0));
                 ev -= (dvec3) mesh_->position(mesh_->target(h1));
-                l = norm(ev);
+                double l = norm(ev);
                 if (l != 0) {   // avoid overflow in case of 0-length edges
                     ev /= l;
                     l *= 0.5; // only consider half of the edge (matching Voronoi area)
@@ -165,101 +163,108 @@ namespace easy3d {
                     evec[e] = std::sqrt(l) * ev;
                 }
             }
-        }
+        });
 
-        // compute curvature tensor for each vertex
-        for (auto v : mesh_->vertices()) {
-            kmin = 0.0;
-            kmax = 0.0;
-
-            if (!mesh_->is_isolated(v)) {
-                // one-ring or two-ring neighborhood?
-                neighborhood.clear();
-                neighborhood.push_back(v);
-                if (two_ring_neighborhood) {
-                    for (auto vv : mesh_->vertices(v))
-                        neighborhood.push_back(vv);
-                }
+        // compute curvature tensor for each vertex (each chunk of vertices has its own work space)
+        parallel::for_each_range(0, mesh_->vertices_size(), [&](std::size_t begin, std::size_t end) {
+            dvec3 ev;
+            double A, beta, a1, a2, a3;
+            dmat3 tensor;
+
+            double eval1, eval2, eval3, kmin, kmax;
+            double rows[3][3];
+            double *matrix[3] = {rows[0], rows[1], rows[2]};
+            EigenSolver<double> solver(3);
+
+            std::vector<SurfaceMesh::Vertex> neighborhood;
+            neighborhood.reserve(15);
+
+            for (std::size_t idx = begin; idx < end; ++idx) {
+                SurfaceMesh::Vertex v(static_cast<int>(idx));
+                if (mesh_->is_deleted(v))
+                    continue;
 
-                A = 0.0;
-                tensor = dmat3(0.0);
-
-                // compute tensor over vertex neighborhood stored in vertices
-                for (auto nit : neighborhood) {
-                    // accumulate tensor from dihedral angles around vertices
-                    for (auto hv : mesh_->halfedges(nit)) {
-                        auto ee = mesh_->edge(hv);
-                        ev = evec[ee];
-                        beta = angle[ee];
-                        for (int i = 0; i < 3; ++i)
-                            for (int j = 0; j < 3; ++j)
-                                tensor(i, j) += beta * ev[i] * ev[j];
+                kmin = 0.0;
+                kmax = 0.0;
+
+                if (!mesh_->is_isolated(v)) {
+                    // one-ring or two-ring neighborhood?
+                    neighborhood.clear();
+                    neighborhood.push_back(v);
+                    if (two_ring_neighborhood) {
+                        for (auto vv : mesh_->vertices(v))
+                            neighborhood.push_back(vv);
                     }
 
-                    // accumulate area
-                    A += area[nit];
-                }
+                    A = 0.0;
+                    tensor = dmat3(0.0);
+
+                    // compute tensor over vertex neighborhood stored in vertices
+                    for (auto nit : neighborhood) {
+                        // accumulate tensor from dihedral angles around vertices
+                        for (auto hv : mesh_->halfedges(nit)) {
+                            auto ee = mesh_->edge(hv);
+                            ev = evec[ee];
+                            beta = angle[ee];
+                            for (int i = 0; i < 3; ++i)
+                                for (int j = 0; j < 3; ++j)
+                                    tensor(i, j) += beta * ev[i] * ev[j];
+                        }
+
+                        // accumulate area
+                        A += area[nit];
+                    }
 
-                // normalize tensor by accumulated
-                if (A != 0)     // avoid overflow in case of 0-area
-                    tensor /= A;
+                    // normalize tensor by accumulated
+                    if (A != 0)     // avoid overflow in case of 0-area
+                        tensor /= A;
 
-                // Liangliang: eigen solver requires FT** as input matrix :-(
-                double **matrix = new double *[3];
-                for (int i = 0; i < 3; ++i) {
-                    matrix[i] = new double[3];
-                    for (int j = 0; j < 3; ++j)
-                        matrix[i][j] = tensor(i, j);
-                }
-                // Eigen-decomposition
-                EigenSolver<double> solver(3);
-                solver.solve(matrix, EigenSolver<double>::DECREASING);
-                eval1 = solver.eigen_value(0);
-                eval2 = solver.eigen_value(1);
-                eval3 = solver.eigen_value(2);
-                for (int i = 0; i < 3; ++i) {
-                    evec1[i] = solver.eigen_vector(i, 0);
-                    evec2[i] = solver.eigen_vector(i, 1);
-                    evec3[i] = solver.eigen_vector(i, 2);
-                }
-                for (int i = 0; i < 3; ++i)
-                    delete[] matrix[i];
-                delete[] matrix;
-
-                // curvature values:
-                //   normal vector -> eval with the smallest absolute value
-                //   evals are sorted in decreasing order
-                a1 = fabs(eval1);
-                a2 = fabs(eval2);
-                a3 = fabs(eval3);
-                if (a1 < a2) {
-                    if (a1 < a3) {
-                        // e1 is normal
-                        kmax = eval2;
-                        kmin = eval3;
-                    } else {
-                        // e3 is normal
-                        kmax = eval1;
-                        kmin = eval2;
+                    // Liangliang: eigen solver requires FT** as input matrix :-(
+                    for (int i = 0; i < 3; ++i) {
+                        for (int j = 0; j < 3; ++j)
+                            matrix[i][j] = tensor(i, j);
                     }
-                } else {
-                    if (a2 < a3) {
-                        // e2 is normal
-                        kmax = eval1;
-                        kmin = eval3;
+                    // Eigen-decomposition
+                    solver.solve(matrix, EigenSolver<double>::DECREASING);
+                    eval1 = solver.eigen_value(0);
+                    eval2 = solver.eigen_value(1);
+                    eval3 = solver.eigen_value(2);
+
+                    // curvature values:
+                    //   normal vector -> eval with the smallest absolute value
+                    //   evals are sorted in decreasing order
+                    a1 = fabs(eval1);
+                    a2 = fabs(eval2);
+                    a3 = fabs(eval3);
+                    if (a1 < a2) {
+                        if (a1 < a3) {
+                            // e1 is normal
+                            kmax = eval2;
+                            kmin = eval3;
+                        } else {
+                            // e3 is normal
+                            kmax = eval1;
+                            kmin = eval2;
+                        }
                     } else {
-                        // e3 is normal
-                        kmax = eval1;
-                        kmin = eval2;
+                        if (a2 < a3) {
+                            // e2 is normal
+                            kmax = eval1;
+                            kmin = eval3;
+                        } else {
+                            // e3 is normal
+                            kmax = eval1;
+                            kmin = eval2;
+                        }
                     }
                 }
-            }
 
-            assert(kmin <= kmax);
+                assert(kmin <= kmax);
 
-            min_curvature_[v] = static_cast<float>(kmin);
-            max_curvature_[v] = static_cast<float>(kmax);
-        }
+                min_curvature_[v] = static_cast<float>(kmin);
+                max_curvature_[v] = static_cast<float>(kmax);
+            }
+        });
 
         // clean-up properties
         mesh_->remove_vertex_property(area);
@@ -15,14 +15,14 @@
 #include <Eigen/Sparse>
 
 #include <easy3d/algo/surface_mesh_geometry.h>
+#include <easy3d/algo/sparse_solver.h>
 #include <easy3d/util/logging.h>
 
 
 namespace easy3d {
 
     // \cond
-    using SparseMatrix = Eigen::SparseMatrix<double>;
-    using Triplet = Eigen::Triplet<double>;
+    using Triplet = SparseSolver::Triplet;
     // \endcond
 
     //=============================================================================
@@ -120,7 +120,6 @@ namespace easy3d {
 
         // construct matrix & rhs
         const unsigned int n = static_cast<unsigned int>(vertices.size());
-        SparseMatrix A(n, n);
         Eigen::MatrixXd B(n, 3);
         dvec3 b;
 
@@ -146,13 +145,11 @@ namespace easy3d {
             B.row(i) = (Eigen::Vector3d) b;
         }
 
-        A.setFromTriplets(triplets.begin(), triplets.end());
-
         // solve A*X = B
-        Eigen::SimplicialLDLT<SparseMatrix> solver(A);
-        Eigen::MatrixXd X = solver.solve(B);
-
-        if (solver.info() != Eigen::Success) {
+        Eigen::MatrixXd X;
+        std::shared_ptr<SparseSolver> solver = SparseSolver::shared(mesh_, "fairing");
+        if (!solver->factorize(mesh_->connectivity_revision(), static_cast<int>(n), triplets) ||
+            !solver->solve(B, X)) {
             LOG(ERROR) << "SurfaceMeshFairing failed to solve the linear system";
         } else {
             for (unsigned int i = 0; i < n; ++i) {
@@ -22,6 +22,8 @@ namespace easy3d {
      * \class SurfaceMeshFairing easy3d/algo/surface_mesh_fairing.h
      * See the following paper for more details:
      *  - Mathieu Desbrun et al. Implicit fairing of irregular meshes using diffusion and curvature flow. SIGGRAPH, 1999.
+     * The sparsity pattern of the linear system is analyzed once and reused by subsequent fairings of the same mesh
+     * (see SparseSolver::shared()) as long as the connectivity and the free vertices do not change.
      */
     class SurfaceMeshFairing {
     public:
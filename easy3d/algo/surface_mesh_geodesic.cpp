@@ -11,16 +11,168 @@
 
 #include <easy3d/algo/surface_mesh_geodesic.h>
 
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#include <Eigen/Sparse>
+
+#include <easy3d/util/parallel.h>
+
 
 namespace easy3d {
 
+    // \cond
+    using SparseMatrix = Eigen::SparseMatrix<double>;
+    using Triplet = Eigen::Triplet<double>;
+    // \endcond
+
+    namespace internal {
+
+        // A priority queue of (distance, vertex index) pairs for the marching front. The entries are distributed
+        // into buckets of a fixed width of distance (the buckets are reused cyclically, and the rare entries beyond
+        // the range of the buckets are kept aside until the front reaches them). Only the entries of the current,
+        // i.e., the lowest, bucket are kept in a binary heap. So the entries are popped in exactly the same order as
+        // from a fully sorted queue, while most pushes cost O(1). Entries are never updated or removed: the caller
+        // pushes a new entry whenever a distance changes and skips the outdated entries when they are popped.
+        class BucketQueue {
+        public:
+            typedef std::pair<float, int> Entry;
+
+            void reset(float width, std::size_t num_buckets) {
+                inv_width_ = 1.0 / width;
+                buckets_.resize(num_buckets);
+                if (size_ > 0) {
+                    for (auto &bucket : buckets_)
+                        bucket.clear();
+                }
+                heap_.clear();
+                overflow_.clear();
+                overflow_min_key_ = DBL_MAX;
+                current_ = 0;
+                size_ = 0;
+            }
+
+            void push(float dist, int v) {
+                const double k = key(dist);
+                if (k <= static_cast<double>(current_)) {
+                    heap_.emplace_back(dist, v);
+                    std::push_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+                } else if (k < static_cast<double>(current_ + buckets_.size())) {
+                    buckets_[static_cast<std::size_t>(k) % buckets_.size()].emplace_back(dist, v);
+                    ++size_;
+                } else {
+                    overflow_.emplace_back(dist, v);
+                    overflow_min_key_ = std::min(overflow_min_key_, k);
+                }
+            }
+
+            // Returns false if the queue is empty.
+            bool pop(Entry &entry) {
+                if (heap_.empty() && !next_bucket())
+                    return false;
+                std::pop_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+                entry = heap_.back();
+                heap_.pop_back();
+                return true;
+            }
+
+        private:
+            double key(float dist) const { return std::floor(dist * inv_width_); }
+
+            // moves the entries of the next non-empty bucket into the heap
+            bool next_bucket() {
+                const std::size_t num = buckets_.size();
+                while (heap_.empty()) {
+                    if (size_ == 0) {
+                        if (overflow_.empty())
+                            return false;
+                        current_ = static_cast<std::size_t>(overflow_min_key_);
+                        redistribute_overflow();
+                        continue;
+                    }
+                    ++current_;
+                    if (!overflow_.empty() && overflow_min_key_ < static_cast<double>(current_ + num))
+                        redistribute_overflow();
+                    std::vector<Entry> &bucket = buckets_[current_ % num];
+                    if (!bucket.empty()) {
+                        size_ -= bucket.size();
+                        heap_.insert(heap_.end(), bucket.begin(), bucket.end());
+                        bucket.clear();
+                        std::make_heap(heap_.begin(), heap_.end(), std::greater<Entry>());
+                    }
+                }
+                return true;
+            }
+
+            void redistribute_overflow() {
+                scratch_.swap(overflow_);
+                overflow_.clear();
+                overflow_min_key_ = DBL_MAX;
+                for (const auto &entry : scratch_)
+                    push(entry.first, entry.second);
+                scratch_.clear();
+            }
+
+        private:
+            std::vector<std::vector<Entry> > buckets_;
+            std::vector<Entry> heap_;       // the entries of the current bucket
+            std::vector<Entry> overflow_;   // the entries beyond the range of the buckets
+            std::vector<Entry> scratch_;
+            double overflow_min_key_ = DBL_MAX;
+            double inv_width_ = 1.0;
+            std::size_t current_ = 0;       // the key of the current bucket
+            std::size_t size_ = 0;          // the number of entries in the buckets (excluding the heap)
+        };
+
+    }
+
+    //-----------------------------------------------------------------------------
+
+    struct SurfaceMeshGeodesic::Workspace {
+        float *distance = nullptr;              // the output distances
+        std::vector<unsigned char> processed;
+        internal::BucketQueue front;
+        Eigen::VectorXd rhs, solution;          // for the heat method
+    };
+
+    //-----------------------------------------------------------------------------
+
+    struct SurfaceMeshGeodesic::HeatSolver {
+        Eigen::SimplicialLDLT<SparseMatrix> heat;       // the heat flow: M + tL
+        Eigen::SimplicialLDLT<SparseMatrix> poisson;    // the Poisson equation: L + eM
+        std::vector<int> corners;       // the vertex of each corner (three consecutive corners form a triangle)
+        std::vector<double> cotans;     // the cotangent of the angle at each corner
+        std::vector<bool> valid;        // vertices incident to at least one non-degenerate triangle
+    };
+
+    //-----------------------------------------------------------------------------
+
     SurfaceMeshGeodesic::SurfaceMeshGeodesic(SurfaceMesh *mesh, bool use_virtual_edges)
-            : mesh_(mesh), use_virtual_edges_(use_virtual_edges), front_(nullptr) {
+            : mesh_(mesh), use_virtual_edges_(use_virtual_edges), bucket_width_(1.0f), num_buckets_(1) {
         distance_ = mesh_->vertex_property<float>("v:geodesic:distance");
-        processed_ = mesh_->add_vertex_property<bool>("v:geodesic:processed");
 
         if (use_virtual_edges_)
             find_virtual_edges();
+
+        // The front advances by at most the length of the longest (virtual) edge in a single step. Buckets of the
+        // average edge length therefore hold a narrow band of the front each, and the queue needs just enough of
+        // them to cover a step.
+        const SurfaceMesh *cmesh = mesh_;
+        double sum_length(0.0);
+        float max_length(0.0f);
+        for (auto e : cmesh->edges()) {
+            const float length = cmesh->edge_length(e);
+            sum_length += length;
+            max_length = std::max(max_length, length);
+        }
+        for (const auto &ve : virtual_edges_)
+            max_length = std::max(max_length, ve.length);
+
+        if (sum_length > 0.0)
+            bucket_width_ = static_cast<float>(sum_length / cmesh->n_edges());
+        const std::size_t max_num_buckets = 1 << 16;
+        num_buckets_ = std::min(static_cast<std::size_t>(max_length / bucket_width_) + 2, max_num_buckets);
     }
 
     //-----------------------------------------------------------------------------
@@ -30,30 +182,36 @@ namespace easy3d {
     //-----------------------------------------------------------------------------
 
     void SurfaceMeshGeodesic::find_virtual_edges() {
-        SurfaceMesh::Halfedge hh, hhh;
-        SurfaceMesh::Vertex vh0, vh1, vhn, start_vh0, start_vh1;
-        vec3 pp, p0, p1, pn, p, d0, d1;
-        vec3 X, Y;
-        vec2 v0, v1, vn, v, d;
-        float f, alpha, beta, tan_beta;
-
         const float one(1.0), minus_one(-1.0);
         const float max_angle = 90.0 / 180.0 * M_PI;
         const float max_angle_cos = std::cos(max_angle);
 
-        virtual_edges_.clear();
+        const SurfaceMesh *mesh = mesh_;
+        virtual_edges_.assign(mesh->halfedges_size(), VirtualEdge());
+
+        // each vertex only writes the virtual edges of its outgoing halfedges
+        parallel::for_each(0, mesh->vertices_size(), [&](std::size_t idx) {
+            const SurfaceMesh::Vertex vv(static_cast<int>(idx));
+            if (mesh->is_deleted(vv))
+                return;
+
+            SurfaceMesh::Halfedge hh, hhh;
+            SurfaceMesh::Vertex vh0, vh1, vhn, start_vh0, start_vh1;
+            vec3 pp, p0, p1, pn, p, d0, d1;
+            vec3 X, Y;
+            vec2 v0, v1, vn, v, d;
+            float f, alpha, beta, tan_beta;
 
-        for (auto vv : mesh_->vertices()) {
-            pp = mesh_->position(vv);
+            pp = mesh->position(vv);
 
-            for (auto h : mesh_->halfedges(vv)) {
-                if (!mesh_->is_border(h)) {
-                    vh0 = mesh_->target(h);
-                    hh = mesh_->next(h);
-                    vh1 = mesh_->target(hh);
+            for (auto h : mesh->halfedges(vv)) {
+                if (!mesh->is_border(h)) {
+                    vh0 = mesh->target(h);
+                    hh = mesh->next(h);
+                    vh1 = mesh->target(hh);
 
-                    p0 = mesh_->position(vh0);
-                    p1 = mesh_->position(vh1);
+                    p0 = mesh->position(vh0);
+                    p1 = mesh->position(vh1);
                     d0 = normalize(p0 - pp);
                     d1 = normalize(p1 - pp);
 
@@ -79,14 +237,14 @@ namespace easy3d {
 
                         start_vh0 = vh0;
                         start_vh1 = vh1;
-                        hhh = mesh_->opposite(hh);
+                        hhh = mesh->opposite(hh);
 
                         // unfold ...
                         while (((vh0 == start_vh0) || (vh1 == start_vh1)) &&
-                               (!mesh_->is_border(hhh))) {
+                               (!mesh->is_border(hhh))) {
                             // get next point
-                            vhn = mesh_->target(mesh_->next(hhh));
-                            pn = mesh_->position(vhn);
+                            vhn = mesh->target(mesh->next(hhh));
+                            pn = mesh->position(vhn);
                             d0 = (p1 - p0);
                             d1 = (pn - p0);
                             d = (v1 - v0);
@@ -98,35 +256,84 @@ namespace easy3d {
 
                             // point in tolerance?
                             if ((fabs(vn[1]) / fabs(vn[0])) < tan_beta) {
-                                virtual_edges_.insert(
-                                        std::pair<SurfaceMesh::Halfedge, VirtualEdge>(
-                                                h, VirtualEdge(vhn, norm(vn))));
+                                virtual_edges_[h.idx()] = VirtualEdge(vhn, norm(vn));
                                 break;
                             }
 
                             // prepare next edge
                             if (vn[1] > 0.0) {
-                                hh = mesh_->opposite(hh);
-                                hh = mesh_->next(hh);
+                                hh = mesh->opposite(hh);
+                                hh = mesh->next(hh);
                                 vh1 = vhn;
                                 p1 = pn;
                                 v1 = vn;
                             } else {
-                                hh = mesh_->opposite(hh);
-                                hh = mesh_->next(hh);
-                                hh = mesh_->next(hh);
+                                hh = mesh->opposite(hh);
+                                hh = mesh->next(hh);
+                                hh = mesh->next(hh);
                                 vh0 = vhn;
                                 p0 = pn;
                                 v0 = vn;
                             }
-                            hhh = mesh_->opposite(hh);
+                            hhh = mesh->opposite(hh);
                         }
                     }
                 }
             }
+        });
+
+        const auto num = std::count_if(virtual_edges_.begin(), virtual_edges_.end(), [](const VirtualEdge &ve) {
+            return ve.vertex.is_valid();
+        });
+        LOG(INFO) << num << " virtual edges found";
+    }
+
+    //-----------------------------------------------------------------------------
+
+    std::unique_ptr<SurfaceMeshGeodesic::Workspace> SurfaceMeshGeodesic::acquire_workspace() {
+        std::lock_guard<std::mutex> lock(workspace_mutex_);
+        if (workspaces_.empty())
+            return std::unique_ptr<Workspace>(new Workspace);
+        std::unique_ptr<Workspace> ws = std::move(workspaces_.back());
+        workspaces_.pop_back();
+        return ws;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshGeodesic::release_workspace(std::unique_ptr<Workspace> ws) {
+        ws->distance = nullptr;
+        std::lock_guard<std::mutex> lock(workspace_mutex_);
+        workspaces_.push_back(std::move(ws));
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshGeodesic::distance_arrays(const std::vector<std::string> &names, std::size_t num_sets,
+                                              std::vector<float *> &arrays) {
+        if (names.size() != num_sets) {
+            LOG(ERROR) << "the number of property names (" << names.size()
+                       << ") does not match the number of seed sets (" << num_sets << ")";
+            return false;
         }
 
-        LOG(INFO) << virtual_edges_.size() << " virtual edges found";
+        arrays.clear();
+        for (const auto &name : names) {
+            auto prop = mesh_->vertex_property<float>(name);
+            if (!prop) {
+                LOG(ERROR) << "failed to create vertex property '" << name << "' (a property of a different type "
+                           << "with the same name may exist)";
+                return false;
+            }
+            // acquiring the vector duplicates the array (if shared with a copy of the mesh) before the parallel writes
+            float *array = prop.vector().data();
+            if (std::find(arrays.begin(), arrays.end(), array) != arrays.end()) {
+                LOG(ERROR) << "duplicate property name '" << name << "'";
+                return false;
+            }
+            arrays.push_back(array);
+        }
+        return true;
     }
 
     //-----------------------------------------------------------------------------
@@ -134,15 +341,44 @@ namespace easy3d {
     unsigned int SurfaceMeshGeodesic::compute(const std::vector<SurfaceMesh::Vertex> &seed,
                                               float max_dist, unsigned int max_num,
                                               std::vector<SurfaceMesh::Vertex> *neighbors) {
-        // generate front
-        front_ = new PriorityQueue(VertexCmp(distance_));
+        std::unique_ptr<Workspace> ws = acquire_workspace();
+        ws->distance = distance_.vector().data();
+        const unsigned int num = march(seed, max_dist, max_num, neighbors, *ws);
+        release_workspace(std::move(ws));
+        return num;
+    }
+
+    //-----------------------------------------------------------------------------
 
+    bool SurfaceMeshGeodesic::compute(const std::vector<std::vector<SurfaceMesh::Vertex> > &seeds,
+                                      const std::vector<std::string> &names, float max_dist) {
+        std::vector<float *> arrays;
+        if (!distance_arrays(names, seeds.size(), arrays))
+            return false;
+
+        parallel::for_each(0, seeds.size(), [&](std::size_t i) {
+            std::unique_ptr<Workspace> ws = acquire_workspace();
+            ws->distance = arrays[i];
+            march(seeds[i], max_dist, INT_MAX, nullptr, *ws);
+            release_workspace(std::move(ws));
+        }, 1);
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    unsigned int SurfaceMeshGeodesic::march(const std::vector<SurfaceMesh::Vertex> &seed,
+                                            float max_dist, unsigned int max_num,
+                                            std::vector<SurfaceMesh::Vertex> *neighbors, Workspace &ws) const {
         // initialize front with given seed
-        unsigned int num = init_front(seed, neighbors);
+        unsigned int num = init_front(seed, neighbors, ws);
 
         // sort one-ring neighbors of seed vertices
         if (neighbors) {
-            std::sort(neighbors->begin(), neighbors->end(), VertexCmp(distance_));
+            const float *dist = ws.distance;
+            std::sort(neighbors->begin(), neighbors->end(), [dist](SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1) {
+                return (dist[v0.idx()] == dist[v1.idx()]) ? (v0 < v1) : (dist[v0.idx()] < dist[v1.idx()]);
+            });
         }
 
         // correct if seed vertices have more than max_num neighbors
@@ -154,12 +390,7 @@ namespace easy3d {
 
         // propagate up to max distance or max number of neighbors
         if (num < max_num)
-            num += propagate_front(max_dist, max_num - num, neighbors);
-
-        // clean up
-        delete front_;
-
-        mesh_->remove_vertex_property(processed_);
+            num += propagate_front(max_dist, max_num - num, neighbors, ws);
 
         return num;
     }
@@ -167,35 +398,39 @@ namespace easy3d {
     //-----------------------------------------------------------------------------
 
     unsigned int SurfaceMeshGeodesic::init_front(const std::vector<SurfaceMesh::Vertex> &seed,
-                                                 std::vector<SurfaceMesh::Vertex> *neighbors) {
+                                                 std::vector<SurfaceMesh::Vertex> *neighbors, Workspace &ws) const {
+        const SurfaceMesh *mesh = mesh_;
+        float *dist = ws.distance;
+        auto &processed = ws.processed;
+
+        // reset all vertices (and the front, which may hold entries of a previous computation)
+        const std::size_t n = mesh->vertices_size();
+        processed.assign(n, 0);
+        std::fill(dist, dist + n, FLT_MAX);
+        ws.front.reset(bucket_width_, num_buckets_);
+
         unsigned int num(0);
 
         if (seed.empty())
             return num;
 
-        // reset all vertices
-        for (auto v : mesh_->vertices()) {
-            processed_[v] = false;
-            distance_[v] = FLT_MAX;
-        }
-
         // initialize neighbor array
         if (neighbors)
             neighbors->clear();
 
         // initialize seed vertices
         for (auto v : seed) {
-            processed_[v] = true;
-            distance_[v] = 0.0;
+            processed[v.idx()] = true;
+            dist[v.idx()] = 0.0;
         }
 
         // initialize seed's one-ring
         for (auto v : seed) {
-            for (auto vv : mesh_->vertices(v)) {
-                const float dist = easy3d::distance(mesh_->position(v), mesh_->position(vv));
-                if (dist < distance_[vv]) {
-                    distance_[vv] = dist;
-                    processed_[vv] = true;
+            for (auto vv : mesh->vertices(v)) {
+                const float d = easy3d::distance(mesh->position(v), mesh->position(vv));
+                if (d < dist[vv.idx()]) {
+                    dist[vv.idx()] = d;
+                    processed[vv.idx()] = true;
                     ++num;
                     if (neighbors)
                         neighbors->push_back(vv);
@@ -204,12 +439,11 @@ namespace easy3d {
         }
 
         // init marching front
-        front_->clear();
         for (auto v : seed) {
-            for (auto vv : mesh_->vertices(v)) {
-                for (auto vvv : mesh_->vertices(vv)) {
-                    if (!processed_[vvv]) {
-                        heap_vertex(vvv);
+            for (auto vv : mesh->vertices(v)) {
+                for (auto vvv : mesh->vertices(vv)) {
+                    if (!processed[vvv.idx()]) {
+                        heap_vertex(vvv, ws);
                     }
                 }
             }
@@ -222,21 +456,27 @@ namespace easy3d {
 
     unsigned int SurfaceMeshGeodesic::propagate_front(float max_dist,
                                                       unsigned int max_num,
-                                                      std::vector<SurfaceMesh::Vertex> *neighbors) {
+                                                      std::vector<SurfaceMesh::Vertex> *neighbors,
+                                                      Workspace &ws) const {
+        const SurfaceMesh *mesh = mesh_;
+        const float *dist = ws.distance;
+        auto &processed = ws.processed;
+
         unsigned int num(0);
 
-        while (!front_->empty()) {
-            // find minimum vertex, remove it from queue
-            auto v = *front_->begin();
-            front_->erase(front_->begin());
-            assert(!processed_[v]);
-            processed_[v] = true;
+        internal::BucketQueue::Entry entry;
+        while (ws.front.pop(entry)) {
+            // find minimum vertex (skipping outdated entries)
+            const SurfaceMesh::Vertex v(entry.second);
+            if (processed[v.idx()] || dist[v.idx()] != entry.first)
+                continue;
+            processed[v.idx()] = true;
             ++num;
             if (neighbors)
                 neighbors->push_back(v);
 
             // did we reach maximum distance?
-            if (distance_[v] > max_dist)
+            if (dist[v.idx()] > max_dist)
                 break;
 
             // did we reach maximum number of neighbors
@@ -244,9 +484,9 @@ namespace easy3d {
                 break;
 
             // update front
-            for (auto vv : mesh_->vertices(v)) {
-                if (!processed_[vv]) {
-                    heap_vertex(vv);
+            for (auto vv : mesh->vertices(v)) {
+                if (!processed[vv.idx()]) {
+                    heap_vertex(vv, ws);
                 }
             }
         }
@@ -256,25 +496,26 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
-    void SurfaceMeshGeodesic::heap_vertex(SurfaceMesh::Vertex v) {
-        assert(!processed_[v]);
+    void SurfaceMeshGeodesic::heap_vertex(SurfaceMesh::Vertex v, Workspace &ws) const {
+        const SurfaceMesh *mesh = mesh_;
+        const auto &processed = ws.processed;
+        assert(!processed[v.idx()]);
 
         SurfaceMesh::Vertex v0, v1, vv;
         float dist, dist_min(FLT_MAX), d;
-        typename VirtualEdges::const_iterator ve_it, ve_end(virtual_edges_.end());
         bool found(false);
 
-        for (auto h : mesh_->halfedges(v)) {
-            if (!mesh_->is_border(h)) {
-                ve_it = virtual_edges_.find(h);
+        for (auto h : mesh->halfedges(v)) {
+            if (!mesh->is_border(h)) {
+                const VirtualEdge *ve = virtual_edges_.empty() ? nullptr : &virtual_edges_[h.idx()];
 
                 // no virtual edge
-                if (ve_it == ve_end) {
-                    v0 = mesh_->target(h);
-                    v1 = mesh_->target(mesh_->next(h));
+                if (!ve || !ve->vertex.is_valid()) {
+                    v0 = mesh->target(h);
+                    v1 = mesh->target(mesh->next(h));
 
-                    if (processed_[v0] && processed_[v1]) {
-                        dist = distance(v0, v1, v);
+                    if (processed[v0.idx()] && processed[v1.idx()]) {
+                        dist = distance(v0, v1, v, ws.distance);
                         if (dist < dist_min) {
                             dist_min = dist;
                             found = true;
@@ -284,21 +525,21 @@ namespace easy3d {
 
                     // virtual edge
                 else {
-                    v0 = mesh_->target(h);
-                    v1 = mesh_->target(mesh_->next(h));
-                    vv = ve_it->second.vertex;
-                    d = ve_it->second.length;
+                    v0 = mesh->target(h);
+                    v1 = mesh->target(mesh->next(h));
+                    vv = ve->vertex;
+                    d = ve->length;
 
-                    if (processed_[v0] && processed_[vv]) {
-                        dist = distance(v0, vv, v, FLT_MAX, d);
+                    if (processed[v0.idx()] && processed[vv.idx()]) {
+                        dist = distance(v0, vv, v, ws.distance, FLT_MAX, d);
                         if (dist < dist_min) {
                             dist_min = dist;
                             found = true;
                         }
                     }
 
-                    if (processed_[v1] && processed_[vv]) {
-                        dist = distance(vv, v1, v, d, FLT_MAX);
+                    if (processed[v1.idx()] && processed[vv.idx()]) {
+                        dist = distance(vv, v1, v, ws.distance, d, FLT_MAX);
                         if (dist < dist_min) {
                             dist_min = dist;
                             found = true;
@@ -308,48 +549,42 @@ namespace easy3d {
             }
         }
 
-        // update priority queue
+        // update priority queue (the outdated entry of v, if any, is skipped when popped)
+        float &current = ws.distance[v.idx()];
         if (found) {
-            if (distance_[v] != FLT_MAX) {
-                auto it = front_->find(v);
-                assert(it != front_->end());
-                front_->erase(it);
-            }
-
-            distance_[v] = dist_min;
-            front_->insert(v);
-        } else {
-            if (distance_[v] != FLT_MAX) {
-                front_->erase(v);
-                distance_[v] = FLT_MAX;
+            if (dist_min != current) {
+                current = dist_min;
+                ws.front.push(dist_min, v.idx());
             }
-        }
+        } else
+            current = FLT_MAX;
     }
 
     //-----------------------------------------------------------------------------
 
     float
-    SurfaceMeshGeodesic::distance(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1, SurfaceMesh::Vertex v2, float r0,
-                                  float r1) {
+    SurfaceMeshGeodesic::distance(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1, SurfaceMesh::Vertex v2,
+                                  const float *dist, float r0, float r1) const {
+        const SurfaceMesh *mesh = mesh_;
         vec3 A, B, C;
         double TA, TB;
         double a, b;
 
         // choose points such that TB>TA and hence u>0
-        if (distance_[v0] < distance_[v1]) {
-            A = mesh_->position(v0);
-            B = mesh_->position(v1);
-            C = mesh_->position(v2);
-            TA = distance_[v0];
-            TB = distance_[v1];
+        if (dist[v0.idx()] < dist[v1.idx()]) {
+            A = mesh->position(v0);
+            B = mesh->position(v1);
+            C = mesh->position(v2);
+            TA = dist[v0.idx()];
+            TB = dist[v1.idx()];
             a = r1 == FLT_MAX ? easy3d::distance(B, C) : r1;
             b = r0 == FLT_MAX ? easy3d::distance(A, C) : r0;
         } else {
-            A = mesh_->position(v1);
-            B = mesh_->position(v0);
-            C = mesh_->position(v2);
-            TA = distance_[v1];
-            TB = distance_[v0];
+            A = mesh->position(v1);
+            B = mesh->position(v0);
+            C = mesh->position(v2);
+            TA = dist[v1.idx()];
+            TB = dist[v0.idx()];
             a = r0 == FLT_MAX ? easy3d::distance(B, C) : r0;
             b = r1 == FLT_MAX ? easy3d::distance(A, C) : r1;
         }
@@ -384,6 +619,181 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
+    bool SurfaceMeshGeodesic::prepare_heat_solver() {
+        if (heat_solver_)
+            return true;
+
+        const SurfaceMesh *mesh = mesh_;
+        if (!mesh->is_triangle_mesh()) {
+            LOG(ERROR) << "the heat method requires a triangle mesh";
+            return false;
+        }
+
+        std::unique_ptr<HeatSolver> solver(new HeatSolver);
+        const int n = static_cast<int>(mesh->vertices_size());
+
+        // the cotan Laplacian L (positive semi-definite here) and the lumped mass matrix M
+        std::vector<Triplet> stiffness;
+        stiffness.reserve(mesh->n_faces() * 12);
+        std::vector<double> mass(n, 0.0);
+        solver->corners.reserve(mesh->n_faces() * 3);
+        solver->cotans.reserve(mesh->n_faces() * 3);
+        double sum_length(0.0);
+        for (auto f : mesh->faces()) {
+            int ids[3];
+            dvec3 p[3];
+            int k = 0;
+            for (auto v : mesh->vertices(f)) {
+                ids[k] = v.idx();
+                p[k] = dvec3(mesh->position(v));
+                ++k;
+            }
+            const double area2 = norm(cross(p[1] - p[0], p[2] - p[0]));    // twice the area
+            for (int c = 0; c < 3; ++c) {
+                const int a = (c + 1) % 3, b = (c + 2) % 3;
+                const double cot = area2 > 0.0 ? dot(p[a] - p[c], p[b] - p[c]) / area2 : 0.0;
+                solver->corners.push_back(ids[c]);
+                solver->cotans.push_back(cot);
+                const double w = 0.5 * cot;
+                stiffness.emplace_back(ids[a], ids[b], -w);
+                stiffness.emplace_back(ids[b], ids[a], -w);
+                stiffness.emplace_back(ids[a], ids[a], w);
+                stiffness.emplace_back(ids[b], ids[b], w);
+                mass[ids[c]] += area2 / 6.0;
+                sum_length += norm(p[a] - p[b]);
+            }
+        }
+
+        // the time step is the squared mean edge length
+        const double h = sum_length / std::max<std::size_t>(solver->corners.size(), 1);
+        const double t = h * h;
+        const double epsilon = 1e-6 / t;
+
+        std::vector<Triplet> heat_triplets, poisson_triplets;
+        heat_triplets.reserve(stiffness.size() + n);
+        poisson_triplets.reserve(stiffness.size() + n);
+        for (const auto &triplet : stiffness) {
+            heat_triplets.emplace_back(triplet.row(), triplet.col(), t * triplet.value());
+            poisson_triplets.push_back(triplet);
+        }
+        solver->valid.assign(n, true);
+        for (int i = 0; i < n; ++i) {
+            if (mass[i] > 0.0) {
+                heat_triplets.emplace_back(i, i, mass[i]);
+                poisson_triplets.emplace_back(i, i, epsilon * mass[i]);
+            } else {    // deleted, isolated, or only incident to degenerate faces
+                solver->valid[i] = false;
+                heat_triplets.emplace_back(i, i, 1.0);
+                poisson_triplets.emplace_back(i, i, 1.0);
+            }
+        }
+
+        SparseMatrix A(n, n);
+        A.setFromTriplets(heat_triplets.begin(), heat_triplets.end());
+        solver->heat.compute(A);
+        if (solver->heat.info() != Eigen::Success) {
+            LOG(ERROR) << "failed to factorize the heat flow matrix";
+            return false;
+        }
+
+        A.setFromTriplets(poisson_triplets.begin(), poisson_triplets.end());
+        solver->poisson.compute(A);
+        if (solver->poisson.info() != Eigen::Success) {
+            LOG(ERROR) << "failed to factorize the Poisson matrix";
+            return false;
+        }
+
+        heat_solver_ = std::move(solver);
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshGeodesic::solve_heat(const std::vector<SurfaceMesh::Vertex> &seed, Workspace &ws) const {
+        const SurfaceMesh *mesh = mesh_;
+        const HeatSolver &solver = *heat_solver_;
+        const std::size_t n = mesh->vertices_size();
+
+        // heat flow from the seeds
+        ws.rhs.setZero(static_cast<Eigen::Index>(n));
+        for (auto v : seed) {
+            if (solver.valid[v.idx()])
+                ws.rhs[v.idx()] = 1.0;
+        }
+        ws.solution = solver.heat.solve(ws.rhs);
+        const Eigen::VectorXd &u = ws.solution;
+
+        // the (negated) divergence of the normalized gradient field of the heat
+        Eigen::VectorXd divergence = Eigen::VectorXd::Zero(static_cast<Eigen::Index>(n));
+        for (std::size_t i = 0; i < solver.corners.size(); i += 3) {
+            const int *ids = &solver.corners[i];
+            const double *cot = &solver.cotans[i];
+            const dvec3 p[3] = {dvec3(mesh->position(SurfaceMesh::Vertex(ids[0]))),
+                                dvec3(mesh->position(SurfaceMesh::Vertex(ids[1]))),
+                                dvec3(mesh->position(SurfaceMesh::Vertex(ids[2])))};
+            const dvec3 normal = cross(p[1] - p[0], p[2] - p[0]);
+            const double area2 = norm(normal);
+            if (area2 <= 0.0)
+                continue;
+
+            dvec3 grad(0.0, 0.0, 0.0);
+            for (int c = 0; c < 3; ++c)
+                grad += u[ids[c]] * cross(normal, p[(c + 2) % 3] - p[(c + 1) % 3]);
+            const double length = norm(grad);
+            if (length <= 0.0)
+                continue;
+            const dvec3 X = grad / (-length);
+
+            for (int c = 0; c < 3; ++c) {
+                const int a = (c + 1) % 3, b = (c + 2) % 3;
+                divergence[ids[c]] -= 0.5 * (cot[b] * dot(p[a] - p[c], X) + cot[a] * dot(p[b] - p[c], X));
+            }
+        }
+
+        // recover the distances and shift them to start from zero
+        ws.solution = solver.poisson.solve(divergence);
+        const Eigen::VectorXd &phi = ws.solution;
+        double min_phi = DBL_MAX;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (solver.valid[i])
+                min_phi = std::min(min_phi, phi[i]);
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            ws.distance[i] = solver.valid[i] ? static_cast<float>(phi[i] - min_phi) : FLT_MAX;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshGeodesic::compute_heat(const std::vector<SurfaceMesh::Vertex> &seed) {
+        if (!prepare_heat_solver())
+            return false;
+
+        std::unique_ptr<Workspace> ws = acquire_workspace();
+        ws->distance = distance_.vector().data();
+        solve_heat(seed, *ws);
+        release_workspace(std::move(ws));
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+
+    bool SurfaceMeshGeodesic::compute_heat(const std::vector<std::vector<SurfaceMesh::Vertex> > &seeds,
+                                           const std::vector<std::string> &names) {
+        std::vector<float *> arrays;
+        if (!distance_arrays(names, seeds.size(), arrays) || !prepare_heat_solver())
+            return false;
+
+        parallel::for_each(0, seeds.size(), [&](std::size_t i) {
+            std::unique_ptr<Workspace> ws = acquire_workspace();
+            ws->distance = arrays[i];
+            solve_heat(seeds[i], *ws);
+            release_workspace(std::move(ws));
+        }, 1);
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+
     void SurfaceMeshGeodesic::distance_to_texture_coordinates() {
         // find maximum distance
         float max_dist(0);
@@ -14,7 +14,9 @@
 
 #include <easy3d/core/surface_mesh.h>
 #include <vector>
-#include <set>
+#include <string>
+#include <memory>
+#include <mutex>
 #include <cfloat>
 #include <climits>
 
@@ -24,9 +26,17 @@ namespace easy3d {
      * \brief This class computes geodesic distance from a set of seed vertices.
      * \class SurfaceMeshGeodesic easy3d/algo/surface_mesh_geodesic.h
      * \details The method works by a Dykstra-like breadth first traversal from the seed vertices, implemented by a
-     * heap structure. See the following paper for more details:
+     * bucketed priority queue. See the following paper for more details:
      *  - Kimmel and Sethian. Computing geodesic paths on manifolds. Proceedings of the National Academy of Sciences,
      *    95(15):8431–8435, 1998.
+     * The scratch buffers of the traversal are kept and reused by subsequent computations. Many independent sets of
+     * seeds can be processed in parallel, each into its own vertex property. Alternatively, the distances can be
+     * approximated by the heat method, which factorizes two sparse matrices once and reuses the factorizations for
+     * all subsequent computations (triangle meshes only):
+     *  - Crane, Weischedel, and Wardetzky. Geodesics in heat: A new approach to computing distance based on heat
+     *    flow. ACM Transactions on Graphics, 32(5):152:1–152:11, 2013.
+     * \note The virtual edges and the factorizations are computed for the mesh at the time of construction (resp. the
+     *    first call to compute_heat()). Construct a new instance after the mesh has been modified.
      */
     class SurfaceMeshGeodesic {
     public:
@@ -53,6 +63,35 @@ namespace easy3d {
                              unsigned int max_num = INT_MAX,
                              std::vector<SurfaceMesh::Vertex> *neighbors = nullptr);
 
+        //! \brief Compute geodesic distances from many independent sets of seed points in parallel.
+        //! \details The distances from the i-th set of seeds are stored as SurfaceMesh::VertexProperty<float> with
+        //!     the name \p names[i] (created if it does not exist). The vertices farther than \p max_dist have a
+        //!     distance of FLT_MAX.
+        //! \param[in] seeds The sets of seed vertices.
+        //! \param[in] names The names of the vertex properties storing the distances, one for each set of seeds.
+        //! \param[in] max_dist The maximum distance up to which to compute the geodesic distances.
+        //! \return true on success, and false if the numbers of seed sets and names differ.
+        bool compute(const std::vector<std::vector<SurfaceMesh::Vertex> > &seeds,
+                     const std::vector<std::string> &names,
+                     float max_dist = FLT_MAX);
+
+        //! \brief Compute geodesic distances from specified seed points using the heat method.
+        //! \details The results are store as SurfaceMesh::VertexProperty<float> with a name "v:geodesic:distance".
+        //!     The matrices are factorized at the first call, and the factorizations are reused afterwards.
+        //! \param[in] seed The vector of seed vertices.
+        //! \return true on success, and false if the mesh is not a triangle mesh or the factorization failed.
+        bool compute_heat(const std::vector<SurfaceMesh::Vertex> &seed);
+
+        //! \brief Compute geodesic distances from many independent sets of seed points in parallel using the heat
+        //!     method.
+        //! \details The distances from the i-th set of seeds are stored as SurfaceMesh::VertexProperty<float> with
+        //!     the name \p names[i] (created if it does not exist).
+        //! \param[in] seeds The sets of seed vertices.
+        //! \param[in] names The names of the vertex properties storing the distances, one for each set of seeds.
+        //! \return true on success.
+        bool compute_heat(const std::vector<std::vector<SurfaceMesh::Vertex> > &seeds,
+                          const std::vector<std::string> &names);
+
         //! \brief Access the computed geodesic distance.
         //! \param[in] v The vertex for which to return the geodesic distance.
         //! \return The geodesic distance of vertex \p v.
@@ -68,47 +107,52 @@ namespace easy3d {
         void distance_to_texture_coordinates();
 
     private: // private types
-        // functor for comparing two vertices w.r.t. their geodesic distance
-        class VertexCmp {
-        public:
-            explicit VertexCmp(const SurfaceMesh::VertexProperty<float> &dist) : dist_(dist) {}
-
-            bool operator()(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1) const {
-                return ((dist_[v0] == dist_[v1]) ? (v0 < v1)
-                                                 : (dist_[v0] < dist_[v1]));
-            }
-
-        private:
-            const SurfaceMesh::VertexProperty<float> &dist_;
-        };
-
-        // priority queue using geodesic distance as sorting criterion
-        typedef std::set<SurfaceMesh::Vertex, VertexCmp> PriorityQueue;
-
         // virtual edges for walking through obtuse triangles
         struct VirtualEdge {
+            VirtualEdge() : length(0.0f) {}
             VirtualEdge(SurfaceMesh::Vertex v, float l) : vertex(v), length(l) {}
 
-            SurfaceMesh::Vertex vertex;
+            SurfaceMesh::Vertex vertex; // invalid if the halfedge has no virtual edge
             float length;
         };
 
-        // set for storing virtual edges
-        typedef std::map<SurfaceMesh::Halfedge, VirtualEdge> VirtualEdges;
+        // the virtual edges indexed by halfedges
+        typedef std::vector<VirtualEdge> VirtualEdges;
+
+        // the scratch buffers of a single computation (defined in the source file)
+        struct Workspace;
+
+        // the cached factorizations of the heat method (defined in the source file)
+        struct HeatSolver;
 
     private: // private methods
         void find_virtual_edges();
 
+        unsigned int march(const std::vector<SurfaceMesh::Vertex> &seed, float max_dist, unsigned int max_num,
+                           std::vector<SurfaceMesh::Vertex> *neighbors, Workspace &ws) const;
+
         unsigned int init_front(const std::vector<SurfaceMesh::Vertex> &seed,
-                                std::vector<SurfaceMesh::Vertex> *neighbors);
+                                std::vector<SurfaceMesh::Vertex> *neighbors, Workspace &ws) const;
 
         unsigned int propagate_front(float max_dist, unsigned int max_num,
-                                     std::vector<SurfaceMesh::Vertex> *neighbors);
+                                     std::vector<SurfaceMesh::Vertex> *neighbors, Workspace &ws) const;
+
+        void heap_vertex(SurfaceMesh::Vertex v, Workspace &ws) const;
+
+        float distance(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1, SurfaceMesh::Vertex v2, const float *dist,
+                       float r0 = FLT_MAX, float r1 = FLT_MAX) const;
+
+        bool prepare_heat_solver();
 
-        void heap_vertex(SurfaceMesh::Vertex v);
+        void solve_heat(const std::vector<SurfaceMesh::Vertex> &seed, Workspace &ws) const;
 
-        float distance(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1, SurfaceMesh::Vertex v2, float r0 = FLT_MAX,
-                       float r1 = FLT_MAX);
+        // get a workspace from the pool (or create a new one), and give it back
+        std::unique_ptr<Workspace> acquire_workspace();
+        void release_workspace(std::unique_ptr<Workspace> ws);
+
+        // collect the output arrays of the distance properties named 'names' (created if necessary)
+        bool distance_arrays(const std::vector<std::string> &names, std::size_t num_sets,
+                             std::vector<float *> &arrays);
 
     private: // private data
         SurfaceMesh *mesh_;
@@ -116,13 +160,19 @@ namespace easy3d {
         bool use_virtual_edges_;
         VirtualEdges virtual_edges_;
 
-        PriorityQueue *front_;
+        // width and number of the buckets of the priority queue
+        float bucket_width_;
+        std::size_t num_buckets_;
+
+        std::vector<std::unique_ptr<Workspace> > workspaces_;
+        std::mutex workspace_mutex_;
+
+        std::unique_ptr<HeatSolver> heat_solver_;
 
         SurfaceMesh::VertexProperty<float> distance_;
-        SurfaceMesh::VertexProperty<bool> processed_;
     };
 
 } // namespace easy3d
 
 
-#endif  // EASY3D_ALGO_SURFACE_MESH_GEODESIC_H
\ No newline at end of file
+#endif  // EASY3D_ALGO_SURFACE_MESH_GEODESIC_H
@@ -14,6 +14,8 @@
 #include <limits>
 #include <cmath>
 
+#include <easy3d/util/parallel.h>
+
 
 namespace easy3d {
 
@@ -33,31 +35,47 @@ namespace easy3d {
         //-----------------------------------------------------------------------------
 
         float surface_area(const SurfaceMesh *mesh) {
-            float area(0);
-            for (auto f : mesh->faces()) {
-                area += triangle_area(mesh, f);
-            }
-            return area;
+            return parallel::reduce(0, mesh->faces_size(), 0.0f,
+                    [mesh](std::size_t begin, std::size_t end) -> float {
+                        float area(0);
+                        for (std::size_t i = begin; i < end; ++i) {
+                            const SurfaceMesh::Face f(static_cast<int>(i));
+                            if (!mesh->is_deleted(f))
+                                area += triangle_area(mesh, f);
+                        }
+                        return area;
+                    },
+                    std::plus<float>()
+            );
         }
 
         //-----------------------------------------------------------------------------
 
-        float volume(const SurfaceMesh& mesh)
+        float volume(const SurfaceMesh *mesh)
         {
-            if (!mesh.is_triangle_mesh()) {
+            if (!mesh->is_triangle_mesh()) {
                 LOG(ERROR) << "input is not a pure triangle mesh!";
                 return 0;
             }
 
-            float volume(0);
-            for (const auto f : mesh.faces()) {
-                auto fv = mesh.vertices(f);
-                const auto& p0 = mesh.position(*fv);
-                const auto& p1 = mesh.position(*(++fv));
-                const auto& p2 = mesh.position(*(++fv));
-
-                volume += float(1.0) / float(6.0) * dot(cross(p0, p1), p2);
-            }
+            float volume = parallel::reduce(0, mesh->faces_size(), 0.0f,
+                    [mesh](std::size_t begin, std::size_t end) -> float {
+                        float vol(0);
+                        for (std::size_t i = begin; i < end; ++i) {
+                            const SurfaceMesh::Face f(static_cast<int>(i));
+                            if (mesh->is_deleted(f))
+                                continue;
+                            auto fv = mesh->vertices(f);
+                            const auto& p0 = mesh->position(*fv);
+                            const auto& p1 = mesh->position(*(++fv));
+                            const auto& p2 = mesh->position(*(++fv));
+
+                            vol += float(1.0) / float(6.0) * dot(cross(p0, p1), p2);
+                        }
+                        return vol;
+                    },
+                    std::plus<float>()
+            );
 
             return std::abs(volume);
         }
@@ -78,16 +96,24 @@ namespace easy3d {
         //-----------------------------------------------------------------------------
 
         vec3 centroid(const SurfaceMesh *mesh) {
-            vec3 center(0, 0, 0), c;
-            float area(0), a;
-            for (auto f : mesh->faces()) {
-                a = triangle_area(mesh, f);
-                c = centroid(mesh, f);
-                area += a;
-                center += a * c;
-            }
-            center /= area;
-            return center;
+            // area-weighted sum of the face centroids (in xyz) and the area (in w)
+            const vec4 sum = parallel::reduce(0, mesh->faces_size(), vec4(0, 0, 0, 0),
+                    [mesh](std::size_t begin, std::size_t end) -> vec4 {
+                        vec3 center(0, 0, 0);
+                        float area(0), a;
+                        for (std::size_t i = begin; i < end; ++i) {
+                            const SurfaceMesh::Face f(static_cast<int>(i));
+                            if (mesh->is_deleted(f))
+                                continue;
+                            a = triangle_area(mesh, f);
+                            area += a;
+                            center += a * centroid(mesh, f);
+                        }
+                        return vec4(center, area);
+                    },
+                    [](const vec4 &a, const vec4 &b) -> vec4 { return a + b; }
+            );
+            return vec3(sum.x, sum.y, sum.z) / sum.w;
         }
 
         //-----------------------------------------------------------------------------
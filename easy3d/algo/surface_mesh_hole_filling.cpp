@@ -15,10 +15,10 @@
 #include <Eigen/Sparse>
 
 #include <easy3d/algo/surface_mesh_fairing.h>
+#include <easy3d/algo/sparse_solver.h>
 #include <easy3d/util/logging.h>
 
-using SparseMatrix = Eigen::SparseMatrix<double>;
-using Triplet = Eigen::Triplet<double>;
+using Triplet = easy3d::SparseSolver::Triplet;
 
 
 namespace easy3d {
@@ -418,12 +418,10 @@ namespace easy3d {
             B.row(i) = Eigen::Vector3d(b.x, b.y, b.z);
         }
 
-        // solve least squares system
-        SparseMatrix A(n, n);
-        A.setFromTriplets(triplets.begin(), triplets.end());
-        Eigen::SimplicialLDLT<SparseMatrix> solver(A);
-        Eigen::MatrixXd X = solver.solve(B);
-        if (solver.info() != Eigen::Success) {
+        // solve least squares system (the pattern is reused if the last refinement step left the hole unchanged)
+        Eigen::MatrixXd X;
+        std::shared_ptr<SparseSolver> solver = SparseSolver::shared(mesh_, "hole_filling");
+        if (!solver->factorize(mesh_->connectivity_revision(), n, triplets) || !solver->solve(B, X)) {
             LOG(ERROR) << "SurfaceMeshHoleFilling failed to solve the linear system";
             return;
         }
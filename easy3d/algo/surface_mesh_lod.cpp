@@ -0,0 +1,178 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/algo/surface_mesh_lod.h>
+#include <easy3d/algo/surface_mesh_simplification.h>
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/core/surface_mesh_builder.h>
+#include <easy3d/util/logging.h>
+
+#include <algorithm>
+
+
+namespace easy3d {
+
+    namespace internal {
+
+        // builds a triangle mesh from the vertices and the faces of an LOD pyramid (or a level of it). The input is
+        // manifold, so the builder keeps the vertices and the faces as they are.
+        SurfaceMesh *build_lod_mesh(const std::vector<vec3> &points, const std::vector<int> &parents,
+                                    const std::vector<int> &indices) {
+            auto mesh = new SurfaceMesh;
+            SurfaceMeshBuilder builder(mesh);
+            builder.begin_surface();
+            for (const auto &p : points)
+                builder.add_vertex(p);
+            builder.add_faces(indices);
+            builder.end_surface(false);
+
+            if (mesh->n_vertices() != points.size() || mesh->n_faces() * 3 != indices.size()) {
+                LOG(ERROR) << "failed building the LOD mesh (the mesh is not manifold)";
+                delete mesh;
+                return nullptr;
+            }
+
+            auto parent = mesh->add_vertex_property<int>("v:lod:parent");
+            parent.vector() = parents;
+            return mesh;
+        }
+
+    }
+
+
+    SurfaceMesh *SurfaceMeshLOD::build(const SurfaceMesh *mesh, unsigned int min_vertices,
+                                       float aspect_ratio, float normal_deviation) {
+        if (!mesh) {
+            LOG(ERROR) << "null mesh pointer";
+            return nullptr;
+        }
+        if (!mesh->is_triangle_mesh()) {
+            LOG(ERROR) << "LOD generation requires a triangle mesh";
+            return nullptr;
+        }
+
+        SurfaceMesh original(*mesh);
+        original.collect_garbage(true);   // the faces are indexed below
+
+        // simplify a copy once and record the collapses
+        SurfaceMesh coarse(original);
+        SurfaceMeshSimplification simplifier(&coarse);
+        simplifier.initialize(aspect_ratio, 0.0f, 0, normal_deviation, 0.0f);
+        simplifier.simplify(min_vertices);
+        const auto &collapses = simplifier.collapses();
+
+        // the new indices of the vertices: the remaining vertices keep their order, and the removed vertices follow
+        // in the reverse order of their removal
+        const int nv = static_cast<int>(original.n_vertices());
+        const int nc = static_cast<int>(collapses.size());
+        std::vector<int> new_index(nv, -1);
+        for (int i = 0; i < nc; ++i)
+            new_index[collapses[i].v0.idx()] = nv - 1 - i;
+        int nb = 0;
+        for (int v = 0; v < nv; ++v) {
+            if (new_index[v] == -1)
+                new_index[v] = nb++;
+        }
+
+        const auto points = original.get_vertex_property<vec3>("v:point");
+        std::vector<vec3> new_points(nv);
+        std::vector<int> parents(nv, -1);
+        for (int v = 0; v < nv; ++v)
+            new_points[new_index[v]] = points[SurfaceMesh::Vertex(v)];
+        for (const auto &c : collapses)
+            parents[new_index[c.v0.idx()]] = new_index[c.v1.idx()];
+
+        // the faces of the coarsest level come first, followed by the faces created by each vertex split
+        std::vector<SurfaceMesh::Face> faces;
+        faces.reserve(original.n_faces());
+        std::vector<bool> removed(original.n_faces(), false);
+        for (const auto &c : collapses) {
+            if (c.fl.is_valid()) removed[c.fl.idx()] = true;
+            if (c.fr.is_valid()) removed[c.fr.idx()] = true;
+        }
+        for (auto f : original.faces()) {
+            if (!removed[f.idx()])
+                faces.push_back(f);
+        }
+        for (int i = nc - 1; i >= 0; --i) {
+            if (collapses[i].fl.is_valid()) faces.push_back(collapses[i].fl);
+            if (collapses[i].fr.is_valid()) faces.push_back(collapses[i].fr);
+        }
+
+        std::vector<int> indices;
+        indices.reserve(faces.size() * 3);
+        for (auto f : faces) {
+            for (auto v : original.vertices(f))
+                indices.push_back(new_index[v.idx()]);
+        }
+
+        LOG(INFO) << "LOD pyramid: " << nb << " - " << nv << " vertices";
+        return internal::build_lod_mesh(new_points, parents, indices);
+    }
+
+
+    SurfaceMesh *SurfaceMeshLOD::extract(const SurfaceMesh *pyramid, unsigned int n_vertices) {
+        if (!pyramid) {
+            LOG(ERROR) << "null mesh pointer";
+            return nullptr;
+        }
+        const auto parent = pyramid->get_vertex_property<int>("v:lod:parent");
+        if (!parent || pyramid->has_garbage() || !pyramid->is_triangle_mesh()) {
+            LOG(ERROR) << "the mesh is not an LOD pyramid";
+            return nullptr;
+        }
+
+        const unsigned int nv = pyramid->n_vertices();
+        unsigned int nb = 0;
+        while (nb < nv && parent[SurfaceMesh::Vertex(static_cast<int>(nb))] < 0)
+            ++nb;
+        const int n = static_cast<int>(std::max(nb, std::min(n_vertices, nv)));
+
+        const auto points = pyramid->get_vertex_property<vec3>("v:point");
+        const std::vector<vec3> level_points(points.vector().begin(), points.vector().begin() + n);
+        const std::vector<int> level_parents(parent.vector().begin(), parent.vector().begin() + n);
+
+        // the faces are sorted by the level at which they appear, so the faces of the level are those before the
+        // first face that collapses (i.e., the first one with two vertices mapped to the same ancestor)
+        std::vector<int> indices;
+        indices.reserve(pyramid->n_faces() * 3);
+        for (auto f : pyramid->faces()) {
+            int ids[3], k = 0;
+            for (auto v : pyramid->vertices(f)) {
+                int id = v.idx();
+                while (id >= n)
+                    id = parent.vector()[id];
+                ids[k++] = id;
+            }
+            if (ids[0] == ids[1] || ids[1] == ids[2] || ids[2] == ids[0])
+                break;
+            indices.insert(indices.end(), ids, ids + 3);
+        }
+
+        return internal::build_lod_mesh(level_points, level_parents, indices);
+    }
+
+}
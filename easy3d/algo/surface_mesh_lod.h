@@ -0,0 +1,81 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_ALGO_SURFACE_MESH_LOD_H
+#define EASY3D_ALGO_SURFACE_MESH_LOD_H
+
+
+namespace easy3d {
+
+    class SurfaceMesh;
+
+    /**
+     * \brief Level-of-detail (LOD) pyramid of a triangle mesh, generated by a single simplification.
+     * \class SurfaceMeshLOD easy3d/algo/surface_mesh_lod.h
+     * \details The mesh is simplified once (see SurfaceMeshSimplification) and the sequence of halfedge collapses is
+     *      recorded as a progressive mesh, which is stored as a reordered copy of the original mesh (only the vertex
+     *      positions are kept):
+     *        - The vertices are sorted from coarse to fine. The vertices of the coarsest level come first, followed
+     *          by the removed vertices in the reverse order of their removal. So the level with n vertices consists
+     *          of the first n vertices, and going from n to n + 1 vertices is the vertex split of vertex n.
+     *        - The vertex property "v:lod:parent" (of type int) stores the vertex each removed vertex was merged into,
+     *          which always comes before it. It is -1 for the vertices of the coarsest level.
+     *        - The faces are sorted by the level at which they appear. A face of the level with n vertices is the
+     *          original face with each of its vertices replaced by its first ancestor (following the parents) whose
+     *          index is smaller than n.
+     *      Any level can be extracted by extract() without simplifying again. The pyramid can be saved to and loaded
+     *      from a compact binary file (see io::save_lod() and io::load_lod()), in which the coarse levels come first
+     *      so they can be loaded (e.g., for display) without reading the rest of the file.
+     */
+    class SurfaceMeshLOD {
+    public:
+        /**
+         * \brief Generates the LOD pyramid of a triangle mesh.
+         * \param mesh The input triangle mesh. It is not modified.
+         * \param min_vertices The number of vertices of the coarsest level.
+         * \param aspect_ratio The maximum aspect ratio of the triangles of the simplified meshes (0 for no limit).
+         * \param normal_deviation The maximum deviation (in degrees) of the normals of the simplified meshes from
+         *      the original ones (0 for no limit).
+         * \return The input mesh with its vertices and faces reordered as described above (nullptr if failed). The
+         *      caller takes the ownership.
+         */
+        static SurfaceMesh *build(const SurfaceMesh *mesh, unsigned int min_vertices = 0,
+                                  float aspect_ratio = 0.0f, float normal_deviation = 0.0f);
+
+        /**
+         * \brief Extracts a level from an LOD pyramid.
+         * \param pyramid The LOD pyramid, e.g., generated by build() or loaded by io::load_lod().
+         * \param n_vertices The number of vertices of the level. It is clamped to the range of the pyramid.
+         * \return The mesh of the level (nullptr if \p pyramid is not an LOD pyramid). It carries the parents of its
+         *      vertices, so it is an LOD pyramid itself (with the coarser levels). The caller takes the ownership.
+         */
+        static SurfaceMesh *extract(const SurfaceMesh *pyramid, unsigned int n_vertices);
+    };
+
+}
+
+
+#endif  // EASY3D_ALGO_SURFACE_MESH_LOD_H
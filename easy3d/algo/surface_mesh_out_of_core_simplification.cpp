@@ -0,0 +1,305 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/algo/surface_mesh_out_of_core_simplification.h>
+#include <easy3d/algo/surface_mesh_simplification.h>
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/core/surface_mesh_builder.h>
+#include <easy3d/core/box.h>
+#include <easy3d/util/stop_watch.h>
+#include <easy3d/util/logging.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+
+
+namespace easy3d {
+
+    namespace internal {
+
+        // an occupied cell of the grid
+        struct Cell {
+            Quadric quadric;    // the (area weighted) error quadrics of the faces incident to the cell
+            dvec3 sum;          // the sum of the vertex positions (for a fallback position)
+            std::size_t count;
+        };
+
+        // a face of the result, given by its cells. Two triangles are the same if they have the same cells, no
+        // matter their orientations.
+        struct Triangle {
+            uint32_t cells[3];
+        };
+
+        struct TriangleHash {
+            std::size_t operator()(const Triangle &t) const {
+                uint32_t c[3] = {t.cells[0], t.cells[1], t.cells[2]};
+                std::sort(c, c + 3);
+                return (static_cast<std::size_t>(c[0]) * 73856093u) ^ (static_cast<std::size_t>(c[1]) * 19349663u) ^
+                       (static_cast<std::size_t>(c[2]) * 83492791u);
+            }
+        };
+
+        struct TriangleEqual {
+            bool operator()(const Triangle &a, const Triangle &b) const {
+                uint32_t ca[3] = {a.cells[0], a.cells[1], a.cells[2]};
+                uint32_t cb[3] = {b.cells[0], b.cells[1], b.cells[2]};
+                std::sort(ca, ca + 3);
+                std::sort(cb, cb + 3);
+                return ca[0] == cb[0] && ca[1] == cb[1] && ca[2] == cb[2];
+            }
+        };
+
+
+        class VertexClustering {
+        public:
+            VertexClustering(const std::vector<vec3> &points, const Box3 &box, unsigned int resolution,
+                             std::size_t memory_budget)
+                    : points_(points), budget_(memory_budget), level_(0) {
+                // the grid is anchored at the corner of the bounding box, and the cells at the finest level are
+                // addressed by 21 bits per axis
+                resolution = std::max(1u, std::min(resolution, (1u << 21) - 1));
+                origin_ = dvec3(box.min_point().x, box.min_point().y, box.min_point().z);
+                cell_size_ = std::max(static_cast<double>(box.max_range()), 1e-30) / resolution;
+                max_index_ = resolution - 1;
+            }
+
+            // the estimated memory consumption (in bytes)
+            std::size_t memory() const {
+                // the nodes (a few pointers) and buckets of the hash tables are included
+                return points_.size() * sizeof(vec3) +
+                       cells_.size() * (sizeof(Cell) + sizeof(uint64_t) + 4 * sizeof(void *)) +
+                       triangles_.size() * (sizeof(Triangle) + 4 * sizeof(void *));
+            }
+
+            void add_face(const std::vector<int> &vertices) {
+                const int num = static_cast<int>(vertices.size());
+                if (num < 3)
+                    return;
+                for (int v : vertices) {
+                    if (v < 0 || v >= static_cast<int>(points_.size())) {
+                        LOG_N_TIMES(3, ERROR) << "face refers to a non-existing vertex (" << v << "). " << COUNTER;
+                        return;
+                    }
+                }
+
+                // the polygon is triangulated as a fan
+                for (int i = 1; i + 1 < num; ++i)
+                    add_triangle(vertices[0], vertices[i], vertices[i + 1]);
+
+                if (memory() > budget_)
+                    coarsen();
+            }
+
+            // the number of cells along the longest side of the bounding box
+            unsigned int resolution() const { return (max_index_ >> level_) + 1; }
+
+            SurfaceMesh *extract(const dvec3 &translation) const {
+                auto mesh = new SurfaceMesh;
+                SurfaceMeshBuilder builder(mesh);
+                builder.begin_surface();
+
+                const double radius = cell_size_ * (1u << level_) * std::sqrt(3.0);
+                std::vector<SurfaceMesh::Vertex> vertices(cells_.size());
+                for (const auto &t : triangles_) {
+                    for (auto c : t.cells) {
+                        if (vertices[c].is_valid())
+                            continue;
+                        // the minimizer of the quadric, or the mean position if it leaves the cell (e.g., for
+                        // badly conditioned quadrics)
+                        const Cell &cell = cells_[c];
+                        const dvec3 mean = cell.sum / static_cast<double>(cell.count);
+                        dvec3 p = cell.quadric.minimizer(mean);
+                        if (distance(p, mean) > radius)
+                            p = mean;
+                        p += translation;
+                        vertices[c] = builder.add_vertex(vec3(static_cast<float>(p.x), static_cast<float>(p.y),
+                                                              static_cast<float>(p.z)));
+                    }
+                }
+
+                for (const auto &t : triangles_)
+                    builder.add_triangle(vertices[t.cells[0]], vertices[t.cells[1]], vertices[t.cells[2]]);
+
+                builder.end_surface(false);
+                return mesh;
+            }
+
+        private:
+            uint64_t key(const dvec3 &p) const {
+                uint64_t k = 0;
+                for (int i = 0; i < 3; ++i) {
+                    const double x = std::floor((p[i] - origin_[i]) / cell_size_);
+                    const uint64_t index = static_cast<uint64_t>(std::min(std::max(x, 0.0), double(max_index_)));
+                    k |= (index >> level_) << (21 * i);
+                }
+                return k;
+            }
+
+            uint32_t cell(const dvec3 &p) {
+                const auto pos = indices_.insert(std::make_pair(key(p), static_cast<uint32_t>(cells_.size())));
+                if (pos.second) {
+                    cells_.emplace_back();
+                    cells_.back().sum = dvec3(0, 0, 0);
+                    cells_.back().count = 0;
+                }
+                return pos.first->second;
+            }
+
+            void add_triangle(int a, int b, int c) {
+                const dvec3 p[3] = {dvec3(points_[a].data()), dvec3(points_[b].data()), dvec3(points_[c].data())};
+                uint32_t ids[3];
+                for (int i = 0; i < 3; ++i)
+                    ids[i] = cell(p[i]);
+
+                dvec3 n = cross(p[1] - p[0], p[2] - p[0]);
+                const double area = 0.5 * n.norm();
+                if (area > 0.0) {
+                    n /= 2.0 * area;
+                    Quadric q(n.x, n.y, n.z, -dot(n, p[0]));
+                    q *= area;
+                    for (auto id : ids)
+                        cells_[id].quadric += q;
+                }
+                for (int i = 0; i < 3; ++i) {
+                    cells_[ids[i]].sum += p[i];
+                    ++cells_[ids[i]].count;
+                }
+
+                // only the triangles whose corners are in different cells survive
+                if (ids[0] != ids[1] && ids[1] != ids[2] && ids[2] != ids[0])
+                    triangles_.insert(Triangle{{ids[0], ids[1], ids[2]}});
+            }
+
+            // doubles the size of the cells by merging each 2x2x2 block of cells
+            void coarsen() {
+                while (memory() > budget_ && resolution() > 1) {
+                    ++level_;
+                    std::unordered_map<uint64_t, uint32_t> indices;
+                    std::vector<Cell> cells;
+                    std::vector<uint32_t> remap(cells_.size());
+                    for (const auto &entry : indices_) {
+                        uint64_t k = 0;
+                        for (int i = 0; i < 3; ++i)
+                            k |= (((entry.first >> (21 * i)) & ((1u << 21) - 1)) >> 1) << (21 * i);
+                        const auto pos = indices.insert(std::make_pair(k, static_cast<uint32_t>(cells.size())));
+                        const Cell &c = cells_[entry.second];
+                        if (pos.second)
+                            cells.push_back(c);
+                        else {
+                            Cell &merged = cells[pos.first->second];
+                            merged.quadric += c.quadric;
+                            merged.sum += c.sum;
+                            merged.count += c.count;
+                        }
+                        remap[entry.second] = pos.first->second;
+                    }
+                    indices_.swap(indices);
+                    cells_.swap(cells);
+
+                    std::unordered_set<Triangle, TriangleHash, TriangleEqual> triangles;
+                    for (const auto &t : triangles_) {
+                        const Triangle r{{remap[t.cells[0]], remap[t.cells[1]], remap[t.cells[2]]}};
+                        if (r.cells[0] != r.cells[1] && r.cells[1] != r.cells[2] && r.cells[2] != r.cells[0])
+                            triangles.insert(r);
+                    }
+                    triangles_.swap(triangles);
+                    LOG(INFO) << "memory budget exceeded. Grid coarsened to resolution " << resolution();
+                }
+            }
+
+        private:
+            const std::vector<vec3> &points_;
+            std::size_t budget_;
+
+            dvec3 origin_;
+            double cell_size_;      // the size of the cells at the finest level
+            unsigned int max_index_;
+            int level_;             // the cells are 2^level times as large as the cells at the finest level
+
+            std::unordered_map<uint64_t, uint32_t> indices_;    // the key of a cell -> its index in cells_
+            std::vector<Cell> cells_;
+            std::unordered_set<Triangle, TriangleHash, TriangleEqual> triangles_;
+        };
+
+    }
+
+
+    SurfaceMesh *SurfaceMeshOutOfCoreSimplification::apply(const Stream &stream, unsigned int resolution,
+                                                           std::size_t memory_budget) {
+        StopWatch w;
+        const std::size_t budget = memory_budget * 1024 * 1024;
+
+        // pass 1: the vertices. They are stored with respect to the first vertex, so float precision suffices also
+        // for geo-referenced data.
+        std::vector<vec3> points;
+        dvec3 first(0, 0, 0);
+        Box3 box;
+        bool overflow = false;
+        auto vertex_callback = [&](const dvec3 &p) {
+            if (points.empty())
+                first = p;
+            if ((points.size() + 1) * sizeof(vec3) > budget) {
+                overflow = true;
+                return;
+            }
+            const vec3 q(static_cast<float>(p.x - first.x), static_cast<float>(p.y - first.y),
+                         static_cast<float>(p.z - first.z));
+            points.push_back(q);
+            box.grow(q);
+        };
+        if (!stream(vertex_callback, nullptr))
+            return nullptr;
+        if (overflow) {
+            LOG(ERROR) << "the vertices of the mesh do not fit into the memory budget (" << memory_budget << " MB)";
+            return nullptr;
+        }
+        if (points.empty()) {
+            LOG(ERROR) << "the mesh has no vertices";
+            return nullptr;
+        }
+
+        // pass 2: the faces are clustered while being streamed
+        internal::VertexClustering clustering(points, box, resolution, budget);
+        if (!stream(nullptr, [&](const std::vector<int> &vertices) {
+            clustering.add_face(vertices);
+        }))
+            return nullptr;
+
+        SurfaceMesh *mesh = clustering.extract(first);
+        if (mesh->n_faces() == 0) {
+            LOG(WARNING) << "no faces left after simplification (resolution " << clustering.resolution() << ")";
+            delete mesh;
+            return nullptr;
+        }
+
+        LOG(INFO) << "simplification done (#vertex: " << points.size() << " -> " << mesh->n_vertices()
+                  << ", resolution: " << clustering.resolution() << "). " << w.time_string();
+        return mesh;
+    }
+
+}
@@ -0,0 +1,89 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_ALGO_SURFACE_MESH_OUT_OF_CORE_SIMPLIFICATION_H
+#define EASY3D_ALGO_SURFACE_MESH_OUT_OF_CORE_SIMPLIFICATION_H
+
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+#include <easy3d/core/types.h>
+
+
+namespace easy3d {
+
+    class SurfaceMesh;
+
+    /**
+     * \brief Out-of-core simplification of surface meshes that are too large to be loaded into memory.
+     * \class SurfaceMeshOutOfCoreSimplification easy3d/algo/surface_mesh_out_of_core_simplification.h
+     * \details The mesh is streamed (e.g., from a file by io::stream_surface_mesh()) and simplified by vertex
+     *      clustering with error quadrics: the bounding box is divided into a uniform grid, the error quadrics of the
+     *      faces are accumulated in the cells of their vertices, and each occupied cell is replaced by the position
+     *      minimizing its quadric. Because all faces are clustered on the same grid, the result is consistent across
+     *      the whole mesh, i.e., there are no seams that need stitching. Faces are never stored. Besides the result,
+     *      the memory holds the vertex positions (12 bytes per vertex) and the data of the occupied cells. If the cells
+     *      exceed the memory budget, the grid is coarsened by merging its cells (the quadrics are additive, so the
+     *      result is the same as clustering on the coarser grid directly). Non-manifold configurations caused by the
+     *      clustering are resolved when building the resulting mesh.
+     *      See the following paper for more details:
+     *          - Peter Lindstrom. Out-of-core simplification of large polygonal models. SIGGRAPH 2000.
+     */
+    class SurfaceMeshOutOfCoreSimplification {
+    public:
+        //! \brief Receives a vertex of the streamed mesh.
+        typedef std::function<void(const dvec3 &p)> VertexCallback;
+        //! \brief Receives a face of the streamed mesh, given by its vertex indices (starting from 0).
+        typedef std::function<void(const std::vector<int> &vertices)> FaceCallback;
+        //! \brief Passes all the vertices and faces of the mesh to the callbacks, in the same order every time it
+        //!     is called. An empty callback means the corresponding elements are not needed. Returns false on
+        //!     failure. For a file, io::stream_surface_mesh() does this job, e.g.,
+        //!     \code
+        //!         auto stream = [&](const SurfaceMeshOutOfCoreSimplification::VertexCallback &vertex_callback,
+        //!                           const SurfaceMeshOutOfCoreSimplification::FaceCallback &face_callback) {
+        //!             return io::stream_surface_mesh(file_name, vertex_callback, face_callback);
+        //!         };
+        //!         SurfaceMesh *mesh = SurfaceMeshOutOfCoreSimplification::apply(stream, 256);
+        //!     \endcode
+        typedef std::function<bool(const VertexCallback &, const FaceCallback &)> Stream;
+
+        /**
+         * \brief Simplifies a surface mesh without loading it into memory.
+         * \param stream Streams the mesh. It is called twice, first for the vertices and then for the faces.
+         * \param resolution The number of grid cells along the longest side of the bounding box of the mesh, which
+         *      controls the level of detail of the result.
+         * \param memory_budget The memory (in MB) the simplification may use. The grid is coarsened if needed.
+         * \return The simplified mesh (nullptr if failed). The caller takes the ownership.
+         */
+        static SurfaceMesh *apply(const Stream &stream, unsigned int resolution, std::size_t memory_budget = 1024);
+    };
+
+}
+
+
+#endif  // EASY3D_ALGO_SURFACE_MESH_OUT_OF_CORE_SIMPLIFICATION_H
@@ -16,6 +16,7 @@
 #include <Eigen/Sparse>
 
 #include <easy3d/algo/surface_mesh_geometry.h>
+#include <easy3d/algo/sparse_solver.h>
 #include <easy3d/util/logging.h>
 
 
@@ -121,10 +122,8 @@ namespace easy3d {
 
         // setup matrix A and rhs B
         const unsigned int n = free_vertices.size();
-        Eigen::SparseMatrix<double> A(n, n);
         Eigen::MatrixXd B(n, 2);
-        std::vector<Eigen::Triplet<double>>
-                triplets;
+        std::vector<SparseSolver::Triplet> triplets;
         dvec2 b;
         double w, ww;
         SurfaceMesh::Vertex v, vv;
@@ -153,13 +152,10 @@ namespace easy3d {
             B.row(i) = (Eigen::Vector2d) b;
         }
 
-        // build sparse matrix from triplets
-        A.setFromTriplets(triplets.begin(), triplets.end());
-
         // solve A*X = B
-        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver(A);
-        Eigen::MatrixXd X = solver.solve(B);
-        if (solver.info() != Eigen::Success) {
+        Eigen::MatrixXd X;
+        std::shared_ptr<SparseSolver> solver = SparseSolver::shared(mesh_, "parameterization:harmonic");
+        if (!solver->factorize(mesh_->connectivity_revision(), n, triplets) || !solver->solve(B, X)) {
             LOG(ERROR) << "failed solving the linear system.";
         } else {
             // copy solution
@@ -306,10 +302,8 @@ namespace easy3d {
         double si, sj0, sj1, sign;
         int row(0), c0, c1;
 
-        Eigen::SparseMatrix<double> A(2 * n, 2 * n);
         Eigen::VectorXd b = Eigen::VectorXd::Zero(2 * n);
-        std::vector<Eigen::Triplet<double>>
-                triplets;
+        std::vector<SparseSolver::Triplet> triplets;
 
         for (unsigned int i = 0; i < nv2; ++i) {
             vi = SurfaceMesh::Vertex(i % nv);
@@ -365,18 +359,15 @@ namespace easy3d {
             }
         }
 
-        // build sparse matrix from triplets
-        A.setFromTriplets(triplets.begin(), triplets.end());
-
         // solve A*X = B
-        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver(A);
-        Eigen::VectorXd x = solver.solve(b);
-        if (solver.info() != Eigen::Success) {
+        Eigen::MatrixXd x;
+        std::shared_ptr<SparseSolver> solver = SparseSolver::shared(mesh_, "parameterization:lscm");
+        if (!solver->factorize(mesh_->connectivity_revision(), 2 * n, triplets) || !solver->solve(b, x)) {
             LOG(ERROR) << "failed solving the linear system";
         } else {
             // copy solution
             for (unsigned int i = 0; i < n; ++i) {
-                tex[free_vertices[i]] = vec2(x[i], x[i + n]);
+                tex[free_vertices[i]] = vec2(x(i, 0), x(i + n, 0));
             }
         }
 
@@ -14,15 +14,16 @@
 #include <cmath>
 #include <algorithm>
 
-#include <easy3d/algo/triangle_mesh_kdtree.h>
+#include <easy3d/algo/triangle_mesh_bvh.h>
 #include <easy3d/algo/surface_mesh_curvature.h>
 #include <easy3d/algo/surface_mesh_geometry.h>
 #include <easy3d/util/progress.h>
+#include <easy3d/util/parallel.h>
 
 namespace easy3d {
 
     SurfaceMeshRemeshing::SurfaceMeshRemeshing(SurfaceMesh *mesh)
-            : mesh_(mesh), refmesh_(nullptr), kd_tree_(nullptr) {
+            : mesh_(mesh), refmesh_(nullptr), bvh_(nullptr), parallel_(false) {
         if (!mesh_->is_triangle_mesh())
             LOG(ERROR) << "input is not a pure triangle mesh!";
 
@@ -36,8 +37,10 @@ namespace easy3d {
 
     void SurfaceMeshRemeshing::uniform_remeshing(float edge_length,
                                                  unsigned int iterations,
-                                                 bool use_projection) {
+                                                 bool use_projection,
+                                                 bool parallel) {
         uniform_ = true;
+        parallel_ = parallel;
         use_projection_ = use_projection;
         target_edge_length_ = edge_length;
 
@@ -71,8 +74,10 @@ namespace easy3d {
                                                   float max_edge_length,
                                                   float approx_error,
                                                   unsigned int iterations,
-                                                  bool use_projection) {
+                                                  bool use_projection,
+                                                  bool parallel) {
         uniform_ = false;
+        parallel_ = parallel;
         min_edge_length_ = min_edge_length;
         max_edge_length_ = max_edge_length;
         approx_error_ = approx_error;
@@ -240,15 +245,15 @@ namespace easy3d {
                 refsizing_[v] = vsizing_[v];
             }
 
-            // build kd-tree
-            kd_tree_ = new TriangleMeshKdTree(refmesh_, 0);
+            // build the BVH for the closest-point queries
+            bvh_ = new TriangleMeshBVH(refmesh_);
         }
     }
 
     void SurfaceMeshRemeshing::postprocessing() {
-        // delete kd-tree and reference mesh
+        // delete the BVH and reference mesh
         if (use_projection_) {
-            delete kd_tree_;
+            delete bvh_;
             delete refmesh_;
         }
 
@@ -264,7 +269,7 @@ namespace easy3d {
         }
 
         // find the closest triangle of reference mesh
-        TriangleMeshKdTree::NearestNeighbor nn = kd_tree_->nearest(points_[v]);
+        TriangleMeshBVH::NearestNeighbor nn = bvh_->nearest(points_[v]);
         const vec3 p = nn.nearest;
         const SurfaceMesh::Face f = nn.face;
         if (!f.is_valid()) {
@@ -316,14 +321,29 @@ namespace easy3d {
         bool ok, is_feature, is_boundary;
         int i;
 
+        // in the parallel mode, the edges are tested in parallel before the sweep. This gives the same result as the
+        // sequential sweep, because a split doesn't change the other edges of the sweep (the new edges are not visited
+        // until the next sweep). For the same reason, the new vertices can be projected after the sweep.
+        std::vector<unsigned char> too_long;
+        std::vector<SurfaceMesh::Vertex> new_vertices;
+
         for (ok = false, i = 0; !ok && i < 10; ++i) {
             ok = true;
 
+            if (parallel_) {
+                too_long.resize(mesh_->edges_size());
+                parallel::for_each(0, too_long.size(), [&](std::size_t k) {
+                    const SurfaceMesh::Edge e(static_cast<int>(k));
+                    too_long[k] = !mesh_->is_deleted(e) && !elocked_[e] &&
+                                  is_too_long(mesh_->vertex(e, 0), mesh_->vertex(e, 1));
+                });
+            }
+
             for (auto e : mesh_->edges()) {
                 v0 = mesh_->vertex(e, 0);
                 v1 = mesh_->vertex(e, 1);
 
-                if (!elocked_[e] && is_too_long(v0, v1)) {
+                if (parallel_ ? too_long[e.idx()] : (!elocked_[e] && is_too_long(v0, v1))) {
                     const vec3 &p0 = points_[v0];
                     const vec3 &p1 = points_[v1];
 
@@ -342,6 +362,8 @@ namespace easy3d {
                                            : SurfaceMesh::Edge(mesh_->n_edges() - 3);
                         efeature_[enew] = true;
                         vfeature_[vnew] = true;
+                    } else if (parallel_) {
+                        new_vertices.push_back(vnew);
                     } else {
                         project_to_reference(vnew);
                     }
@@ -349,137 +371,276 @@ namespace easy3d {
                     ok = false;
                 }
             }
+
+            if (use_projection_ && !new_vertices.empty()) {
+                parallel::for_each(0, new_vertices.size(), [&](std::size_t k) {
+                    project_to_reference(new_vertices[k]);
+                });
+                new_vertices.clear();
+            }
         }
     }
 
-    void SurfaceMeshRemeshing::collapse_short_edges() {
+    SurfaceMesh::Halfedge SurfaceMeshRemeshing::find_collapse(SurfaceMesh::Edge e) const {
         SurfaceMesh::Vertex v0, v1;
         SurfaceMesh::Halfedge h0, h1, h01, h10;
-        bool ok, b0, b1, l0, l1, f0, f1;
-        int i;
+        bool b0, b1, l0, l1, f0, f1;
         bool hcol01, hcol10;
 
+        if (mesh_->is_deleted(e) || elocked_[e])
+            return SurfaceMesh::Halfedge();
+
+        h10 = mesh_->halfedge(e, 0);
+        h01 = mesh_->halfedge(e, 1);
+        v0 = mesh_->target(h10);
+        v1 = mesh_->target(h01);
+
+        if (!is_too_short(v0, v1))
+            return SurfaceMesh::Halfedge();
+
+        // get status
+        b0 = mesh_->is_border(v0);
+        b1 = mesh_->is_border(v1);
+        l0 = vlocked_[v0];
+        l1 = vlocked_[v1];
+        f0 = vfeature_[v0];
+        f1 = vfeature_[v1];
+        hcol01 = hcol10 = true;
+
+        // boundary rules
+        if (b0 && b1) {
+            if (!mesh_->is_border(e))
+                return SurfaceMesh::Halfedge();
+        } else if (b0)
+            hcol01 = false;
+        else if (b1)
+            hcol10 = false;
+
+        // locked rules
+        if (l0 && l1)
+            return SurfaceMesh::Halfedge();
+        else if (l0)
+            hcol01 = false;
+        else if (l1)
+            hcol10 = false;
+
+        // feature rules
+        if (f0 && f1) {
+            // edge must be a feature
+            if (!efeature_[e])
+                return SurfaceMesh::Halfedge();
+
+            // the other two edges removed by collapse must not be features
+            h0 = mesh_->prev(h01);
+            h1 = mesh_->next(h10);
+            if (efeature_[mesh_->edge(h0)] ||
+                efeature_[mesh_->edge(h1)])
+                hcol01 = false;
+            // the other two edges removed by collapse must not be features
+            h0 = mesh_->prev(h10);
+            h1 = mesh_->next(h01);
+            if (efeature_[mesh_->edge(h0)] ||
+                efeature_[mesh_->edge(h1)])
+                hcol10 = false;
+        } else if (f0)
+            hcol01 = false;
+        else if (f1)
+            hcol10 = false;
+
+        // topological rules
+        bool collapse_ok = mesh_->is_collapse_ok(h01);
+
+        if (hcol01)
+            hcol01 = collapse_ok;
+        if (hcol10)
+            hcol10 = collapse_ok;
+
+        // both collapses possible: collapse into vertex w/ higher valence
+        if (hcol01 && hcol10) {
+            if (mesh_->valence(v0) < mesh_->valence(v1))
+                hcol10 = false;
+            else
+                hcol01 = false;
+        }
+
+        // try v1 -> v0
+        if (hcol10) {
+            // don't create too long edges
+            for (auto vv : mesh_->vertices(v1)) {
+                if (is_too_long(v0, vv))
+                    return SurfaceMesh::Halfedge();
+            }
+            return h10;
+        }
+
+            // try v0 -> v1
+        else if (hcol01) {
+            // don't create too long edges
+            for (auto vv : mesh_->vertices(v0)) {
+                if (is_too_long(v1, vv))
+                    return SurfaceMesh::Halfedge();
+            }
+            return h01;
+        }
+
+        return SurfaceMesh::Halfedge();
+    }
+
+    void SurfaceMeshRemeshing::collapse_short_edges() {
+        if (parallel_) {
+            collapse_short_edges_parallel();
+            return;
+        }
+
+        bool ok;
+        int i;
+
         for (ok = false, i = 0; !ok && i < 10; ++i) {
             ok = true;
 
             for (auto e : mesh_->edges()) {
-                if (!mesh_->is_deleted(e) && !elocked_[e]) {
-                    h10 = mesh_->halfedge(e, 0);
-                    h01 = mesh_->halfedge(e, 1);
-                    v0 = mesh_->target(h10);
-                    v1 = mesh_->target(h01);
-
-                    if (is_too_short(v0, v1)) {
-                        // get status
-                        b0 = mesh_->is_border(v0);
-                        b1 = mesh_->is_border(v1);
-                        l0 = vlocked_[v0];
-                        l1 = vlocked_[v1];
-                        f0 = vfeature_[v0];
-                        f1 = vfeature_[v1];
-                        hcol01 = hcol10 = true;
-
-                        // boundary rules
-                        if (b0 && b1) {
-                            if (!mesh_->is_border(e))
-                                continue;
-                        } else if (b0)
-                            hcol01 = false;
-                        else if (b1)
-                            hcol10 = false;
-
-                        // locked rules
-                        if (l0 && l1)
-                            continue;
-                        else if (l0)
-                            hcol01 = false;
-                        else if (l1)
-                            hcol10 = false;
-
-                        // feature rules
-                        if (f0 && f1) {
-                            // edge must be a feature
-                            if (!efeature_[e])
-                                continue;
-
-                            // the other two edges removed by collapse must not be features
-                            h0 = mesh_->prev(h01);
-                            h1 = mesh_->next(h10);
-                            if (efeature_[mesh_->edge(h0)] ||
-                                efeature_[mesh_->edge(h1)])
-                                hcol01 = false;
-                            // the other two edges removed by collapse must not be features
-                            h0 = mesh_->prev(h10);
-                            h1 = mesh_->next(h01);
-                            if (efeature_[mesh_->edge(h0)] ||
-                                efeature_[mesh_->edge(h1)])
-                                hcol10 = false;
-                        } else if (f0)
-                            hcol01 = false;
-                        else if (f1)
-                            hcol10 = false;
-
-                        // topological rules
-                        bool collapse_ok = mesh_->is_collapse_ok(h01);
-
-                        if (hcol01)
-                            hcol01 = collapse_ok;
-                        if (hcol10)
-                            hcol10 = collapse_ok;
-
-                        // both collapses possible: collapse into vertex w/ higher valence
-                        if (hcol01 && hcol10) {
-                            if (mesh_->valence(v0) < mesh_->valence(v1))
-                                hcol10 = false;
-                            else
-                                hcol01 = false;
-                        }
-
-                        // try v1 -> v0
-                        if (hcol10) {
-                            // don't create too long edges
-                            for (auto vv : mesh_->vertices(v1)) {
-                                if (is_too_long(v0, vv)) {
-                                    hcol10 = false;
-                                    break;
-                                }
-                            }
+                const SurfaceMesh::Halfedge h = find_collapse(e);
+                if (h.is_valid()) {
+                    mesh_->collapse(h);
+                    ok = false;
+                }
+            }
+        }
 
-                            if (hcol10) {
-                                mesh_->collapse(h10);
-                                ok = false;
-                            }
-                        }
+        mesh_->collect_garbage(true);
+    }
 
-                            // try v0 -> v1
-                        else if (hcol01) {
-                            // don't create too long edges
-                            for (auto vv : mesh_->vertices(v0)) {
-                                if (is_too_long(v1, vv)) {
-                                    hcol01 = false;
-                                    break;
-                                }
-                            }
+    void SurfaceMeshRemeshing::collapse_short_edges_parallel() {
+        std::vector<SurfaceMesh::Halfedge> collapses;
+        std::vector<unsigned char> locked(mesh_->vertices_size(), 0);
+        std::vector<SurfaceMesh::Vertex> region, locked_vertices;
+
+        // the collapses are done in rounds. In each round, all the edges are evaluated in parallel, and then the
+        // collapses whose (closed) neighborhoods don't overlap are performed. Such collapses don't affect the checks
+        // of each other, so the rules are the same as for the sequential sweeps. A round does fewer collapses than a
+        // sweep, so more rounds than sweeps are allowed.
+        const int max_rounds = 50;
+        for (int round = 0; round < max_rounds; ++round) {
+            collapses.resize(mesh_->edges_size());
+            parallel::for_each(0, collapses.size(), [&](std::size_t i) {
+                collapses[i] = find_collapse(SurfaceMesh::Edge(static_cast<int>(i)));
+            });
+
+            bool ok = true;
+            for (auto h : collapses) {
+                if (!h.is_valid())
+                    continue;
+
+                const SurfaceMesh::Vertex v0 = mesh_->source(h);
+                const SurfaceMesh::Vertex v1 = mesh_->target(h);
+                region.clear();
+                region.push_back(v0);
+                region.push_back(v1);
+                for (auto vv : mesh_->vertices(v0))
+                    region.push_back(vv);
+                for (auto vv : mesh_->vertices(v1))
+                    region.push_back(vv);
+
+                bool free = true;
+                for (auto vv : region) {
+                    if (locked[vv.idx()]) {
+                        free = false;
+                        break;
+                    }
+                }
+                if (!free || !mesh_->is_collapse_ok(h))
+                    continue;
 
-                            if (hcol01) {
-                                mesh_->collapse(h01);
-                                ok = false;
-                            }
-                        }
+                for (auto vv : region) {
+                    if (!locked[vv.idx()]) {
+                        locked[vv.idx()] = 1;
+                        locked_vertices.push_back(vv);
                     }
                 }
+
+                // collapses allocate nothing, but they update the (shared) bookkeeping of the deleted elements, so
+                // they are performed one after another
+                mesh_->collapse(h);
+                ok = false;
             }
+
+            for (auto v : locked_vertices)
+                locked[v.idx()] = 0;
+            locked_vertices.clear();
+
+            if (ok)
+                break;
         }
 
-        mesh_->collect_garbage();
+        mesh_->collect_garbage(true);
     }
 
-    void SurfaceMeshRemeshing::flip_edges() {
+    bool SurfaceMeshRemeshing::is_flip_beneficial(SurfaceMesh::Edge e,
+                                                  const SurfaceMesh::VertexProperty<int> &valence) const {
         SurfaceMesh::Vertex v0, v1, v2, v3;
         SurfaceMesh::Halfedge h;
         int val0, val1, val2, val3;
         int val_opt0, val_opt1, val_opt2, val_opt3;
         int ve0, ve1, ve2, ve3, ve_before, ve_after;
+
+        if (mesh_->is_deleted(e) || elocked_[e] || efeature_[e])
+            return false;
+
+        h = mesh_->halfedge(e, 0);
+        v0 = mesh_->target(h);
+        v2 = mesh_->target(mesh_->next(h));
+        h = mesh_->halfedge(e, 1);
+        v1 = mesh_->target(h);
+        v3 = mesh_->target(mesh_->next(h));
+
+        if (vlocked_[v0] || vlocked_[v1] || vlocked_[v2] || vlocked_[v3])
+            return false;
+
+        val0 = valence[v0];
+        val1 = valence[v1];
+        val2 = valence[v2];
+        val3 = valence[v3];
+
+        val_opt0 = (mesh_->is_border(v0) ? 4 : 6);
+        val_opt1 = (mesh_->is_border(v1) ? 4 : 6);
+        val_opt2 = (mesh_->is_border(v2) ? 4 : 6);
+        val_opt3 = (mesh_->is_border(v3) ? 4 : 6);
+
+        ve0 = (val0 - val_opt0);
+        ve1 = (val1 - val_opt1);
+        ve2 = (val2 - val_opt2);
+        ve3 = (val3 - val_opt3);
+
+        ve0 *= ve0;
+        ve1 *= ve1;
+        ve2 *= ve2;
+        ve3 *= ve3;
+
+        ve_before = ve0 + ve1 + ve2 + ve3;
+
+        --val0;
+        --val1;
+        ++val2;
+        ++val3;
+
+        ve0 = (val0 - val_opt0);
+        ve1 = (val1 - val_opt1);
+        ve2 = (val2 - val_opt2);
+        ve3 = (val3 - val_opt3);
+
+        ve0 *= ve0;
+        ve1 *= ve1;
+        ve2 *= ve2;
+        ve3 *= ve3;
+
+        ve_after = ve0 + ve1 + ve2 + ve3;
+
+        return ve_before > ve_after && mesh_->is_flip_ok(e);
+    }
+
+    void SurfaceMeshRemeshing::flip_edges() {
+        SurfaceMesh::Vertex v0, v1, v2, v3;
+        SurfaceMesh::Halfedge h;
         bool ok;
         int i;
 
@@ -489,11 +650,17 @@ namespace easy3d {
             valence[v] = mesh_->valence(v);
         }
 
+        if (parallel_) {
+            flip_edges_parallel(valence);
+            mesh_->remove_vertex_property(valence);
+            return;
+        }
+
         for (ok = false, i = 0; !ok && i < 10; ++i) {
             ok = true;
 
             for (auto e : mesh_->edges()) {
-                if (!elocked_[e] && !efeature_[e]) {
+                if (is_flip_beneficial(e, valence)) {
                     h = mesh_->halfedge(e, 0);
                     v0 = mesh_->target(h);
                     v2 = mesh_->target(mesh_->next(h));
@@ -501,56 +668,12 @@ namespace easy3d {
                     v1 = mesh_->target(h);
                     v3 = mesh_->target(mesh_->next(h));
 
-                    if (!vlocked_[v0] && !vlocked_[v1] && !vlocked_[v2] &&
-                        !vlocked_[v3]) {
-                        val0 = valence[v0];
-                        val1 = valence[v1];
-                        val2 = valence[v2];
-                        val3 = valence[v3];
-
-                        val_opt0 = (mesh_->is_border(v0) ? 4 : 6);
-                        val_opt1 = (mesh_->is_border(v1) ? 4 : 6);
-                        val_opt2 = (mesh_->is_border(v2) ? 4 : 6);
-                        val_opt3 = (mesh_->is_border(v3) ? 4 : 6);
-
-                        ve0 = (val0 - val_opt0);
-                        ve1 = (val1 - val_opt1);
-                        ve2 = (val2 - val_opt2);
-                        ve3 = (val3 - val_opt3);
-
-                        ve0 *= ve0;
-                        ve1 *= ve1;
-                        ve2 *= ve2;
-                        ve3 *= ve3;
-
-                        ve_before = ve0 + ve1 + ve2 + ve3;
-
-                        --val0;
-                        --val1;
-                        ++val2;
-                        ++val3;
-
-                        ve0 = (val0 - val_opt0);
-                        ve1 = (val1 - val_opt1);
-                        ve2 = (val2 - val_opt2);
-                        ve3 = (val3 - val_opt3);
-
-                        ve0 *= ve0;
-                        ve1 *= ve1;
-                        ve2 *= ve2;
-                        ve3 *= ve3;
-
-                        ve_after = ve0 + ve1 + ve2 + ve3;
-
-                        if (ve_before > ve_after && mesh_->is_flip_ok(e)) {
-                            mesh_->flip(e);
-                            --valence[v0];
-                            --valence[v1];
-                            ++valence[v2];
-                            ++valence[v3];
-                            ok = false;
-                        }
-                    }
+                    mesh_->flip(e);
+                    --valence[v0];
+                    --valence[v1];
+                    ++valence[v2];
+                    ++valence[v3];
+                    ok = false;
                 }
             }
         }
@@ -558,28 +681,97 @@ namespace easy3d {
         mesh_->remove_vertex_property(valence);
     }
 
-    void SurfaceMeshRemeshing::tangential_smoothing(unsigned int iterations) {
-        SurfaceMesh::Vertex v1, v2, v3, vv;
-        SurfaceMesh::Edge e;
-        float w, ww;
-        vec3 u, n, t, b;
+    void SurfaceMeshRemeshing::flip_edges_parallel(SurfaceMesh::VertexProperty<int> &valence) {
+        std::vector<unsigned char> candidates(mesh_->edges_size());
+        std::vector<unsigned char> locked(mesh_->vertices_size(), 0);
+        std::vector<SurfaceMesh::Edge> flips;
+
+        // the flips below write the connectivity concurrently. If the arrays are shared with a copy of the mesh,
+        // duplicate them now instead of letting the threads wait for each other in the first write.
+        mesh_->get_vertex_property<SurfaceMesh::VertexConnectivity>("v:connectivity").array().detach();
+        mesh_->get_halfedge_property<SurfaceMesh::HalfedgeConnectivity>("h:connectivity").array().detach();
+        mesh_->get_face_property<SurfaceMesh::FaceConnectivity>("f:connectivity").array().detach();
+
+        // the flips are done in rounds. In each round, all the edges are evaluated in parallel, and then the flips
+        // whose quads (i.e., the two incident triangles) don't share any vertex are performed in parallel.
+        const int max_rounds = 50;
+        for (int round = 0; round < max_rounds; ++round) {
+            parallel::for_each(0, candidates.size(), [&](std::size_t i) {
+                candidates[i] = is_flip_beneficial(SurfaceMesh::Edge(static_cast<int>(i)), valence);
+            });
+
+            flips.clear();
+            for (std::size_t i = 0; i < candidates.size(); ++i) {
+                if (!candidates[i])
+                    continue;
+                const SurfaceMesh::Edge e(static_cast<int>(i));
+                const SurfaceMesh::Halfedge h0 = mesh_->halfedge(e, 0);
+                const SurfaceMesh::Halfedge h1 = mesh_->halfedge(e, 1);
+                const SurfaceMesh::Vertex quad[4] = {mesh_->target(h0), mesh_->target(h1),
+                                                     mesh_->target(mesh_->next(h0)), mesh_->target(mesh_->next(h1))};
+                if (locked[quad[0].idx()] || locked[quad[1].idx()] || locked[quad[2].idx()] || locked[quad[3].idx()])
+                    continue;
+                for (auto v : quad)
+                    locked[v.idx()] = 1;
+                flips.push_back(e);
+            }
+            if (flips.empty())
+                break;
+
+            // a flip only changes the connectivity of its quad, so the selected flips can be done concurrently
+            parallel::for_each(0, flips.size(), [&](std::size_t i) {
+                const SurfaceMesh::Edge e = flips[i];
+                SurfaceMesh::Halfedge h = mesh_->halfedge(e, 0);
+                const SurfaceMesh::Vertex v0 = mesh_->target(h);
+                const SurfaceMesh::Vertex v2 = mesh_->target(mesh_->next(h));
+                h = mesh_->halfedge(e, 1);
+                const SurfaceMesh::Vertex v1 = mesh_->target(h);
+                const SurfaceMesh::Vertex v3 = mesh_->target(mesh_->next(h));
+
+                mesh_->flip(e);
+                --valence[v0];
+                --valence[v1];
+                ++valence[v2];
+                ++valence[v3];
+                locked[v0.idx()] = locked[v1.idx()] = locked[v2.idx()] = locked[v3.idx()] = 0;
+            });
+        }
+    }
 
+    void SurfaceMeshRemeshing::tangential_smoothing(unsigned int iterations) {
         // add property
         SurfaceMesh::VertexProperty <vec3> update = mesh_->add_vertex_property<vec3>("v:update");
 
+        // the positions and normals are written concurrently below. If they are shared with a copy of the mesh,
+        // duplicate them now instead of letting the threads wait for each other in the first write.
+        points_.array().detach();
+        vnormal_.array().detach();
+
+        // the vertices are processed independently of each other (each update is computed from the positions of
+        // the previous iteration), so all of this is done in parallel
+        const std::size_t num_vertices = mesh_->vertices_size();
+        auto is_movable = [&](SurfaceMesh::Vertex v) -> bool {
+            return !mesh_->is_deleted(v) && !mesh_->is_border(v) && !vlocked_[v];
+        };
+
         // project at the beginning to get valid sizing values and normal vectors
         // for vertices introduced by splitting
         if (use_projection_) {
-            for (auto v : mesh_->vertices()) {
-                if (!mesh_->is_border(v) && !vlocked_[v]) {
+            parallel::for_each(0, num_vertices, [&](std::size_t i) {
+                const SurfaceMesh::Vertex v(static_cast<int>(i));
+                if (is_movable(v))
                     project_to_reference(v);
-                }
-            }
+            });
         }
 
         for (unsigned int iters = 0; iters < iterations; ++iters) {
-            for (auto v : mesh_->vertices()) {
-                if (!mesh_->is_border(v) && !vlocked_[v]) {
+            parallel::for_each(0, num_vertices, [&](std::size_t i) {
+                const SurfaceMesh::Vertex v(static_cast<int>(i));
+                SurfaceMesh::Vertex vv;
+                float w, ww;
+                vec3 u, n, t, b;
+
+                if (is_movable(v)) {
                     if (vfeature_[v]) {
                         u = vec3(0.0);
                         t = vec3(0.0);
@@ -634,14 +826,14 @@ namespace easy3d {
                         update[v] = u;
                     }
                 }
-            }
+            });
 
             // update vertex positions
-            for (auto v : mesh_->vertices()) {
-                if (!mesh_->is_border(v) && !vlocked_[v]) {
+            parallel::for_each(0, num_vertices, [&](std::size_t i) {
+                const SurfaceMesh::Vertex v(static_cast<int>(i));
+                if (is_movable(v))
                     points_[v] += update[v];
-                }
-            }
+            });
 
             // update normal vectors (if not done so through projection)
             mesh_->update_vertex_normals();
@@ -649,11 +841,11 @@ namespace easy3d {
 
         // project at the end
         if (use_projection_) {
-            for (auto v : mesh_->vertices()) {
-                if (!mesh_->is_border(v) && !vlocked_[v]) {
+            parallel::for_each(0, num_vertices, [&](std::size_t i) {
+                const SurfaceMesh::Vertex v(static_cast<int>(i));
+                if (is_movable(v))
                     project_to_reference(v);
-                }
-            }
+            });
         }
 
         // remove property
@@ -16,7 +16,7 @@
 
 namespace easy3d {
 
-    class TriangleMeshKdTree;
+    class TriangleMeshBVH;
 
     /**
      * \brief A class for uniform and adaptive surface remeshing.
@@ -27,6 +27,9 @@ namespace easy3d {
      * and tangential relaxation. See the following papers for more details:
      *  - Mario Botsch and Leif Kobbelt. A remeshing approach to multiresolution modeling. SGP, 2004.
      *  - Marion Dunyach et al. Adaptive remeshing for real-time mesh deformation. EG (Short Papers) 2013.
+     * The tangential smoothing and the projection to the input surface always run in parallel. In the parallel mode,
+     * the edge collapses and flips are also done in rounds of non-overlapping operations, which are evaluated (and
+     * for flips also performed) in parallel.
      */
     class SurfaceMeshRemeshing {
     public:
@@ -38,8 +41,10 @@ namespace easy3d {
         //! \param edge_length the target edge length.
         //! \param iterations the number of iterations
         //! \param use_projection use back-projection to the input surface
+        //! \param parallel use the parallel mode. The result is deterministic, but it differs from the sequential
+        //!     one because the collapses and flips are done in a different order.
         void uniform_remeshing(float edge_length, unsigned int iterations = 10,
-                               bool use_projection = true);
+                               bool use_projection = true, bool parallel = false);
 
         //! \brief Perform adaptive remeshing.
         //! \param min_edge_length the minimum edge length.
@@ -47,16 +52,27 @@ namespace easy3d {
         //! \param approx_error the maximum approximation error
         //! \param iterations the number of iterations
         //! \param use_projection use back-projection to the input surface
+        //! \param parallel use the parallel mode (see uniform_remeshing()).
         void adaptive_remeshing(float min_edge_length, float max_edge_length,
                                 float approx_error, unsigned int iterations = 10,
-                                bool use_projection = true);
+                                bool use_projection = true, bool parallel = false);
 
     private:
         void preprocessing();
         void postprocessing();
         void split_long_edges();
         void collapse_short_edges();
+        void collapse_short_edges_parallel();
         void flip_edges();
+        void flip_edges_parallel(SurfaceMesh::VertexProperty<int> &valence);
+
+        // the halfedge to be collapsed for edge e (invalid if the edge should not be collapsed). It doesn't modify
+        // the mesh, so it can be called concurrently.
+        SurfaceMesh::Halfedge find_collapse(SurfaceMesh::Edge e) const;
+
+        // does flipping edge e improve the valences? It doesn't modify the mesh, so it can be called concurrently.
+        bool is_flip_beneficial(SurfaceMesh::Edge e, const SurfaceMesh::VertexProperty<int> &valence) const;
+
         void tangential_smoothing(unsigned int iterations);
         void remove_caps();
         vec3 minimize_squared_areas(SurfaceMesh::Vertex v);
@@ -77,7 +93,8 @@ namespace easy3d {
         SurfaceMesh *refmesh_;
 
         bool use_projection_;
-        TriangleMeshKdTree *kd_tree_;
+        TriangleMeshBVH *bvh_;
+        bool parallel_;
 
         bool uniform_;
         float target_edge_length_;
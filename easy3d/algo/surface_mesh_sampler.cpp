@@ -25,10 +25,12 @@
  ********************************************************************/
 
 #include <easy3d/algo/surface_mesh_sampler.h>
+#include <random>
 #include <easy3d/core/surface_mesh.h>
 #include <easy3d/core/point_cloud.h>
 #include <easy3d/util/file_system.h>
 #include <easy3d/util/progress.h>
+#include <easy3d/util/parallel.h>
 #include <easy3d/algo/surface_mesh_triangulation.h>
 
 
@@ -68,54 +70,45 @@ namespace easy3d {
                 return cloud;   // we got enough points already
 
             // collect triangles and compute their areas
-            struct Triangle : std::vector<SurfaceMesh::Vertex> {};
-
-            std::vector<Triangle> triangles;
-            std::vector<float> triangle_areas;
-            std::vector<vec3> triangle_normals;
-
-            auto mesh_face_normals = mesh->get_face_property<vec3>("f:normal");
-            float surface_area = 0.0f;
-            for (auto f : mesh->faces()) {
-                const vec3 &n = mesh_face_normals[f];
-                SurfaceMesh::Halfedge start = mesh->halfedge(f);
-                SurfaceMesh::Halfedge cur = mesh->next(mesh->next(start));
-                SurfaceMesh::Vertex va = mesh->target(start);
-                while (cur != start) {
-                    SurfaceMesh::Vertex vb = mesh->source(cur);
-                    SurfaceMesh::Vertex vc = mesh->target(cur);
-
-                    Triangle tri;
-                    tri.push_back(va);
-                    tri.push_back(vb);
-                    tri.push_back(vc);
-                    triangles.push_back(tri);
-                    float area = geom::triangle_area(mesh_points[va], mesh_points[vb], mesh_points[vc]);
-                    triangle_areas.push_back(area);
-                    triangle_normals.push_back(n);
-                    surface_area += area;
-
-                    cur = mesh->next(cur);
+            struct Triangle {
+                SurfaceMesh::Vertex vertices[3];
+            };
+
+            std::vector<SurfaceMesh::Face> faces;
+            faces.reserve(mesh->n_faces());
+            for (auto f : mesh->faces())
+                faces.push_back(f);
+
+            const std::size_t triangle_num = faces.size();
+            std::vector<Triangle> triangles(triangle_num);
+            std::vector<float> triangle_areas(triangle_num);
+            parallel::for_each(0, triangle_num, [&](std::size_t idx) {
+                SurfaceMesh::Halfedge h = mesh->halfedge(faces[idx]);
+                Triangle &tri = triangles[idx];
+                for (auto &v : tri.vertices) {
+                    v = mesh->target(h);
+                    h = mesh->next(h);
                 }
-            }
-
+                triangle_areas[idx] = geom::triangle_area(
+                        mesh_points[tri.vertices[0]], mesh_points[tri.vertices[1]], mesh_points[tri.vertices[2]]);
+            });
+
+            const float surface_area = parallel::reduce(0, triangle_num, 0.0f,
+                    [&](std::size_t begin, std::size_t end) -> float {
+                        float area = 0.0f;
+                        for (std::size_t idx = begin; idx < end; ++idx)
+                            area += triangle_areas[idx];
+                        return area;
+                    },
+                    std::plus<float>()
+            );
+
+            // the number of samples of each triangle (considering the facet size, i.e., area). This is a sequential
+            // pass because the quantization error is accumulated over the triangles.
             float density = static_cast<float>(num_needed) / surface_area;
             float samples_error = 0.0f;
-            std::size_t triangle_num = triangles.size();
-            std::size_t num_generated = 0;
-            std::size_t triangles_done = 0;
-            ProgressLogger progress(triangle_num, false, false);
+            std::vector<std::size_t> offsets(triangle_num + 1, 0);
             for (std::size_t idx = 0; idx < triangle_num; ++idx) {
-                if (progress.is_canceled()) {
-                    LOG(WARNING) << "sampling surface mesh cancelled";
-                    delete cloud;
-                    return nullptr;
-                }
-
-                const Triangle &tri = triangles[idx];
-                const vec3 &n = triangle_normals[idx];
-
-                // samples number considering the facet size (i.e., area)
                 float samples_num = triangle_areas[idx] * density;
                 int quant_samples_num = static_cast<int>(samples_num);
 
@@ -126,32 +119,62 @@ namespace easy3d {
                     quant_samples_num++;
                 }
 
-                if (triangles_done ==
-                    triangle_num - 1)        // override number to gather all remaining points if last facet
-                    quant_samples_num = num_needed - static_cast<int>(num_generated);
-
-                // generate points
-                for (int j = 0; j < quant_samples_num; j++) {
-                    // compute barycentric coords
-                    double s = std::sqrt(static_cast<double>(rand()) / static_cast<double>(RAND_MAX));
-                    double t = static_cast<double>(rand()) / static_cast<double>(RAND_MAX);
-                    double c[3];
+                if (idx == triangle_num - 1)   // override number to gather all remaining points if last facet
+                    quant_samples_num = num_needed - static_cast<int>(offsets[idx]);
 
-                    c[0] = 1.0 - s;
-                    c[1] = s * (1.0 - t);
-                    c[2] = s * t;
+                offsets[idx + 1] = offsets[idx] + static_cast<std::size_t>(std::max(quant_samples_num, 0));
+            }
 
-                    vec3 p;
-                    for (std::size_t i = 0; i < 3; i++)
-                        p = p + c[i] * mesh_points[tri[i]];
+            // allocate all the samples at once, then generate them in parallel
+            const std::size_t first_sample = cloud->vertices_size();
+            cloud->resize(static_cast<unsigned int>(first_sample + offsets[triangle_num]));
+            std::vector<vec3> &points = cloud->points();
+            std::vector<vec3> &point_normals = normals.vector();
+            auto mesh_face_normals = mesh->get_face_property<vec3>("f:normal");
 
-                    PointCloud::Vertex v = cloud->add_vertex(p);
-                    normals[v] = n;
+            // the triangles are processed in batches, so the progress can be reported (and the sampling can be
+            // canceled) from the calling thread
+            const std::size_t num_batches = std::min<std::size_t>(100, triangle_num);
+            ProgressLogger progress(triangle_num, false, false);
+            for (std::size_t batch = 0; batch < num_batches; ++batch) {
+                if (progress.is_canceled()) {
+                    LOG(WARNING) << "sampling surface mesh cancelled";
+                    delete cloud;
+                    return nullptr;
                 }
 
-                num_generated += quant_samples_num;
-                triangles_done++;
-                progress.next();
+                const std::size_t batch_begin = batch * triangle_num / num_batches;
+                const std::size_t batch_end = (batch + 1) * triangle_num / num_batches;
+                parallel::for_each_range(batch_begin, batch_end, [&](std::size_t begin, std::size_t end) {
+                    // the random numbers depend only on the chunk, so the result doesn't depend on the threads
+                    std::mt19937 generator(static_cast<unsigned int>(begin));
+                    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+                    for (std::size_t idx = begin; idx < end; ++idx) {
+                        const Triangle &tri = triangles[idx];
+                        const vec3 &n = mesh_face_normals[faces[idx]];
+
+                        // generate points
+                        for (std::size_t j = offsets[idx]; j < offsets[idx + 1]; ++j) {
+                            // compute barycentric coords
+                            double s = std::sqrt(uniform(generator));
+                            double t = uniform(generator);
+                            double c[3];
+
+                            c[0] = 1.0 - s;
+                            c[1] = s * (1.0 - t);
+                            c[2] = s * t;
+
+                            vec3 p;
+                            for (std::size_t i = 0; i < 3; i++)
+                                p = p + c[i] * mesh_points[tri.vertices[i]];
+
+                            points[first_sample + j] = p;
+                            point_normals[first_sample + j] = n;
+                        }
+                    }
+                });
+
+                progress.notify(batch_end);
             }
 
             LOG(INFO) << "done. resulted point cloud has " << cloud->n_vertices() << " points";
@@ -12,11 +12,41 @@
 #include <easy3d/algo/surface_mesh_simplification.h>
 
 #include <cfloat>
+#include <algorithm>
 #include <iterator> // for back_inserter on Windows
 
+#include <easy3d/util/parallel.h>
+
+#include <Eigen/Eigenvalues>
+
 
 namespace easy3d {
 
+    dvec3 Quadric::minimizer(const dvec3 &p) const {
+        Eigen::Matrix3d A;
+        A << a_, b_, c_,
+             b_, e_, f_,
+             c_, f_, h_;
+        const Eigen::Vector3d b(d_, g_, i_);
+        const Eigen::Vector3d x0(p.x, p.y, p.z);
+
+        // the gradient vanishes where A * x = -b. Solved by the pseudo-inverse of A around p, i.e., the (relatively)
+        // small eigenvalues are truncated.
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(A);
+        const Eigen::Vector3d &lambda = solver.eigenvalues();
+        const Eigen::Matrix3d &V = solver.eigenvectors();
+        const double threshold = 1e-3 * lambda.cwiseAbs().maxCoeff();
+        const Eigen::Vector3d r = -b - A * x0;
+        Eigen::Vector3d x = x0;
+        for (int i = 0; i < 3; ++i) {
+            if (std::abs(lambda[i]) > threshold && threshold > 0.0)
+                x += V.col(i) * (V.col(i).dot(r) / lambda[i]);
+        }
+        return dvec3(x[0], x[1], x[2]);
+    }
+
+    //-----------------------------------------------------------------------------
+
     SurfaceMeshSimplification::SurfaceMeshSimplification(SurfaceMesh *mesh)
             : mesh_(mesh), initialized_(false), queue_(nullptr), has_selection_(false), has_features_(false) {
         aspect_ratio_ = 0;
@@ -121,7 +151,7 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
-    void SurfaceMeshSimplification::simplify(unsigned int n_vertices) {
+    void SurfaceMeshSimplification::simplify(unsigned int n_vertices, float max_error, bool parallel) {
         if (!mesh_->is_triangle_mesh()) {
             std::cerr << "Not a triangle mesh!" << std::endl;
             return;
@@ -131,11 +161,33 @@ namespace easy3d {
         if (!initialized_)
             initialize();
 
-        // add properties for priority queue
+        // add properties for the best collapse of each vertex
         vpriority_ = mesh_->add_vertex_property<float>("v:prio");
-        heap_pos_ = mesh_->add_vertex_property<int>("v:heap");
         vtarget_ = mesh_->add_vertex_property<SurfaceMesh::Halfedge>("v:target");
 
+        collapses_.clear();
+        if (parallel)
+            simplify_parallel(n_vertices, max_error);
+        else
+            simplify_sequential(n_vertices, max_error);
+
+        // clean up
+        mesh_->collect_garbage(true);
+        mesh_->remove_vertex_property(vpriority_);
+        mesh_->remove_vertex_property(vtarget_);
+
+        // remove added properties
+        mesh_->remove_vertex_property(vquadric_);
+        mesh_->remove_face_property(normal_cone_);
+        mesh_->remove_face_property(face_points_);
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshSimplification::simplify_sequential(unsigned int n_vertices, float max_error) {
+        // add properties for priority queue
+        heap_pos_ = mesh_->add_vertex_property<int>("v:heap");
+
         // build priority queue
         HeapInterface hi(vpriority_, heap_pos_);
         queue_ = new PriorityQueue(hi);
@@ -153,6 +205,8 @@ namespace easy3d {
         while (nv > n_vertices && !queue_->empty()) {
             // get 1st element
             v = queue_->front();
+            if (vpriority_[v] > max_error)
+                break;
             queue_->pop_front();
             h = vtarget_[v];
             CollapseData cd(mesh_, h);
@@ -161,6 +215,13 @@ namespace easy3d {
             if (!mesh_->is_collapse_ok(h))
                 continue;
 
+            // the priority is not updated when a collapse in the neighborhood changes the quadric of the target
+            // vertex, so check the bound with the current one
+            if (max_error < FLT_MAX && priority(cd) > max_error) {
+                enqueue_vertex(v);
+                continue;
+            }
+
             // store one-ring
             one_ring.clear();
             for (auto vv : mesh_->vertices(cd.v0)) {
@@ -169,6 +230,7 @@ namespace easy3d {
 
             // perform collapse
             mesh_->collapse(h);
+            collapses_.push_back({cd.v0, cd.v1, cd.fl, cd.fr});
             --nv;
             //if (nv % 1000 == 0) std::cerr << nv << "\r";
 
@@ -181,24 +243,129 @@ namespace easy3d {
                 enqueue_vertex(*or_it);
         }
 
-        // clean up
         delete queue_;
-        mesh_->collect_garbage();
-        mesh_->remove_vertex_property(vpriority_);
+        queue_ = nullptr;
         mesh_->remove_vertex_property(heap_pos_);
-        mesh_->remove_vertex_property(vtarget_);
+    }
 
-        // remove added properties
-        mesh_->remove_vertex_property(vquadric_);
-        mesh_->remove_face_property(normal_cone_);
-        mesh_->remove_face_property(face_points_);
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshSimplification::simplify_parallel(unsigned int n_vertices, float max_error) {
+        // the best collapses are stored in plain arrays, which are written concurrently
+        float *priority = vpriority_.vector().data();
+        SurfaceMesh::Halfedge *target = vtarget_.vector().data();
+
+        auto evaluate = [&](const std::vector<SurfaceMesh::Vertex> &vertices) {
+            parallel::for_each(0, vertices.size(), [&](std::size_t i) {
+                const int v = vertices[i].idx();
+                if (!find_collapse(vertices[i], target[v], priority[v])) {
+                    priority[v] = -1;
+                    target[v] = SurfaceMesh::Halfedge();
+                }
+            });
+        };
+
+        std::vector<SurfaceMesh::Vertex> candidates;
+        candidates.reserve(mesh_->n_vertices());
+        for (auto v : mesh_->vertices())
+            candidates.push_back(v);
+        evaluate(candidates);
+
+        std::vector<unsigned char> locked(mesh_->vertices_size(), 0);
+        std::vector<SurfaceMesh::Vertex> locked_vertices, region, dirty;
+        std::vector<CollapseData> collapses;
+
+        unsigned int nv(mesh_->n_vertices());
+        while (nv > n_vertices) {
+            // the candidates in the order of their priorities (the ties are broken by the vertex indices, so the
+            // result does not depend on the number of threads)
+            candidates.clear();
+            for (auto v : mesh_->vertices()) {
+                if (target[v.idx()].is_valid() && priority[v.idx()] <= max_error)
+                    candidates.push_back(v);
+            }
+            if (candidates.empty())
+                break;
+            std::sort(candidates.begin(), candidates.end(), [&](SurfaceMesh::Vertex a, SurfaceMesh::Vertex b) {
+                return priority[a.idx()] < priority[b.idx()] ||
+                       (priority[a.idx()] == priority[b.idx()] && a.idx() < b.idx());
+            });
+
+            // greedily select independent collapses among the cheapest quarter of the candidates. The closed
+            // neighborhoods of the two vertices of the selected collapses are disjoint, so the collapses neither
+            // touch the same elements nor affect the checks of each other.
+            const std::size_t num_scan = std::max<std::size_t>(1, candidates.size() / 4);
+            collapses.clear();
+            for (std::size_t i = 0; i < num_scan && collapses.size() < nv - n_vertices; ++i) {
+                CollapseData cd(mesh_, target[candidates[i].idx()]);
+                region.clear();
+                region.push_back(cd.v0);
+                region.push_back(cd.v1);
+                for (auto vv : mesh_->vertices(cd.v0))
+                    region.push_back(vv);
+                for (auto vv : mesh_->vertices(cd.v1))
+                    region.push_back(vv);
+
+                bool free = true;
+                for (auto vv : region) {
+                    if (locked[vv.idx()]) {
+                        free = false;
+                        break;
+                    }
+                }
+                if (!free)
+                    continue;
+
+                for (auto vv : region) {
+                    if (!locked[vv.idx()]) {
+                        locked[vv.idx()] = 1;
+                        locked_vertices.push_back(vv);
+                    }
+                }
+                collapses.push_back(cd);
+            }
+
+            // perform the collapses. The topological changes are applied one after another because they all update
+            // the (shared) bookkeeping of the deleted elements of the mesh.
+            dirty.clear();
+            std::size_t num = 0;
+            for (const auto &cd : collapses) {
+                if (!mesh_->is_collapse_ok(cd.v0v1)) {
+                    priority[cd.v0.idx()] = -1;
+                    target[cd.v0.idx()] = SurfaceMesh::Halfedge();
+                    continue;
+                }
+                mesh_->collapse(cd.v0v1);
+                // the one-ring of v1 now covers that of v0, and its vertices may collapse into v1, whose quadric
+                // changes
+                dirty.push_back(cd.v1);
+                for (auto vv : mesh_->vertices(cd.v1))
+                    dirty.push_back(vv);
+                collapses_.push_back({cd.v0, cd.v1, cd.fl, cd.fr});
+                collapses[num++] = cd;
+                --nv;
+            }
+            collapses.erase(collapses.begin() + num, collapses.end());
+
+            // postprocessing, e.g., update quadrics
+            parallel::for_each(0, collapses.size(), [&](std::size_t i) { postprocess_collapse(collapses[i]); });
+
+            // re-evaluate the vertices around the collapses
+            evaluate(dirty);
+
+            for (auto v : locked_vertices)
+                locked[v.idx()] = 0;
+            locked_vertices.clear();
+        }
     }
 
     //-----------------------------------------------------------------------------
 
-    void SurfaceMeshSimplification::enqueue_vertex(SurfaceMesh::Vertex v) {
-        float prio, min_prio(FLT_MAX);
-        SurfaceMesh::Halfedge min_h;
+    bool SurfaceMeshSimplification::find_collapse(SurfaceMesh::Vertex v, SurfaceMesh::Halfedge &min_h,
+                                                  float &min_prio) const {
+        float prio;
+        min_prio = FLT_MAX;
+        min_h = SurfaceMesh::Halfedge();
 
         // find best out-going halfedge
         for (auto h : mesh_->halfedges(v)) {
@@ -212,8 +379,17 @@ namespace easy3d {
             }
         }
 
+        return min_h.is_valid();
+    }
+
+    //-----------------------------------------------------------------------------
+
+    void SurfaceMeshSimplification::enqueue_vertex(SurfaceMesh::Vertex v) {
+        float min_prio;
+        SurfaceMesh::Halfedge min_h;
+
         // target found -> put vertex on heap
-        if (min_h.is_valid()) {
+        if (find_collapse(v, min_h, min_prio)) {
             vpriority_[v] = min_prio;
             vtarget_[v] = min_h;
 
@@ -235,7 +411,7 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
-    bool SurfaceMeshSimplification::is_collapse_legal(const CollapseData &cd) {
+    bool SurfaceMeshSimplification::is_collapse_legal(const CollapseData &cd) const {
         // test selected vertices
         if (has_selection_) {
             if (!vselected_[cd.v0])
@@ -294,26 +470,20 @@ namespace easy3d {
             }
         }
 
-        // check for flipping normals
+        // check for flipping normals (the faces are evaluated with v0 moved to p1)
         if (normal_deviation_ == 0.0) {
-            vpoint_[cd.v0] = p1;
             for (auto f : mesh_->faces(cd.v0)) {
                 if (f != cd.fl && f != cd.fr) {
                     vec3 n0 = fnormal_[f];
-                    vec3 n1 = mesh_->compute_face_normal(f);
-                    if (dot(n0, n1) < 0.0) {
-                        vpoint_[cd.v0] = p0;
+                    vec3 n1 = face_normal(f, cd.v0, p1);
+                    if (dot(n0, n1) < 0.0)
                         return false;
-                    }
                 }
             }
-            vpoint_[cd.v0] = p0;
         }
 
             // check normal cone
         else {
-            vpoint_[cd.v0] = p1;
-
             SurfaceMesh::Face fll, frr;
             if (cd.vl.is_valid())
                 fll = mesh_->face(
@@ -325,21 +495,17 @@ namespace easy3d {
             for (auto f : mesh_->faces(cd.v0)) {
                 if (f != cd.fl && f != cd.fr) {
                     NormalCone nc = normal_cone_[f];
-                    nc.merge(mesh_->compute_face_normal(f));
+                    nc.merge(face_normal(f, cd.v0, p1));
 
                     if (f == fll)
                         nc.merge(normal_cone_[cd.fl]);
                     if (f == frr)
                         nc.merge(normal_cone_[cd.fr]);
 
-                    if (nc.angle() > 0.5 * normal_deviation_) {
-                        vpoint_[cd.v0] = p0;
+                    if (nc.angle() > 0.5 * normal_deviation_)
                         return false;
-                    }
                 }
             }
-
-            vpoint_[cd.v0] = p0;
         }
 
         // check aspect ratio
@@ -349,10 +515,8 @@ namespace easy3d {
             for (auto f : mesh_->faces(cd.v0)) {
                 if (f != cd.fl && f != cd.fr) {
                     // worst aspect ratio after collapse
-                    vpoint_[cd.v0] = p1;
-                    ar1 = std::max(ar1, aspect_ratio(f));
+                    ar1 = std::max(ar1, aspect_ratio(f, cd.v0, p1));
                     // worst aspect ratio before collapse
-                    vpoint_[cd.v0] = p0;
                     ar0 = std::max(ar0, aspect_ratio(f));
                 }
             }
@@ -372,28 +536,24 @@ namespace easy3d {
                 std::copy(face_points_[f].begin(), face_points_[f].end(),
                           std::back_inserter(points));
             }
-            points.push_back(vpoint_[cd.v0]);
+            points.push_back(p0);
 
             // test points against all faces
-            vpoint_[cd.v0] = p1;
             for (auto point : points) {
                 ok = false;
 
                 for (auto f : mesh_->faces(cd.v0)) {
                     if (f != cd.fl && f != cd.fr) {
-                        if (distance(f, point) < hausdorff_error_) {
+                        if (distance(f, point, cd.v0, p1) < hausdorff_error_) {
                             ok = true;
                             break;
                         }
                     }
                 }
 
-                if (!ok) {
-                    vpoint_[cd.v0] = p0;
+                if (!ok)
                     return false;
-                }
             }
-            vpoint_[cd.v0] = p0;
         }
 
         // collapse passed all tests -> ok
@@ -402,7 +562,7 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
-    float SurfaceMeshSimplification::priority(const CollapseData &cd) {
+    float SurfaceMeshSimplification::priority(const CollapseData &cd) const {
         // computer quadric error metric
         Quadric Q = vquadric_[cd.v0];
         Q += vquadric_[cd.v1];
@@ -484,16 +644,37 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
-    float SurfaceMeshSimplification::aspect_ratio(SurfaceMesh::Face f) const {
+    void SurfaceMeshSimplification::corners(SurfaceMesh::Face f, SurfaceMesh::Vertex v, const vec3 &q,
+                                            vec3 &p0, vec3 &p1, vec3 &p2) const {
+        SurfaceMesh::VertexAroundFaceCirculator fvit = mesh_->vertices(f);
+
+        const SurfaceMesh::Vertex v0 = *fvit;
+        const SurfaceMesh::Vertex v1 = *(++fvit);
+        const SurfaceMesh::Vertex v2 = *(++fvit);
+
+        p0 = (v0 == v) ? q : vpoint_[v0];
+        p1 = (v1 == v) ? q : vpoint_[v1];
+        p2 = (v2 == v) ? q : vpoint_[v2];
+    }
+
+    //-----------------------------------------------------------------------------
+
+    vec3 SurfaceMeshSimplification::face_normal(SurfaceMesh::Face f, SurfaceMesh::Vertex v, const vec3 &q) const {
+        // same as SurfaceMesh::compute_face_normal() for triangles
+        vec3 p0, p1, p2;
+        corners(f, v, q, p0, p1, p2);
+        return cross(p2 - p1, p0 - p1).normalize();
+    }
+
+    //-----------------------------------------------------------------------------
+
+    float SurfaceMeshSimplification::aspect_ratio(SurfaceMesh::Face f, SurfaceMesh::Vertex v, const vec3 &q) const {
         // min height is area/maxLength
         // aspect ratio = length / height
         //              = length * length / area
 
-        SurfaceMesh::VertexAroundFaceCirculator fvit = mesh_->vertices(f);
-
-        const vec3 p0 = vpoint_[*fvit];
-        const vec3 p1 = vpoint_[*(++fvit)];
-        const vec3 p2 = vpoint_[*(++fvit)];
+        vec3 p0, p1, p2;
+        corners(f, v, q, p0, p1, p2);
 
         const vec3 d0 = p0 - p1;
         const vec3 d1 = p1 - p2;
@@ -514,12 +695,10 @@ namespace easy3d {
 
     //-----------------------------------------------------------------------------
 
-    float SurfaceMeshSimplification::distance(SurfaceMesh::Face f, const vec3 &p) const {
-        SurfaceMesh::VertexAroundFaceCirculator fvit = mesh_->vertices(f);
-
-        const vec3 p0 = vpoint_[*fvit];
-        const vec3 p1 = vpoint_[*(++fvit)];
-        const vec3 p2 = vpoint_[*(++fvit)];
+    float SurfaceMeshSimplification::distance(SurfaceMesh::Face f, const vec3 &p, SurfaceMesh::Vertex v,
+                                              const vec3 &q) const {
+        vec3 p0, p1, p2;
+        corners(f, v, q, p0, p1, p2);
 
         vec3 n;
         return geom::dist_point_triangle(p, p0, p1, p2, n);
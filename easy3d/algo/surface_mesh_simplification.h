@@ -17,6 +17,7 @@
 
 #include <set>
 #include <vector>
+#include <cfloat>
 
 
 namespace easy3d {
@@ -88,6 +89,10 @@ namespace easy3d {
                    + j_;
         }
 
+        //! find the position minimizing the quadric. In the directions in which the quadric is (nearly) constant,
+        //! the minimizer is not unique and the position closest to \p p is taken.
+        dvec3 minimizer(const dvec3 &p) const;
+
     private:
 
         double a_, b_, c_, d_,
@@ -162,6 +167,8 @@ namespace easy3d {
      * for more details:
      *  - Michael Garland and Paul Seagrave Heckbert. Surface simplification using quadric error metrics. SIGGRAPH 1997.
      *  - Leif Kobbelt et al. A general framework for mesh decimation. In Proceedings of Graphics Interface, 1998.
+     * In the parallel mode, the mesh is simplified in rounds. Each round evaluates the collapses in parallel, selects a
+     * maximal set of non-overlapping collapses among the cheapest ones, and performs them at once.
      */
     class SurfaceMeshSimplification {
     public:
@@ -176,8 +183,30 @@ namespace easy3d {
                         unsigned int max_valence = 0, float normal_deviation = 0.0,
                         float hausdorff_error = 0.0);
 
-        //! Simplify mesh to \p n vertices.
-        void simplify(unsigned int n_vertices);
+        //! \brief Simplify mesh to \p n_vertices vertices.
+        //! \param n_vertices The number of vertices of the simplified mesh.
+        //! \param max_error The maximum quadric error (i.e., the sum of the squared distances to the planes of the
+        //!     merged faces) of a collapse. The simplification stops before the cheapest collapse exceeds it. To
+        //!     simplify the mesh up to this error only, pass 0 for \p n_vertices.
+        //! \param parallel If true, the mesh is simplified in rounds of independent collapses, which are evaluated
+        //!     and processed in parallel. The result is deterministic, but it is not the same as the sequential one,
+        //!     which always performs the globally cheapest collapse next.
+        void simplify(unsigned int n_vertices, float max_error = FLT_MAX, bool parallel = false);
+
+        //! A halfedge collapse performed by simplify(): vertex \c v0 was merged into vertex \c v1, and the faces
+        //! \c fl and \c fr (which may be invalid on the boundary) were removed.
+        struct CollapseRecord {
+            SurfaceMesh::Vertex v0;
+            SurfaceMesh::Vertex v1;
+            SurfaceMesh::Face fl;
+            SurfaceMesh::Face fr;
+        };
+
+        //! \brief The collapses performed by the last call of simplify(), in the order they were performed.
+        //! \details The elements are referred to by their indices before simplification, i.e., before the garbage
+        //!     collection at the end of simplify(). Replaying the record in reverse order (as vertex splits) restores
+        //!     the original mesh from the simplified one.
+        const std::vector<CollapseRecord> &collapses() const { return collapses_; }
 
     private:
         //! Store data for an halfedge collapse
@@ -235,23 +264,40 @@ namespace easy3d {
         typedef std::vector<vec3> Points;
 
     private:
+        // simplify by collapsing the cheapest halfedge one at a time
+        void simplify_sequential(unsigned int n_vertices, float max_error);
+
+        // simplify in rounds of independent collapses
+        void simplify_parallel(unsigned int n_vertices, float max_error);
+
         // put the vertex v in the priority queue
         void enqueue_vertex(SurfaceMesh::Vertex v);
 
-        // is collapsing the halfedge h allowed?
-        bool is_collapse_legal(const CollapseData &cd);
+        // find the cheapest legal collapse of the out-going halfedges of v. Returns false if there is none.
+        bool find_collapse(SurfaceMesh::Vertex v, SurfaceMesh::Halfedge &h, float &prio) const;
+
+        // is collapsing the halfedge h allowed? (It does not modify the mesh, so it can be called concurrently.)
+        bool is_collapse_legal(const CollapseData &cd) const;
 
         // what is the priority of collapsing the halfedge h
-        float priority(const CollapseData &cd);
+        float priority(const CollapseData &cd) const;
 
         // postprocess halfedge collapse
         void postprocess_collapse(const CollapseData &cd);
 
-        // compute aspect ratio for face f
-        float aspect_ratio(SurfaceMesh::Face f) const;
+        // the corners of triangle f, where vertex v (if valid) is placed at position q
+        void corners(SurfaceMesh::Face f, SurfaceMesh::Vertex v, const vec3 &q, vec3 &p0, vec3 &p1, vec3 &p2) const;
+
+        // compute normal of face f, where vertex v is placed at position q
+        vec3 face_normal(SurfaceMesh::Face f, SurfaceMesh::Vertex v, const vec3 &q) const;
 
-        // compute distance from p to triangle f
-        float distance(SurfaceMesh::Face f, const vec3 &p) const;
+        // compute aspect ratio for face f, where vertex v (if valid) is placed at position q
+        float aspect_ratio(SurfaceMesh::Face f, SurfaceMesh::Vertex v = SurfaceMesh::Vertex(),
+                           const vec3 &q = vec3(0, 0, 0)) const;
+
+        // compute distance from p to triangle f, where vertex v (if valid) is placed at position q
+        float distance(SurfaceMesh::Face f, const vec3 &p, SurfaceMesh::Vertex v = SurfaceMesh::Vertex(),
+                       const vec3 &q = vec3(0, 0, 0)) const;
 
     private:
         SurfaceMesh *mesh_;
@@ -273,6 +319,8 @@ namespace easy3d {
 
         PriorityQueue *queue_;
 
+        std::vector<CollapseRecord> collapses_;
+
         bool has_selection_;
         bool has_features_;
         float normal_deviation_;
@@ -15,19 +15,21 @@
 #include <Eigen/Sparse>
 
 #include <easy3d/algo/surface_mesh_geometry.h>
+#include <easy3d/algo/sparse_solver.h>
+#include <easy3d/util/parallel.h>
+#include <easy3d/util/logging.h>
 
 
 namespace easy3d {
 
     // \cond
-    using SparseMatrix = Eigen::SparseMatrix<double>;
-    using Triplet = Eigen::Triplet<double>;
+    using Triplet = SparseSolver::Triplet;
     // \endcond
 
     //-----------------------------------------------------------------------------
 
     SurfaceMeshSmoothing::SurfaceMeshSmoothing(SurfaceMesh *mesh) : mesh_(mesh) {
-        how_many_edge_weights_ = 0;
+        edge_weights_revision_ = 0;
     }
 
     //-----------------------------------------------------------------------------
@@ -55,7 +57,7 @@ namespace easy3d {
                 eweight[e] = static_cast<float>(std::max(0.0, geom::cotan_weight(mesh_, e)));
         }
 
-        how_many_edge_weights_ = mesh_->n_edges();
+        edge_weights_revision_ = mesh_->connectivity_revision();
     }
 
     //-----------------------------------------------------------------------------
@@ -81,7 +83,7 @@ namespace easy3d {
 
         // compute Laplace weight per edge: cotan or uniform
         auto eweight = mesh_->get_edge_property<float>("e:cotan");
-        if (!eweight || how_many_edge_weights_ != mesh_->n_edges())
+        if (!eweight || edge_weights_revision_ != mesh_->connectivity_revision())
             compute_edge_weights(use_uniform_laplace);
         eweight = mesh_->get_edge_property<float>("e:cotan");
 
@@ -126,13 +128,14 @@ namespace easy3d {
 
     void SurfaceMeshSmoothing::implicit_smoothing(float timestep,
                                                   bool use_uniform_laplace,
-                                                  bool rescale) {
+                                                  bool rescale,
+                                                  bool matrix_free) {
         if (!mesh_->n_vertices())
             return;
 
         // compute edge weights if they don't exist or if the mesh changed
         auto eweight = mesh_->get_edge_property<float>("e:cotan");
-        if (!eweight || how_many_edge_weights_ != mesh_->n_edges())
+        if (!eweight || edge_weights_revision_ != mesh_->connectivity_revision())
             compute_edge_weights(use_uniform_laplace);
         eweight = mesh_->get_edge_property<float>("e:cotan");
 
@@ -166,11 +169,11 @@ namespace easy3d {
         const unsigned int n = free_vertices.size();
 
         // A*X = B
-        SparseMatrix A(n, n);
         Eigen::MatrixXd B(n, 3);
 
-        // nonzero elements of A as triplets: (row, column, value)
+        // nonzero elements of A as triplets: (row, column, value), and the diagonal of A
         std::vector<Triplet> triplets;
+        Eigen::VectorXd diagonal(n);
 
         // setup matrix A and rhs B
         for (i = 0; i < n; ++i) {
@@ -191,25 +194,50 @@ namespace easy3d {
                     b -= -timestep * eweight[e] * static_cast<dvec3>(points[vv]);
                 }
                     // free interior vertex -> matrix
-                else {
+                else if (!matrix_free) {
                     triplets.emplace_back(i, idx[vv], -timestep * eweight[e]);
                 }
-
-                B.row(i) = (Eigen::Vector3d) b;
             }
+            B.row(i) = (Eigen::Vector3d) b;
 
             // center vertex -> matrix
-            triplets.emplace_back(i, i, 1.0 / vweight[v] + timestep * ww);
+            diagonal[i] = 1.0 / vweight[v] + timestep * ww;
+            if (!matrix_free)
+                triplets.emplace_back(i, i, diagonal[i]);
         }
 
-        // build sparse matrix from triplets
-        A.setFromTriplets(triplets.begin(), triplets.end());
-
         // solve A*X = B
-        Eigen::SimplicialLDLT<SparseMatrix> solver(A);
-        Eigen::MatrixXd X = solver.solve(B);
-        if (solver.info() != Eigen::Success) {
-            std::cerr << "SurfaceMeshSmoothing: Could not solve linear system\n";
+        Eigen::MatrixXd X;
+        bool success = false;
+        if (matrix_free) {
+            // the product with A is computed from the mesh, starting from the current positions
+            const SurfaceMesh *mesh = mesh_;
+            auto product = [&](const Eigen::MatrixXd &x, Eigen::MatrixXd &y) {
+                y.resize(n, x.cols());
+                parallel::for_each(0, n, [&](std::size_t r) {
+                    y.row(r) = diagonal[r] * x.row(r);
+                    for (auto h : mesh->halfedges(free_vertices[r])) {
+                        const int c = idx[mesh->target(h)];
+                        if (c >= 0)
+                            y.row(r) -= (timestep * eweight[mesh->edge(h)]) * x.row(c);
+                    }
+                });
+            };
+
+            X.resize(n, 3);
+            for (unsigned int r = 0; r < n; ++r)
+                X.row(r) = (Eigen::Vector3d) static_cast<dvec3>(points[free_vertices[r]]);
+            if (!SparseSolver::solve_cg(product, diagonal, B, X))
+                LOG(WARNING) << "SurfaceMeshSmoothing: conjugate gradients did not converge";
+            success = true;
+        } else {
+            // the pattern only depends on the connectivity, so it is analyzed once for repeated smoothing steps
+            std::shared_ptr<SparseSolver> solver = SparseSolver::shared(mesh_, "smoothing");
+            success = solver->factorize(mesh_->connectivity_revision(), n, triplets) && solver->solve(B, X);
+        }
+
+        if (!success) {
+            LOG(ERROR) << "SurfaceMeshSmoothing: Could not solve linear system";
         } else {
             // copy solution
             for (i = 0; i < n; ++i) {
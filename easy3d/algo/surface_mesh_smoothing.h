@@ -22,6 +22,9 @@ namespace easy3d {
      * See the following papers for more details:
      *  - Mathieu Desbrun et al. Implicit fairing of irregular meshes using diffusion and curvature flow. SIGGRAPH, 1999.
      *  - Misha Kazhdan et al. Can mean‐curvature flow be modified to be non‐singular? CGF, 2012.
+     * The linear system of implicit smoothing is factorized by the SparseSolver shared for this mesh (see
+     * SparseSolver::shared()), so repeated smoothing steps on the same connectivity only redo the numeric
+     * factorization, even if each step uses a new SurfaceMeshSmoothing.
      */
     class SurfaceMeshSmoothing {
     public:
@@ -39,9 +42,12 @@ namespace easy3d {
         //! \brief Perform implicit Laplacian smoothing with \p timestep.
         //! Decide whether to use uniform Laplacian or cotan Laplacian (default: cotan).
         //! Decide whether to re-center and re-scale model after smoothing (default: true).
+        //! Decide whether to solve the linear system by matrix-free conjugate gradients instead of a sparse
+        //! factorization (default: false). This needs much less memory and is preferable for very large meshes.
         void implicit_smoothing(float timestep = 0.001,
                                 bool use_uniform_laplace = false,
-                                bool rescale = true);
+                                bool rescale = true,
+                                bool matrix_free = false);
 
         //! \brief Initialize edge and vertex weights.
         void initialize(bool use_uniform_laplace = false) {
@@ -60,9 +66,9 @@ namespace easy3d {
         //! the mesh
         SurfaceMesh *mesh_;
 
-        // remember for how many edges we computed weights
-        // recompute if numbers change (i.e. mesh has changed)
-        unsigned int how_many_edge_weights_;
+        // remember for which connectivity we computed weights
+        // recompute if it changes (i.e. mesh has changed)
+        std::size_t edge_weights_revision_;
     };
 
 } // namespace easy3d
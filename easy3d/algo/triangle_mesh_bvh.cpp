@@ -0,0 +1,728 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/algo/triangle_mesh_bvh.h>
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+#include <easy3d/util/parallel.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+namespace easy3d {
+
+    namespace {
+
+        // A thin wrapper of the 4-wide SIMD instructions used to test a ray against a packet of four triangles.
+#if defined(__SSE2__) || defined(_M_X64)
+        struct Lanes {
+            typedef __m128 type;
+            typedef __m128 mask;
+            static type load(const float *p) { return _mm_loadu_ps(p); }
+            static void store(float *p, type v) { _mm_storeu_ps(p, v); }
+            static type set(float v) { return _mm_set1_ps(v); }
+            static type add(type a, type b) { return _mm_add_ps(a, b); }
+            static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+            static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+            static type div(type a, type b) { return _mm_div_ps(a, b); }
+            static mask ge(type a, type b) { return _mm_cmpge_ps(a, b); }
+            static mask gt(type a, type b) { return _mm_cmpgt_ps(a, b); }
+            static mask lt(type a, type b) { return _mm_cmplt_ps(a, b); }
+            static mask both(mask a, mask b) { return _mm_and_ps(a, b); }
+            static int bits(mask m) { return _mm_movemask_ps(m); }
+        };
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        struct Lanes {
+            typedef float32x4_t type;
+            typedef uint32x4_t mask;
+            static type load(const float *p) { return vld1q_f32(p); }
+            static void store(float *p, type v) { vst1q_f32(p, v); }
+            static type set(float v) { return vdupq_n_f32(v); }
+            static type add(type a, type b) { return vaddq_f32(a, b); }
+            static type sub(type a, type b) { return vsubq_f32(a, b); }
+            static type mul(type a, type b) { return vmulq_f32(a, b); }
+            static type div(type a, type b) { return vdivq_f32(a, b); }
+            static mask ge(type a, type b) { return vcgeq_f32(a, b); }
+            static mask gt(type a, type b) { return vcgtq_f32(a, b); }
+            static mask lt(type a, type b) { return vcltq_f32(a, b); }
+            static mask both(mask a, mask b) { return vandq_u32(a, b); }
+            static int bits(mask m) {
+                const int32x4_t shifts = {0, 1, 2, 3};
+                return static_cast<int>(vaddvq_u32(vshlq_u32(vshrq_n_u32(m, 31), shifts)));
+            }
+        };
+#else
+        struct Lanes {
+            struct type { float v[4]; };
+            typedef int mask;
+            static type load(const float *p) { type r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+            static void store(float *p, type a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+            static type set(float v) { type r; for (int i = 0; i < 4; ++i) r.v[i] = v; return r; }
+            static type add(type a, type b) { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+            static type sub(type a, type b) { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+            static type mul(type a, type b) { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+            static type div(type a, type b) { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+            static mask ge(type a, type b) { int m = 0; for (int i = 0; i < 4; ++i) m |= (a.v[i] >= b.v[i]) << i; return m; }
+            static mask gt(type a, type b) { int m = 0; for (int i = 0; i < 4; ++i) m |= (a.v[i] > b.v[i]) << i; return m; }
+            static mask lt(type a, type b) { int m = 0; for (int i = 0; i < 4; ++i) m |= (a.v[i] < b.v[i]) << i; return m; }
+            static mask both(mask a, mask b) { return a & b; }
+            static int bits(mask m) { return m; }
+        };
+#endif
+
+        typedef Lanes::type lanes;
+
+        // a ray broadcast to all lanes
+        struct Ray4 {
+            Ray4(const vec3 &o, const vec3 &d) {
+                for (int i = 0; i < 3; ++i) {
+                    origin[i] = Lanes::set(o[i]);
+                    direction[i] = Lanes::set(d[i]);
+                }
+            }
+            lanes origin[3];
+            lanes direction[3];
+        };
+
+        inline lanes dot4(const lanes a[3], const lanes b[3]) {
+            return Lanes::add(Lanes::add(Lanes::mul(a[0], b[0]), Lanes::mul(a[1], b[1])), Lanes::mul(a[2], b[2]));
+        }
+
+        inline void cross4(const lanes a[3], const lanes b[3], lanes c[3]) {
+            c[0] = Lanes::sub(Lanes::mul(a[1], b[2]), Lanes::mul(a[2], b[1]));
+            c[1] = Lanes::sub(Lanes::mul(a[2], b[0]), Lanes::mul(a[0], b[2]));
+            c[2] = Lanes::sub(Lanes::mul(a[0], b[1]), Lanes::mul(a[1], b[0]));
+        }
+
+
+        // The closest point on a triangle (a, b, c) to a point p, see "Real-Time Collision Detection" by Christer
+        // Ericson (Section 5.1.5). The region of the closest point is 0 for the interior, 1-3 for the vertices a, b,
+        // and c, and 4-6 for the edges ab, bc, and ca.
+        inline vec3 closest_point_on_triangle(const vec3 &p, const vec3 &a, const vec3 &b, const vec3 &c, int &region) {
+            const vec3 ab = b - a, ac = c - a, ap = p - a;
+            const float d1 = easy3d::dot(ab, ap), d2 = easy3d::dot(ac, ap);
+            if (d1 <= 0.0f && d2 <= 0.0f) { region = 1; return a; }
+
+            const vec3 bp = p - b;
+            const float d3 = easy3d::dot(ab, bp), d4 = easy3d::dot(ac, bp);
+            if (d3 >= 0.0f && d4 <= d3) { region = 2; return b; }
+
+            const float vc = d1 * d4 - d3 * d2;
+            if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+                region = 4;
+                return a + ab * (d1 / (d1 - d3));
+            }
+
+            const vec3 cp = p - c;
+            const float d5 = easy3d::dot(ab, cp), d6 = easy3d::dot(ac, cp);
+            if (d6 >= 0.0f && d5 <= d6) { region = 3; return c; }
+
+            const float vb = d5 * d2 - d1 * d6;
+            if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+                region = 6;
+                return a + ac * (d2 / (d2 - d6));
+            }
+
+            const float va = d3 * d6 - d5 * d4;
+            if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+                region = 5;
+                return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+            }
+
+            const float sum = va + vb + vc;
+            if (sum <= 0.0f) {  // degenerate triangle
+                region = 1;
+                return a;
+            }
+            region = 0;
+            return a + ab * (vb / sum) + ac * (vc / sum);
+        }
+
+
+        // the squared distance from a point to a box (0 if the point is inside)
+        inline float squared_distance(const vec3 &p, const float bmin[3], const float bmax[3]) {
+            float d = 0.0f;
+            for (int i = 0; i < 3; ++i) {
+                const float v = std::max(std::max(bmin[i] - p[i], p[i] - bmax[i]), 0.0f);
+                d += v * v;
+            }
+            return d;
+        }
+
+
+        // tests if a ray hits a box with a parameter in [0, t_max]
+        inline bool hit_box(const vec3 &origin, const vec3 &inv_direction, float t_max,
+                            const float bmin[3], const float bmax[3]) {
+            float t0 = 0.0f, t1 = t_max;
+            for (int i = 0; i < 3; ++i) {
+                float t_near = (bmin[i] - origin[i]) * inv_direction[i];
+                float t_far = (bmax[i] - origin[i]) * inv_direction[i];
+                if (t_near > t_far)
+                    std::swap(t_near, t_far);
+                t0 = t_near > t0 ? t_near : t0;   // also ignores NaN
+                t1 = t_far < t1 ? t_far : t1;
+                if (t0 > t1)
+                    return false;
+            }
+            return true;
+        }
+
+    }
+
+
+    // The nodes are built with the triangles (i.e., indices into the build arrays) of a leaf stored in
+    // indices[offset, offset + num_packets), and the packets are created once the hierarchy is complete.
+    struct TriangleMeshBVH::Builder {
+        Builder(std::vector<Box3> &&boxes, std::vector<vec3> &&centroids, unsigned int max_leaf_size)
+                : boxes_(std::move(boxes)), centroids_(std::move(centroids)), max_leaf_size_(max_leaf_size), indices_(boxes_.size()) {
+            for (std::size_t i = 0; i < indices_.size(); ++i)
+                indices_[i] = static_cast<int>(i);
+        }
+
+        const std::vector<int> &indices() const { return indices_; }
+
+        void build(std::vector<Node> &nodes) {
+            if (!indices_.empty())
+                build(0, indices_.size(), 0, nodes);
+        }
+
+    private:
+        static const int num_bins = 16;
+
+        // the bounding boxes of the triangles and of their centroids
+        struct Bounds {
+            Box3 box, centroid_box;
+            Bounds operator+(const Bounds &b) const {
+                Bounds r = *this;
+                r.box += b.box;
+                r.centroid_box.grow(b.centroid_box);
+                return r;
+            }
+        };
+
+        struct Bins {
+            Bins() { std::fill(&count[0][0], &count[0][0] + 3 * num_bins, std::size_t(0)); }
+            Box3 box[3][num_bins];
+            std::size_t count[3][num_bins];
+            Bins operator+(const Bins &b) const {
+                Bins r = *this;
+                for (int a = 0; a < 3; ++a) {
+                    for (int i = 0; i < num_bins; ++i) {
+                        r.box[a][i] += b.box[a][i];
+                        r.count[a][i] += b.count[a][i];
+                    }
+                }
+                return r;
+            }
+        };
+
+        // the ranges larger than this are processed in parallel
+        static const std::size_t parallel_threshold = 16384;
+        // beyond this depth, the ranges are split at the median (to bound the depth of the hierarchy)
+        static const std::size_t max_sah_depth = 64;
+
+        int bin_index(const Box3 &centroid_box, int axis, const vec3 &centroid) const {
+            const float extent = centroid_box.range(axis);
+            const int i = static_cast<int>(num_bins * (centroid[axis] - centroid_box.min_coord(axis)) / extent);
+            return std::max(0, std::min(num_bins - 1, i));
+        }
+
+        Bounds compute_bounds(std::size_t begin, std::size_t end) const {
+            auto func = [&](std::size_t b, std::size_t e) -> Bounds {
+                Bounds r;
+                for (std::size_t i = b; i < e; ++i) {
+                    r.box += boxes_[indices_[i]];
+                    r.centroid_box.grow(centroids_[indices_[i]]);
+                }
+                return r;
+            };
+            if (end - begin < parallel_threshold)
+                return func(begin, end);
+            return parallel::reduce(begin, end, Bounds(), func, std::plus<Bounds>());
+        }
+
+        Bins compute_bins(std::size_t begin, std::size_t end, const Box3 &centroid_box) const {
+            auto func = [&](std::size_t b, std::size_t e) -> Bins {
+                Bins r;
+                for (std::size_t i = b; i < e; ++i) {
+                    const int t = indices_[i];
+                    for (int a = 0; a < 3; ++a) {
+                        if (centroid_box.range(a) <= 0.0f)
+                            continue;
+                        const int k = bin_index(centroid_box, a, centroids_[t]);
+                        r.box[a][k] += boxes_[t];
+                        ++r.count[a][k];
+                    }
+                }
+                return r;
+            };
+            if (end - begin < parallel_threshold)
+                return func(begin, end);
+            return parallel::reduce(begin, end, Bins(), func, std::plus<Bins>());
+        }
+
+        // Finds the best split with the surface area heuristic. Returns the position of the split in the range.
+        std::size_t split(std::size_t begin, std::size_t end, std::size_t depth, const Bounds &bounds, int &axis) {
+            axis = static_cast<int>(bounds.centroid_box.max_range_axis());
+            const std::size_t middle = begin + (end - begin) / 2;
+            if (depth >= max_sah_depth || bounds.centroid_box.range(axis) <= 0.0f)
+                return middle;
+
+            const Bins bins = compute_bins(begin, end, bounds.centroid_box);
+            float best_cost = std::numeric_limits<float>::max();
+            int best_bin = -1;
+            for (int a = 0; a < 3; ++a) {
+                if (bounds.centroid_box.range(a) <= 0.0f)
+                    continue;
+                // sweep from the right to get the costs of the right parts
+                float right_cost[num_bins];
+                Box3 box;
+                std::size_t count = 0;
+                for (int i = num_bins - 1; i > 0; --i) {
+                    box += bins.box[a][i];
+                    count += bins.count[a][i];
+                    right_cost[i] = count > 0 ? box.surface_area() * static_cast<float>(count) : 0.0f;
+                }
+                box.clear();
+                count = 0;
+                for (int i = 0; i < num_bins - 1; ++i) {
+                    box += bins.box[a][i];
+                    count += bins.count[a][i];
+                    if (count == 0 || count == end - begin)
+                        continue;
+                    const float cost = box.surface_area() * static_cast<float>(count) + right_cost[i + 1];
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_bin = i;
+                        axis = a;
+                    }
+                }
+            }
+            if (best_bin < 0)
+                return middle;
+
+            const Box3 &centroid_box = bounds.centroid_box;
+            const int split_axis = axis;
+            auto pos = std::partition(indices_.begin() + begin, indices_.begin() + end, [&](int t) {
+                return bin_index(centroid_box, split_axis, centroids_[t]) <= best_bin;
+            });
+            const auto result = static_cast<std::size_t>(pos - indices_.begin());
+            return (result == begin || result == end) ? middle : result;
+        }
+
+        // Builds the subtree of the range into 'nodes' (the indices of the nodes are relative to the beginning of
+        // 'nodes').
+        void build(std::size_t begin, std::size_t end, std::size_t depth, std::vector<Node> &nodes) {
+            const Bounds bounds = compute_bounds(begin, end);
+            const std::size_t index = nodes.size();
+            nodes.emplace_back();
+            for (int i = 0; i < 3; ++i) {
+                nodes[index].bmin[i] = bounds.box.min_coord(i);
+                nodes[index].bmax[i] = bounds.box.max_coord(i);
+            }
+            nodes[index].axis = 0;
+            nodes[index].padding = 0;
+
+            if (end - begin <= max_leaf_size_) {
+                nodes[index].offset = static_cast<uint32_t>(begin);
+                nodes[index].num_packets = static_cast<uint16_t>(end - begin);
+                return;
+            }
+
+            int axis = 0;
+            const std::size_t mid = split(begin, end, depth, bounds, axis);
+            nodes[index].axis = static_cast<uint8_t>(axis);
+            nodes[index].num_packets = 0;
+
+            if (end - begin >= parallel_threshold) {
+                // build the two subtrees in parallel and then append them
+                std::vector<Node> children[2];
+                parallel::pool().run(2, [&](std::size_t i) {
+                    if (i == 0)
+                        build(begin, mid, depth + 1, children[0]);
+                    else
+                        build(mid, end, depth + 1, children[1]);
+                });
+                const auto first = static_cast<uint32_t>(index + 1);
+                const auto second = static_cast<uint32_t>(first + children[0].size());
+                nodes[index].offset = second;
+                for (int c = 0; c < 2; ++c) {
+                    const uint32_t shift = (c == 0) ? first : second;
+                    for (auto node : children[c]) {
+                        if (node.num_packets == 0)  // interior node
+                            node.offset += shift;
+                        nodes.push_back(node);
+                    }
+                }
+            } else {
+                build(begin, mid, depth + 1, nodes);
+                nodes[index].offset = static_cast<uint32_t>(nodes.size());
+                build(mid, end, depth + 1, nodes);
+            }
+        }
+
+    private:
+        std::vector<Box3> boxes_;
+        std::vector<vec3> centroids_;
+        std::size_t max_leaf_size_;
+        std::vector<int> indices_;
+    };
+
+
+    TriangleMeshBVH::TriangleMeshBVH(const SurfaceMesh *mesh, unsigned int max_leaf_size) : mesh_(mesh) {
+        max_leaf_size = std::max(1u, std::min(max_leaf_size, 64u));
+
+        // triangulate the faces (as a fan)
+        std::vector<TriangleInfo> triangles;
+        triangles.reserve(mesh->n_faces());
+        std::vector<SurfaceMesh::Halfedge> halfedges;
+        for (auto f : mesh->faces()) {
+            halfedges.clear();
+            for (auto h : mesh->halfedges(f))
+                halfedges.push_back(h);
+            const std::size_t n = halfedges.size();
+            for (std::size_t i = 1; i + 1 < n; ++i) {
+                TriangleInfo t;
+                t.face = f.idx();
+                t.vertices[0] = mesh->source(halfedges[0]).idx();
+                t.vertices[1] = mesh->source(halfedges[i]).idx();
+                t.vertices[2] = mesh->target(halfedges[i]).idx();
+                t.halfedges[0] = (i == 1) ? halfedges[0].idx() : -1;
+                t.halfedges[1] = halfedges[i].idx();
+                t.halfedges[2] = (i + 2 == n) ? halfedges[n - 1].idx() : -1;
+                triangles.push_back(t);
+            }
+        }
+
+        const std::vector<vec3> &points = mesh->points();
+        std::vector<Box3> boxes(triangles.size());
+        std::vector<vec3> centroids(triangles.size());
+        parallel::for_each(0, triangles.size(), [&](std::size_t i) {
+            const TriangleInfo &t = triangles[i];
+            Box3 box;
+            for (int j = 0; j < 3; ++j)
+                box.grow(points[t.vertices[j]]);
+            boxes[i] = box;
+            centroids[i] = box.center();
+        });
+
+        Builder builder(std::move(boxes), std::move(centroids), max_leaf_size);
+        builder.build(nodes_);
+
+        // create the packets in the order of the leaves (i.e., depth-first order)
+        const std::vector<int> &indices = builder.indices();
+        std::vector<std::size_t> leaves, first_packets(1, 0);
+        std::vector<std::size_t> first_triangles, num_triangles;
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            Node &node = nodes_[i];
+            if (node.num_packets == 0)
+                continue;
+            leaves.push_back(i);
+            first_triangles.push_back(node.offset);
+            num_triangles.push_back(node.num_packets);
+            node.num_packets = static_cast<uint16_t>((num_triangles.back() + 3) / 4);
+            node.offset = static_cast<uint32_t>(first_packets.back());
+            first_packets.push_back(first_packets.back() + node.num_packets);
+        }
+
+        TriangleInfo unused;
+        unused.face = -1;
+        std::fill(unused.vertices, unused.vertices + 3, -1);
+        std::fill(unused.halfedges, unused.halfedges + 3, -1);
+        packets_.resize(first_packets.back());
+        triangles_.assign(packets_.size() * 4, unused);
+        parallel::for_each(0, leaves.size(), [&](std::size_t i) {
+            const std::size_t first_slot = first_packets[i] * 4;
+            for (std::size_t k = 0; k < first_packets[i + 1] - first_packets[i]; ++k)
+                std::fill(&packets_[first_packets[i] + k].v0[0][0], &packets_[first_packets[i] + k].v0[0][0] + 36, 0.0f);
+            for (std::size_t j = 0; j < num_triangles[i]; ++j) {
+                const std::size_t slot = first_slot + j;
+                triangles_[slot] = triangles[indices[first_triangles[i] + j]];
+                const TriangleInfo &t = triangles_[slot];
+                const vec3 &a = points[t.vertices[0]];
+                const vec3 e1 = points[t.vertices[1]] - a;
+                const vec3 e2 = points[t.vertices[2]] - a;
+                Packet &packet = packets_[slot / 4];
+                const std::size_t lane = slot % 4;
+                for (int c = 0; c < 3; ++c) {
+                    packet.v0[c][lane] = a[c];
+                    packet.e1[c][lane] = e1[c];
+                    packet.e2[c][lane] = e2[c];
+                }
+            }
+        });
+
+        // for the signed distance
+        halfedge_slots_.assign(mesh->halfedges_size(), -1);
+        vertex_pseudo_normals_.assign(mesh->vertices_size(), vec3(0, 0, 0));
+        for (std::size_t slot = 0; slot < triangles_.size(); ++slot) {
+            const TriangleInfo &t = triangles_[slot];
+            if (t.face < 0)
+                continue;
+            const vec3 n = triangle_normal(slot);
+            for (int j = 0; j < 3; ++j) {
+                if (t.halfedges[j] >= 0)
+                    halfedge_slots_[t.halfedges[j]] = static_cast<int>(slot);
+                // the angle-weighted normal
+                const vec3 &p = points[t.vertices[j]];
+                const vec3 d1 = normalize(points[t.vertices[(j + 1) % 3]] - p);
+                const vec3 d2 = normalize(points[t.vertices[(j + 2) % 3]] - p);
+                const float angle = std::acos(std::max(-1.0f, std::min(1.0f, easy3d::dot(d1, d2))));
+                vertex_pseudo_normals_[t.vertices[j]] += n * angle;
+            }
+        }
+    }
+
+
+    vec3 TriangleMeshBVH::triangle_normal(std::size_t slot) const {
+        const TriangleInfo &t = triangles_[slot];
+        const vec3 &a = mesh_->position(SurfaceMesh::Vertex(t.vertices[0]));
+        const vec3 &b = mesh_->position(SurfaceMesh::Vertex(t.vertices[1]));
+        const vec3 &c = mesh_->position(SurfaceMesh::Vertex(t.vertices[2]));
+        return normalize(easy3d::cross(b - a, c - a));
+    }
+
+
+    Box3 TriangleMeshBVH::bounding_box() const {
+        if (nodes_.empty())
+            return Box3();
+        return Box3(vec3(nodes_[0].bmin), vec3(nodes_[0].bmax));
+    }
+
+
+    int TriangleMeshBVH::traverse(const vec3 &origin, const vec3 &direction, float t_max, bool any_hit,
+                                  float &t, float &u, float &v) const {
+        if (nodes_.empty())
+            return -1;
+
+        const vec3 inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        const Ray4 ray(origin, direction);
+        const lanes zero = Lanes::set(0.0f), one = Lanes::set(1.0f);
+        // a small tolerance on the barycentric coordinates, such that rays through edges and vertices don't slip
+        // through the gaps caused by rounding errors
+        const lanes lower = Lanes::set(-1e-6f), upper = Lanes::set(1.0f + 1e-6f);
+
+        int best = -1;
+        float lane_t[4], lane_u[4], lane_v[4];
+        uint32_t stack[128];
+        int top = 0;
+        uint32_t current = 0;
+        while (true) {
+            const Node &node = nodes_[current];
+            if (hit_box(origin, inv_direction, t_max, node.bmin, node.bmax)) {
+                if (node.num_packets == 0) {
+                    // visit the child on the side where the ray comes from first
+                    uint32_t first = current + 1, second = node.offset;
+                    if (direction[node.axis] < 0.0f)
+                        std::swap(first, second);
+                    stack[top++] = second;
+                    current = first;
+                    continue;
+                }
+
+                for (uint32_t k = node.offset; k < node.offset + node.num_packets; ++k) {
+                    // the Moller-Trumbore test on four triangles at once
+                    const Packet &packet = packets_[k];
+                    lanes v0[3], e1[3], e2[3], p[3], q[3], s[3];
+                    for (int c = 0; c < 3; ++c) {
+                        v0[c] = Lanes::load(packet.v0[c]);
+                        e1[c] = Lanes::load(packet.e1[c]);
+                        e2[c] = Lanes::load(packet.e2[c]);
+                        s[c] = Lanes::sub(ray.origin[c], v0[c]);
+                    }
+                    cross4(ray.direction, e2, p);
+                    const lanes inv_det = Lanes::div(one, dot4(e1, p));
+                    const lanes bu = Lanes::mul(dot4(s, p), inv_det);
+                    cross4(s, e1, q);
+                    const lanes bv = Lanes::mul(dot4(ray.direction, q), inv_det);
+                    const lanes bt = Lanes::mul(dot4(e2, q), inv_det);
+                    // a zero determinant results in infinite or NaN values, which fail these tests
+                    const int mask = Lanes::bits(Lanes::both(
+                            Lanes::both(Lanes::ge(bu, lower), Lanes::ge(bv, lower)),
+                            Lanes::both(Lanes::ge(upper, Lanes::add(bu, bv)),
+                                        Lanes::both(Lanes::gt(bt, zero), Lanes::lt(bt, Lanes::set(t_max))))));
+                    if (mask == 0)
+                        continue;
+
+                    Lanes::store(lane_t, bt);
+                    Lanes::store(lane_u, bu);
+                    Lanes::store(lane_v, bv);
+                    for (int lane = 0; lane < 4; ++lane) {
+                        if ((mask & (1 << lane)) && lane_t[lane] < t_max) {
+                            t_max = lane_t[lane];
+                            t = lane_t[lane];
+                            u = lane_u[lane];
+                            v = lane_v[lane];
+                            best = static_cast<int>(k * 4 + lane);
+                            if (any_hit)
+                                return best;
+                        }
+                    }
+                }
+            }
+            if (top == 0)
+                break;
+            current = stack[--top];
+        }
+        return best;
+    }
+
+
+    bool TriangleMeshBVH::intersect(const vec3 &origin, const vec3 &direction, Hit &hit, float t_max) const {
+        float t, u, v;
+        const int slot = traverse(origin, direction, t_max, false, t, u, v);
+        if (slot < 0) {
+            hit = Hit();
+            return false;
+        }
+        hit.t = t;
+        hit.u = u;
+        hit.v = v;
+        hit.face = SurfaceMesh::Face(triangles_[slot].face);
+        hit.point = origin + direction * t;
+        return true;
+    }
+
+
+    void TriangleMeshBVH::intersect(const std::vector<vec3> &origins, const std::vector<vec3> &directions,
+                                    std::vector<Hit> &hits) const {
+        const std::size_t num = std::min(origins.size(), directions.size());
+        hits.resize(num);
+        parallel::for_each(0, num, [&](std::size_t i) {
+            intersect(origins[i], directions[i], hits[i]);
+        });
+    }
+
+
+    bool TriangleMeshBVH::occluded(const vec3 &origin, const vec3 &direction, float t_max) const {
+        float t, u, v;
+        return traverse(origin, direction, t_max, true, t, u, v) >= 0;
+    }
+
+
+    int TriangleMeshBVH::nearest_slot(const vec3 &p, float &best_sqr_dist, vec3 &nearest, int &region,
+                                      int &tests) const {
+        int best = -1;
+        if (nodes_.empty())
+            return best;
+
+        uint32_t stack[128];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes_[stack[--top]];
+            if (squared_distance(p, node.bmin, node.bmax) >= best_sqr_dist)
+                continue;
+
+            if (node.num_packets == 0) {
+                // visit the closer child first, i.e., push it last
+                const uint32_t first = static_cast<uint32_t>(&node - nodes_.data()) + 1, second = node.offset;
+                const float d1 = squared_distance(p, nodes_[first].bmin, nodes_[first].bmax);
+                const float d2 = squared_distance(p, nodes_[second].bmin, nodes_[second].bmax);
+                if (d1 < d2) {
+                    stack[top++] = second;
+                    stack[top++] = first;
+                } else {
+                    stack[top++] = first;
+                    stack[top++] = second;
+                }
+                continue;
+            }
+
+            const std::size_t end = (node.offset + node.num_packets) * 4;
+            for (std::size_t slot = node.offset * 4; slot < end; ++slot) {
+                const TriangleInfo &t = triangles_[slot];
+                if (t.face < 0)
+                    continue;
+                int r;
+                const vec3 q = closest_point_on_triangle(p,
+                                                         mesh_->position(SurfaceMesh::Vertex(t.vertices[0])),
+                                                         mesh_->position(SurfaceMesh::Vertex(t.vertices[1])),
+                                                         mesh_->position(SurfaceMesh::Vertex(t.vertices[2])), r);
+                ++tests;
+                const float d = distance2(p, q);
+                if (d < best_sqr_dist) {
+                    best_sqr_dist = d;
+                    nearest = q;
+                    region = r;
+                    best = static_cast<int>(slot);
+                }
+            }
+        }
+        return best;
+    }
+
+
+    TriangleMeshBVH::NearestNeighbor TriangleMeshBVH::nearest(const vec3 &p) const {
+        NearestNeighbor data;
+        data.tests = 0;
+        float sqr_dist = std::numeric_limits<float>::max();
+        int region = 0;
+        const int slot = nearest_slot(p, sqr_dist, data.nearest, region, data.tests);
+        data.dist = (slot < 0) ? std::numeric_limits<float>::max() : std::sqrt(sqr_dist);
+        if (slot >= 0)
+            data.face = SurfaceMesh::Face(triangles_[slot].face);
+        return data;
+    }
+
+
+    float TriangleMeshBVH::signed_distance(const vec3 &p) const {
+        float sqr_dist = std::numeric_limits<float>::max();
+        vec3 q;
+        int region = 0, tests = 0;
+        const int slot = nearest_slot(p, sqr_dist, q, region, tests);
+        if (slot < 0)
+            return std::numeric_limits<float>::max();
+
+        // the angle-weighted pseudo-normal at the closest point
+        const TriangleInfo &t = triangles_[slot];
+        vec3 n;
+        if (region == 0)
+            n = triangle_normal(slot);
+        else if (region <= 3)
+            n = vertex_pseudo_normals_[t.vertices[region - 1]];
+        else {
+            n = triangle_normal(slot);
+            const int h = t.halfedges[region - 4];
+            if (h >= 0) {
+                const int other = halfedge_slots_[h ^ 1];   // the opposite halfedge
+                if (other >= 0)
+                    n += triangle_normal(static_cast<std::size_t>(other));
+            }
+        }
+
+        const float dist = std::sqrt(sqr_dist);
+        return easy3d::dot(p - q, n) < 0.0f ? -dist : dist;
+    }
+
+}
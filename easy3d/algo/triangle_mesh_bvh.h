@@ -0,0 +1,185 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_ALGO_TRIANGLE_MESH_BVH_H
+#define EASY3D_ALGO_TRIANGLE_MESH_BVH_H
+
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+
+#include <easy3d/core/surface_mesh.h>
+
+
+namespace easy3d {
+
+    /**
+     * \brief A bounding volume hierarchy (BVH) of the faces of a surface mesh for fast ray casting, closest-point, and
+     *      signed distance queries.
+     * \class TriangleMeshBVH easy3d/algo/triangle_mesh_bvh.h
+     * \details The hierarchy is built (in parallel) using the surface area heuristic (SAH). Its nodes are stored in a
+     *      flat array (32 bytes per node) in depth-first order, i.e., the first child of an interior node directly
+     *      follows it. The triangles of each leaf are stored in packets of four in the structure-of-arrays layout, and
+     *      a ray is tested against all triangles of a packet at once using SIMD instructions (SSE or NEON).
+     *      Polygonal faces are triangulated (as a fan) internally, and the queries report the original faces.
+     *      Usage example:
+     *      \code
+     *          TriangleMeshBVH bvh(mesh);
+     *          TriangleMeshBVH::Hit hit;
+     *          if (bvh.intersect(origin, direction, hit))
+     *              std::cout << "hit face " << hit.face << " at " << hit.point << std::endl;
+     *          const float dist = bvh.signed_distance(p);
+     *      \endcode
+     * \attention The BVH refers to the mesh (for the vertex positions and the connectivity), so the mesh must not be
+     *      modified during the lifetime of the BVH.
+     * \sa TriangleMeshKdTree.
+     */
+    class TriangleMeshBVH {
+    public:
+        /**
+         * \brief Builds the BVH of a surface mesh.
+         * \param mesh The surface mesh.
+         * \param max_leaf_size The maximum number of triangles in a leaf node (unless the triangles can't be split).
+         */
+        explicit TriangleMeshBVH(const SurfaceMesh *mesh, unsigned int max_leaf_size = 8);
+
+        /// \brief The intersection of a ray and the mesh.
+        struct Hit {
+            Hit() : t(std::numeric_limits<float>::max()), u(0.0f), v(0.0f) {}
+            float t;                ///< The ray parameter of the intersection, i.e., point = origin + t * direction.
+            SurfaceMesh::Face face; ///< The intersected face (invalid if the ray doesn't hit the mesh).
+            vec3 point;             ///< The intersection point.
+            float u, v;             ///< The barycentric coordinates of the point in the intersected triangle.
+        };
+
+        /**
+         * \brief Computes the first intersection of a ray with the mesh.
+         * \param origin The origin of the ray.
+         * \param direction The direction of the ray (not necessarily normalized).
+         * \param hit Returns the intersection (if any).
+         * \param t_max Only the intersections with a ray parameter in (0, t_max) are considered.
+         * \return \c true if the ray hits the mesh.
+         */
+        bool intersect(const vec3 &origin, const vec3 &direction, Hit &hit,
+                       float t_max = std::numeric_limits<float>::max()) const;
+
+        /**
+         * \brief Computes the first intersections of a batch of rays with the mesh (in parallel).
+         * \param origins The origins of the rays.
+         * \param directions The directions of the rays.
+         * \param hits Returns the intersection of each ray. The face of a hit is invalid if the ray misses the mesh.
+         */
+        void intersect(const std::vector<vec3> &origins, const std::vector<vec3> &directions,
+                       std::vector<Hit> &hits) const;
+
+        /**
+         * \brief Tests if a ray hits the mesh at all (i.e., any hit), e.g., for visibility and shadow queries. This
+         *      is faster than intersect() because the traversal stops at the first intersection found.
+         * \param origin The origin of the ray.
+         * \param direction The direction of the ray (not necessarily normalized).
+         * \param t_max Only the intersections with a ray parameter in (0, t_max) are considered.
+         * \return \c true if the ray hits the mesh.
+         */
+        bool occluded(const vec3 &origin, const vec3 &direction,
+                      float t_max = std::numeric_limits<float>::max()) const;
+
+        /// \brief The closest point on the mesh to a query point.
+        struct NearestNeighbor {
+            float dist;             ///< The distance between the query point and the closest point.
+            SurfaceMesh::Face face; ///< The face containing the closest point.
+            vec3 nearest;           ///< The closest point.
+            int tests;              ///< The number of point-triangle distance computations performed.
+        };
+
+        /// \brief Finds the closest point on the mesh to a query point.
+        NearestNeighbor nearest(const vec3 &p) const;
+
+        /**
+         * \brief Computes the signed distance from a point to the mesh, which is positive outside and negative inside.
+         * \details The sign is determined by the angle-weighted pseudo-normal at the closest point, so the mesh should
+         *      be closed and consistently oriented (with outward normals).
+         */
+        float signed_distance(const vec3 &p) const;
+
+        /// \brief Returns the bounding box of the mesh.
+        Box3 bounding_box() const;
+
+        /// \brief Returns the number of nodes of the hierarchy.
+        std::size_t num_nodes() const { return nodes_.size(); }
+
+    private:
+        // A node of the hierarchy (32 bytes).
+        struct Node {
+            float bmin[3], bmax[3]; // the bounding box
+            uint32_t offset;        // leaf: the index of the first packet; interior: the index of the second child
+            uint16_t num_packets;   // leaf: the number of packets; interior: 0
+            uint8_t axis;           // interior: the split axis
+            uint8_t padding;
+        };
+
+        // Four triangles in the structure-of-arrays layout, each stored as a vertex and the two edges from it.
+        struct Packet {
+            float v0[3][4];
+            float e1[3][4];
+            float e2[3][4];
+        };
+
+        // The triangles are stored in packets. The corresponding information of the triangle in lane i of packet k
+        // is at index 4 * k + i of the following arrays (the unused lanes of a packet are marked by face index -1).
+        struct TriangleInfo {
+            int face;
+            int vertices[3];
+            int halfedges[3];   // the halfedges of the three edges (-1 for the diagonals of a triangulated polygon)
+        };
+
+        // Closest-point query with the current best squared distance 'best_sqr_dist', and the triangle slot.
+        int nearest_slot(const vec3 &p, float &best_sqr_dist, vec3 &nearest, int &region, int &tests) const;
+
+        // Ray traversal: returns the slot of the closest hit (any hit if 'any_hit'), or -1.
+        int traverse(const vec3 &origin, const vec3 &direction, float t_max, bool any_hit,
+                     float &t, float &u, float &v) const;
+
+        // The normal of the triangle in a slot.
+        vec3 triangle_normal(std::size_t slot) const;
+
+    private:
+        const SurfaceMesh *mesh_;
+        std::vector<Node> nodes_;
+        std::vector<Packet> packets_;
+        std::vector<TriangleInfo> triangles_;
+
+        // For the signed distance: the triangle slot of each halfedge, and the angle-weighted vertex normals
+        std::vector<int> halfedge_slots_;
+        std::vector<vec3> vertex_pseudo_normals_;
+
+        struct Builder;
+    };
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_ALGO_TRIANGLE_MESH_BVH_H
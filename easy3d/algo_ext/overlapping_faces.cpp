@@ -237,7 +237,7 @@ namespace easy3d {
             }
         }
 #endif
-        mesh.collect_garbage();
+        mesh.collect_garbage(true);   // the copy inherits the deferred garbage collection, and it is indexed below
 
         // construct the new mesh
         input->clear();
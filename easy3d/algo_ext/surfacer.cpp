@@ -52,7 +52,7 @@ namespace easy3d {
 
         void to_cgal(SurfaceMesh *input, CGALMesh &output) {
             if (input->has_garbage())
-                input->collect_garbage();
+                input->collect_garbage(true);   // the faces are indexed below
 
             output.clear();
 
@@ -195,6 +195,9 @@ namespace easy3d {
             if (!mesh)
                 return;
 
+            if (mesh->has_garbage())
+                mesh->collect_garbage(true);   // the points and faces are indexed below
+
             points = mesh->points();
             polygons.resize(mesh->n_faces());
             for (auto f : mesh->faces()) {
@@ -525,7 +528,7 @@ namespace easy3d {
         for (auto f : to_delete)
             mesh->delete_face(f);
 
-        mesh->collect_garbage();
+        mesh->collect_garbage(true);   // callers (e.g., SelfIntersection) index the remaining faces contiguously
 
         unsigned int diff = num - mesh->n_faces();
         if (diff > 0)
@@ -26,6 +26,10 @@
 
 #include <easy3d/core/graph.h>
 
+#include <algorithm>
+
+#include <easy3d/util/parallel.h>
+
 
 namespace easy3d {
 
@@ -44,6 +48,7 @@ namespace easy3d {
 
         deleted_vertices_ = deleted_edges_ = 0;
         garbage_ = false;
+        garbage_collection_deferred_ = false;
     }
 
 
@@ -70,6 +75,7 @@ namespace easy3d {
             deleted_vertices_ = rhs.deleted_vertices_;
             deleted_edges_    = rhs.deleted_edges_;
             garbage_          = rhs.garbage_;
+            garbage_collection_deferred_ = rhs.garbage_collection_deferred_;
         }
 
         return *this;
@@ -111,6 +117,7 @@ namespace easy3d {
             deleted_vertices_ = rhs.deleted_vertices_;
             deleted_edges_    = rhs.deleted_edges_;
             garbage_          = rhs.garbage_;
+            garbage_collection_deferred_ = rhs.garbage_collection_deferred_;
         }
 
         return *this;
@@ -263,37 +270,17 @@ namespace easy3d {
 
     void Graph::delete_vertex(Vertex v)
     {
-        /// todo: implement this function
-        LOG(WARNING) << "not implemented. Please ask Liangliang (liangliang.nan@gmail.com) to implement this function";
-    //    if (vdeleted_[v])  return;
-
-    //    // collect incident faces
-    //    std::vector<Face> incident_faces;
-    //    incident_faces.reserve(6);
-
-    //    FaceAroundVertexCirculator fc, fc_end;
-    //    fc = fc_end = faces(v);
-
-    //    if (fc)
-    //    do
-    //    {
-    //        incident_faces.push_back(*fc);
-    //    } while (++fc != fc_end);
-
-    //    // delete incident faces
-    //    std::vector<Face>::iterator fit(incident_faces.begin()),
-    //                                fend(incident_faces.end());
-
-    //    for (; fit != fend; ++fit)
-    //        delete_face(*fit);
-
-    //    // mark v as deleted if not yet done by delete_face()
-    //    if (!vdeleted_[v])
-    //    {
-    //        vdeleted_[v] = true;
-    //        deleted_vertices_++;
-    //        garbage_ = true;
-    //    }
+        if (vdeleted_[v])  return;
+
+        // delete incident edges
+        const std::vector<Edge> incident_edges = vconn_[v].edges_;
+        for (auto e : incident_edges)
+            delete_edge(e);
+
+        // mark v as deleted
+        vdeleted_[v] = true;
+        deleted_vertices_++;
+        garbage_ = true;
     }
 
 
@@ -302,115 +289,78 @@ namespace easy3d {
 
     void Graph::delete_edge(Edge e)
     {
-        /// todo: implement this function
-        LOG(WARNING) << "not implemented. Please ask Liangliang (liangliang.nan@gmail.com) to implement this function";
-    //    if (edeleted_[e])  return;
+        if (edeleted_[e])  return;
 
-    //    Face f0 = face(halfedge(e, 0));
-    //    Face f1 = face(halfedge(e, 1));
+        // detach e from its end points
+        for (auto v : {econn_[e].source_, econn_[e].target_}) {
+            auto& edges = vconn_[v].edges_;
+            edges.erase(std::remove(edges.begin(), edges.end(), e), edges.end());
+        }
 
-    //    if (f0.is_valid()) delete_face(f0);
-    //    if (f1.is_valid()) delete_face(f1);
+        // mark e as deleted
+        edeleted_[e] = true;
+        deleted_edges_++;
+        garbage_ = true;
     }
 
 
     //-----------------------------------------------------------------------------
 
-    void Graph::collect_garbage()
+    void Graph::collect_garbage(bool force)
+    {
+        if (!garbage_ || (garbage_collection_deferred_ && !force))
+            return;
+
+        const int nV(static_cast<int>(vertices_size())),
+                  nE(static_cast<int>(edges_size()));
+
+        // setup the remap tables: the new index of each element (-1 for the deleted ones), and the kept elements in
+        // their original order
+        std::vector<int> vmap(nV, -1), emap(nE, -1);
+        std::vector<std::size_t> vkept, ekept;
+        vkept.reserve(nV - deleted_vertices_);
+        for (int i=0; i<nV; ++i)
+        {
+            if (vdeleted_[Vertex(i)]) continue;
+            vmap[i] = static_cast<int>(vkept.size());
+            vkept.push_back(i);
+        }
+        ekept.reserve(nE - deleted_edges_);
+        for (int i=0; i<nE; ++i)
+        {
+            if (edeleted_[Edge(i)]) continue;
+            emap[i] = static_cast<int>(ekept.size());
+            ekept.push_back(i);
+        }
+
+        // compact all property arrays (all the arrays of the two containers are processed in parallel)
+        PropertyContainer* containers[] = { &vprops_, &eprops_ };
+        const std::vector<std::size_t>* kept[] = { &vkept, &ekept };
+        parallel::for_each(0, 2, [&](std::size_t i) { containers[i]->compact(*kept[i]); }, 1);
+
+        // update vertex connectivity
+        parallel::for_each(0, vkept.size(), [&](std::size_t i) {
+            for (auto& e : vconn_[Vertex(static_cast<int>(i))].edges_)
+                e = Edge(emap[e.idx()]);
+        });
+
+        // update edge connectivity
+        parallel::for_each(0, ekept.size(), [&](std::size_t i) {
+            EdgeConnectivity& conn = econn_[Edge(static_cast<int>(i))];
+            conn.source_ = Vertex(vmap[conn.source_.idx()]);
+            conn.target_ = Vertex(vmap[conn.target_.idx()]);
+        });
+
+        deleted_vertices_ = deleted_edges_ = 0;
+        garbage_ = false;
+    }
+
+
+    void Graph::defer_garbage_collection(bool deferred)
     {
-        /// todo: implement this function
-        LOG(WARNING) << "not implemented. Please ask Liangliang (liangliang.nan@gmail.com) to implement this function";
-    //    int  i, i0, i1,
-    //    nV(vertices_size()),
-    //    nE(edges_size()),
-    //    nH(halfedges_size()),
-
-    //    Vertex    v;
-    //    Halfedge  h;
-
-
-    //    // setup handle mapping
-    //    VertexProperty<Vertex>      vmap = add_vertex_property<Vertex>("v:garbage-collection");
-    //    EdgeProperty<Edge>          emap = add_edge_property<Edge>("e:garbage-collection");
-
-    //    for (i=0; i<nV; ++i)
-    //        vmap[Vertex(i)] = Vertex(i);
-    //    for (i=0; i<nH; ++i)
-    //        emap[Edge(i)] = Edge(i);
-
-    //    // remove deleted vertices
-    //    if (nV > 0)
-    //    {
-    //        i0=0;  i1=nV-1;
-
-    //        while (1)
-    //        {
-    //            // find first deleted and last un-deleted
-    //            while (!vdeleted_[Vertex(i0)] && i0 < i1)  ++i0;
-    //            while ( vdeleted_[Vertex(i1)] && i0 < i1)  --i1;
-    //            if (i0 >= i1) break;
-
-    //            // swap
-    //            vprops_.swap(i0, i1);
-    //        };
-
-    //        // remember new size
-    //        nV = vdeleted_[Vertex(i0)] ? i0 : i0+1;
-    //    }
-
-
-    //    // remove deleted edges
-    //    if (nE > 0)
-    //    {
-    //        i0=0;  i1=nE-1;
-
-    //        while (1)
-    //        {
-    //            // find first deleted and last un-deleted
-    //            while (!edeleted_[Edge(i0)] && i0 < i1)  ++i0;
-    //            while ( edeleted_[Edge(i1)] && i0 < i1)  --i1;
-    //            if (i0 >= i1) break;
-
-    //            // swap
-    //            eprops_.swap(i0, i1);
-    //            eprops_.swap(2*i0,   2*i1);
-    //        };
-
-    //        // remember new size
-    //        nE = edeleted_[Edge(i0)] ? i0 : i0+1;
-    //        nH = 2*nE;
-    //    }
-
-    //    // update vertex connectivity
-    //    for (i=0; i<nV; ++i)
-    //    {
-    //        v = Vertex(i);
-    //        if (!is_isolated(v))
-    //            set_halfedge(v, hmap[edges(v)]);
-    //    }
-
-
-    //    // update halfedge connectivity
-    //    for (i=0; i<nH; ++i)
-    //    {
-    //        h = Halfedge(i);
-    //        set_vertex(h, vmap[target(h)]);
-    //        set_next(h, hmap[next(h)]);
-    //        if (!is_border(h))
-    //            set_face(h, fmap[face(h)]);
-    //    }
-
-    //    // remove handle maps
-    //    remove_vertex_property(vmap);
-    //    remove_edge_property(emap);
-
-
-    //    // finally resize arrays
-    //    vprops_.resize(nV); vprops_.free_memory();
-    //    eprops_.resize(nH); eprops_.free_memory();
-
-    //    deleted_vertices_ = deleted_edges_ = 0;
-    //    garbage_ = false;
+        garbage_collection_deferred_ = deferred;
+        if (!deferred)
+            collect_garbage();
     }
 
 
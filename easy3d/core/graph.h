@@ -574,7 +574,19 @@ namespace easy3d {
         bool has_garbage() const { return garbage_; }
 
 		/// remove deleted vertices/edges
-		void collect_garbage();
+		/// \details The remaining elements keep their relative order. All property arrays are compacted in parallel.
+		///     If the garbage collection is deferred, nothing happens unless \p force is true. Algorithms that rely on
+		///     contiguous indices afterwards must force it.
+		/// \sa defer_garbage_collection()
+		void collect_garbage(bool force = false);
+
+		/// \brief Defers (or resumes) the garbage collection.
+		/// \details While the garbage collection is deferred, collect_garbage() keeps the deleted elements, so the
+		///     handles and iterators remain valid across editing operations (the iterators skip deleted elements).
+		///     Resuming the garbage collection removes all the elements deleted in the meantime at once.
+		void defer_garbage_collection(bool deferred);
+		/// is the garbage collection deferred?
+		bool garbage_collection_deferred() const { return garbage_collection_deferred_; }
 
 
 		/// returns whether vertex \c v is deleted
@@ -910,6 +922,7 @@ namespace easy3d {
 		unsigned int deleted_vertices_;
 		unsigned int deleted_edges_;
 		bool garbage_;
+		bool garbage_collection_deferred_;
 	};
 
 
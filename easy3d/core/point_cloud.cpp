@@ -40,6 +40,7 @@ namespace easy3d {
 
         deleted_vertices_ = 0;
         garbage_ = false;
+        garbage_collection_deferred_ = false;
     }
 
 
@@ -61,6 +62,7 @@ namespace easy3d {
             // how many elements are deleted?
             deleted_vertices_ = rhs.deleted_vertices_;
             garbage_          = rhs.garbage_;
+            garbage_collection_deferred_ = rhs.garbage_collection_deferred_;
         }
 
         return *this;
@@ -110,6 +112,7 @@ namespace easy3d {
             // how many elements are deleted?
             deleted_vertices_ = rhs.deleted_vertices_;
             garbage_          = rhs.garbage_;
+            garbage_collection_deferred_ = rhs.garbage_collection_deferred_;
         }
 
         return *this;
@@ -199,45 +202,35 @@ namespace easy3d {
     //-----------------------------------------------------------------------------
 
 
-    void PointCloud::collect_garbage()
+    void PointCloud::collect_garbage(bool force)
     {
-        int  nV = static_cast<int>(vertices_size());
+        if (!garbage_ || (garbage_collection_deferred_ && !force))
+            return;
 
-        // setup handle mapping
-        auto vmap = add_vertex_property<Vertex>("v:garbage-collection");
-        for (int i=0; i<nV; ++i)
-            vmap[Vertex(i)] = Vertex(i);
+        const int nV = static_cast<int>(vertices_size());
 
-        // remove deleted vertices
-        if (nV > 0)
+        // the kept vertices (in their original order)
+        std::vector<std::size_t> kept;
+        kept.reserve(nV - deleted_vertices_);
+        for (int i=0; i<nV; ++i)
         {
-            int i0 = 0;
-            int i1 = nV - 1;
-
-            while (true)
-            {
-                // find first deleted and last un-deleted
-                while (!vdeleted_[Vertex(i0)] && i0 < i1)  ++i0;
-                while ( vdeleted_[Vertex(i1)] && i0 < i1)  --i1;
-                if (i0 >= i1) break;
-
-                // swap
-                vprops_.swap(i0, i1);
-            }
-
-            // remember new size
-            nV = vdeleted_[Vertex(i0)] ? i0 : i0+1;
+            if (!vdeleted_[Vertex(i)])
+                kept.push_back(i);
         }
 
-        // remove handle maps
-        remove_vertex_property(vmap);
-
-        // finally resize arrays
-        vprops_.resize(nV);
-        vprops_.shrink_to_fit();
+        // compact all property arrays (in parallel)
+        vprops_.compact(kept);
 
         deleted_vertices_ = 0;
         garbage_ = false;
     }
 
+
+    void PointCloud::defer_garbage_collection(bool deferred)
+    {
+        garbage_collection_deferred_ = deferred;
+        if (!deferred)
+            collect_garbage();
+    }
+
 } // namespace easy3d
@@ -288,7 +288,19 @@ namespace easy3d {
         bool has_garbage() const { return garbage_; }
 
         /// @brief remove deleted vertices
-        void collect_garbage();
+        /// \details The remaining vertices keep their relative order. All property arrays are compacted in parallel.
+        ///     If the garbage collection is deferred, nothing happens unless \p force is true. Algorithms that rely on
+        ///     contiguous indices afterwards must force it.
+        /// \sa defer_garbage_collection()
+        void collect_garbage(bool force = false);
+
+        /// @brief Defers (or resumes) the garbage collection.
+        /// \details While the garbage collection is deferred, collect_garbage() keeps the deleted vertices, so the
+        ///     handles and iterators remain valid across editing operations (the iterators skip deleted vertices).
+        ///     Resuming the garbage collection removes all the vertices deleted in the meantime at once.
+        void defer_garbage_collection(bool deferred);
+        /// @brief is the garbage collection deferred?
+        bool garbage_collection_deferred() const { return garbage_collection_deferred_; }
 
         /// @brief deletes the vertex \c v from the cloud
         void delete_vertex(Vertex v);
@@ -487,6 +499,7 @@ namespace easy3d {
 
         unsigned int	deleted_vertices_;
         bool			garbage_;
+        bool			garbage_collection_deferred_;
     };
 
 
@@ -31,6 +31,11 @@
 #include <algorithm>
 #include <typeinfo>
 #include <cassert>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include <easy3d/util/parallel.h>
 
 
 namespace easy3d {
@@ -73,7 +78,11 @@ namespace easy3d {
         /// Let copy 'from' -> 'to'.
         virtual void copy(size_t from, size_t to) = 0;
 
-        /// Return a deep copy of self.
+        /// Keep only the elements \p kept (given in increasing order), i.e., the i'th element becomes kept[i].
+        /// Unused memory is freed.
+        virtual void compact(const std::vector<size_t>& kept) = 0;
+
+        /// Return a copy of self. The copy shares the data with self until one of them is modified (copy-on-write).
         virtual BasePropertyArray* clone () const = 0;
 
         /// Return a empty copy of self.
@@ -105,6 +114,12 @@ namespace easy3d {
     //== CLASS DEFINITION =========================================================
 
     /// \brief Implementation of a generic property array.
+    /// \details The elements are stored in a reference-counted buffer that is shared by copies of the array (e.g.,
+    ///     made by clone() when a model is copied), i.e., copy-on-write. A copy is thus cheap, and the buffer is
+    ///     duplicated only when one of the copies is modified for the first time after the copy. All non-const member
+    ///     functions (including the non-const element access and vector()) may trigger this duplication. It happens
+    ///     once, it is thread safe, and it also applies to the handles acquired before copying the array, so they can
+    ///     never modify a copy. Const access never duplicates the buffer.
     /// \class PropertyArray easy3d/core/properties.h
     template <class T>
     class PropertyArray : public BasePropertyArray
@@ -116,36 +131,63 @@ namespace easy3d {
         typedef typename vector_type::reference         reference;
         typedef typename vector_type::const_reference   const_reference;
 
-        explicit PropertyArray(const std::string& name, T t=T()) : BasePropertyArray(name), value_(t) {}
+        explicit PropertyArray(const std::string& name, T t=T())
+                : BasePropertyArray(name), data_(std::make_shared<vector_type>()), ptr_(data_.get()),
+                  writable_(data_.get()), value_(t) {}
+
+        /// Copy constructor. The data is shared with \p other until either of them is modified.
+        PropertyArray(const PropertyArray& other)
+                : BasePropertyArray(other.name_), data_(other.data_), ptr_(data_.get()), writable_(nullptr),
+                  value_(other.value_)
+        {
+            other.writable_.store(nullptr, std::memory_order_release);
+        }
+
+        /// Assignment. The data is shared with \p other until either of them is modified.
+        PropertyArray& operator=(const PropertyArray& other)
+        {
+            if (this != &other) {
+                name_ = other.name_;
+                data_ = other.data_;
+                retired_.reset();
+                ptr_.store(data_.get(), std::memory_order_release);
+                writable_.store(nullptr, std::memory_order_release);
+                other.writable_.store(nullptr, std::memory_order_release);
+                value_ = other.value_;
+            }
+            return *this;
+        }
 
 
     public: // virtual interface of BasePropertyArray
 
         void reserve(size_t n) override
         {
-            data_.reserve(n);
+            resizable().reserve(n);
         }
 
         void resize(size_t n) override
         {
-            data_.resize(n, value_);
+            resizable().resize(n, value_);
         }
 
         void push_back() override
         {
-            data_.push_back(value_);
+            resizable().push_back(value_);
         }
 
         void reset(size_t idx) override
         {
-            data_[idx] = value_;
+            writable()[idx] = value_;
         }
 
         bool transfer(const BasePropertyArray& other) override
         {
             const auto pa = dynamic_cast<const PropertyArray*>(&other);
             if(pa != nullptr){
-                std::copy((*pa).data_.begin(), (*pa).data_.end(), data_.end()-(*pa).data_.size());
+                const vector_type& src = pa->vector();
+                vector_type& data = resizable();
+                std::copy(src.begin(), src.end(), data.end()-src.size());
                 return true;
             }
             return false;
@@ -156,7 +198,7 @@ namespace easy3d {
             const auto pa = dynamic_cast<const PropertyArray*>(&other);
             if (pa != nullptr)
             {
-                data_[to] = (*pa)[from];
+                writable()[to] = (*pa)[from];
                 return true;
             }
 
@@ -165,26 +207,52 @@ namespace easy3d {
 
         void shrink_to_fit() override
         {
-            vector_type(data_).swap(data_);
+            vector_type& data = resizable();
+            vector_type(data).swap(data);
         }
 
         void swap(size_t i0, size_t i1) override
         {
-            T d(data_[i0]);
-            data_[i0]=data_[i1];
-            data_[i1]=d;
+            vector_type& data = writable();
+            T d(data[i0]);
+            data[i0]=data[i1];
+            data[i1]=d;
         }
 
         void copy(size_t from, size_t to) override
         {
-            data_[to]=data_[from];
+            vector_type& data = writable();
+            data[to]=data[from];
+        }
+
+        void compact(const std::vector<size_t>& kept) override
+        {
+            if (is_shared()) {  // build the compacted copy directly instead of duplicating everything first
+                auto data = std::make_shared<vector_type>();
+                data->reserve(kept.size());
+                for (auto i : kept)
+                    data->push_back((*data_)[i]);
+                data_ = data;
+                retired_.reset();
+                ptr_.store(data_.get(), std::memory_order_release);
+                writable_.store(data_.get(), std::memory_order_release);
+                return;
+            }
+
+            vector_type& data = resizable();
+            for (size_t i=0; i<kept.size(); ++i)
+            {
+                if (kept[i] != i)
+                    data[i]=data[kept[i]];
+            }
+            data.erase(data.begin() + kept.size(), data.end());
+            vector_type(data).swap(data);
         }
 
+        /// Return a copy of self. The data is shared until either of them is modified.
         BasePropertyArray* clone() const override
         {
-            auto p = new PropertyArray<T>(name_, value_);
-            p->data_ = data_;
-            return p;
+            return new PropertyArray<T>(*this);
         }
 
         BasePropertyArray* empty_clone() const override
@@ -201,34 +269,96 @@ namespace easy3d {
         /// Get pointer to array (does not work for T==bool)
         const T* data() const
         {
-            return &data_[0];
+            return &vector()[0];
         }
 
 
-        /// Get reference to the underlying vector
+        /// Get reference to the underlying vector. The data is duplicated first if it is shared with other copies.
         std::vector<T>& vector()
         {
-            return data_;
+            return writable();
+        }
+
+        /// Get const reference to the underlying vector
+        const std::vector<T>& vector() const
+        {
+            return *ptr_.load(std::memory_order_acquire);
         }
 
 
-        /// Access the i'th element. No range check is performed!
+        /// Access the i'th element. No range check is performed! The data is duplicated first if it is shared with
+        /// other copies.
         reference operator[](size_t _idx)
         {
-            assert( size_t(_idx) < data_.size() );
-            return data_[_idx];
+            vector_type& data = writable();
+            assert( size_t(_idx) < data.size() );
+            return data[_idx];
         }
 
         /// Const access to the i'th element. No range check is performed!
         const_reference operator[](size_t _idx) const
         {
-            assert( size_t(_idx) < data_.size());
-            return data_[_idx];
+            const vector_type& data = vector();
+            assert( size_t(_idx) < data.size());
+            return data[_idx];
         }
 
 
+        /// Test if the data is shared with other copies of this array, i.e., if modifying it will duplicate it.
+        bool is_shared() const
+        {
+            return writable_.load(std::memory_order_acquire) == nullptr && data_.use_count() > 1;
+        }
+
+        /// Make the data exclusively owned by this array, duplicating it if it is shared with other copies. This is
+        /// done by the first modification anyway. Calling it before a parallel loop avoids the threads waiting for
+        /// each other in the first modification.
+        void detach()
+        {
+            writable();
+        }
+
     private:
-        vector_type data_;
+        // The data for modification (duplicated if it is shared). Thread safe.
+        vector_type& writable()
+        {
+            vector_type* data = writable_.load(std::memory_order_acquire);
+            return data ? *data : make_writable();
+        }
+
+        // The data for changing the size of the array. Not thread safe (just like changing the size of a vector).
+        vector_type& resizable()
+        {
+            vector_type& data = writable();
+            retired_.reset();   // no other thread can be reading the replaced buffer now
+            return data;
+        }
+
+        vector_type& make_writable()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            vector_type* data = writable_.load(std::memory_order_relaxed);
+            if (!data) {
+                // The replaced buffer is kept until the size of this array changes, because other threads may still
+                // be reading it. Meanwhile, it also makes the copies duplicate it when they are modified.
+                if (data_.use_count() > 1) {
+                    retired_ = data_;
+                    data_ = std::make_shared<vector_type>(*retired_);
+                    ptr_.store(data_.get(), std::memory_order_release);
+                }
+                data = data_.get();
+                writable_.store(data, std::memory_order_release);
+            }
+            return *data;
+        }
+
+    private:
+        std::shared_ptr<vector_type> data_;
+        std::shared_ptr<vector_type> retired_;  // the shared buffer replaced by the first modification
+        std::atomic<vector_type*> ptr_;         // data_ (for the element access)
+        // data_ if it is exclusive to this array, nullptr if it may be shared (i.e., must be duplicated before writing)
+        mutable std::atomic<vector_type*> writable_;
+        std::mutex mutex_;
         value_type  value_;
     };
 
@@ -281,7 +411,7 @@ namespace easy3d {
         virtual const_reference operator[](size_t i) const
         {
             assert(parray_ != nullptr);
-            return (*parray_)[i];
+            return static_cast<const PropertyArray<T>&>(*parray_)[i];
         }
 
         const T* data() const
@@ -299,7 +429,7 @@ namespace easy3d {
         const std::vector<T>& vector() const
         {
             assert(parray_ != nullptr);
-            return parray_->vector();
+            return static_cast<const PropertyArray<T>*>(parray_)->vector();
         }
 
         PropertyArray<T>& array()
@@ -336,21 +466,25 @@ namespace easy3d {
 
 
     /// \brief Implementation of generic property container.
+    /// \details The property arrays of a container grow together: the container keeps a shared capacity that grows
+    ///     geometrically, and all arrays (including those added later) are reserved to it at once. Thus adding
+    ///     elements one by one doesn't make each array reallocate on its own, and reserve() is also effective for the
+    ///     properties added after it (e.g., by a builder).
     /// \class PropertyContainer easy3d/core/properties.h
     class PropertyContainer
     {
     public:
 
         // default constructor
-        PropertyContainer() : size_(0) {}
+        PropertyContainer() : size_(0), capacity_(0) {}
 
         // destructor (deletes all property arrays)
         virtual ~PropertyContainer() { clear(); }
 
-        // copy constructor: performs deep copy of property arrays
+        // copy constructor: copies the property arrays (the data is copied on write, see PropertyArray)
         PropertyContainer(const PropertyContainer& _rhs) { operator=(_rhs); }
 
-        // assignment: performs deep copy of property arrays
+        // assignment: copies the property arrays (the data is copied on write, see PropertyArray)
         PropertyContainer& operator=(const PropertyContainer& _rhs)
         {
             if (this != &_rhs)
@@ -358,6 +492,7 @@ namespace easy3d {
                 clear();
                 parrays_.resize(_rhs.n_properties());
                 size_ = _rhs.size();
+                capacity_ = size_;
                 for (size_t i=0; i<parrays_.size(); ++i)
                     parrays_[i] = _rhs.parrays_[i]->clone();
             }
@@ -440,6 +575,7 @@ namespace easy3d {
 
             // otherwise add the property
             auto p = new PropertyArray<T>(name, t);
+            p->reserve(capacity_);
             p->resize(size_);
             parrays_.push_back(p);
             return Property<T>(p);
@@ -533,19 +669,26 @@ namespace easy3d {
                 delete pa;
             parrays_.clear();
             size_ = 0;
+            capacity_ = 0;
         }
 
 
-        // reserve memory for n entries in all arrays
-        void reserve(size_t n) const
+        // reserve memory for n entries in all arrays (and in the arrays added later)
+        void reserve(size_t n)
         {
             for(auto pa : parrays_)
                 pa->reserve(n);
+            capacity_ = std::max(capacity_, n);
         }
 
+        // returns the shared capacity of the property arrays
+        size_t capacity() const { return capacity_; }
+
         // resize all arrays to size n
         void resize(size_t n)
         {
+            if (n > capacity_)
+                reserve(std::max(n, 2 * capacity_));
             for(auto pa : parrays_)
                 pa->resize(n);
             size_ = n;
@@ -564,15 +707,18 @@ namespace easy3d {
         }
 
         // free unused space in all arrays
-        void shrink_to_fit() const
+        void shrink_to_fit()
         {
             for(auto pa : parrays_)
                 pa->shrink_to_fit();
+            capacity_ = size_;
         }
 
-        // add a new element to each vector
+        // add a new element to each vector. When the capacity is exhausted, all arrays grow together.
         void push_back()
         {
+            if (size_ == capacity_)
+                reserve(std::max<size_t>(2 * capacity_, 16));
             for(auto pa : parrays_)
                 pa->push_back();
             ++size_;
@@ -597,6 +743,7 @@ namespace easy3d {
         {
             this->parrays_.swap (other.parrays_);
             std::swap(this->size_, other.size_);
+            std::swap(this->capacity_, other.capacity_);
         }
 
         // copy 'from' -> 'to' in all arrays
@@ -606,12 +753,21 @@ namespace easy3d {
                 pa->copy(from, to);
         }
 
+        // keep only the elements 'kept' (given in increasing order) in all arrays (processed in parallel).
+        void compact(const std::vector<size_t>& kept)
+        {
+            parallel::for_each(0, parrays_.size(), [&](size_t i) { parrays_[i]->compact(kept); }, 1);
+            size_ = kept.size();
+            capacity_ = size_;
+        }
+
         const std::vector<BasePropertyArray*>& arrays() const { return parrays_; }
         std::vector<BasePropertyArray*>& arrays() { return parrays_; }
 
     private:
         std::vector<BasePropertyArray*>  parrays_;
         size_t  size_;
+        size_t  capacity_;  // the shared capacity of all arrays
     };
 
 } // namespace easy3d
@@ -24,6 +24,7 @@
 
 #include <easy3d/core/surface_mesh.h>
 #include <easy3d/util/logging.h>
+#include <easy3d/util/parallel.h>
 
 #include <cmath>
 #include <fstream>
@@ -46,6 +47,9 @@ namespace easy3d {
 
         deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
         garbage_ = false;
+        garbage_collection_deferred_ = false;
+
+        connectivity_revision_ = 0;
     }
 
 
@@ -56,7 +60,7 @@ namespace easy3d {
     {
         if (this != &rhs)
         {
-            // deep copy of property containers
+            // copy the property containers (the data is copied on write)
             vprops_ = rhs.vprops_;
             hprops_ = rhs.hprops_;
             eprops_ = rhs.eprops_;
@@ -81,6 +85,9 @@ namespace easy3d {
             deleted_edges_    = rhs.deleted_edges_;
             deleted_faces_    = rhs.deleted_faces_;
             garbage_          = rhs.garbage_;
+            garbage_collection_deferred_ = rhs.garbage_collection_deferred_;
+
+            modify_connectivity();
         }
 
         return *this;
@@ -191,6 +198,9 @@ namespace easy3d {
             deleted_edges_    = rhs.deleted_edges_;
             deleted_faces_    = rhs.deleted_faces_;
             garbage_          = rhs.garbage_;
+            garbage_collection_deferred_ = rhs.garbage_collection_deferred_;
+
+            modify_connectivity();
         }
 
         return *this;
@@ -317,6 +327,7 @@ namespace easy3d {
 
         deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
         garbage_ = false;
+        modify_connectivity();
 
         //---- keep the standard properties and remove all the other properties
 
@@ -1013,19 +1024,21 @@ namespace easy3d {
         if (!fnormal_)
             fnormal_ = face_property<vec3>("f:normal");
 
-        FaceIterator fit, fend=faces_end();
-
-        int num_degenerate = 0;
-        for (fit=faces_begin(); fit!=fend; ++fit) {
-            if (is_degenerate(*fit)) {
+        // the faces are independent of each other
+        std::atomic<int> num_degenerate(0);
+        parallel::for_each(0, faces_size(), [&](std::size_t i) {
+            const Face f(static_cast<int>(i));
+            if (is_deleted(f))
+                return;
+            if (is_degenerate(f)) {
                 ++num_degenerate;
-                fnormal_[*fit] = vec3(0, 0, 1);
+                fnormal_[f] = vec3(0, 0, 1);
             } else
-                fnormal_[*fit] = compute_face_normal(*fit);
-        }
+                fnormal_[f] = compute_face_normal(f);
+        });
 
         if (num_degenerate > 0)
-            LOG(WARNING) << "model has " << num_degenerate << " degenerate faces";
+            LOG(WARNING) << "model has " << num_degenerate.load() << " degenerate faces";
     }
 
 
@@ -1095,9 +1108,8 @@ namespace easy3d {
         if (!vnormal_)
             vnormal_ = vertex_property<vec3>("v:normal");
 
-        VertexIterator vit, vend=vertices_end();
-
 #if 0   // not stable for concave vertices
+        VertexIterator vit, vend=vertices_end();
         for (vit=vertices_begin(); vit!=vend; ++vit)
             vnormal_[*vit] = compute_vertex_normal(*vit);
 #else // the angle-weighted average of incident face average
@@ -1158,8 +1170,12 @@ namespace easy3d {
         // always re-compute face normals
         update_face_normals();
 
-        for (vit=vertices_begin(); vit!=vend; ++vit)
-            vnormal_[*vit] = angle_weighted_face_normals(*vit);
+        // the vertices are independent of each other
+        parallel::for_each(0, vertices_size(), [&](std::size_t i) {
+            const Vertex v(static_cast<int>(i));
+            if (!is_deleted(v))
+                vnormal_[v] = angle_weighted_face_normals(v);
+        });
 #endif
     }
 
@@ -1975,6 +1991,7 @@ namespace easy3d {
             vdeleted_[v] = true;
             deleted_vertices_++;
             garbage_ = true;
+            modify_connectivity();
         }
     }
 
@@ -2005,6 +2022,7 @@ namespace easy3d {
         {
             fdeleted_[f] = true;
             deleted_faces_++;
+            modify_connectivity();
         }
 
         // boundary edges of face f to be deleted
@@ -2110,141 +2128,84 @@ namespace easy3d {
     //-----------------------------------------------------------------------------
 
 
-    void SurfaceMesh::collect_garbage()
+    void SurfaceMesh::collect_garbage(bool force)
     {
-        if (!garbage_)
+        if (!garbage_ || (garbage_collection_deferred_ && !force))
             return;
 
-        int  i, i0, i1,
-        nV(static_cast<int>(vertices_size())),
-        nE(static_cast<int>(edges_size())),
-        nH(static_cast<int>(halfedges_size())),
-        nF(static_cast<int>(faces_size()));
-
-        Vertex    v;
-        Halfedge  h;
-        Face      f;
-
-        // setup handle mapping
-        VertexProperty<Vertex>      vmap = add_vertex_property<Vertex>("v:garbage-collection");
-        HalfedgeProperty<Halfedge>  hmap = add_halfedge_property<Halfedge>("h:garbage-collection");
-        FaceProperty<Face>          fmap = add_face_property<Face>("f:garbage-collection");
-        for (i=0; i<nV; ++i)
-            vmap[Vertex(i)] = Vertex(i);
-        for (i=0; i<nH; ++i)
-            hmap[Halfedge(i)] = Halfedge(i);
-        for (i=0; i<nF; ++i)
-            fmap[Face(i)] = Face(i);
-
-
+        const int nV(static_cast<int>(vertices_size())),
+                  nE(static_cast<int>(edges_size())),
+                  nF(static_cast<int>(faces_size()));
 
-        // remove deleted vertices
-        if (nV > 0)
+        // setup the remap tables: the new index of each element (-1 for the deleted ones), and the kept elements in
+        // their original order. The two halfedges of an edge stay together.
+        std::vector<int> vmap(nV, -1), hmap(2 * nE, -1), fmap(nF, -1);
+        std::vector<std::size_t> vkept, hkept, ekept, fkept;
+        vkept.reserve(nV - deleted_vertices_);
+        for (int i=0; i<nV; ++i)
         {
-            i0=0;  i1=nV-1;
-
-            while (true)
-            {
-                // find first deleted and last un-deleted
-                while (!vdeleted_[Vertex(i0)] && i0 < i1)  ++i0;
-                while ( vdeleted_[Vertex(i1)] && i0 < i1)  --i1;
-                if (i0 >= i1) break;
-
-                // swap
-                vprops_.swap(i0, i1);
-            }
-
-            // remember new size
-            nV = vdeleted_[Vertex(i0)] ? i0 : i0+1;
-        }
-
-
-        // remove deleted edges
-        if (nE > 0)
-        {
-            i0=0;  i1=nE-1;
-
-            while (true)
-            {
-                // find first deleted and last un-deleted
-                while (!edeleted_[Edge(i0)] && i0 < i1)  ++i0;
-                while ( edeleted_[Edge(i1)] && i0 < i1)  --i1;
-                if (i0 >= i1) break;
-
-                // swap
-                eprops_.swap(i0, i1);
-                hprops_.swap(2*i0,   2*i1);
-                hprops_.swap(2*i0+1, 2*i1+1);
-            }
-
-            // remember new size
-            nE = edeleted_[Edge(i0)] ? i0 : i0+1;
-            nH = 2*nE;
+            if (vdeleted_[Vertex(i)]) continue;
+            vmap[i] = static_cast<int>(vkept.size());
+            vkept.push_back(i);
         }
-
-
-        // remove deleted faces
-        if (nF > 0)
+        ekept.reserve(nE - deleted_edges_);
+        hkept.reserve(2 * (nE - deleted_edges_));
+        for (int i=0; i<nE; ++i)
         {
-            i0=0;  i1=nF-1;
-
-            while (true)
-            {
-                // find 1st deleted and last un-deleted
-                while (!fdeleted_[Face(i0)] && i0 < i1)  ++i0;
-                while ( fdeleted_[Face(i1)] && i0 < i1)  --i1;
-                if (i0 >= i1) break;
-
-                // swap
-                fprops_.swap(i0, i1);
-            }
-
-            // remember new size
-            nF = fdeleted_[Face(i0)] ? i0 : i0+1;
+            if (edeleted_[Edge(i)]) continue;
+            hmap[2*i]   = static_cast<int>(hkept.size());
+            hmap[2*i+1] = static_cast<int>(hkept.size() + 1);
+            ekept.push_back(i);
+            hkept.push_back(2*i);
+            hkept.push_back(2*i+1);
         }
-
-
-        // update vertex connectivity
-        for (i=0; i<nV; ++i)
+        fkept.reserve(nF - deleted_faces_);
+        for (int i=0; i<nF; ++i)
         {
-            v = Vertex(i);
-            if (!is_isolated(v))
-                set_out_halfedge(v, hmap[out_halfedge(v)]);
+            if (fdeleted_[Face(i)]) continue;
+            fmap[i] = static_cast<int>(fkept.size());
+            fkept.push_back(i);
         }
 
+        // compact all property arrays (all the arrays of the four containers are processed in parallel)
+        PropertyContainer* containers[] = { &vprops_, &hprops_, &eprops_, &fprops_ };
+        const std::vector<std::size_t>* kept[] = { &vkept, &hkept, &ekept, &fkept };
+        parallel::for_each(0, 4, [&](std::size_t i) { containers[i]->compact(*kept[i]); }, 1);
 
-        // update halfedge connectivity
-        for (i=0; i<nH; ++i)
-        {
-            h = Halfedge(i);
-            set_target(h, vmap[target(h)]);
-            set_next(h, hmap[next(h)]);
-            if (!is_border(h))
-                set_face(h, fmap[face(h)]);
-        }
+        auto new_vertex = [&](Vertex v) { return v.is_valid() ? Vertex(vmap[v.idx()]) : v; };
+        auto new_halfedge = [&](Halfedge h) { return h.is_valid() ? Halfedge(hmap[h.idx()]) : h; };
+        auto new_face = [&](Face f) { return f.is_valid() ? Face(fmap[f.idx()]) : f; };
 
+        // update vertex connectivity
+        parallel::for_each(0, vkept.size(), [&](std::size_t i) {
+            const Vertex v(static_cast<int>(i));
+            set_out_halfedge(v, new_halfedge(out_halfedge(v)));
+        });
+
+        // update halfedge connectivity. The previous halfedges are set in a second pass, in which each halfedge
+        // only writes to its next halfedge.
+        parallel::for_each(0, hkept.size(), [&](std::size_t i) {
+            HalfedgeConnectivity& conn = hconn_[Halfedge(static_cast<int>(i))];
+            conn.vertex_ = new_vertex(conn.vertex_);
+            conn.next_ = new_halfedge(conn.next_);
+            conn.face_ = new_face(conn.face_);
+        });
+        parallel::for_each(0, hkept.size(), [&](std::size_t i) {
+            const Halfedge h(static_cast<int>(i));
+            const Halfedge nh = next(h);
+            if (nh.is_valid())
+                hconn_[nh].prev_ = h;
+        });
 
         // update handles of faces
-        for (i=0; i<nF; ++i)
-        {
-            f = Face(i);
-            set_halfedge(f, hmap[halfedge(f)]);
-        }
-
-
-        // remove handle maps
-        remove_vertex_property(vmap);
-        remove_halfedge_property(hmap);
-        remove_face_property(fmap);
-
-        // finally resize arrays
-        vprops_.resize(nV); vprops_.shrink_to_fit();
-        hprops_.resize(nH); hprops_.shrink_to_fit();
-        eprops_.resize(nE); eprops_.shrink_to_fit();
-        fprops_.resize(nF); fprops_.shrink_to_fit();
+        parallel::for_each(0, fkept.size(), [&](std::size_t i) {
+            const Face f(static_cast<int>(i));
+            set_halfedge(f, new_halfedge(halfedge(f)));
+        });
 
         deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
         garbage_ = false;
+        modify_connectivity();
 
 #if 1
         // [Liangliang]: It seems the outgoing halfedges of the vertices may be broken after garbage collection, e.g.,
@@ -2257,6 +2218,30 @@ namespace easy3d {
     }
 
 
+    void SurfaceMesh::defer_garbage_collection(bool deferred)
+    {
+        garbage_collection_deferred_ = deferred;
+        if (!deferred)
+            collect_garbage();
+    }
+
+
+    std::size_t SurfaceMesh::connectivity_revision() const
+    {
+        // the revisions are drawn from a process-wide counter, so they also differ between meshes
+        static std::atomic<std::size_t> counter(0);
+        std::size_t revision = connectivity_revision_.load(std::memory_order_acquire);
+        while (revision == 0) {
+            // if another caller assigns a revision first, the exchange fails and all callers return that revision
+            const std::size_t assigned = ++counter;
+            if (connectivity_revision_.compare_exchange_weak(revision, assigned, std::memory_order_acq_rel,
+                                                             std::memory_order_acquire))
+                return assigned;
+        }
+        return revision;
+    }
+
+
     bool SurfaceMesh::is_degenerate(Face f) const {
         Halfedge h = halfedge(f);
         Halfedge hend = h;
@@ -29,6 +29,8 @@
 #include <easy3d/core/types.h>
 #include <easy3d/core/property.h>
 
+#include <atomic>
+
 namespace easy3d {
 
     /**
@@ -1089,6 +1091,7 @@ namespace easy3d {
         /// associated properties.
         /// Note: ne is the number of edges. for halfedges, nh = 2 * ne. */
         void resize(unsigned int nv, unsigned int ne, unsigned int nf) {
+            modify_connectivity();
             vprops_.resize(nv);
             hprops_.resize(2 * ne);
             eprops_.resize(ne);
@@ -1099,7 +1102,28 @@ namespace easy3d {
         bool has_garbage() const { return garbage_; }
 
         /// remove deleted vertices/edges/faces
-        void collect_garbage();
+        /// \details The remaining elements keep their relative order. All property arrays are compacted in parallel.
+        ///     If the garbage collection is deferred, nothing happens unless \p force is true. Algorithms that rely on
+        ///     contiguous indices afterwards must force it.
+        /// \sa defer_garbage_collection()
+        void collect_garbage(bool force = false);
+
+        /// \brief Defers (or resumes) the garbage collection.
+        /// \details While the garbage collection is deferred, collect_garbage() keeps the deleted elements, so the
+        ///     handles and iterators remain valid across editing operations (the iterators skip deleted elements).
+        ///     This avoids compacting all property arrays after each step of an iterative editing session. Resuming
+        ///     the garbage collection removes all the elements deleted in the meantime at once.
+        void defer_garbage_collection(bool deferred);
+        /// is the garbage collection deferred?
+        bool garbage_collection_deferred() const { return garbage_collection_deferred_; }
+
+        /// \brief Returns the revision of the connectivity of the mesh.
+        /// \details The revision changes whenever elements are added, deleted, or (re)connected, and it is unique
+        ///     among all the meshes of the process. So it can be used as the key of data derived from the
+        ///     connectivity, e.g., the sparsity pattern of a Laplacian matrix, which then remain valid as long as the
+        ///     revision does not change. Moving vertices does not change the revision. It can be called concurrently
+        ///     (e.g., by several solvers sharing the mesh), and all the callers get the same revision.
+        std::size_t connectivity_revision() const;
 
 
         /// returns whether vertex \c v is deleted
@@ -1169,6 +1193,7 @@ namespace easy3d {
         /// set the outgoing halfedge of vertex \c v to \c h
         void set_out_halfedge(Vertex v, Halfedge h)
         {
+            modify_connectivity();
             vconn_[v].halfedge_ = h;
         }
 
@@ -1222,6 +1247,7 @@ namespace easy3d {
         /// sets the vertex the halfedge \c h points to to \c v
         void set_target(Halfedge h, Vertex v)
         {
+            modify_connectivity();
             hconn_[h].vertex_ = v;
         }
 
@@ -1234,6 +1260,7 @@ namespace easy3d {
         /// sets the incident face to halfedge \c h to \c f
         void set_face(Halfedge h, Face f)
         {
+            modify_connectivity();
             hconn_[h].face_ = f;
         }
 
@@ -1246,6 +1273,7 @@ namespace easy3d {
         /// sets the next halfedge of \c h within the face to \c nh
         void set_next(Halfedge h, Halfedge nh)
         {
+            modify_connectivity();
             hconn_[h].next_ = nh;
             hconn_[nh].prev_ = h;
         }
@@ -1340,6 +1368,7 @@ namespace easy3d {
         /// sets the halfedge of face \c f to \c h
         void set_halfedge(Face f, Halfedge h)
         {
+            modify_connectivity();
             fconn_[f].halfedge_ = h;
         }
 
@@ -1962,6 +1991,7 @@ namespace easy3d {
         /// allocate a new vertex, resize vertex properties accordingly.
         Vertex new_vertex()
         {
+            modify_connectivity();
             vprops_.push_back();
             return Vertex(static_cast<int>(vertices_size()-1));
         }
@@ -1971,6 +2001,7 @@ namespace easy3d {
         {
             assert(start != end);
 
+            modify_connectivity();
             eprops_.push_back();
             hprops_.push_back();
             hprops_.push_back();
@@ -1987,6 +2018,7 @@ namespace easy3d {
         /// allocate a new face, resize face properties accordingly.
         Face new_face()
         {
+            modify_connectivity();
             fprops_.push_back();
             return Face(static_cast<int>(faces_size()-1));
         }
@@ -1994,6 +2026,10 @@ namespace easy3d {
 
     private: //--------------------------------------------------- helper functions
 
+        /// marks the connectivity as modified, so connectivity_revision() assigns a new revision. This is called
+        /// concurrently by parallel bulk operations, hence the atomic revision (0 means "to be assigned").
+        void modify_connectivity() { connectivity_revision_.store(0, std::memory_order_relaxed); }
+
         /**
          * [Liangliang]:
          * The outgoing halfedges of the vertices may not be valid after a sequence calls to add_face() operations or
@@ -2040,6 +2076,9 @@ namespace easy3d {
         unsigned int deleted_edges_;
         unsigned int deleted_faces_;
         bool garbage_;
+        bool garbage_collection_deferred_;
+
+        mutable std::atomic<std::size_t> connectivity_revision_;
 
         // helper data for add_face()
         typedef std::pair<Halfedge, Halfedge>  NextCacheEntry;
@@ -27,9 +27,12 @@
 #include <easy3d/core/surface_mesh_builder.h>
 
 #include <set>
+#include <limits>
+#include <algorithm>
 
 #include <easy3d/util/logging.h>
 #include <easy3d/util/file_system.h>
+#include <easy3d/util/parallel.h>
 
 
 namespace easy3d {
@@ -255,8 +258,8 @@ namespace easy3d {
         // Check #3; a face has out-of-range vertices
         for (auto v : vertices) {
             if (v.idx() < 0 || v.idx() >= static_cast<int>(mesh_->n_vertices())) {
-                LOG_N_TIMES(3, ERROR) << "face has out-of-range vertices (number of vertices is "
-                                      << mesh_->n_vertices() << "). " << COUNTER;
+                // the COUNTER must be on the same line as LOG_N_TIMES (it is looked up by the line number)
+                LOG_N_TIMES(3, ERROR) << "face has out-of-range vertices (number of vertices is " << mesh_->n_vertices() << "). " << COUNTER;
                 ++num_faces_out_of_range_vertices_;
                 return false;
             }
@@ -363,6 +366,307 @@ namespace easy3d {
     }
 
 
+    std::vector<SurfaceMesh::Face> SurfaceMeshBuilder::add_faces(const std::vector<int> &indices, const std::vector<int> &face_sizes) {
+        DLOG_IF(!original_vertex_, ERROR) << "you must call begin_surface() before the constructing a surface mesh";
+
+        const bool all_triangles = face_sizes.empty();
+        const std::size_t num_faces = all_triangles ? indices.size() / 3 : face_sizes.size();
+
+        // the first corner (i.e., the position in 'indices') of each face
+        std::vector<std::size_t> face_offsets(num_faces + 1, 0);
+        for (std::size_t f = 0; f < num_faces; ++f)
+            face_offsets[f + 1] = face_offsets[f] + (all_triangles ? 3 : static_cast<std::size_t>(std::max(face_sizes[f], 0)));
+        const std::size_t num_corners = face_offsets[num_faces];
+        if (num_corners != indices.size()) {
+            LOG(ERROR) << "the number of vertex indices (" << indices.size()
+                       << ") does not match the total size of the faces (" << num_corners << ")";
+            return std::vector<Face>();
+        }
+
+        std::vector<Face> faces(num_faces);
+        std::vector<Vertex> vertices;
+        auto add_face_incrementally = [&](std::size_t f) {
+            vertices.clear();
+            for (std::size_t c = face_offsets[f]; c < face_offsets[f + 1]; ++c)
+                vertices.emplace_back(Vertex(indices[c]));
+            faces[f] = add_face(vertices);
+        };
+
+        // The direct linking assumes there are no faces yet (and the halfedges must be indexable by 'int').
+        if (mesh_->faces_size() > 0 || num_corners > static_cast<std::size_t>(std::numeric_limits<int>::max() / 2)) {
+            for (std::size_t f = 0; f < num_faces; ++f)
+                add_face_incrementally(f);
+            return faces;
+        }
+
+        std::vector<unsigned int> corner_face;
+        if (!all_triangles) {
+            corner_face.resize(num_corners);
+            parallel::for_each(0, num_faces, [&](std::size_t f) {
+                for (std::size_t c = face_offsets[f]; c < face_offsets[f + 1]; ++c)
+                    corner_face[c] = static_cast<unsigned int>(f);
+            });
+        }
+        auto face_of = [&](std::size_t c) -> std::size_t {
+            return all_triangles ? c / 3 : corner_face[c];
+        };
+        // a corner and its next corner in the same face define a halfedge
+        auto next_corner = [&](std::size_t c) -> std::size_t {
+            const std::size_t f = face_of(c);
+            return (c + 1 == face_offsets[f + 1]) ? face_offsets[f] : c + 1;
+        };
+
+        // Faces that cannot be directly linked are deferred to add_face(). First, the invalid faces (add_face() will
+        // reject them and report the issues).
+        const int nv = static_cast<int>(mesh_->vertices_size());
+        std::vector<unsigned char> deferred(num_faces, 0);
+        parallel::for_each(0, num_faces, [&](std::size_t f) {
+            const std::size_t n = face_offsets[f + 1] - face_offsets[f];
+            const int *ids = indices.data() + face_offsets[f];
+            bool valid = (n >= 3);
+            for (std::size_t i = 0; valid && i < n; ++i)
+                valid = (ids[i] >= 0 && ids[i] < nv);
+            if (valid && n <= 16) {
+                for (std::size_t i = 0; valid && i < n; ++i) {
+                    for (std::size_t j = i + 1; valid && j < n; ++j)
+                        valid = (ids[i] != ids[j]);
+                }
+            } else if (valid) {
+                std::vector<int> sorted(ids, ids + n);
+                std::sort(sorted.begin(), sorted.end());
+                valid = (std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+            }
+            deferred[f] = !valid;
+        });
+
+        // Then, the faces on non-manifold edges. The halfedges of the faces are bucketed by their smaller vertex and
+        // sorted by their larger vertex within each bucket, so the halfedges of an edge become adjacent. An edge is
+        // manifold if it has a single halfedge or two halfedges of opposite directions. For the other edges, the first
+        // halfedge and its first opposite halfedge are kept, and the faces of the remaining ones are deferred. Since
+        // deferring a face changes the halfedges of its other edges, this is repeated until no face is deferred.
+        std::vector<std::size_t> bucket_offsets(nv + 1);
+        std::vector<unsigned int> bucket;
+        std::vector<unsigned char> conflict(num_corners, 0);
+        std::vector<unsigned int> edge_offsets(nv + 1);
+        auto smaller = [&](std::size_t c) -> int { return std::min(indices[c], indices[next_corner(c)]); };
+        auto larger = [&](std::size_t c) -> int { return std::max(indices[c], indices[next_corner(c)]); };
+        auto ascending = [&](std::size_t c) -> bool { return indices[c] < indices[next_corner(c)]; };
+        while (true) {
+            std::fill(bucket_offsets.begin(), bucket_offsets.end(), 0);
+            for (std::size_t f = 0; f < num_faces; ++f) {
+                if (!deferred[f]) {
+                    for (std::size_t c = face_offsets[f]; c < face_offsets[f + 1]; ++c)
+                        ++bucket_offsets[smaller(c) + 1];
+                }
+            }
+            for (int v = 0; v < nv; ++v)
+                bucket_offsets[v + 1] += bucket_offsets[v];
+
+            bucket.resize(bucket_offsets[nv]);
+            std::vector<std::size_t> pos(bucket_offsets.begin(), bucket_offsets.end() - 1);
+            for (std::size_t f = 0; f < num_faces; ++f) {
+                if (!deferred[f]) {
+                    for (std::size_t c = face_offsets[f]; c < face_offsets[f + 1]; ++c)
+                        bucket[pos[smaller(c)]++] = static_cast<unsigned int>(c);
+                }
+            }
+
+            edge_offsets[0] = 0;
+            parallel::for_each_range(0, nv, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t v = begin; v < end; ++v) {
+                    auto first = bucket.begin() + bucket_offsets[v];
+                    auto last = bucket.begin() + bucket_offsets[v + 1];
+                    std::sort(first, last, [&](unsigned int a, unsigned int b) {
+                        const int la = larger(a), lb = larger(b);
+                        return la < lb || (la == lb && a < b);
+                    });
+
+                    unsigned int num_edges = 0;
+                    for (auto group = first; group != last; ++num_edges) {
+                        const int l = larger(*group);
+                        const bool dir = ascending(*group);
+                        conflict[*group] = 0;
+                        bool paired = false;
+                        auto it = group + 1;
+                        for (; it != last && larger(*it) == l; ++it) {
+                            const bool opposite = (ascending(*it) != dir);
+                            conflict[*it] = !(opposite && !paired);
+                            paired = paired || opposite;
+                        }
+                        group = it;
+                    }
+                    edge_offsets[v + 1] = num_edges;
+                }
+            });
+
+            const std::size_t num_deferred = parallel::reduce(0, num_faces, std::size_t(0),
+                    [&](std::size_t begin, std::size_t end) -> std::size_t {
+                        std::size_t count = 0;
+                        for (std::size_t f = begin; f < end; ++f) {
+                            if (deferred[f])
+                                continue;
+                            for (std::size_t c = face_offsets[f]; c < face_offsets[f + 1]; ++c) {
+                                if (conflict[c]) {
+                                    deferred[f] = 1;
+                                    ++count;
+                                    break;
+                                }
+                            }
+                        }
+                        return count;
+                    },
+                    std::plus<std::size_t>()
+            );
+            if (num_deferred == 0)
+                break;
+        }
+
+        // Now all the remaining faces can be directly linked. Each edge gets two consecutive halfedges: the first one
+        // for the first halfedge in its group, and the second one for its opposite (a border halfedge if unpaired).
+        for (int v = 0; v < nv; ++v)
+            edge_offsets[v + 1] += edge_offsets[v];
+        const unsigned int num_edges = edge_offsets[nv];
+
+        std::vector<int> corner_halfedge(num_corners, -1);
+        std::vector<unsigned char> on_border(num_corners, 0);
+        parallel::for_each_range(0, nv, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t v = begin; v < end; ++v) {
+                int e = static_cast<int>(edge_offsets[v]);
+                auto last = bucket.begin() + bucket_offsets[v + 1];
+                for (auto it = bucket.begin() + bucket_offsets[v]; it != last; ++e) {
+                    corner_halfedge[*it] = 2 * e;
+                    if (it + 1 != last && larger(*(it + 1)) == larger(*it)) {
+                        corner_halfedge[*(it + 1)] = 2 * e + 1;
+                        it += 2;
+                    } else {
+                        on_border[*it] = 1;
+                        ++it;
+                    }
+                }
+            }
+        });
+
+        std::vector<int> face_index(num_faces, -1);
+        int num_linked_faces = 0;
+        for (std::size_t f = 0; f < num_faces; ++f) {
+            if (!deferred[f])
+                face_index[f] = num_linked_faces++;
+        }
+
+        mesh_->resize(nv, num_edges, num_linked_faces);
+
+        // the connectivity within each face and the targets of the border halfedges
+        parallel::for_each(0, num_faces, [&](std::size_t f) {
+            if (deferred[f])
+                return;
+            const Face face(face_index[f]);
+            for (std::size_t c = face_offsets[f]; c < face_offsets[f + 1]; ++c) {
+                const std::size_t nc = next_corner(c);
+                const Halfedge h(corner_halfedge[c]);
+                mesh_->set_target(h, Vertex(indices[nc]));
+                mesh_->set_face(h, face);
+                mesh_->set_next(h, Halfedge(corner_halfedge[nc]));
+                if (on_border[c])
+                    mesh_->set_target(mesh_->opposite(h), Vertex(indices[c]));
+            }
+            mesh_->set_halfedge(face, Halfedge(corner_halfedge[face_offsets[f]]));
+            faces[f] = face;
+        });
+
+        // Link the border halfedges. A border halfedge pointing to a vertex is followed by a border halfedge leaving
+        // it. At a vertex shared by multiple umbrellas, they are paired in an arbitrary order, and the vertex will be
+        // split by resolve_non_manifold_vertices() in end_surface().
+        std::vector<Halfedge> border_out(nv);
+        std::unordered_map<int, std::vector<Halfedge> > more_border_out;
+        for (std::size_t c = 0; c < num_corners; ++c) {
+            if (on_border[c] && !deferred[face_of(c)]) {
+                const Halfedge b = mesh_->opposite(Halfedge(corner_halfedge[c]));
+                const int s = indices[next_corner(c)];
+                if (border_out[s].is_valid())
+                    more_border_out[s].push_back(b);
+                else
+                    border_out[s] = b;
+            }
+        }
+        for (std::size_t c = 0; c < num_corners; ++c) {
+            if (on_border[c] && !deferred[face_of(c)]) {
+                const Halfedge b = mesh_->opposite(Halfedge(corner_halfedge[c]));
+                const int t = indices[c];
+                auto pos = more_border_out.find(t);
+                if (pos == more_border_out.end() || pos->second.empty()) {
+                    mesh_->set_next(b, border_out[t]);
+                } else {
+                    mesh_->set_next(b, pos->second.back());
+                    pos->second.pop_back();
+                }
+            }
+        }
+
+        // the outgoing halfedges (border halfedges for border vertices)
+        parallel::for_each(0, static_cast<std::size_t>(nv), [&](std::size_t v) {
+            mesh_->set_out_halfedge(Vertex(static_cast<int>(v)), border_out[v]);
+        });
+        for (std::size_t c = 0; c < num_corners; ++c) {
+            if (!deferred[face_of(c)] && !border_out[indices[c]].is_valid()) {
+                const Vertex v(indices[c]);
+                if (!mesh_->out_halfedge(v).is_valid())
+                    mesh_->set_out_halfedge(v, Halfedge(corner_halfedge[c]));
+            }
+        }
+
+        if (num_linked_faces == static_cast<int>(num_faces))
+            return faces;
+
+        // Add the deferred faces one by one. The halfedges of the linked faces that may be duplicated by the deferred
+        // faces are put into our record (only used for the report on the non-manifold edges).
+        std::vector<unsigned char> is_source(nv, 0);
+        for (std::size_t f = 0; f < num_faces; ++f) {
+            if (deferred[f]) {
+                for (std::size_t c = face_offsets[f]; c < face_offsets[f + 1]; ++c) {
+                    if (indices[c] >= 0 && indices[c] < nv)
+                        is_source[indices[c]] = 1;
+                }
+            }
+        }
+        for (std::size_t c = 0; c < num_corners; ++c) {
+            if (!deferred[face_of(c)] && is_source[indices[c]])
+                outgoing_halfedges_[indices[c]].push_back(indices[next_corner(c)]);
+        }
+
+        for (std::size_t f = 0; f < num_faces; ++f) {
+            if (deferred[f])
+                add_face_incrementally(f);
+        }
+
+        // The deferred faces were appended. Reorder the faces to follow the input order.
+        const std::size_t num_created_faces = mesh_->faces_size();
+        std::vector<int> new_index(num_created_faces);
+        int count = 0;
+        for (std::size_t f = 0; f < num_faces; ++f) {
+            if (faces[f].is_valid()) {
+                new_index[faces[f].idx()] = count;
+                faces[f] = Face(count++);
+            }
+        }
+        const std::vector<int> face_map = new_index;
+        for (std::size_t i = 0; i < num_created_faces; ++i) {
+            while (new_index[i] != static_cast<int>(i)) {
+                const int j = new_index[i];
+                mesh_->fprops_.swap(i, j);
+                std::swap(new_index[i], new_index[j]);
+            }
+        }
+        parallel::for_each(0, mesh_->halfedges_size(), [&](std::size_t i) {
+            const Halfedge h(static_cast<int>(i));
+            const Face f = mesh_->face(h);
+            if (f.is_valid())
+                mesh_->set_face(h, Face(face_map[f.idx()]));
+        });
+
+        return faces;
+    }
+
+
     SurfaceMesh::Vertex SurfaceMeshBuilder::get(Vertex v) {
         auto pos = copied_vertices_.find(v);
         if (pos == copied_vertices_.end()) { // no copies
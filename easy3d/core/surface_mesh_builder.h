@@ -28,6 +28,7 @@
 #define EASY3D_CORE_SURFACE_MESH_BUILDER_H
 
 
+#include <vector>
 #include <unordered_map>
 #include <easy3d/core/surface_mesh.h>
 
@@ -102,6 +103,22 @@ namespace easy3d {
          */
         Face add_quad(Vertex v1, Vertex v2, Vertex v3, Vertex v4);
 
+        /**
+         * @brief Add all the faces of a mesh at once from an indexed face array.
+         * @details The halfedge connectivity of the faces is built in a single (partially parallel) pass by sorting
+         *      the edges, which is much faster than adding the faces one by one for large models. Only the faces that
+         *      cannot be directly linked (e.g., invalid faces and faces on non-manifold edges) go through add_face(),
+         *      so non-manifoldness is resolved as in the incremental construction. The only difference is which
+         *      umbrella of a non-manifold vertex keeps the original vertex (the others get copies of it). The faces are
+         *      created in the order they appear in the input. This function must be called after all vertices have been added
+         *      and before any face is added. Otherwise, it falls back to adding the faces one by one.
+         * @param indices The vertex indices of all faces, concatenated.
+         * @param face_sizes The number of vertices of each face. An empty array means all faces are triangles.
+         * @return The added faces, one for each input face (an invalid face if the input face was not added).
+         * @related add_face().
+         */
+        std::vector<Face> add_faces(const std::vector<int> &indices, const std::vector<int> &face_sizes = {});
+
         /**
          * @brief Finalize surface construction. Must be called at the end of the surface construction and used in
          *        pair with begin_surface() at the beginning of surface mesh construction.
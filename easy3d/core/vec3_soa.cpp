@@ -0,0 +1,341 @@
+#include <easy3d/core/vec3_soa.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <easy3d/util/parallel.h>
+
+// The AVX2 kernels are compiled with function-level target attributes (and the intrinsics are available regardless
+// of the compiler flags), so the rest of this file and the inline code it instantiates still run on any x86-64 CPU.
+// The kernels are then chosen at run time by the features of the CPU.
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#define EASY3D_SIMD_X86
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+namespace easy3d {
+
+    void Vec3SoA::assign(const std::vector<vec3> &vectors) {
+        resize(vectors.size());
+        parallel::for_each(0, vectors.size(), [&](std::size_t i) {
+            const vec3 &v = vectors[i];
+            x_[i] = v.x;
+            y_[i] = v.y;
+            z_[i] = v.z;
+        });
+    }
+
+
+    void Vec3SoA::copy_to(std::vector<vec3> &vectors) const {
+        vectors.resize(size());
+        parallel::for_each(0, size(), [&](std::size_t i) {
+            vectors[i] = vec3(x_[i], y_[i], z_[i]);
+        });
+    }
+
+
+    namespace simd {
+
+        /// \cond
+        namespace internal {
+
+            // The reductions accumulate blocks of this size in single precision (using SIMD), and the results of
+            // the blocks are then accumulated in double precision.
+            const std::size_t block_size = 1024;
+
+            struct Covariance {
+                double xx, xy, xz, yy, yz, zz;
+                Covariance() : xx(0), xy(0), xz(0), yy(0), yz(0), zz(0) {}
+                Covariance operator+(const Covariance &c) const {
+                    Covariance r;
+                    r.xx = xx + c.xx; r.xy = xy + c.xy; r.xz = xz + c.xz;
+                    r.yy = yy + c.yy; r.yz = yz + c.yz; r.zz = zz + c.zz;
+                    return r;
+                }
+            };
+
+            // The kernels for each instruction set. A thin wrapper 'Batch' of the SIMD instructions is defined in
+            // a namespace, and the kernels in vec3_soa_kernels.inl are then compiled in that namespace.
+#if defined(EASY3D_SIMD_X86)
+            namespace sse2 {
+                struct Batch {
+                    typedef __m128 type;
+                    static const std::size_t width = 4;
+                    static type load(const float *p) { return _mm_loadu_ps(p); }
+                    static void store(float *p, type v) { _mm_storeu_ps(p, v); }
+                    static type set(float v) { return _mm_set1_ps(v); }
+                    static type add(type a, type b) { return _mm_add_ps(a, b); }
+                    static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+                    static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+                    static type div(type a, type b) { return _mm_div_ps(a, b); }
+                    static type min(type a, type b) { return _mm_min_ps(a, b); }
+                    static type max(type a, type b) { return _mm_max_ps(a, b); }
+                    static type sqrt(type a) { return _mm_sqrt_ps(a); }
+                    static type madd(type a, type b, type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+                    // returns (c > 0) ? a : b
+                    static type select_positive(type c, type a, type b) {
+                        const type mask = _mm_cmpgt_ps(c, _mm_setzero_ps());
+                        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+                    }
+                };
+#include "vec3_soa_kernels.inl"
+            }
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+            namespace avx2 {
+                struct Batch {
+                    typedef __m256 type;
+                    static const std::size_t width = 8;
+                    static type load(const float *p) { return _mm256_loadu_ps(p); }
+                    static void store(float *p, type v) { _mm256_storeu_ps(p, v); }
+                    static type set(float v) { return _mm256_set1_ps(v); }
+                    static type add(type a, type b) { return _mm256_add_ps(a, b); }
+                    static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+                    static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+                    static type div(type a, type b) { return _mm256_div_ps(a, b); }
+                    static type min(type a, type b) { return _mm256_min_ps(a, b); }
+                    static type max(type a, type b) { return _mm256_max_ps(a, b); }
+                    static type sqrt(type a) { return _mm256_sqrt_ps(a); }
+                    static type madd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+                    // returns (c > 0) ? a : b
+                    static type select_positive(type c, type a, type b) {
+                        return _mm256_blendv_ps(b, a, _mm256_cmp_ps(c, _mm256_setzero_ps(), _CMP_GT_OQ));
+                    }
+                };
+#include "vec3_soa_kernels.inl"
+            }
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+            // returns true if both the CPU and the operating system support AVX2 and FMA.
+            bool cpu_supports_avx2() {
+#if defined(__AVX2__) && defined(__FMA__)
+                return true;    // the whole program already requires AVX2
+#elif defined(_MSC_VER) && !defined(__clang__)
+                int info[4];
+                __cpuid(info, 0);
+                if (info[0] < 7)
+                    return false;
+                __cpuid(info, 1);
+                const bool fma = (info[2] & (1 << 12)) != 0;
+                const bool osxsave = (info[2] & (1 << 27)) != 0;
+                const bool avx = (info[2] & (1 << 28)) != 0;
+                if (!fma || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)  // the OS saves the YMM registers
+                    return false;
+                __cpuidex(info, 7, 0);
+                return (info[1] & (1 << 5)) != 0;
+#else
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+            }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+            namespace neon {
+                struct Batch {
+                    typedef float32x4_t type;
+                    static const std::size_t width = 4;
+                    static type load(const float *p) { return vld1q_f32(p); }
+                    static void store(float *p, type v) { vst1q_f32(p, v); }
+                    static type set(float v) { return vdupq_n_f32(v); }
+                    static type add(type a, type b) { return vaddq_f32(a, b); }
+                    static type sub(type a, type b) { return vsubq_f32(a, b); }
+                    static type mul(type a, type b) { return vmulq_f32(a, b); }
+                    static type div(type a, type b) { return vdivq_f32(a, b); }
+                    static type min(type a, type b) { return vminq_f32(a, b); }
+                    static type max(type a, type b) { return vmaxq_f32(a, b); }
+                    static type sqrt(type a) { return vsqrtq_f32(a); }
+                    static type madd(type a, type b, type c) { return vfmaq_f32(c, a, b); }
+                    // returns (c > 0) ? a : b
+                    static type select_positive(type c, type a, type b) {
+                        return vbslq_f32(vcgtq_f32(c, vdupq_n_f32(0.0f)), a, b);
+                    }
+                };
+#include "vec3_soa_kernels.inl"
+            }
+#else
+            namespace scalar {
+                struct Batch {
+                    typedef float type;
+                    static const std::size_t width = 1;
+                    static type load(const float *p) { return *p; }
+                    static void store(float *p, type v) { *p = v; }
+                    static type set(float v) { return v; }
+                    static type add(type a, type b) { return a + b; }
+                    static type sub(type a, type b) { return a - b; }
+                    static type mul(type a, type b) { return a * b; }
+                    static type div(type a, type b) { return a / b; }
+                    static type min(type a, type b) { return std::min(a, b); }
+                    static type max(type a, type b) { return std::max(a, b); }
+                    static type sqrt(type a) { return std::sqrt(a); }
+                    static type madd(type a, type b, type c) { return a * b + c; }
+                    static type select_positive(type c, type a, type b) { return c > 0.0f ? a : b; }
+                };
+#include "vec3_soa_kernels.inl"
+            }
+#endif
+
+            // the kernels of the instruction set chosen at run time
+            struct Kernels {
+                const char *name;
+                Box3 (*bounding_box)(const float *, const float *, const float *, std::size_t, std::size_t);
+                void (*translate)(float *, float *, float *, std::size_t, std::size_t, const float[3]);
+                void (*affine_transform)(float *, float *, float *, std::size_t, std::size_t, const float[9],
+                                         const float[3]);
+                void (*normalize)(float *, float *, float *, std::size_t, std::size_t);
+                dvec3 (*sum)(const float *, const float *, const float *, std::size_t, std::size_t);
+                Covariance (*covariance)(const float *, const float *, const float *, std::size_t, std::size_t,
+                                         const float[3]);
+            };
+
+#define EASY3D_SIMD_KERNELS(name, ns) \
+            { name, ns::bounding_box, ns::translate, ns::affine_transform, ns::normalize, ns::sum, ns::covariance }
+
+            Kernels select_kernels() {
+#if defined(EASY3D_SIMD_X86)
+                if (cpu_supports_avx2()) {
+                    const Kernels kernels = EASY3D_SIMD_KERNELS("AVX2", avx2);
+                    return kernels;
+                }
+                const Kernels kernels = EASY3D_SIMD_KERNELS("SSE2", sse2);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+                const Kernels kernels = EASY3D_SIMD_KERNELS("NEON", neon);
+#else
+                const Kernels kernels = EASY3D_SIMD_KERNELS("none", scalar);
+#endif
+                return kernels;
+            }
+
+#undef EASY3D_SIMD_KERNELS
+
+            const Kernels &kernels() {
+                static const Kernels kernels = select_kernels();
+                return kernels;
+            }
+        }
+        /// \endcond
+
+        using namespace internal;
+
+
+        const char *instruction_set() {
+            return kernels().name;
+        }
+
+
+        Box3 bounding_box(const Vec3SoA &points) {
+            const float *x = points.x(), *y = points.y(), *z = points.z();
+            const Kernels &k = kernels();
+            return parallel::reduce(0, points.size(), Box3(), [&](std::size_t begin, std::size_t end) -> Box3 {
+                return k.bounding_box(x, y, z, begin, end);
+            }, [](const Box3 &a, const Box3 &b) { return a + b; });
+        }
+
+
+        void translate(Vec3SoA &points, const vec3 &t) {
+            float *x = points.x(), *y = points.y(), *z = points.z();
+            const float offset[3] = {t.x, t.y, t.z};
+            const Kernels &k = kernels();
+            parallel::for_each_range(0, points.size(), [&](std::size_t begin, std::size_t end) {
+                k.translate(x, y, z, begin, end, offset);
+            });
+        }
+
+
+        /// \cond
+        namespace internal {
+            // p' = m * p + t, where m is a 3 by 3 matrix (row major) and t is the translation.
+            void affine_transform(Vec3SoA &points, const float m[9], const float t[3]) {
+                float *x = points.x(), *y = points.y(), *z = points.z();
+                const Kernels &k = kernels();
+                parallel::for_each_range(0, points.size(), [&](std::size_t begin, std::size_t end) {
+                    k.affine_transform(x, y, z, begin, end, m, t);
+                });
+            }
+        }
+        /// \endcond
+
+
+        void transform(Vec3SoA &points, const mat4 &m) {
+            const float linear[9] = {m(0, 0), m(0, 1), m(0, 2),
+                                     m(1, 0), m(1, 1), m(1, 2),
+                                     m(2, 0), m(2, 1), m(2, 2)};
+            const float translation[3] = {m(0, 3), m(1, 3), m(2, 3)};
+            affine_transform(points, linear, translation);
+        }
+
+
+        void transform(Vec3SoA &vectors, const mat3 &m) {
+            const float linear[9] = {m(0, 0), m(0, 1), m(0, 2),
+                                     m(1, 0), m(1, 1), m(1, 2),
+                                     m(2, 0), m(2, 1), m(2, 2)};
+            const float translation[3] = {0.0f, 0.0f, 0.0f};
+            affine_transform(vectors, linear, translation);
+        }
+
+
+        void normalize(Vec3SoA &vectors) {
+            float *x = vectors.x(), *y = vectors.y(), *z = vectors.z();
+            const Kernels &k = kernels();
+            parallel::for_each_range(0, vectors.size(), [&](std::size_t begin, std::size_t end) {
+                k.normalize(x, y, z, begin, end);
+            });
+        }
+
+
+        dvec3 centroid(const Vec3SoA &points) {
+            const std::size_t n = points.size();
+            if (n == 0)
+                return dvec3(0, 0, 0);
+
+            const float *x = points.x(), *y = points.y(), *z = points.z();
+            const Kernels &k = kernels();
+            const dvec3 total = parallel::reduce(0, n, dvec3(0, 0, 0), [&](std::size_t begin, std::size_t end) {
+                return k.sum(x, y, z, begin, end);
+            }, [](const dvec3 &a, const dvec3 &b) { return a + b; });
+
+            return total / static_cast<double>(n);
+        }
+
+
+        dmat3 covariance(const Vec3SoA &points, const dvec3 &center) {
+            const std::size_t n = points.size();
+            if (n == 0)
+                return dmat3(0.0);
+
+            const float *x = points.x(), *y = points.y(), *z = points.z();
+            const float c[3] = {static_cast<float>(center.x), static_cast<float>(center.y),
+                                static_cast<float>(center.z)};
+            const Kernels &k = kernels();
+            const Covariance total = parallel::reduce(0, n, Covariance(), [&](std::size_t begin, std::size_t end) {
+                return k.covariance(x, y, z, begin, end, c);
+            }, [](const Covariance &a, const Covariance &b) { return a + b; });
+
+            dmat3 cov;
+            cov(0, 0) = total.xx;
+            cov(0, 1) = cov(1, 0) = total.xy;
+            cov(0, 2) = cov(2, 0) = total.xz;
+            cov(1, 1) = total.yy;
+            cov(1, 2) = cov(2, 1) = total.yz;
+            cov(2, 2) = total.zz;
+            cov /= static_cast<double>(n);
+            return cov;
+        }
+
+    } // namespace simd
+
+} // namespace easy3d
@@ -0,0 +1,124 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_CORE_VEC3_SOA_H
+#define EASY3D_CORE_VEC3_SOA_H
+
+#include <vector>
+
+#include <easy3d/core/types.h>
+
+
+namespace easy3d {
+
+    /**
+     * \brief A structure-of-arrays (SoA) storage of 3D vectors.
+     * \details The properties of the models (e.g., "v:point" and "v:normal") store their 3D vectors interleaved
+     *      (i.e., x0 y0 z0 x1 y1 z1 ...), which is required by the renderer. Vec3SoA stores the x, y, and z
+     *      coordinates in three separate arrays (i.e., x0 x1 ..., y0 y1 ..., z0 z1 ...) such that bulk operations
+     *      can process several vectors with a single SIMD instruction. See the kernels in the namespace
+     *      easy3d::simd. Usage example:
+     *      \code
+     *          Vec3SoA points(cloud->points());        // copies the points into the SoA layout
+     *          simd::transform(points, mat);
+     *          const Box3& box = simd::bounding_box(points);
+     *          points.copy_to(cloud->points());        // copies the points back
+     *      \endcode
+     * \class Vec3SoA easy3d/core/vec3_soa.h
+     */
+    class Vec3SoA {
+    public:
+        /// default constructor.
+        Vec3SoA() = default;
+        /// constructs from an array of 3D vectors (in the interleaved layout).
+        explicit Vec3SoA(const std::vector<vec3> &vectors) { assign(vectors); }
+
+        /// copies an array of 3D vectors (in the interleaved layout).
+        void assign(const std::vector<vec3> &vectors);
+        /// copies the 3D vectors to \p vectors (in the interleaved layout). \p vectors will be resized if needed.
+        void copy_to(std::vector<vec3> &vectors) const;
+
+        /// the number of vectors.
+        std::size_t size() const { return x_.size(); }
+        /// changes the number of vectors.
+        void resize(std::size_t n) { x_.resize(n); y_.resize(n); z_.resize(n); }
+
+        /// returns the \p i-th vector.
+        vec3 operator[](std::size_t i) const { return vec3(x_[i], y_[i], z_[i]); }
+        /// sets the \p i-th vector.
+        void set(std::size_t i, const vec3 &v) { x_[i] = v.x; y_[i] = v.y; z_[i] = v.z; }
+
+        /// the array of the x coordinates.
+        float *x() { return x_.data(); }
+        const float *x() const { return x_.data(); }
+        /// the array of the y coordinates.
+        float *y() { return y_.data(); }
+        const float *y() const { return y_.data(); }
+        /// the array of the z coordinates.
+        float *z() { return z_.data(); }
+        const float *z() const { return z_.data(); }
+
+    private:
+        std::vector<float> x_;
+        std::vector<float> y_;
+        std::vector<float> z_;
+    };
+
+
+    /**
+     * \brief SIMD kernels for bulk operations on 3D vectors stored in the structure-of-arrays layout.
+     * \details The instruction set is chosen at run time on x86-64: AVX2 (with FMA) if the CPU supports it, and
+     *      SSE2 otherwise. NEON is used on ARM, and plain scalar code on other platforms. Large arrays are
+     *      additionally split into chunks processed in parallel. The reductions (i.e., centroid and covariance)
+     *      accumulate in double precision, and their results don't depend on the number of threads.
+     * \namespace easy3d::simd
+     */
+    namespace simd {
+
+        /// returns the name of the instruction set used by the kernels, i.e., "AVX2", "SSE2", "NEON", or "none".
+        const char *instruction_set();
+
+        /// computes the bounding box of the points.
+        Box3 bounding_box(const Vec3SoA &points);
+        /// translates the points by \p t.
+        void translate(Vec3SoA &points, const vec3 &t);
+        /// transforms the points by the affine transformation \p m (the last row of \p m is ignored).
+        void transform(Vec3SoA &points, const mat4 &m);
+        /// transforms the vectors by the linear transformation \p m, e.g., transforming normals by the normal matrix.
+        void transform(Vec3SoA &vectors, const mat3 &m);
+        /// normalizes the vectors. Zero-length vectors are kept unchanged.
+        void normalize(Vec3SoA &vectors);
+        /// computes the centroid of the points.
+        dvec3 centroid(const Vec3SoA &points);
+        /// computes the covariance matrix of the points w.r.t. \p center, i.e., sum((p - c) * (p - c)^T) / n.
+        dmat3 covariance(const Vec3SoA &points, const dvec3 &center);
+
+    } // namespace simd
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_CORE_VEC3_SOA_H
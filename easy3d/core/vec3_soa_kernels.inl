@@ -0,0 +1,201 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+// The SIMD kernels of vec3_soa.cpp on a range [begin, end) of the arrays. This file is included by vec3_soa.cpp
+// once per instruction set, inside a namespace defining 'Batch' (see vec3_soa.cpp). Each kernel processes
+// 'Batch::width' vectors at a time, and the remaining ones are processed by the scalar code.
+
+typedef Batch::type batch;
+const std::size_t W = Batch::width;
+
+// sums the lanes of a batch in double precision
+inline double sum(batch v) {
+    float lanes[W];
+    Batch::store(lanes, v);
+    double result = 0.0;
+    for (std::size_t i = 0; i < W; ++i)
+        result += lanes[i];
+    return result;
+}
+
+
+Box3 bounding_box(const float *x, const float *y, const float *z, std::size_t begin, std::size_t end) {
+    Box3 box;
+    if (begin == end)
+        return box;
+
+    std::size_t i = begin;
+    if (end - begin >= W) {
+        batch min_x = Batch::load(x + i), min_y = Batch::load(y + i), min_z = Batch::load(z + i);
+        batch max_x = min_x, max_y = min_y, max_z = min_z;
+        for (i += W; i + W <= end; i += W) {
+            const batch vx = Batch::load(x + i), vy = Batch::load(y + i), vz = Batch::load(z + i);
+            min_x = Batch::min(min_x, vx);
+            min_y = Batch::min(min_y, vy);
+            min_z = Batch::min(min_z, vz);
+            max_x = Batch::max(max_x, vx);
+            max_y = Batch::max(max_y, vy);
+            max_z = Batch::max(max_z, vz);
+        }
+        float lx[W], ly[W], lz[W], ux[W], uy[W], uz[W];
+        Batch::store(lx, min_x);
+        Batch::store(ly, min_y);
+        Batch::store(lz, min_z);
+        Batch::store(ux, max_x);
+        Batch::store(uy, max_y);
+        Batch::store(uz, max_z);
+        for (std::size_t j = 0; j < W; ++j) {
+            box.grow(vec3(lx[j], ly[j], lz[j]));
+            box.grow(vec3(ux[j], uy[j], uz[j]));
+        }
+    }
+    for (; i < end; ++i)
+        box.grow(vec3(x[i], y[i], z[i]));
+    return box;
+}
+
+
+// p' = m * p + t, where m is a 3 by 3 matrix (row major) and t is the translation.
+void affine_transform(float *x, float *y, float *z, std::size_t begin, std::size_t end, const float m[9],
+                      const float t[3]) {
+    batch bm[9], bt[3];
+    for (int k = 0; k < 9; ++k)
+        bm[k] = Batch::set(m[k]);
+    for (int k = 0; k < 3; ++k)
+        bt[k] = Batch::set(t[k]);
+
+    std::size_t i = begin;
+    for (; i + W <= end; i += W) {
+        const batch vx = Batch::load(x + i), vy = Batch::load(y + i), vz = Batch::load(z + i);
+        Batch::store(x + i, Batch::madd(bm[0], vx, Batch::madd(bm[1], vy, Batch::madd(bm[2], vz, bt[0]))));
+        Batch::store(y + i, Batch::madd(bm[3], vx, Batch::madd(bm[4], vy, Batch::madd(bm[5], vz, bt[1]))));
+        Batch::store(z + i, Batch::madd(bm[6], vx, Batch::madd(bm[7], vy, Batch::madd(bm[8], vz, bt[2]))));
+    }
+    for (; i < end; ++i) {
+        const float vx = x[i], vy = y[i], vz = z[i];
+        x[i] = m[0] * vx + m[1] * vy + m[2] * vz + t[0];
+        y[i] = m[3] * vx + m[4] * vy + m[5] * vz + t[1];
+        z[i] = m[6] * vx + m[7] * vy + m[8] * vz + t[2];
+    }
+}
+
+
+void translate(float *x, float *y, float *z, std::size_t begin, std::size_t end, const float t[3]) {
+    const batch tx = Batch::set(t[0]), ty = Batch::set(t[1]), tz = Batch::set(t[2]);
+    std::size_t i = begin;
+    for (; i + W <= end; i += W) {
+        Batch::store(x + i, Batch::add(Batch::load(x + i), tx));
+        Batch::store(y + i, Batch::add(Batch::load(y + i), ty));
+        Batch::store(z + i, Batch::add(Batch::load(z + i), tz));
+    }
+    for (; i < end; ++i) {
+        x[i] += t[0];
+        y[i] += t[1];
+        z[i] += t[2];
+    }
+}
+
+
+void normalize(float *x, float *y, float *z, std::size_t begin, std::size_t end) {
+    const batch one = Batch::set(1.0f);
+    std::size_t i = begin;
+    for (; i + W <= end; i += W) {
+        const batch vx = Batch::load(x + i), vy = Batch::load(y + i), vz = Batch::load(z + i);
+        const batch len2 = Batch::madd(vx, vx, Batch::madd(vy, vy, Batch::mul(vz, vz)));
+        // zero-length vectors are multiplied by 1
+        const batch s = Batch::select_positive(len2, Batch::div(one, Batch::sqrt(len2)), one);
+        Batch::store(x + i, Batch::mul(vx, s));
+        Batch::store(y + i, Batch::mul(vy, s));
+        Batch::store(z + i, Batch::mul(vz, s));
+    }
+    for (; i < end; ++i) {
+        const float len2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+        if (len2 > 0.0f) {
+            const float s = 1.0f / std::sqrt(len2);
+            x[i] *= s;
+            y[i] *= s;
+            z[i] *= s;
+        }
+    }
+}
+
+
+dvec3 sum(const float *x, const float *y, const float *z, std::size_t begin, std::size_t end) {
+    dvec3 result(0, 0, 0);
+    for (std::size_t block = begin; block < end; block += block_size) {
+        const std::size_t block_end = std::min(block + block_size, end);
+        batch sx = Batch::set(0.0f), sy = Batch::set(0.0f), sz = Batch::set(0.0f);
+        std::size_t i = block;
+        for (; i + W <= block_end; i += W) {
+            sx = Batch::add(sx, Batch::load(x + i));
+            sy = Batch::add(sy, Batch::load(y + i));
+            sz = Batch::add(sz, Batch::load(z + i));
+        }
+        result += dvec3(sum(sx), sum(sy), sum(sz));
+        for (; i < block_end; ++i)
+            result += dvec3(x[i], y[i], z[i]);
+    }
+    return result;
+}
+
+
+Covariance covariance(const float *x, const float *y, const float *z, std::size_t begin, std::size_t end,
+                      const float c[3]) {
+    Covariance result;
+    const batch cx = Batch::set(c[0]), cy = Batch::set(c[1]), cz = Batch::set(c[2]);
+    for (std::size_t block = begin; block < end; block += block_size) {
+        const std::size_t block_end = std::min(block + block_size, end);
+        batch xx = Batch::set(0.0f), xy = xx, xz = xx, yy = xx, yz = xx, zz = xx;
+        std::size_t i = block;
+        for (; i + W <= block_end; i += W) {
+            const batch dx = Batch::sub(Batch::load(x + i), cx);
+            const batch dy = Batch::sub(Batch::load(y + i), cy);
+            const batch dz = Batch::sub(Batch::load(z + i), cz);
+            xx = Batch::madd(dx, dx, xx);
+            xy = Batch::madd(dx, dy, xy);
+            xz = Batch::madd(dx, dz, xz);
+            yy = Batch::madd(dy, dy, yy);
+            yz = Batch::madd(dy, dz, yz);
+            zz = Batch::madd(dz, dz, zz);
+        }
+        result.xx += sum(xx);
+        result.xy += sum(xy);
+        result.xz += sum(xz);
+        result.yy += sum(yy);
+        result.yz += sum(yz);
+        result.zz += sum(zz);
+        for (; i < block_end; ++i) {
+            const double dx = x[i] - c[0], dy = y[i] - c[1], dz = z[i] - c[2];
+            result.xx += dx * dx;
+            result.xy += dx * dy;
+            result.xz += dx * dz;
+            result.yy += dy * dy;
+            result.yz += dy * dz;
+            result.zz += dz * dz;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,208 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/fileio/async_loader.h>
+
+#include <algorithm>
+
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/core/graph.h>
+#include <easy3d/core/poly_mesh.h>
+#include <easy3d/fileio/surface_mesh_io.h>
+#include <easy3d/fileio/point_cloud_io.h>
+#include <easy3d/fileio/point_cloud_io_ptx.h>
+#include <easy3d/fileio/graph_io.h>
+#include <easy3d/fileio/poly_mesh_io.h>
+#include <easy3d/fileio/ply_reader_writer.h>
+#include <easy3d/fileio/translator.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/progress.h>
+#include <easy3d/util/logging.h>
+
+
+namespace easy3d {
+
+
+    AsyncLoader::Task::Task(const std::string &file_name)
+            : file_name_(file_name)
+            , status_(PENDING)
+            , progress_(0)
+            , canceled_(false)
+    {
+    }
+
+
+    AsyncLoader::Task::~Task() {
+        for (auto model : models_)
+            delete model;
+    }
+
+
+    void AsyncLoader::Task::wait() const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return is_done(); });
+    }
+
+
+    std::vector<Model *> AsyncLoader::Task::take() {
+        wait();
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<Model *> models;
+        models.swap(models_);
+        return models;
+    }
+
+
+    void AsyncLoader::Task::finish(Status status, std::vector<Model *> &models) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            models_.swap(models);
+            if (status == SUCCEEDED)
+                progress_ = 100;
+            status_ = status;
+        }
+        done_.notify_all();
+    }
+
+    //_________________________________________________________
+
+
+    namespace internal {
+        // serializes the loading of the files of all loaders while the (global) Translator is enabled
+        static std::mutex translator_mutex;
+    }
+
+
+    AsyncLoader::AsyncLoader(unsigned int num_threads)
+            : pool_(std::max(1u, num_threads) + 1)  // the pool counts the calling thread, which doesn't run async tasks
+    {
+    }
+
+
+    AsyncLoader::~AsyncLoader() {
+        cancel_all();
+        // the destructor of the pool waits for the running tasks
+    }
+
+
+    AsyncLoader::Handle AsyncLoader::load(const std::string &file_name, const Callback &callback) {
+        Handle task = std::make_shared<Task>(file_system::convert_to_native_style(file_name));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // forget the tasks that have been released by their owners
+            tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(), [](const std::weak_ptr<Task> &t) {
+                return t.expired();
+            }), tasks_.end());
+            tasks_.push_back(task);
+        }
+
+        pool_.async([task, callback]() {
+            std::vector<Model *> models;
+            if (!task->is_canceled()) {
+                task->status_ = Task::LOADING;
+                try {
+                    // The readers read and update the translation of the Translator (e.g., the translation of the
+                    // first point of a file is applied to the files loaded later on), so the files are loaded one
+                    // after another while it is enabled.
+                    std::unique_lock<std::mutex> lock(internal::translator_mutex, std::defer_lock);
+                    if (Translator::instance()->status() != Translator::DISABLED)
+                        lock.lock();
+
+                    // the readers report their progress to the task and check its cancellation flag
+                    ThreadProgress progress([task](std::size_t percent) { task->progress_ = percent; }, task->canceled_);
+                    models = load_models(task->file_name());
+                }
+                catch (const std::exception &e) {
+                    LOG(ERROR) << "failed loading file '" << task->file_name() << "': " << e.what();
+                }
+            }
+
+            Task::Status status = Task::SUCCEEDED;
+            if (task->is_canceled()) {
+                for (auto model : models)
+                    delete model;
+                models.clear();
+                status = Task::CANCELED;
+                LOG(INFO) << "loading canceled: " << task->file_name();
+            }
+            else if (models.empty())
+                status = Task::FAILED;
+            task->finish(status, models);
+
+            if (callback)
+                callback(task);
+        });
+
+        return task;
+    }
+
+
+    void AsyncLoader::cancel_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &t : tasks_) {
+            Handle task = t.lock();
+            if (task)
+                task->cancel();
+        }
+    }
+
+
+    std::vector<Model *> AsyncLoader::load_models(const std::string &file_name) {
+        std::vector<Model *> models;
+
+        const std::string &ext = file_system::extension(file_name, true);
+        bool is_ply_mesh = false;
+        if (ext == "ply")
+            is_ply_mesh = (io::PlyReader::num_instances(file_name, "face") > 0);
+
+        Model *model = nullptr;
+        if ((ext == "ply" && is_ply_mesh) || ext == "obj" || ext == "off" || ext == "stl" || ext == "sm" || ext == "geojson" || ext == "trilist") { // mesh
+            model = SurfaceMeshIO::load(file_name);
+        } else if (ext == "ply" && io::PlyReader::num_instances(file_name, "edge") > 0) {
+            model = GraphIO::load(file_name);
+        } else if (ext == "plm" || ext == "pm" || ext == "mesh") {
+            model = PolyMeshIO::load(file_name);
+        }
+        else { // point cloud
+            if (ext == "ptx") {
+                io::PointCloudIO_ptx serializer(file_name);
+                PointCloud *cloud = nullptr;
+                while ((cloud = serializer.load_next()))
+                    models.push_back(cloud);
+                return models;
+            } else
+                model = PointCloudIO::load(file_name);
+        }
+
+        if (model) {
+            model->set_name(file_name);
+            models.push_back(model);
+        }
+        return models;
+    }
+
+}
@@ -0,0 +1,152 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_FILEIO_ASYNC_LOADER_H
+#define EASY3D_FILEIO_ASYNC_LOADER_H
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include <easy3d/util/parallel.h>
+
+
+namespace easy3d {
+
+    class Model;
+
+    /**
+     * \brief Loads models in the background.
+     * \details The files are parsed by a pool of worker threads, so the calling thread (e.g., the GUI thread) is not
+     *      blocked. Each load request returns a handle for monitoring its progress (reported by the ProgressLoggers of
+     *      the file readers, see ThreadProgress), canceling it (cooperatively, i.e., the readers stop at the next
+     *      check of ProgressLogger::is_canceled()), and collecting the loaded models. While the Translator is enabled,
+     *      the files are loaded one after another (the readers share its translation), and the Translator must not
+     *      be modified or used by the other threads until the tasks have completed.
+     *      Usage example:
+     *      \code
+     *          AsyncLoader loader;
+     *          AsyncLoader::Handle task = loader.load("bunny.ply");
+     *          ... // do something else
+     *          std::vector<Model*> models = task->take();  // waits for the task to complete
+     *      \endcode
+     * \class AsyncLoader easy3d/fileio/async_loader.h
+     */
+    class AsyncLoader {
+    public:
+        /// \brief A load request.
+        class Task {
+        public:
+            enum Status { PENDING, LOADING, SUCCEEDED, FAILED, CANCELED };
+
+            explicit Task(const std::string &file_name);
+            /// Deletes the loaded models that have not been taken.
+            ~Task();
+
+            const std::string &file_name() const { return file_name_; }
+
+            Status status() const { return static_cast<Status>(status_.load()); }
+            /// Returns true if the task has completed (successfully or not).
+            bool is_done() const { return status() > LOADING; }
+            /// Returns the progress (in percent) of the task.
+            std::size_t progress() const { return progress_; }
+
+            /// Requests the cancellation of the task. A pending task will not be executed, and the result of a running
+            /// task will be discarded.
+            void cancel() { canceled_ = true; }
+            bool is_canceled() const { return canceled_; }
+
+            /// Blocks until the task has completed.
+            void wait() const;
+
+            /// \brief Waits for the task to complete and returns the loaded models.
+            /// \details The caller takes the ownership of the models. The models are returned only once, i.e., an
+            ///     empty vector is returned by the subsequent calls (and if the task failed or was canceled).
+            std::vector<Model *> take();
+
+        private:
+            void finish(Status status, std::vector<Model *> &models);
+
+            std::string file_name_;
+            std::atomic<int> status_;
+            std::atomic<std::size_t> progress_;
+            std::atomic<bool> canceled_;
+            std::vector<Model *> models_;
+
+            mutable std::mutex mutex_;
+            mutable std::condition_variable done_;
+
+            friend class AsyncLoader;
+        };
+
+        typedef std::shared_ptr<Task> Handle;
+        /// The function called (by the worker thread) when a task has completed.
+        typedef std::function<void(const Handle &)> Callback;
+
+    public:
+        /// \param num_threads The number of worker threads, i.e., the number of files that can be loaded concurrently.
+        explicit AsyncLoader(unsigned int num_threads = 2);
+        /// Cancels all the pending tasks and waits for the running ones.
+        ~AsyncLoader();
+
+        /**
+         * \brief Schedules the loading of the file \p file_name.
+         * \param callback The function to be called when the task has completed. It is called by the worker thread.
+         * \return The handle of the task.
+         */
+        Handle load(const std::string &file_name, const Callback &callback = nullptr);
+
+        /// Cancels all the tasks that have not completed.
+        void cancel_all();
+
+        /**
+         * \brief Loads the models stored in the file \p file_name (synchronously).
+         * \details File extension determines the type of the models, i.e., SurfaceMesh, PointCloud, Graph, or PolyMesh.
+         *      A file usually stores a single model, except a PTX file (which may store multiple point clouds).
+         * \return The loaded models (empty if failed). The caller takes the ownership of the models.
+         */
+        static std::vector<Model *> load_models(const std::string &file_name);
+
+    private:
+        ThreadPool pool_;
+
+        std::mutex mutex_;
+        std::vector<std::weak_ptr<Task> > tasks_;
+
+        // non-copyable
+        AsyncLoader(const AsyncLoader &) = delete;
+        AsyncLoader &operator=(const AsyncLoader &) = delete;
+    };
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_FILEIO_ASYNC_LOADER_H
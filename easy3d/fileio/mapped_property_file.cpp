@@ -0,0 +1,396 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/fileio/mapped_property_file.h>
+
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+
+#include <easy3d/util/parallel.h>
+#include <easy3d/util/logging.h>
+
+#include <3rd_party/stb/stb_image.h>
+
+// stb_image_write only declares its deflate compressor in its implementation, so a private copy of the
+// implementation is compiled here (the public one is compiled in image_io.cpp)
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+#endif
+#define STB_IMAGE_WRITE_STATIC
+#define STBI_WRITE_NO_STDIO
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <3rd_party/stb/stb_image_write.h>
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+
+namespace easy3d {
+
+    namespace io {
+
+        /// \cond
+        namespace internal {
+
+            struct MappedHeader {
+                char magic[8];
+                uint32_t version;
+                uint32_t num_properties;
+                uint64_t num_elements[5];   // vertices, halfedges, edges, faces, and model
+                uint64_t directory_offset;
+            };
+            static_assert(sizeof(MappedHeader) == 64, "unexpected size of the header");
+
+            struct MappedEntry {
+                char name[80];
+                uint32_t element;
+                uint32_t type;
+                uint32_t element_size;
+                uint32_t compression;
+                uint64_t offset;
+                uint64_t size;
+                uint32_t checksum;
+                uint32_t reserved0;
+                uint64_t reserved1;
+            };
+            static_assert(sizeof(MappedEntry) == 128, "unexpected size of a directory entry");
+
+            // CRC-32 (as in zlib)
+            uint32_t crc32(const char *data, std::size_t size) {
+                static const std::vector<uint32_t> table = [] {
+                    std::vector<uint32_t> t(256);
+                    for (uint32_t i = 0; i < 256; ++i) {
+                        uint32_t c = i;
+                        for (int k = 0; k < 8; ++k)
+                            c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+                        t[i] = c;
+                    }
+                    return t;
+                }();
+                uint32_t crc = 0xFFFFFFFFu;
+                const auto bytes = reinterpret_cast<const unsigned char *>(data);
+                for (std::size_t i = 0; i < size; ++i)
+                    crc = table[(crc ^ bytes[i]) & 0xFFu] ^ (crc >> 8);
+                return crc ^ 0xFFFFFFFFu;
+            }
+
+            inline std::size_t aligned(std::size_t offset, std::size_t alignment) {
+                return (offset + alignment - 1) / alignment * alignment;
+            }
+
+            // a block to be written: the uncompressed data or the compressed copy
+            struct CompressedBlock {
+                const char *data;
+                std::size_t size;
+                std::vector<char> buffer;
+                MappedPropertyFile::Compression compression;
+                uint32_t checksum;
+
+                const char *bytes() const { return data ? data : buffer.data(); }
+            };
+        }
+        /// \endcond
+
+
+        MappedPropertyFile::MappedPropertyFile() : version_(0) {
+            std::fill(num_elements_, num_elements_ + 5, 0);
+        }
+
+
+        const char *MappedPropertyFile::element_name(ElementType element) {
+            static const char *names[] = {"vertex", "halfedge", "edge", "face", "model"};
+            return names[element];
+        }
+
+
+        bool MappedPropertyFile::open(const std::string &file_name, const char *magic, uint32_t version,
+                                      const std::string &format) {
+            close();
+            if (!file_.open(file_name))
+                return false;
+
+            internal::MappedHeader header;
+            if (file_.size() < sizeof(header)) {
+                LOG(ERROR) << "not " << format << " file (file too small): " << file_name;
+                close();
+                return false;
+            }
+            std::memcpy(&header, file_.data(), sizeof(header));
+            if (std::memcmp(header.magic, magic, sizeof(header.magic)) != 0) {
+                LOG(ERROR) << "not " << format << " file (or a file of an old version): " << file_name;
+                close();
+                return false;
+            }
+            if (header.version > version) {
+                LOG(ERROR) << "unsupported " << format << " version (" << header.version << "): " << file_name;
+                close();
+                return false;
+            }
+
+            const uint64_t directory_end = header.directory_offset +
+                                           uint64_t(header.num_properties) * sizeof(internal::MappedEntry);
+            if (header.directory_offset > file_.size() || directory_end > file_.size()) {
+                LOG(ERROR) << "corrupted " << format << " file (truncated property directory): " << file_name;
+                close();
+                return false;
+            }
+
+            version_ = header.version;
+            for (int i = 0; i < 5; ++i)
+                num_elements_[i] = header.num_elements[i];
+
+            for (uint32_t i = 0; i < header.num_properties; ++i) {
+                internal::MappedEntry entry;
+                std::memcpy(&entry, file_.data() + header.directory_offset + i * sizeof(entry), sizeof(entry));
+                entry.name[sizeof(entry.name) - 1] = '\0';
+
+                Property prop;
+                prop.name = entry.name;
+                prop.element = static_cast<ElementType>(std::min<uint32_t>(entry.element, MODEL));
+                prop.type = static_cast<ValueType>(entry.type);
+                prop.element_size = entry.element_size;
+                prop.compression = static_cast<Compression>(entry.compression);
+                prop.offset = entry.offset;
+                prop.size = entry.size;
+                prop.checksum = entry.checksum;
+                if (entry.element > MODEL || prop.type == UNKNOWN_TYPE || prop.type > FACE_CONNECTIVITY ||
+                    prop.element_size == 0 || prop.compression > DEFLATE) {
+                    LOG(WARNING) << "ignored property '" << prop.name << "' of unknown type";
+                    continue;
+                }
+                // the sizes are checked without overflowing
+                const uint64_t num = num_elements_[prop.element];
+                if (prop.offset > file_.size() || prop.size > file_.size() - prop.offset ||
+                    (prop.compression == UNCOMPRESSED &&
+                     (num > UINT64_MAX / prop.element_size || prop.size != num * prop.element_size))) {
+                    LOG(ERROR) << "corrupted " << format << " file (truncated data of " << element_name(prop.element)
+                               << " property '" << prop.name << "'): " << file_name;
+                    close();
+                    return false;
+                }
+                properties_.push_back(prop);
+            }
+
+            return true;
+        }
+
+
+        void MappedPropertyFile::close() {
+            file_.close();
+            version_ = 0;
+            std::fill(num_elements_, num_elements_ + 5, 0);
+            properties_.clear();
+        }
+
+
+        std::vector<std::string> MappedPropertyFile::properties(ElementType element) const {
+            std::vector<std::string> names;
+            for (const auto &prop : properties_) {
+                if (prop.element == element)
+                    names.push_back(prop.name);
+            }
+            return names;
+        }
+
+
+        MappedPropertyFile::ValueType MappedPropertyFile::property_type(ElementType element,
+                                                                        const std::string &name) const {
+            const Property *prop = find(element, name);
+            return prop ? prop->type : UNKNOWN_TYPE;
+        }
+
+
+        bool MappedPropertyFile::is_compressed(ElementType element, const std::string &name) const {
+            const Property *prop = find(element, name);
+            return prop && prop->compression != UNCOMPRESSED;
+        }
+
+
+        const MappedPropertyFile::Property *MappedPropertyFile::find(ElementType element,
+                                                                     const std::string &name) const {
+            for (const auto &prop : properties_) {
+                if (prop.element == element && prop.name == name)
+                    return &prop;
+            }
+            return nullptr;
+        }
+
+
+        bool MappedPropertyFile::verify() const {
+            std::atomic<bool> intact(true);
+            parallel::for_each(0, properties_.size(), [&](std::size_t i) {
+                const Property &prop = properties_[i];
+                if (internal::crc32(file_.data() + prop.offset, prop.size) != prop.checksum)
+                    intact = false;
+            }, 1);
+            return intact;
+        }
+
+
+        bool MappedPropertyFile::read(const std::vector<Destination> &destinations) const {
+            if (destinations.size() != properties_.size()) {
+                LOG(ERROR) << "the number of destinations doesn't match the number of properties";
+                return false;
+            }
+
+            std::atomic<bool> success(true);
+            parallel::for_each(0, properties_.size(), [&](std::size_t i) {
+                const Property &prop = properties_[i];
+                const Destination &target = destinations[i];
+                if (!target.data && !target.bool_values)
+                    return;
+
+                const char *data = file_.data() + prop.offset;
+                if (internal::crc32(data, prop.size) != prop.checksum) {
+                    LOG(ERROR) << "corrupted file (checksum mismatch of " << element_name(prop.element)
+                               << " property '" << prop.name << "'): " << file_.file_name();
+                    success = false;
+                    return;
+                }
+
+                std::vector<char> buffer;
+                if (prop.compression == DEFLATE) {
+                    char *output = target.data;
+                    if (target.bool_values) {
+                        buffer.resize(target.size);
+                        output = buffer.data();
+                    }
+                    const int size = stbi_zlib_decode_buffer(output, static_cast<int>(target.size), data,
+                                                             static_cast<int>(prop.size));
+                    if (size != static_cast<int>(target.size)) {
+                        LOG(ERROR) << "corrupted file (failed decompressing " << element_name(prop.element)
+                                   << " property '" << prop.name << "'): " << file_.file_name();
+                        success = false;
+                        return;
+                    }
+                    data = output;
+                } else {
+                    if (prop.size != target.size) {
+                        LOG(ERROR) << "the size of " << element_name(prop.element) << " property '" << prop.name
+                                   << "' doesn't match its destination";
+                        success = false;
+                        return;
+                    }
+                    if (target.data && target.size > 0)
+                        std::memcpy(target.data, data, target.size);
+                }
+
+                if (target.bool_values) {
+                    std::vector<bool> &values = *target.bool_values;
+                    for (std::size_t j = 0; j < values.size(); ++j)
+                        values[j] = (data[j] != 0);
+                }
+            }, 1);
+
+            return success;
+        }
+
+
+        bool MappedPropertyFile::save(const std::string &file_name, const char *magic, uint32_t version,
+                                      std::size_t alignment, const std::size_t num_elements[5],
+                                      const std::vector<Block> &blocks, bool compress) {
+            // compress the blocks and compute their checksums in parallel
+            std::vector<internal::CompressedBlock> outputs(blocks.size());
+            parallel::for_each(0, blocks.size(), [&](std::size_t i) {
+                internal::CompressedBlock &output = outputs[i];
+                output.data = blocks[i].data;
+                output.size = blocks[i].size;
+                output.compression = UNCOMPRESSED;
+                if (compress && output.size > 0 && output.size <= INT_MAX) {
+                    int size = 0;
+                    unsigned char *compressed = stbi_zlib_compress(
+                            reinterpret_cast<unsigned char *>(const_cast<char *>(output.data)),
+                            static_cast<int>(output.size), &size, 8);
+                    if (compressed && static_cast<std::size_t>(size) < output.size) {
+                        std::vector<char>(compressed, compressed + size).swap(output.buffer);
+                        output.data = nullptr;
+                        output.size = static_cast<std::size_t>(size);
+                        output.compression = DEFLATE;
+                    }
+                    std::free(compressed);
+                }
+                output.checksum = internal::crc32(output.bytes(), output.size);
+            }, 1);
+
+            std::ofstream output(file_name.c_str(), std::fstream::binary);
+            if (output.fail()) {
+                LOG(ERROR) << "could not open file: " << file_name;
+                return false;
+            }
+
+            internal::MappedHeader header;
+            std::memset(&header, 0, sizeof(header));
+            std::memcpy(header.magic, magic, sizeof(header.magic));
+            header.version = version;
+            header.num_properties = static_cast<uint32_t>(blocks.size());
+            for (int i = 0; i < 5; ++i)
+                header.num_elements[i] = num_elements[i];
+            header.directory_offset = sizeof(header);
+            output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+            // the property directory
+            std::size_t offset = internal::aligned(sizeof(header) + blocks.size() * sizeof(internal::MappedEntry),
+                                                   alignment);
+            for (std::size_t i = 0; i < blocks.size(); ++i) {
+                internal::MappedEntry entry;
+                std::memset(&entry, 0, sizeof(entry));
+                std::strncpy(entry.name, blocks[i].name.c_str(), sizeof(entry.name) - 1);
+                entry.element = blocks[i].element;
+                entry.type = blocks[i].type;
+                entry.element_size = static_cast<uint32_t>(blocks[i].element_size);
+                entry.compression = outputs[i].compression;
+                entry.offset = offset;
+                entry.size = outputs[i].size;
+                entry.checksum = outputs[i].checksum;
+                output.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+                offset = internal::aligned(offset + entry.size, alignment);
+            }
+
+            // the data blocks
+            const std::vector<char> padding(alignment, 0);
+            for (const auto &block : outputs) {
+                const auto position = static_cast<std::size_t>(output.tellp());
+                output.write(padding.data(),
+                             static_cast<std::streamsize>(internal::aligned(position, alignment) - position));
+                output.write(block.bytes(), static_cast<std::streamsize>(block.size));
+            }
+
+            if (output.fail()) {
+                LOG(ERROR) << "failed writing file: " << file_name;
+                return false;
+            }
+            return true;
+        }
+
+    } // namespace io
+
+} // namespace easy3d
@@ -0,0 +1,297 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_FILEIO_MAPPED_PROPERTY_FILE_H
+#define EASY3D_FILEIO_MAPPED_PROPERTY_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <easy3d/core/types.h>
+#include <easy3d/util/memory_mapped_file.h>
+
+
+namespace easy3d {
+
+    namespace io {
+
+        /**
+         * \brief Memory-mapped access to the properties of a model stored in a binary file.
+         * \class MappedPropertyFile easy3d/fileio/mapped_property_file.h
+         *
+         * \details This is the container shared by the mappable binary formats of the models, e.g., \c sm for
+         *      SurfaceMesh (see MappedSurfaceMesh) and \c pcb for PointCloud (see MappedPointCloud). The formats
+         *      only differ in their magic strings, the properties they store, and the alignment of the data blocks.
+         *      A file consists of
+         *      - a header (64 bytes): the magic string of the format, the format version, the number of properties,
+         *        the numbers of vertices, halfedges, edges, faces, and model elements, and the offset of the
+         *        property directory;
+         *      - a property directory: one entry (128 bytes) per property recording its element type, name, value
+         *        type, compression, and the offset, size, and checksum (CRC-32) of its data block;
+         *      - the data blocks of the properties, each aligned to the alignment chosen by the format.
+         *
+         *      The data blocks are optionally compressed (by deflate). All values are stored in little-endian byte
+         *      order, and boolean values are stored as one byte each. Opening a file only reads its header and
+         *      property directory. The uncompressed blocks can be accessed directly in the mapped file without
+         *      copying (see property()), and their pages are loaded by the operating system on first access.
+         *
+         *      The class doesn't know the models. The format of each model collects the properties of the model as
+         *      blocks to save(), and creates the properties of the model for read() to fill them.
+         */
+        class MappedPropertyFile {
+        public:
+            /// the types of the elements that properties are attached to.
+            enum ElementType {
+                VERTEX = 0, HALFEDGE = 1, EDGE = 2, FACE = 3, MODEL = 4
+            };
+
+            /// the value types of the properties that can be stored.
+            enum ValueType {
+                UNKNOWN_TYPE = 0, BOOL = 1, CHAR = 2, UCHAR = 3, INT = 4, UINT = 5, FLOAT = 6, DOUBLE = 7,
+                VEC2 = 8, VEC3 = 9, VEC4 = 10, DVEC2 = 11, DVEC3 = 12, DVEC4 = 13, IVEC2 = 14, IVEC3 = 15, IVEC4 = 16,
+                MAT3 = 17, MAT4 = 18, VERTEX_HANDLE = 19, HALFEDGE_HANDLE = 20, EDGE_HANDLE = 21, FACE_HANDLE = 22,
+                VERTEX_CONNECTIVITY = 23, HALFEDGE_CONNECTIVITY = 24, FACE_CONNECTIVITY = 25
+            };
+
+            /// the compression of the data blocks.
+            enum Compression {
+                UNCOMPRESSED = 0, DEFLATE = 1
+            };
+
+            /// a property stored in the file.
+            struct Property {
+                std::string name;
+                ElementType element;
+                ValueType type;
+                std::size_t element_size;
+                Compression compression;
+                std::size_t offset;     // offset of the data block in the file
+                std::size_t size;       // size of the data block in the file
+                uint32_t checksum;      // CRC-32 of the data block
+            };
+
+            /// the (uncompressed) data of a property to be saved.
+            struct Block {
+                ElementType element;
+                std::string name;
+                ValueType type;
+                std::size_t element_size;
+                const char *data;
+                std::size_t size;
+            };
+
+            /// where the data of a property is read to. If \c bool_values is not null, the values are converted to
+            /// \c bool and written to it (\c data is ignored). A destination without any data is skipped.
+            struct Destination {
+                char *data;
+                std::size_t size;
+                std::vector<bool> *bool_values;
+            };
+
+            /// the maximum length of the names of the properties.
+            static const std::size_t MAX_NAME_LENGTH = 79;
+
+        public:
+            MappedPropertyFile();
+
+            /**
+             * \brief Opens a file and reads its header and property directory.
+             * \param file_name The name of the file.
+             * \param magic The magic string (8 characters) of the format.
+             * \param version The current version of the format. Files of later versions are rejected.
+             * \param format The name of the format (for the messages).
+             * \return true on success.
+             */
+            bool open(const std::string &file_name, const char *magic, uint32_t version, const std::string &format);
+            /// closes the file.
+            void close();
+            /// returns whether a file is open.
+            bool is_open() const { return file_.is_open(); }
+            /// returns the name of the open file.
+            const std::string &file_name() const { return file_.file_name(); }
+            /// returns the format version of the open file.
+            uint32_t version() const { return version_; }
+
+            /// returns the number of elements of type \p element stored in the file.
+            std::size_t n_elements(ElementType element) const { return num_elements_[element]; }
+
+            /// returns the properties stored in the file (in the order of the property directory).
+            const std::vector<Property> &directory() const { return properties_; }
+            /// returns the names of the properties of the elements of type \p element stored in the file.
+            std::vector<std::string> properties(ElementType element) const;
+            /// returns the value type of the property \p name (UNKNOWN_TYPE if it doesn't exist).
+            ValueType property_type(ElementType element, const std::string &name) const;
+            /// returns whether the data block of the property \p name is compressed.
+            bool is_compressed(ElementType element, const std::string &name) const;
+
+            /**
+             * \brief Returns the data of the property \p name.
+             * \details No data is copied: the returned pointer points to the mapped file and its pages are loaded
+             *      on first access. The pointer is valid until the file is closed. The checksum is not verified (see
+             *      verify()).
+             * \return The pointer to the first value, or nullptr if the property doesn't exist, is of a different
+             *      type, or is compressed.
+             */
+            template<typename T>
+            const T *property(ElementType element, const std::string &name) const;
+
+            /// verifies the checksums of all the data blocks.
+            /// \return true if all the data blocks are intact.
+            bool verify() const;
+
+            /**
+             * \brief Reads the data blocks to their destinations (in parallel).
+             * \details The data blocks are checked (by their checksums) and decompressed.
+             * \param destinations The destinations of the properties, in the order of directory().
+             * \return true on success.
+             */
+            bool read(const std::vector<Destination> &destinations) const;
+
+            /**
+             * \brief Saves the properties of a model to a file.
+             * \param file_name The name of the file.
+             * \param magic The magic string (8 characters) of the format.
+             * \param version The version of the format.
+             * \param alignment The alignment of the data blocks (in bytes).
+             * \param num_elements The numbers of vertices, halfedges, edges, faces, and model elements.
+             * \param blocks The properties.
+             * \param compress If true, the data blocks are compressed (the blocks that can't be compressed are
+             *      stored uncompressed). Compressed blocks can't be accessed directly in the mapped file.
+             * \return true on success.
+             */
+            static bool save(const std::string &file_name, const char *magic, uint32_t version, std::size_t alignment,
+                             const std::size_t num_elements[5], const std::vector<Block> &blocks, bool compress);
+
+            /// returns the value type corresponding to \c T (UNKNOWN_TYPE if \c T can't be stored).
+            template<typename T>
+            static ValueType value_type();
+
+            /// returns the name of the element type \p element (e.g., "vertex").
+            static const char *element_name(ElementType element);
+
+            /// returns the size of a value of type \p type in the file (0 if the type is unknown to the format \c Format,
+            /// e.g., MappedSurfaceMesh). Boolean values are stored as one byte each.
+            template<typename Format>
+            static std::size_t value_size(ValueType type);
+
+            /// calls \c visitor.apply<T>() with the type \c T of the model-independent value type \p type, i.e., all
+            /// types except the handles and the connectivity types of SurfaceMesh. Returns false for the other types.
+            template<typename Visitor>
+            static bool visit(ValueType type, Visitor &visitor);
+
+        private:
+            const Property *find(ElementType element, const std::string &name) const;
+
+        private:
+            MemoryMappedFile file_;
+            uint32_t version_;
+            std::size_t num_elements_[5];
+            std::vector<Property> properties_;
+        };
+
+
+        //-------------------------- IMPLEMENTATION ---------------------------
+
+        /// \cond
+        template<typename T> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type() { return UNKNOWN_TYPE; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<bool>() { return BOOL; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<char>() { return CHAR; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<unsigned char>() { return UCHAR; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<int>() { return INT; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<unsigned int>() { return UINT; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<float>() { return FLOAT; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<double>() { return DOUBLE; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<vec2>() { return VEC2; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<vec3>() { return VEC3; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<vec4>() { return VEC4; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<dvec2>() { return DVEC2; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<dvec3>() { return DVEC3; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<dvec4>() { return DVEC4; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<ivec2>() { return IVEC2; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<ivec3>() { return IVEC3; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<ivec4>() { return IVEC4; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<mat3>() { return MAT3; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<mat4>() { return MAT4; }
+
+        namespace internal {
+            // the size of a value in the file
+            struct MappedValueSize {
+                std::size_t size;
+                template<typename T> bool apply() { size = sizeof(T); return true; }
+            };
+            template<> inline bool MappedValueSize::apply<bool>() { size = 1; return true; }
+        }
+        /// \endcond
+
+
+        template<typename Format>
+        std::size_t MappedPropertyFile::value_size(ValueType type) {
+            internal::MappedValueSize visitor = {0};
+            return Format::visit(type, visitor) ? visitor.size : 0;
+        }
+
+
+        template<typename T>
+        const T *MappedPropertyFile::property(ElementType element, const std::string &name) const {
+            const Property *prop = find(element, name);
+            if (!prop || prop->type != value_type<T>() || prop->compression != UNCOMPRESSED)
+                return nullptr;
+            return reinterpret_cast<const T *>(file_.data() + prop->offset);
+        }
+
+
+        template<typename Visitor>
+        bool MappedPropertyFile::visit(ValueType type, Visitor &visitor) {
+            switch (type) {
+                case BOOL:   return visitor.template apply<bool>();
+                case CHAR:   return visitor.template apply<char>();
+                case UCHAR:  return visitor.template apply<unsigned char>();
+                case INT:    return visitor.template apply<int>();
+                case UINT:   return visitor.template apply<unsigned int>();
+                case FLOAT:  return visitor.template apply<float>();
+                case DOUBLE: return visitor.template apply<double>();
+                case VEC2:   return visitor.template apply<vec2>();
+                case VEC3:   return visitor.template apply<vec3>();
+                case VEC4:   return visitor.template apply<vec4>();
+                case DVEC2:  return visitor.template apply<dvec2>();
+                case DVEC3:  return visitor.template apply<dvec3>();
+                case DVEC4:  return visitor.template apply<dvec4>();
+                case IVEC2:  return visitor.template apply<ivec2>();
+                case IVEC3:  return visitor.template apply<ivec3>();
+                case IVEC4:  return visitor.template apply<ivec4>();
+                case MAT3:   return visitor.template apply<mat3>();
+                case MAT4:   return visitor.template apply<mat4>();
+                default:     return false;
+            }
+        }
+
+    } // namespace io
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_FILEIO_MAPPED_PROPERTY_FILE_H
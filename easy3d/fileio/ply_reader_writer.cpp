@@ -26,8 +26,12 @@
 
 #include <easy3d/fileio/ply_reader_writer.h>
 #include <easy3d/util/logging.h>
+#include <easy3d/util/parallel.h>
 
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <sstream>
 #include <unordered_map>
 
 
@@ -689,6 +693,403 @@ namespace easy3d {
                 }
             }
         }
+
+
+        namespace internal {
+
+            inline std::size_t ply_value_size(BinaryPlyReader::ValueType type) {
+                switch (type) {
+                    case BinaryPlyReader::INT8:
+                    case BinaryPlyReader::UINT8:    return 1;
+                    case BinaryPlyReader::INT16:
+                    case BinaryPlyReader::UINT16:   return 2;
+                    case BinaryPlyReader::FLOAT64:  return 8;
+                    default:                        return 4;
+                }
+            }
+
+            inline bool ply_value_type(const std::string &name, BinaryPlyReader::ValueType &type) {
+                static const std::unordered_map<std::string, BinaryPlyReader::ValueType> types = {
+                        {"char",   BinaryPlyReader::INT8},   {"int8",    BinaryPlyReader::INT8},
+                        {"uchar",  BinaryPlyReader::UINT8},  {"uint8",   BinaryPlyReader::UINT8},
+                        {"short",  BinaryPlyReader::INT16},  {"int16",   BinaryPlyReader::INT16},
+                        {"ushort", BinaryPlyReader::UINT16}, {"uint16",  BinaryPlyReader::UINT16},
+                        {"int",    BinaryPlyReader::INT32},  {"int32",   BinaryPlyReader::INT32},
+                        {"uint",   BinaryPlyReader::UINT32}, {"uint32",  BinaryPlyReader::UINT32},
+                        {"float",  BinaryPlyReader::FLOAT32}, {"float32", BinaryPlyReader::FLOAT32},
+                        {"double", BinaryPlyReader::FLOAT64}, {"float64", BinaryPlyReader::FLOAT64}
+                };
+                auto pos = types.find(name);
+                if (pos == types.end())
+                    return false;
+                type = pos->second;
+                return true;
+            }
+
+            template<typename S>
+            inline S ply_load_value(const char *p, bool swap) {
+                S value;
+                std::memcpy(&value, p, sizeof(S));
+                if (swap) {
+                    char *bytes = reinterpret_cast<char *>(&value);
+                    std::reverse(bytes, bytes + sizeof(S));
+                }
+                return value;
+            }
+
+            // loads a value of type 'type' stored at 'p' and converts it to T
+            template<typename T>
+            inline T ply_load(BinaryPlyReader::ValueType type, const char *p, bool swap) {
+                switch (type) {
+                    case BinaryPlyReader::INT8:    return static_cast<T>(ply_load_value<int8_t>(p, swap));
+                    case BinaryPlyReader::UINT8:   return static_cast<T>(ply_load_value<uint8_t>(p, swap));
+                    case BinaryPlyReader::INT16:   return static_cast<T>(ply_load_value<int16_t>(p, swap));
+                    case BinaryPlyReader::UINT16:  return static_cast<T>(ply_load_value<uint16_t>(p, swap));
+                    case BinaryPlyReader::INT32:   return static_cast<T>(ply_load_value<int32_t>(p, swap));
+                    case BinaryPlyReader::UINT32:  return static_cast<T>(ply_load_value<uint32_t>(p, swap));
+                    case BinaryPlyReader::FLOAT32: return static_cast<T>(ply_load_value<float>(p, swap));
+                    default:                       return static_cast<T>(ply_load_value<double>(p, swap));
+                }
+            }
+
+            // the PLY type whose values can be copied into an array of T without any conversion
+            template<typename T> inline BinaryPlyReader::ValueType ply_native_type();
+            template<> inline BinaryPlyReader::ValueType ply_native_type<float>() { return BinaryPlyReader::FLOAT32; }
+            template<> inline BinaryPlyReader::ValueType ply_native_type<int>() { return BinaryPlyReader::INT32; }
+
+        } // namespace internal
+
+
+        bool BinaryPlyReader::open(const std::string &file_name) {
+            close();
+            if (!file_.open(file_name))
+                return false;
+            if (!parse_header()) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+
+        void BinaryPlyReader::close() {
+            file_.close();
+            elements_.clear();
+            swap_ = false;
+        }
+
+
+        bool BinaryPlyReader::parse_header() {
+            const char *data = file_.data();
+            const std::size_t size = file_.size();
+            if (size < 3 || std::strncmp(data, "ply", 3) != 0)
+                return false;
+
+            // the data starts right after the line "end_header"
+            static const std::string end_header = "end_header";
+            const char *pos = std::search(data, data + size, end_header.begin(), end_header.end());
+            const char *eol = std::find(pos, data + size, '\n');
+            if (eol == data + size)
+                return false;
+            std::size_t offset = static_cast<std::size_t>(eol - data) + 1;
+
+            bool binary = false;
+            std::istringstream header(std::string(data, pos));
+            std::string line;
+            while (std::getline(header, line)) {
+                std::istringstream in(line);
+                std::string keyword;
+                in >> keyword;
+                if (keyword.empty() || keyword == "ply" || keyword == "comment" || keyword == "obj_info")
+                    continue;
+                else if (keyword == "format") {
+                    std::string format;
+                    in >> format;
+                    if (format == "binary_little_endian")
+                        swap_ = is_big_endian();
+                    else if (format == "binary_big_endian")
+                        swap_ = !is_big_endian();
+                    else
+                        return false; // ASCII files are handled by PlyReader
+                    binary = true;
+                } else if (keyword == "element") {
+                    ElementLayout element;
+                    in >> element.name >> element.num_instances;
+                    if (in.fail())
+                        return false;
+                    element.begin = element.end = element.stride = 0;
+                    elements_.push_back(element);
+                } else if (keyword == "property") {
+                    if (elements_.empty())
+                        return false;
+                    Property property;
+                    property.is_list = false;
+                    property.length_type = UINT8;
+                    property.offset = 0;
+                    std::string type;
+                    in >> type;
+                    if (type == "list") {
+                        std::string length_type, value_type;
+                        in >> length_type >> value_type;
+                        if (!internal::ply_value_type(length_type, property.length_type) ||
+                            !internal::ply_value_type(value_type, property.type))
+                            return false;
+                        property.is_list = true;
+                    } else if (!internal::ply_value_type(type, property.type))
+                        return false;
+                    in >> property.name;
+                    if (in.fail())
+                        return false;
+                    elements_.back().properties.push_back(property);
+                } else
+                    return false;
+            }
+            if (!binary)
+                return false;
+
+            // locate the instances of each element
+            for (auto &element : elements_) {
+                element.begin = offset;
+                bool fixed_size = true;
+                std::size_t stride = 0;
+                for (auto &property : element.properties) {
+                    property.offset = stride;
+                    if (property.is_list)
+                        fixed_size = false;
+                    else
+                        stride += internal::ply_value_size(property.type);
+                }
+
+                if (fixed_size) {
+                    if (stride > 0 && element.num_instances > (size - offset) / stride)
+                        return false;
+                    element.stride = stride;
+                    offset += stride * element.num_instances;
+                } else {
+                    const char *p = data + offset;
+                    for (std::size_t i = 0; i < element.num_instances && p; ++i)
+                        p = skip_instance(element, p);
+                    if (!p)
+                        return false;
+                    offset = static_cast<std::size_t>(p - data);
+                }
+                element.end = offset;
+            }
+            return true;
+        }
+
+
+        const char *BinaryPlyReader::skip_instance(const ElementLayout &element, const char *p) const {
+            const char *end = file_.data() + file_.size();
+            for (const auto &property : element.properties) {
+                std::size_t size = internal::ply_value_size(property.type);
+                if (property.is_list) {
+                    const std::size_t length_size = internal::ply_value_size(property.length_type);
+                    if (static_cast<std::size_t>(end - p) < length_size)
+                        return nullptr;
+                    const double length = internal::ply_load<double>(property.length_type, p, swap_);
+                    if (length < 0)
+                        return nullptr;
+                    p += length_size;
+                    size *= static_cast<std::size_t>(length);
+                }
+                if (static_cast<std::size_t>(end - p) < size)
+                    return nullptr;
+                p += size;
+            }
+            return p;
+        }
+
+
+        const BinaryPlyReader::ElementLayout *BinaryPlyReader::element(const std::string &name) const {
+            for (const auto &element : elements_) {
+                if (element.name == name)
+                    return &element;
+            }
+            return nullptr;
+        }
+
+
+        const BinaryPlyReader::Property *BinaryPlyReader::property(const ElementLayout &element, const std::string &name) {
+            for (const auto &property : element.properties) {
+                if (property.name == name)
+                    return &property;
+            }
+            return nullptr;
+        }
+
+
+        std::vector<BinaryPlyReader::Field> BinaryPlyReader::fields(const ElementLayout &element) {
+            std::vector<std::string> float_names, int_names;
+            for (const auto &property : element.properties) {
+                if (property.is_list)
+                    continue;
+                if (property.type == FLOAT32 || property.type == FLOAT64)
+                    float_names.push_back(property.name);
+                else
+                    int_names.push_back(property.name);
+            }
+
+            // removes the wanted names from 'names' if all of them exist
+            auto extract = [](std::vector<std::string> &names, const std::vector<std::string> &wanted) -> bool {
+                for (const auto &name : wanted) {
+                    if (std::find(names.begin(), names.end(), name) == names.end())
+                        return false;
+                }
+                for (const auto &name : wanted)
+                    names.erase(std::find(names.begin(), names.end(), name));
+                return true;
+            };
+
+            // the same standard properties as PlyReader::collect_elements()
+            std::vector<Field> fields;
+            if (extract(float_names, {"x", "y", "z"}))
+                fields.push_back({"point", {"x", "y", "z"}, true, 1.0f});
+            else if (extract(float_names, {"X", "Y", "Z"}))
+                fields.push_back({"point", {"X", "Y", "Z"}, true, 1.0f});
+
+            if (extract(float_names, {"texcoord_x", "texcoord_y"}))
+                fields.push_back({"texcoord", {"texcoord_x", "texcoord_y"}, true, 1.0f});
+
+            if (extract(float_names, {"nx", "ny", "nz"}))
+                fields.push_back({"normal", {"nx", "ny", "nz"}, true, 1.0f});
+
+            if (extract(float_names, {"r", "g", "b"}))
+                fields.push_back({"color", {"r", "g", "b"}, true, 1.0f});
+            else if (extract(int_names, {"red", "green", "blue"}))
+                fields.push_back({"color", {"red", "green", "blue"}, true, 255.0f});
+            else if (extract(int_names, {"diffuse_red", "diffuse_green", "diffuse_blue"}))
+                fields.push_back({"color", {"diffuse_red", "diffuse_green", "diffuse_blue"}, true, 255.0f});
+
+            if (extract(float_names, {"a"}))
+                fields.push_back({"alpha", {"a"}, true, 1.0f});
+            else if (extract(int_names, {"alpha"}))
+                fields.push_back({"alpha", {"alpha"}, true, 255.0f});
+
+            for (const auto &name : float_names)
+                fields.push_back({name, {name}, true, 1.0f});
+            for (const auto &name : int_names)
+                fields.push_back({name, {name}, false, 1.0f});
+            return fields;
+        }
+
+
+        void BinaryPlyReader::check_normal(const ElementLayout &element, const vec3 &normal) {
+            const float len = length(normal);
+            LOG_IF(std::abs(1.0 - len) > epsilon<float>(), WARNING)
+                            << "normals (defined on element '" << element.name
+                            << "') not normalized (length of the first normal vector is " << len << ")";
+        }
+
+
+        template<typename T>
+        bool BinaryPlyReader::read_values(const ElementLayout &element, const std::vector<std::string> &names, T *data,
+                                          T divisor) const {
+            const std::size_t k = names.size();
+            std::vector<const Property *> properties(k, nullptr);
+            for (std::size_t c = 0; c < k; ++c) {
+                properties[c] = property(element, names[c]);
+                if (!properties[c] || properties[c]->is_list) {
+                    LOG(ERROR) << "element '" << element.name << "' has no scalar property '" << names[c] << "'";
+                    return false;
+                }
+            }
+
+            const std::size_t n = element.num_instances;
+            const char *base = file_.data() + element.begin;
+            if (element.stride > 0) { // fixed size: the instances can be accessed randomly
+                bool native = !swap_ && divisor == T(1);
+                for (std::size_t c = 0; c < k && native; ++c) {
+                    native = properties[c]->type == internal::ply_native_type<T>() &&
+                             properties[c]->offset == properties[0]->offset + c * sizeof(T);
+                }
+                const std::size_t stride = element.stride;
+                if (native && stride == k * sizeof(T))  // the values are stored exactly as requested
+                    std::memcpy(data, base, n * stride);
+                else if (native) {
+                    const std::size_t offset = properties[0]->offset;
+                    parallel::for_each(0, n, [&](std::size_t i) {
+                        std::memcpy(data + i * k, base + i * stride + offset, k * sizeof(T));
+                    });
+                } else {
+                    parallel::for_each(0, n, [&](std::size_t i) {
+                        const char *instance = base + i * stride;
+                        for (std::size_t c = 0; c < k; ++c) {
+                            const Property *p = properties[c];
+                            data[i * k + c] = internal::ply_load<T>(p->type, instance + p->offset, swap_) / divisor;
+                        }
+                    });
+                }
+                return true;
+            }
+
+            // the instances have different sizes and must be visited one after another. The bounds have been checked
+            // when parsing the header.
+            std::vector<int> component(element.properties.size(), -1);
+            for (std::size_t c = 0; c < k; ++c)
+                component[properties[c] - element.properties.data()] = static_cast<int>(c);
+            const char *p = base;
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j < element.properties.size(); ++j) {
+                    const Property &property = element.properties[j];
+                    if (property.is_list) {
+                        const auto length = internal::ply_load<std::size_t>(property.length_type, p, swap_);
+                        p += internal::ply_value_size(property.length_type) + length * internal::ply_value_size(property.type);
+                    } else {
+                        if (component[j] >= 0)
+                            data[i * k + component[j]] = internal::ply_load<T>(property.type, p, swap_) / divisor;
+                        p += internal::ply_value_size(property.type);
+                    }
+                }
+            }
+            return true;
+        }
+
+
+        bool BinaryPlyReader::read(const ElementLayout &element, const std::vector<std::string> &names, float *data,
+                                   float divisor) const {
+            return read_values<float>(element, names, data, divisor);
+        }
+
+
+        bool BinaryPlyReader::read(const ElementLayout &element, const std::vector<std::string> &names, int *data) const {
+            return read_values<int>(element, names, data, 1);
+        }
+
+
+        bool BinaryPlyReader::read_list(const ElementLayout &element, const std::string &name, std::vector<int> &values,
+                                        std::vector<int> &sizes) const {
+            const Property *wanted = property(element, name);
+            if (!wanted || !wanted->is_list) {
+                LOG(ERROR) << "element '" << element.name << "' has no list property '" << name << "'";
+                return false;
+            }
+
+            const std::size_t n = element.num_instances;
+            sizes.resize(n);
+            values.clear();
+            values.reserve(n * 3);  // mostly triangles
+
+            const char *p = file_.data() + element.begin;
+            for (std::size_t i = 0; i < n; ++i) {
+                for (const auto &property : element.properties) {
+                    std::size_t length = 1;
+                    if (property.is_list) {
+                        length = internal::ply_load<std::size_t>(property.length_type, p, swap_);
+                        p += internal::ply_value_size(property.length_type);
+                    }
+                    const std::size_t size = internal::ply_value_size(property.type);
+                    if (&property == wanted) {
+                        sizes[i] = static_cast<int>(length);
+                        for (std::size_t v = 0; v < length; ++v, p += size)
+                            values.push_back(internal::ply_load<int>(property.type, p, swap_));
+                    } else
+                        p += length * size;
+                }
+            }
+            return true;
+        }
+
         // \endcond
 
         bool is_big_endian() {
@@ -32,6 +32,7 @@
 #include <vector>
 
 #include <easy3d/core/types.h>
+#include <easy3d/util/memory_mapped_file.h>
 
 // Todo: check happly, a header-only implementation of the .ply file format.
 //       https://github.com/nmwsharp/happly
@@ -140,6 +141,147 @@ namespace easy3d {
 		};
 
 
+		/**
+		 * \brief A bulk reader for binary PLY files.
+		 * \details Unlike PlyReader, which receives the values one by one from rply and keeps them in intermediate
+		 *      properties, this reader maps the file into memory, parses the header, and copies (and byte-swaps, if
+		 *      the endianness differs) the values of a property directly into the destination array. For elements of a
+		 *      fixed size, e.g., vertices without list properties, the values are located by their offsets and read
+		 *      in parallel. List properties (e.g., the vertex indices of faces) are read into a flat array of values
+		 *      together with the sizes of the lists, which is the input of SurfaceMeshBuilder::add_faces().
+		 *      This class is internally used by PointCloudIO and SurfaceMeshIO, which fall back to PlyReader for ASCII
+		 *      files. Client code should use PointCloudIO and SurfaceMeshIO.
+		 * \class BinaryPlyReader easy3d/fileio/ply_reader_writer.h
+		 */
+		class BinaryPlyReader {
+		public:
+			/// \brief The value types of the PLY format.
+			enum ValueType { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+			/// \brief A property declared in the header.
+			struct Property {
+				std::string name;
+				ValueType type;         // the value type (of the values in the list, if is_list is true)
+				bool is_list;
+				ValueType length_type;  // the type of the length of the list (if is_list is true)
+				std::size_t offset;     // offset (in bytes) within an instance of a fixed-size element
+			};
+
+			/// \brief An element declared in the header.
+			struct ElementLayout {
+				std::string name;
+				std::size_t num_instances;
+				std::vector<Property> properties;
+				std::size_t begin;      // offset (in bytes) of the first instance in the file
+				std::size_t end;        // offset (in bytes) past the last instance in the file
+				std::size_t stride;     // size (in bytes) of an instance, or 0 if the element has list properties
+			};
+
+			/**
+			 * \brief A property of a model made of one or more scalar PLY properties of an element, e.g., "point"
+			 *      consists of "x", "y", and "z". The properties are grouped in the same way as PlyReader does.
+			 */
+			struct Field {
+				std::string name;                       // e.g., "point", "normal", "color", "quality"
+				std::vector<std::string> components;    // the names of the PLY properties (1, 2, or 3)
+				bool is_float;                          // true for float values, false for int values
+				float divisor;                          // e.g., 255 for colors stored as integers
+			};
+
+		public:
+			BinaryPlyReader() : swap_(false) {}
+
+			/**
+			 * \brief Maps the file into memory and parses its header.
+			 * \return false if the file could not be opened, it is not a binary PLY file, or its header is broken.
+			 */
+			bool open(const std::string& file_name);
+			/// \brief Closes the file.
+			void close();
+
+			/// \brief The elements declared in the header (in the order of the file).
+			const std::vector<ElementLayout>& elements() const { return elements_; }
+			/// \brief The element named \p name, or nullptr if it does not exist.
+			const ElementLayout* element(const std::string& name) const;
+			/// \brief The property named \p name of element \p element, or nullptr if it does not exist.
+			static const Property* property(const ElementLayout& element, const std::string& name);
+
+			/// \brief Groups the scalar properties of \p element into fields, e.g., "x", "y", and "z" make "point".
+			static std::vector<Field> fields(const ElementLayout& element);
+
+			/**
+			 * \brief Reads the values of the scalar properties \p names of all instances of \p element into \p data.
+			 * \details The values are interleaved, i.e., \p data receives name[0], name[1], ... of the first instance,
+			 *      followed by those of the second instance, and so on. It must be able to hold
+			 *      num_instances * names.size() values. Each value is divided by \p divisor.
+			 * \return false if a property does not exist or is a list property.
+			 */
+			bool read(const ElementLayout& element, const std::vector<std::string>& names, float* data,
+					  float divisor = 1.0f) const;
+			/// \brief Reads the values of integer properties. See the float version for details.
+			bool read(const ElementLayout& element, const std::vector<std::string>& names, int* data) const;
+
+			/**
+			 * \brief Reads the list property \p name of all instances of \p element.
+			 * \param values The values of all the lists (concatenated in the order of the instances).
+			 * \param sizes The size of each list.
+			 * \return false if the property does not exist or is not a list property.
+			 */
+			bool read_list(const ElementLayout& element, const std::string& name, std::vector<int>& values,
+						   std::vector<int>& sizes) const;
+
+			/**
+			 * \brief Reads all the fields of \p element directly into the properties of a model.
+			 * \param prefix The prefix of the property names, e.g., "v:" for vertex properties. It is prepended to
+			 *      the names of the fields if they don't have it.
+			 * \param storage Provides a \c data<T>(name) function that returns the pointer to the values of the
+			 *      (created if not existing) property named \p name of value type T (vec3, vec2, float, or int).
+			 * \return false if reading any of the fields failed (the fields are read until the first failure).
+			 */
+			template <typename Storage>
+			bool read_fields(const ElementLayout& element, const std::string& prefix, const Storage& storage) const {
+				for (const auto& field : fields(element)) {
+					std::string name = field.name;
+					if (name.find(prefix) == std::string::npos)
+						name = prefix + name;
+					bool success = false;
+					if (field.components.size() == 3) {
+						vec3* values = storage.template data<vec3>(name);
+						success = read(element, field.components, values->data(), field.divisor);
+						if (success && field.name == "normal" && element.num_instances > 0)
+							check_normal(element, values[0]);
+					}
+					else if (field.components.size() == 2)
+						success = read(element, field.components, storage.template data<vec2>(name)->data(), field.divisor);
+					else if (field.is_float)
+						success = read(element, field.components, storage.template data<float>(name), field.divisor);
+					else
+						success = read(element, field.components, storage.template data<int>(name));
+					if (!success)
+						return false;
+				}
+				return true;
+			}
+
+		private:
+			bool parse_header();
+
+			// warns if the first normal is not normalized (as PlyReader does)
+			static void check_normal(const ElementLayout& element, const vec3& normal);
+
+			template <typename T>
+			bool read_values(const ElementLayout& element, const std::vector<std::string>& names, T* data, T divisor) const;
+
+			// returns the end of the instance that starts at 'p', or nullptr if it exceeds the end of the file
+			const char* skip_instance(const ElementLayout& element, const char* p) const;
+
+		private:
+			MemoryMappedFile file_;
+			bool swap_;     // true if the endianness of the file differs from that of the system
+			std::vector<ElementLayout> elements_;
+		};
+
+
 		/// \brief A general purpose PLY file writer.
 		/// \details This class is internally used by PointCloudIO, SurfaceMeshIO, and GraphIO.
 		/// Client code should use PointCloudIO, SurfaceMeshIO, and GraphIO.
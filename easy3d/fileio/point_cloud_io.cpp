@@ -47,6 +47,8 @@ namespace easy3d {
             success = io::load_ply(file_name, cloud);
         else if (ext == "bin")
             success = io::load_bin(file_name, cloud);
+        else if (ext == "pcb")
+            success = io::load_pcb(file_name, cloud);
         else if (ext == "xyz")
             success = io::load_xyz(file_name, cloud);
         else if (ext == "bxyz")
@@ -99,6 +101,8 @@ namespace easy3d {
             success = io::save_ply(final_name, cloud, true);
         } else if (ext == "bin")
             success = io::save_bin(final_name, cloud);
+        else if (ext == "pcb")
+            success = io::save_pcb(final_name, cloud);
         else if (ext == "xyz")
             success = io::save_xyz(final_name, cloud);
         else if (ext == "bxyz")
@@ -30,6 +30,8 @@
 #include <iostream>
 #include <vector>
 
+#include <easy3d/core/types.h>
+
 
 namespace easy3d {
 
@@ -45,7 +47,7 @@ namespace easy3d {
 	public:
         /**
          * \brief Reads a point cloud from file \p file_name.
-         * \details File extension determines file format (bin, xyz/bxyz, ply, las/laz, vg/bvg)
+         * \details File extension determines file format (bin, pcb, xyz/bxyz, ply, las/laz, vg/bvg)
          * and type (i.e. binary or ASCII).
          * \return The pointer of the point cloud (nullptr if failed).
          */
@@ -53,13 +55,14 @@ namespace easy3d {
 
         /**
          * \brief Saves a point_cloud to a file.
-         * \details File extension determines file format (bin, xyz/bxyz, ply, las/laz, vg/bvg) and type (i.e. binary
+         * \details File extension determines file format (bin, pcb, xyz/bxyz, ply, las/laz, vg/bvg) and type (i.e. binary
          * or ASCII).
          * \param file_name The file name.
          * \param cloud The point cloud.
          * \return The status of the operation
          *      \arg true if succeeded
          *      \arg false if failed
+         * \sa io::PointCloudWriter for writing points that don't fit in memory.
          */
 		static bool	save(const std::string& file_name, const PointCloud* cloud);
 	};
@@ -76,6 +79,17 @@ namespace easy3d {
         /// and normals (optional).
 		bool save_bin(const std::string& file_name, const PointCloud* cloud);
 
+        /// \brief Reads point cloud from a \c pcb (i.e., chunked binary) format file.
+        /// \details The file is memory mapped and all the supported vertex properties are loaded. To access only a
+        ///     few properties of a large point cloud, use io::MappedPointCloud directly. Like the other readers, the
+        ///     stored translation is kept (as the "translation" model property) only if the Translator is enabled.
+        ///     Otherwise, the original coordinates are returned.
+        /// \sa io::MappedPointCloud
+        bool load_pcb(const std::string& file_name, PointCloud* cloud);
+        /// \brief Saves a point cloud to a \c pcb (i.e., chunked binary) format file.
+        /// \sa io::MappedPointCloud
+        bool save_pcb(const std::string& file_name, const PointCloud* cloud);
+
         /// \brief Reads point cloud from an \c xyz format file.
         /// \details Each line of an \c xyz file contains three floating point numbers representing the \p x, \p y, and
         /// \p z coordinates of a point.
@@ -93,7 +107,49 @@ namespace easy3d {
 
         /// \brief Reads point cloud from an \c las/laz format file.
         ///     Internally the method uses the LASlib of martin.isenburg@rapidlasso.com. See http://rapidlasso.com
+        /// \details The colors ("v:color") and classifications ("v:classification") of all points are loaded. Use the
+        ///     version with LasOptions to load other attributes or a subset of the points.
         bool load_las(const std::string &file_name, PointCloud *cloud);
+
+        /**
+         * \brief Options for reading \c las/laz files, i.e., which attributes to load and which points to keep.
+         * \sa load_las(const std::string&, PointCloud*, const LasOptions&)
+         */
+        struct LasOptions {
+            /// \brief The per-point attributes that can be loaded (combined by bitwise OR).
+            enum Attribute {
+                COLOR = 1,              ///< "v:color" (vec3). Gray levels from the intensities if the file has no RGB.
+                CLASSIFICATION = 2,     ///< "v:classification" (int)
+                INTENSITY = 4,          ///< "v:intensity" (int)
+                RETURN_NUMBER = 8,      ///< "v:return_number" and "v:number_of_returns" (int)
+                GPS_TIME = 16,          ///< "v:gps_time" (double). Only if the points have GPS time.
+                ALL = 31
+            };
+
+            LasOptions() : attributes(COLOR | CLASSIFICATION), use_region(false), chunk_size(1 << 16) {}
+
+            /// The attributes to load, e.g., COLOR | INTENSITY. The coordinates are always loaded.
+            unsigned int attributes;
+            /// If true, only the points inside the box [region_min, region_max] are loaded. The box is defined in the
+            /// original coordinates of the file (i.e., before the translation, see Translator).
+            bool use_region;
+            dvec3 region_min;
+            dvec3 region_max;
+            /// If not empty, only the points of these classes are loaded.
+            std::vector<int> classifications;
+            /// The number of points decoded and appended to the point cloud at a time.
+            std::size_t chunk_size;
+        };
+
+        /**
+         * \brief Reads the points of an \c las/laz file that pass the filters of \p options, and only the requested
+         *      attributes of them.
+         * \details The points are decoded in chunks that are filtered during reading and appended to the property
+         *      arrays in bulk, so the memory needed is that of the kept points and the requested attributes only. For
+         *      uncompressed \c las files, the point records are decoded in parallel directly from the mapped file. For
+         *      \c laz files, the decompression of the attributes that are not needed is skipped if the file allows.
+         */
+        bool load_las(const std::string &file_name, PointCloud *cloud, const LasOptions &options);
         /// \brief Saves a point cloud to an \c LAS/LAS format file.
         /// \details Internally it uses the LASlib of martin.isenburg@rapidlasso.com. See http://rapidlasso.com
 		bool save_las(const std::string& file_name, const PointCloud* cloud);
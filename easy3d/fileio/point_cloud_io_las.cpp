@@ -28,9 +28,15 @@
 
 #include <algorithm>
 #include <climits>  // for USHRT_MAX
+#include <cstring>
 
 #include <easy3d/fileio/translator.h>
 #include <easy3d/core/point_cloud.h>
+#include <easy3d/util/memory_mapped_file.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/parallel.h>
+#include <easy3d/util/progress.h>
+#include <easy3d/util/logging.h>
 #include <3rd_party/lastools/LASlib/inc/lasreader.hpp>
 #include <3rd_party/lastools/LASlib/inc/laswriter.hpp>
 
@@ -42,103 +48,382 @@ namespace easy3d {
     namespace io {
 
 
-        bool load_las(const std::string &file_name, PointCloud *cloud) {
-            LASreadOpener lasreadopener;
-            lasreadopener.set_file_name(file_name.c_str(), true);
+        namespace internal {
 
-            LASreader *lasreader = lasreadopener.open();
-            if (!lasreader || lasreader->npoints <= 0) {
-                LOG(ERROR) << "could not open file: " << file_name;
-                lasreader->close();
-                delete lasreader;
-                return false;
-            }
+            // a decoded point record
+            struct LasRecord {
+                double x, y, z;
+                double gps_time;
+                unsigned short rgb[3];
+                unsigned short intensity;
+                int classification;
+                int return_number;
+                int number_of_returns;
+                bool has_rgb;
+            };
 
-            std::size_t num = lasreader->npoints;
-            LOG(INFO) << "reading " << num << " points...";
 
-            // read the first point
-            if (!lasreader->read_point()) {
-                LOG(ERROR) << "failed reading point";
-                lasreader->close();
-                delete lasreader;
-                return false;
+            // decodes a point read by LASlib
+            inline void decode(LASpoint &p, LasRecord &r) {
+                // compute the actual coordinates as double floating point values
+                p.compute_coordinates();
+                r.x = p.coordinates[0];
+                r.y = p.coordinates[1];
+                r.z = p.coordinates[2];
+                r.has_rgb = p.have_rgb;
+                r.rgb[0] = p.get_R();
+                r.rgb[1] = p.get_G();
+                r.rgb[2] = p.get_B();
+                r.intensity = p.get_intensity();
+                if (p.is_extended_point_type()) {
+                    r.classification = p.get_extended_classification();
+                    r.return_number = p.get_extended_return_number();
+                    r.number_of_returns = p.get_extended_number_of_returns();
+                } else {
+                    r.classification = p.get_classification();
+                    r.return_number = p.get_return_number();
+                    r.number_of_returns = p.get_number_of_returns();
+                }
+                r.gps_time = p.have_gps_time ? p.get_gps_time() : 0.0;
             }
 
-            LASpoint &p0 = lasreader->point;
-            // compute the actual coordinates as double floating point values
-            p0.compute_coordinates();
-            double x0 = p0.coordinates[0];
-            double y0 = p0.coordinates[1];
-            double z0 = p0.coordinates[2];
-
-            bool translate = false;
-            double origin_x(0), origin_y(0), origin_z(0);
-            if (Translator::instance()->status() == Translator::DISABLED) {
-                if (x0 > 1e4 || y0 > 1e4 || z0 > 1e4)
-                    LOG(WARNING) << "model has large coordinates (first point: "
-                                 << x0 << " " << y0 << " " << z0
-                                 << ") and some decimals may be lost. Hint: transform the model w.r.t. its first point";
-            }
-            else if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
-                Translator::instance()->set_translation(dvec3(x0, y0, z0));
-                origin_x = x0;
-                origin_y = y0;
-                origin_z = z0;
-                translate = true;
+
+            // The layout of the point records of an uncompressed LAS file, which can be decoded directly (and in
+            // parallel) from the mapped file. See the LAS specification 1.4 R15, "Point Data Records".
+            class LasLayout {
+            public:
+                explicit LasLayout(const LASheader &header)
+                        : format_(header.point_data_format), length_(header.point_data_record_length),
+                          offset_(header.offset_to_point_data),
+                          scale_{header.x_scale_factor, header.y_scale_factor, header.z_scale_factor},
+                          translation_{header.x_offset, header.y_offset, header.z_offset} {
+                }
+
+                // returns whether the records have a known layout
+                bool valid() const {
+                    static const unsigned short min_length[] = {20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67};
+                    return format_ <= 10 && length_ >= min_length[format_];
+                }
+
+                bool has_gps_time() const { return format_ != 0 && format_ != 2; }
+
+                std::size_t offset() const { return offset_; }
+                std::size_t length() const { return length_; }
+
+                void decode(const char *q, LasRecord &r) const {
+                    r.x = scale_[0] * load<int32_t>(q) + translation_[0];
+                    r.y = scale_[1] * load<int32_t>(q + 4) + translation_[1];
+                    r.z = scale_[2] * load<int32_t>(q + 8) + translation_[2];
+                    r.intensity = load<uint16_t>(q + 12);
+                    const auto returns = static_cast<unsigned char>(q[14]);
+                    std::size_t gps_time = 20, rgb = 0;
+                    if (format_ < 6) {
+                        r.return_number = returns & 7;
+                        r.number_of_returns = (returns >> 3) & 7;
+                        r.classification = static_cast<unsigned char>(q[15]) & 31;
+                        if (format_ == 2) rgb = 20;
+                        else if (format_ == 3 || format_ == 5) rgb = 28;
+                    } else {
+                        r.return_number = returns & 15;
+                        r.number_of_returns = returns >> 4;
+                        r.classification = static_cast<unsigned char>(q[16]);
+                        gps_time = 22;
+                        if (format_ != 6 && format_ != 9) rgb = 30;
+                    }
+                    r.gps_time = has_gps_time() ? load<double>(q + gps_time) : 0.0;
+                    r.has_rgb = (rgb != 0);
+                    for (std::size_t i = 0; i < 3; ++i)
+                        r.rgb[i] = r.has_rgb ? load<uint16_t>(q + rgb + 2 * i) : 0;
+                }
+
+            private:
+                template<typename T>
+                static T load(const char *p) {
+                    T value;
+                    std::memcpy(&value, p, sizeof(T));
+                    return value;
+                }
+
+            private:
+                unsigned int format_;
+                std::size_t length_;
+                std::size_t offset_;
+                double scale_[3];
+                double translation_[3];
+            };
+
+
+            // Filters the decoded points and appends the kept ones (only the requested attributes) to a point cloud.
+            class LasPointSink {
+            public:
+                LasPointSink(PointCloud *cloud, const LasOptions &options, bool has_gps_time)
+                        : cloud_(cloud), options_(options), begin_(cloud->vertices_size()), size_(begin_),
+                          has_origin_(false), translate_(false) {
+                    if (!options.classifications.empty()) {
+                        classes_.resize(256, false);
+                        for (auto c : options.classifications) {
+                            if (c >= 0 && c < 256)
+                                classes_[c] = true;
+                        }
+                    }
+                    if (options.attributes & LasOptions::COLOR)
+                        color_ = cloud->vertex_property<vec3>("v:color");
+                    if (options.attributes & LasOptions::CLASSIFICATION)
+                        classification_ = cloud->vertex_property<int>("v:classification");
+                    if (options.attributes & LasOptions::INTENSITY)
+                        intensity_ = cloud->vertex_property<int>("v:intensity");
+                    if (options.attributes & LasOptions::RETURN_NUMBER) {
+                        return_number_ = cloud->vertex_property<int>("v:return_number");
+                        number_of_returns_ = cloud->vertex_property<int>("v:number_of_returns");
+                    }
+                    if ((options.attributes & LasOptions::GPS_TIME) && has_gps_time)
+                        gps_time_ = cloud->vertex_property<double>("v:gps_time");
+                }
+
+                // true if the points are filtered, i.e., the number of points to be loaded is not known in advance
+                bool filtering() const { return options_.use_region || !classes_.empty(); }
+
+                // pre-sizes the property arrays for n points
+                void reserve(std::size_t n) { cloud_->resize(static_cast<unsigned int>(begin_ + n)); }
+
+                bool accept(const LasRecord &r) const {
+                    if (!classes_.empty() && (r.classification < 0 || r.classification > 255 || !classes_[r.classification]))
+                        return false;
+                    if (options_.use_region) {
+                        const dvec3 &min = options_.region_min, &max = options_.region_max;
+                        if (r.x < min.x || r.x > max.x || r.y < min.y || r.y > max.y || r.z < min.z || r.z > max.z)
+                            return false;
+                    }
+                    return true;
+                }
+
+                // appends the first n records
+                void append(const std::vector<LasRecord> &records, std::size_t n) {
+                    if (n == 0)
+                        return;
+                    if (!has_origin_)
+                        set_origin(records[0]);
+                    if (size_ + n > cloud_->vertices_size())
+                        cloud_->resize(static_cast<unsigned int>(size_ + n));
+
+                    vec3 *points = cloud_->get_vertex_property<vec3>("v:point").vector().data() + size_;
+                    vec3 *colors = color_ ? color_.vector().data() + size_ : nullptr;
+                    int *classifications = classification_ ? classification_.vector().data() + size_ : nullptr;
+                    int *intensities = intensity_ ? intensity_.vector().data() + size_ : nullptr;
+                    int *return_numbers = return_number_ ? return_number_.vector().data() + size_ : nullptr;
+                    int *numbers_of_returns = number_of_returns_ ? number_of_returns_.vector().data() + size_ : nullptr;
+                    double *gps_times = gps_time_ ? gps_time_.vector().data() + size_ : nullptr;
+                    parallel::for_each(0, n, [&](std::size_t i) {
+                        const LasRecord &r = records[i];
+                        points[i] = vec3(float(r.x - origin_.x), float(r.y - origin_.y), float(r.z - origin_.z));
+                        if (colors) {
+                            if (r.has_rgb) {
+                                colors[i] = vec3(static_cast<float>(r.rgb[0]) / USHRT_MAX,
+                                                 static_cast<float>(r.rgb[1]) / USHRT_MAX,
+                                                 static_cast<float>(r.rgb[2]) / USHRT_MAX);
+                            } else {
+                                const float gray = static_cast<float>(r.intensity % 255) / 255.0f;
+                                colors[i] = vec3(gray, gray, gray);
+                            }
+                        }
+                        if (classifications) classifications[i] = r.classification;
+                        if (intensities) intensities[i] = r.intensity;
+                        if (return_numbers) return_numbers[i] = r.return_number;
+                        if (numbers_of_returns) numbers_of_returns[i] = r.number_of_returns;
+                        if (gps_times) gps_times[i] = r.gps_time;
+                    });
+                    size_ += n;
+                }
+
+                // removes the pre-sized but not used entries and records the translation
+                void finish() {
+                    if (cloud_->vertices_size() != size_)
+                        cloud_->resize(static_cast<unsigned int>(size_));
+                    if (!translate_)
+                        return;
+
+                    auto trans = cloud_->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
+                    trans[0] = origin_;
+                    if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT)
+                        LOG(INFO) << "model translated w.r.t. the first vertex (" << trans[0]
+                                  << "), stored as ModelProperty<dvec3>(\"translation\")";
+                    else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET)
+                        LOG(INFO) << "model translated w.r.t. last known reference point (" << trans[0]
+                                  << "), stored as ModelProperty<dvec3>(\"translation\")";
+                }
+
+                std::size_t num_points() const { return size_ - begin_; }
+
+            private:
+                void set_origin(const LasRecord &first) {
+                    has_origin_ = true;
+                    if (Translator::instance()->status() == Translator::DISABLED) {
+                        if (first.x > 1e4 || first.y > 1e4 || first.z > 1e4)
+                            LOG(WARNING) << "model has large coordinates (first point: "
+                                         << first.x << " " << first.y << " " << first.z
+                                         << ") and some decimals may be lost. Hint: transform the model w.r.t. its first point";
+                    } else if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
+                        origin_ = dvec3(first.x, first.y, first.z);
+                        Translator::instance()->set_translation(origin_);
+                        translate_ = true;
+                    } else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET) {
+                        origin_ = Translator::instance()->translation();
+                        translate_ = true;
+                    }
+                }
+
+            private:
+                PointCloud *cloud_;
+                const LasOptions &options_;
+                std::vector<bool> classes_;
+                std::size_t begin_;
+                std::size_t size_;
+
+                bool has_origin_;
+                bool translate_;
+                dvec3 origin_;
+
+                PointCloud::VertexProperty<vec3> color_;
+                PointCloud::VertexProperty<int> classification_;
+                PointCloud::VertexProperty<int> intensity_;
+                PointCloud::VertexProperty<int> return_number_;
+                PointCloud::VertexProperty<int> number_of_returns_;
+                PointCloud::VertexProperty<double> gps_time_;
+            };
+
+
+            // decodes the point records of an uncompressed LAS file in parallel, directly from the mapped file
+            inline bool read_las_records(const std::string &file_name, const LasLayout &layout, std::size_t num,
+                                         std::size_t chunk_size, LasPointSink &sink) {
+                MemoryMappedFile file;
+                if (!file.open(file_name))
+                    return false;
+                if (file.size() < layout.offset() || (file.size() - layout.offset()) / layout.length() < num) {
+                    LOG(ERROR) << "file size does not match the number of points: " << file_name;
+                    return false;
+                }
+
+                const char *data = file.data() + layout.offset();
+                std::vector<LasRecord> records;
+                std::vector<unsigned char> keep;
+                ProgressLogger progress(num, true, false);
+                for (std::size_t start = 0; start < num; start += chunk_size) {
+                    if (progress.is_canceled()) {
+                        LOG(WARNING) << "loading point cloud file cancelled";
+                        return false;
+                    }
+                    progress.notify(start);
+                    const std::size_t n = std::min(chunk_size, num - start);
+                    records.resize(n);
+                    keep.resize(n);
+                    parallel::for_each(0, n, [&](std::size_t i) {
+                        layout.decode(data + (start + i) * layout.length(), records[i]);
+                        keep[i] = sink.accept(records[i]);
+                    });
+
+                    std::size_t kept = 0;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        if (keep[i])
+                            records[kept++] = records[i];
+                    }
+                    sink.append(records, kept);
+                }
+                return true;
             }
-            else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET) {
-                const dvec3 &origin = Translator::instance()->translation();
-                origin_x = origin.x;
-                origin_y = origin.y;
-                origin_z = origin.z;
-                translate = true;
+
+
+            // reads the points one by one by LASlib (e.g., from a compressed file) and appends them in chunks
+            inline bool read_las_points(LASreader *lasreader, std::size_t chunk_size, LasPointSink &sink) {
+                std::vector<LasRecord> records(chunk_size);
+                std::size_t kept = 0;
+                ProgressLogger progress(static_cast<std::size_t>(lasreader->npoints), true, false);
+                while (lasreader->read_point()) {
+                    decode(lasreader->point, records[kept]);
+                    if (sink.accept(records[kept]) && ++kept == chunk_size) {
+                        sink.append(records, kept);
+                        kept = 0;
+                    }
+                    if (lasreader->p_count % chunk_size == 0) {
+                        if (progress.is_canceled()) {
+                            LOG(WARNING) << "loading point cloud file cancelled";
+                            return false;
+                        }
+                        progress.notify(static_cast<std::size_t>(lasreader->p_count));
+                    }
+                }
+                sink.append(records, kept);
+                return true;
             }
 
-            float r = p0.have_rgb ? static_cast<float>(p0.get_R()) / USHRT_MAX : static_cast<float>(p0.intensity % 255) / 255.0f;
-            float g = p0.have_rgb ? static_cast<float>(p0.get_G()) / USHRT_MAX : static_cast<float>(p0.intensity % 255) / 255.0f;
-            float b = p0.have_rgb ? static_cast<float>(p0.get_B()) / USHRT_MAX : static_cast<float>(p0.intensity % 255) / 255.0f;
+        } // namespace internal
 
-            auto colors = cloud->add_vertex_property<vec3>("v:color");
-            auto classification = cloud->add_vertex_property<int>("v:classification");
-            auto v = cloud->add_vertex(vec3(float(x0 - origin_x), float(y0 - origin_y), float(z0 - origin_z)));
-            colors[v] = vec3(r, g, b);
-            classification[v] = p0.classification;
 
-            // now we read the remaining points...
-            while (lasreader->read_point()) {
-                LASpoint &p = lasreader->point;
+        bool load_las(const std::string &file_name, PointCloud *cloud) {
+            return load_las(file_name, cloud, LasOptions());
+        }
 
-                // compute the actual coordinates as double floating point values
-                p.compute_coordinates();
-                double x = p.coordinates[0] - origin_x;
-                double y = p.coordinates[1] - origin_y;
-                double z = p.coordinates[2] - origin_z;
-                v = cloud->add_vertex(vec3(float(x), float(y), float(z)));
 
-                r = p.have_rgb ? static_cast<float>(p.get_R()) / USHRT_MAX : static_cast<float>(p.intensity % 255) / 255.0f;
-                g = p.have_rgb ? static_cast<float>(p.get_G()) / USHRT_MAX : static_cast<float>(p.intensity % 255) / 255.0f;
-                b = p.have_rgb ? static_cast<float>(p.get_B()) / USHRT_MAX : static_cast<float>(p.intensity % 255) / 255.0f;
+        bool load_las(const std::string &file_name, PointCloud *cloud, const LasOptions &options) {
+            LASreadOpener lasreadopener;
+            lasreadopener.set_file_name(file_name.c_str(), true);
+
+            // skip the decompression of the attributes that are not needed (only for layered compressed files)
+            U32 selective = LASZIP_DECOMPRESS_SELECTIVE_CHANNEL_RETURNS_XY | LASZIP_DECOMPRESS_SELECTIVE_Z;
+            if (options.attributes & LasOptions::COLOR)
+                selective |= LASZIP_DECOMPRESS_SELECTIVE_RGB | LASZIP_DECOMPRESS_SELECTIVE_INTENSITY;
+            if ((options.attributes & LasOptions::CLASSIFICATION) || !options.classifications.empty())
+                selective |= LASZIP_DECOMPRESS_SELECTIVE_CLASSIFICATION;
+            if (options.attributes & LasOptions::INTENSITY)
+                selective |= LASZIP_DECOMPRESS_SELECTIVE_INTENSITY;
+            if (options.attributes & LasOptions::GPS_TIME)
+                selective |= LASZIP_DECOMPRESS_SELECTIVE_GPS_TIME;
+            lasreadopener.set_decompress_selective(selective);
 
-                colors[v] = vec3(r, g, b);
-                classification[v] = p.classification;
+            LASreader *lasreader = lasreadopener.open();
+            if (!lasreader || lasreader->npoints <= 0) {
+                LOG(ERROR) << "could not open file: " << file_name;
+                if (lasreader) {
+                    lasreader->close();
+                    delete lasreader;
+                }
+                return false;
             }
 
-            if (translate) {
-                auto trans = cloud->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
-                trans[0] = dvec3(x0, y0, z0);
+            const auto num = static_cast<std::size_t>(lasreader->npoints);
+            const std::size_t chunk_size = std::max<std::size_t>(options.chunk_size, 1);
+            LOG(INFO) << "reading " << num << " points...";
 
-                if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT)
-                    LOG(INFO) << "model translated w.r.t. the first vertex (" << trans[0]
-                              << "), stored as ModelProperty<dvec3>(\"translation\")";
-                else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET)
-                    LOG(INFO) << "model translated w.r.t. last known reference point (" << trans[0]
-                              << "), stored as ModelProperty<dvec3>(\"translation\")";
+            // the records of uncompressed LAS files can be decoded directly (the byte order of LAS is little endian)
+            const uint16_t endian_test = 1;
+            const internal::LasLayout layout(lasreader->header);
+            const bool direct = !lasreader->header.laszip && layout.valid() &&
+                                *reinterpret_cast<const char *>(&endian_test) == 1 &&
+                                file_system::extension(file_name) == "las";
+            const bool has_gps_time = direct ? layout.has_gps_time() : lasreader->point.have_gps_time;
+
+            internal::LasPointSink sink(cloud, options, has_gps_time);
+            if (!sink.filtering())
+                sink.reserve(num);
+
+            bool success = true;
+            if (direct) {
+                lasreader->close();
+                delete lasreader;
+                success = internal::read_las_records(file_name, layout, num, chunk_size, sink);
+            } else {
+                // LASlib skips the points outside the rectangle (using the spatial index if the file has one)
+                if (options.use_region)
+                    lasreader->inside_rectangle(options.region_min.x, options.region_min.y,
+                                                options.region_max.x, options.region_max.y);
+                success = internal::read_las_points(lasreader, chunk_size, sink);
+                lasreader->close();
+                delete lasreader;
             }
 
-            lasreader->close();
-            delete lasreader;
-            return cloud->n_vertices() > 0;
+            sink.finish();
+            if (sink.filtering())
+                LOG(INFO) << sink.num_points() << " (out of " << num << ") points loaded";
+            return success && cloud->n_vertices() > 0;
         }
 
 
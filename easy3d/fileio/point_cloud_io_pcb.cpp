@@ -0,0 +1,249 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/fileio/point_cloud_io_pcb.h>
+
+#include <easy3d/fileio/point_cloud_io.h>
+#include <easy3d/fileio/translator.h>
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/util/parallel.h>
+
+
+namespace easy3d {
+
+
+    namespace io {
+
+        /// \cond
+        namespace internal {
+
+            const char pcb_magic[8] = {'E', 'A', 'S', 'Y', '3', 'D', 'P', 'C'};
+
+            // the data blocks are aligned to the typical page size
+            const std::size_t pcb_block_alignment = 4096;
+
+            // creates (or gets) the vertex property 'name' of type T and resolves where its data goes
+            struct VertexPropertyCreator {
+                PointCloud *cloud;
+                const std::string &name;
+                MappedPointCloud::Destination destination;
+
+                template<typename T>
+                bool apply() {
+                    auto prop = cloud->vertex_property<T>(name);
+                    if (!prop)
+                        return false;
+                    std::vector<T> &values = prop.vector();
+                    destination.data = reinterpret_cast<char *>(values.data());
+                    destination.size = values.size() * sizeof(T);
+                    return true;
+                }
+            };
+            template<> bool VertexPropertyCreator::apply<bool>() { return false; }  // not stored
+
+            // collects the vertex property 'name' as a block if it is of type T
+            struct VertexBlockCollector {
+                const PointCloud *cloud;
+                const std::string &name;
+                std::vector<MappedPointCloud::Block> &blocks;
+
+                template<typename T>
+                bool apply() {
+                    if (cloud->get_vertex_property_type(name) != typeid(T))
+                        return false;
+                    const auto prop = cloud->get_vertex_property<T>(name);
+                    blocks.push_back({MappedPointCloud::VERTEX, name, MappedPointCloud::value_type<T>(), sizeof(T),
+                                      reinterpret_cast<const char *>(prop.vector().data()),
+                                      prop.vector().size() * sizeof(T)});
+                    return true;
+                }
+            };
+            template<> bool VertexBlockCollector::apply<bool>() { return false; }   // not stored
+        }
+        /// \endcond
+
+
+        bool MappedPointCloud::open(const std::string &file_name) {
+            if (!MappedPropertyFile::open(file_name, internal::pcb_magic, VERSION, "a pcb"))
+                return false;
+
+            if (version() < VERSION) {
+                LOG(ERROR) << "unsupported pcb version (" << version() << "), please re-create the file: " << file_name;
+                close();
+                return false;
+            }
+            for (const auto &prop : directory()) {
+                if (value_size<MappedPointCloud>(prop.type) != prop.element_size) {
+                    LOG(ERROR) << "corrupted pcb file (unexpected value size of " << element_name(prop.element)
+                               << " property '" << prop.name << "'): " << file_name;
+                    close();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+
+        const dvec3 *MappedPointCloud::translation_data() const {
+            return n_elements(MODEL) == 1 ? property<dvec3>(MODEL, "translation") : nullptr;
+        }
+
+
+        dvec3 MappedPointCloud::translation() const {
+            const dvec3 *trans = translation_data();
+            return trans ? *trans : dvec3(0, 0, 0);
+        }
+
+
+        bool MappedPointCloud::load_vertex_property(PointCloud *cloud, const std::string &name) const {
+            if (property_type(VERTEX, name) == UNKNOWN_TYPE) {
+                LOG(ERROR) << "vertex property '" << name << "' doesn't exist in file: " << file_name();
+                return false;
+            }
+            if (cloud->n_vertices() != n_vertices()) {
+                LOG(ERROR) << "the point cloud and the file have different numbers of vertices ("
+                           << cloud->n_vertices() << " vs. " << n_vertices() << ")";
+                return false;
+            }
+
+            // only the data block of this property is read
+            std::vector<Destination> destinations(directory().size(), Destination{nullptr, 0, nullptr});
+            for (std::size_t i = 0; i < directory().size(); ++i) {
+                const Property &prop = directory()[i];
+                if (prop.element != VERTEX || prop.name != name)
+                    continue;
+                internal::VertexPropertyCreator creator = {cloud, name, {nullptr, 0, nullptr}};
+                if (!visit(prop.type, creator)) {
+                    LOG(ERROR) << "vertex property '" << name << "' exists but has a different type";
+                    return false;
+                }
+                destinations[i] = creator.destination;
+            }
+            return read(destinations);
+        }
+
+
+        bool MappedPointCloud::save(const std::string &file_name, const PointCloud *cloud) {
+            std::vector<Block> blocks;
+            for (const auto &name : cloud->vertex_properties()) {
+                if (name.size() > MAX_NAME_LENGTH) {
+                    LOG(WARNING) << "vertex property '" << name << "' ignored (name too long)";
+                    continue;
+                }
+                internal::VertexBlockCollector collector = {cloud, name, blocks};
+                bool collected = false;
+                for (int t = CHAR; t <= MAT4 && !collected; ++t)
+                    collected = visit(static_cast<ValueType>(t), collector);
+                if (!collected && name != "v:deleted") // the deletion flags are not needed
+                    LOG(WARNING) << "vertex property '" << name << "' ignored (unsupported type)";
+            }
+
+            std::size_t num_elements[5] = {cloud->n_vertices(), 0, 0, 0, 0};
+            const auto trans = cloud->get_model_property<dvec3>("translation");
+            if (trans) {
+                blocks.push_back({MODEL, "translation", DVEC3, sizeof(dvec3),
+                                  reinterpret_cast<const char *>(trans.vector().data()), sizeof(dvec3)});
+                num_elements[MODEL] = 1;
+            }
+
+            return MappedPropertyFile::save(file_name, internal::pcb_magic, VERSION, internal::pcb_block_alignment,
+                                            num_elements, blocks, false);
+        }
+
+
+        bool load_pcb(const std::string &file_name, PointCloud *cloud) {
+            MappedPointCloud file;
+            if (!file.open(file_name))
+                return false;
+
+            if (file.n_vertices() == 0) {
+                LOG(ERROR) << "no point exists in file: " << file_name;
+                return false;
+            }
+            if (file.vertex_property_type("v:point") != MappedPointCloud::VEC3) {
+                LOG(ERROR) << "no points (i.e., vertex property 'v:point') in file: " << file_name;
+                return false;
+            }
+
+            cloud->resize(static_cast<unsigned int>(file.n_vertices()));
+            for (const auto &name : file.vertex_properties()) {
+                if (!file.load_vertex_property(cloud, name))
+                    return false;
+            }
+
+            // The translation is stored as metadata, so in most cases the points can be used as they are stored.
+            // Only if the translator requires a different translation, the points have to be shifted.
+            dvec3 origin = file.translation();
+            bool has_translation = file.has_translation();
+            std::vector<vec3> &points = cloud->points();
+            if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
+                if (!has_translation) {
+                    origin = dvec3(points[0].data());
+                    has_translation = true;
+                    const vec3 p0 = points[0];
+                    parallel::for_each(0, points.size(), [&](std::size_t i) { points[i] -= p0; });
+                }
+                Translator::instance()->set_translation(origin);
+                LOG(INFO) << "model translated w.r.t. the first vertex (" << origin
+                          << "), stored as ModelProperty<dvec3>(\"translation\")";
+            } else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET) {
+                const dvec3 &known = Translator::instance()->translation();
+                const vec3 shift(static_cast<float>(known.x - origin.x),
+                                 static_cast<float>(known.y - origin.y),
+                                 static_cast<float>(known.z - origin.z));
+                if (shift != vec3(0, 0, 0))
+                    parallel::for_each(0, points.size(), [&](std::size_t i) { points[i] -= shift; });
+                origin = known;
+                has_translation = true;
+                LOG(INFO) << "model translated w.r.t. last known reference point (" << origin
+                          << "), stored as ModelProperty<dvec3>(\"translation\")";
+            } else if (has_translation) {
+                // no translation is applied when the translator is disabled, so return the original coordinates
+                parallel::for_each(0, points.size(), [&](std::size_t i) {
+                    vec3 &p = points[i];
+                    p.x = static_cast<float>(p.x + origin.x);
+                    p.y = static_cast<float>(p.y + origin.y);
+                    p.z = static_cast<float>(p.z + origin.z);
+                });
+                has_translation = false;
+            }
+
+            if (has_translation) {
+                auto trans = cloud->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
+                trans[0] = origin;
+            }
+
+            return true;
+        }
+
+
+        bool save_pcb(const std::string &file_name, const PointCloud *cloud) {
+            return MappedPointCloud::save(file_name, cloud);
+        }
+
+    } // namespace io
+
+} // namespace easy3d
@@ -0,0 +1,133 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_FILEIO_POINT_CLOUD_IO_PCB_H
+#define EASY3D_FILEIO_POINT_CLOUD_IO_PCB_H
+
+#include <string>
+#include <vector>
+
+#include <easy3d/fileio/mapped_property_file.h>
+
+
+namespace easy3d {
+
+    class PointCloud;
+
+    namespace io {
+
+        /**
+         * \brief Read-only access to a point cloud stored in the chunked binary (\c pcb) format.
+         * \class MappedPointCloud easy3d/fileio/point_cloud_io_pcb.h
+         *
+         * \details The \c pcb format is designed to be memory mapped. A \c pcb file is a MappedPropertyFile with the
+         *      magic string "EASY3DPC", and its data blocks are aligned to 4096 bytes (i.e., a typical page size).
+         *
+         *      The points are stored w.r.t. a translation, which is stored as the model property "translation" (i.e.,
+         *      the translation is stored as metadata and it is not baked into the points).
+         *
+         *      Opening a \c pcb file only reads its header and property directory. The data of a property is paged
+         *      in by the operating system when it is accessed for the first time. So inspecting a single property
+         *      of a huge point cloud only touches the pages of that property.
+         *
+         *      Example usage:
+         *      \code
+         *      io::MappedPointCloud file;
+         *      if (file.open(file_name)) {
+         *          const float* intensities = file.vertex_property<float>("v:intensity");
+         *          if (intensities) {
+         *              // access intensities[0], ..., intensities[file.n_vertices() - 1]
+         *          }
+         *      }
+         *      \endcode
+         *
+         * \note Only vertex properties of the following types are stored: char, unsigned char, int, unsigned int,
+         *      float, double, vec2, vec3, vec4, dvec2, dvec3, dvec4, ivec2, ivec3, ivec4, mat3, and mat4. Properties
+         *      of other types are ignored. The version 1 files (with the translation in the header) are not supported.
+         */
+        class MappedPointCloud : public MappedPropertyFile {
+        public:
+            /// the current version of the \c pcb format.
+            static const uint32_t VERSION = 2;
+
+        public:
+            /// opens the \c pcb file \p file_name. Only the header and the property directory are read.
+            /// \return true on success.
+            bool open(const std::string &file_name);
+
+            /// returns the number of vertices stored in the file.
+            std::size_t n_vertices() const { return n_elements(VERTEX); }
+            /// returns whether the points are stored w.r.t. a translation.
+            bool has_translation() const { return translation_data() != nullptr; }
+            /// returns the translation of the points (i.e., the original coordinates are points + translation).
+            dvec3 translation() const;
+
+            /// returns the names of the vertex properties stored in the file.
+            std::vector<std::string> vertex_properties() const { return properties(VERTEX); }
+            /// returns the value type of the vertex property \p name (UNKNOWN_TYPE if it doesn't exist).
+            ValueType vertex_property_type(const std::string &name) const { return property_type(VERTEX, name); }
+
+            /**
+             * \brief Returns the data of the vertex property \p name.
+             * \details No data is copied: the returned pointer points to the mapped file and its pages are loaded
+             *      on first access. The pointer is valid until the file is closed.
+             * \return The pointer to the first value, or nullptr if the property doesn't exist or is of a
+             *      different type.
+             */
+            template<typename T>
+            const T *vertex_property(const std::string &name) const { return property<T>(VERTEX, name); }
+
+            /**
+             * \brief Copies the vertex property \p name to the point cloud \p cloud.
+             * \details The point cloud must have the same number of vertices as the file. An existing property with
+             *      the same name and type will be overwritten. The points ("v:point") are copied as they are stored,
+             *      i.e., w.r.t. translation(). The data block is checked (by its checksum).
+             * \return true on success.
+             */
+            bool load_vertex_property(PointCloud *cloud, const std::string &name) const;
+
+            /// \brief Saves a point cloud to a \c pcb file.
+            /// \details If the point cloud has the model property "translation" (of type dvec3), it is recorded as
+            ///     the translation of the points.
+            static bool save(const std::string &file_name, const PointCloud *cloud);
+
+            /// calls \c visitor.apply<T>() with the type \c T of the value type \p type (the types of the vertex
+            /// properties that can be stored, and dvec3 of the translation).
+            template<typename Visitor>
+            static bool visit(ValueType type, Visitor &visitor) {
+                return type != BOOL && MappedPropertyFile::visit(type, visitor);
+            }
+
+        private:
+            const dvec3 *translation_data() const;
+        };
+
+    } // namespace io
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_FILEIO_POINT_CLOUD_IO_PCB_H
@@ -50,20 +50,63 @@ namespace easy3d {
 				}
 			}
 
+
+			// gives access to the storage of the vertex properties (created if not existing)
+			struct CloudPropertyStorage {
+				PointCloud* cloud;
+				template <typename T> T* data(const std::string& name) const {
+					return cloud->vertex_property<T>(name).vector().data();
+				}
+			};
+
+
+			// Reads a binary PLY file in bulk: the values are copied from the mapped file directly into the properties
+			// of the point cloud. Returns false (without touching the point cloud) if the file is not binary or it has
+			// data that only PlyReader can handle, e.g., other elements and list properties. Returns false (and the
+			// point cloud is cleared) if reading the values fails.
+			bool load_ply_bulk(const std::string& file_name, PointCloud* cloud)
+			{
+				BinaryPlyReader reader;
+				if (!reader.open(file_name))
+					return false;
+
+				const BinaryPlyReader::ElementLayout* element_vertex = reader.element("vertex");
+				if (!element_vertex || element_vertex->num_instances == 0)
+					return false;
+				for (const auto& e : reader.elements()) {
+					if (e.num_instances > 0 && e.name != "vertex")
+						return false;
+					for (const auto& p : e.properties) {
+						if (p.is_list)
+							return false;
+					}
+				}
+
+				cloud->resize(static_cast<unsigned int>(element_vertex->num_instances));
+				if (!reader.read_fields(*element_vertex, "v:", CloudPropertyStorage{cloud})) {
+					LOG(ERROR) << "failed reading the vertex properties: " << file_name;
+					cloud->clear();
+					return false;
+				}
+				return true;
+			}
+
 		} // namespace internal
 
 		bool load_ply(const std::string& file_name, PointCloud* cloud) {
 			std::vector<Element> elements;
-			PlyReader reader;
-			if (!reader.read(file_name, elements))
-				return false;
-
-            for (const auto& e : elements) {
-                if (e.name == "vertex") {
-                    cloud->resize(static_cast<unsigned int>(e.num_instances));
-                    break;
-                }
-            }
+			if (!internal::load_ply_bulk(file_name, cloud)) {
+				PlyReader reader;
+				if (!reader.read(file_name, elements))
+					return false;
+
+				for (const auto& e : elements) {
+					if (e.name == "vertex") {
+						cloud->resize(static_cast<unsigned int>(e.num_instances));
+						break;
+					}
+				}
+			}
 
             for (const auto& e : elements) {
                 if (e.name == "vertex") {
@@ -27,10 +27,13 @@
 #include <easy3d/fileio/point_cloud_io.h>
 
 #include <fstream>
+#include <algorithm>
 
 #include <easy3d/fileio/translator.h>
 #include <easy3d/core/point_cloud.h>
-#include <easy3d/util/line_stream.h>
+#include <easy3d/util/memory_mapped_file.h>
+#include <easy3d/util/text_scanner.h>
+#include <easy3d/util/parallel.h>
 #include <easy3d/util/logging.h>
 #include <easy3d/util/progress.h>
 
@@ -41,63 +44,76 @@ namespace easy3d {
 	namespace io {
 
 		bool load_xyz(const std::string& file_name, PointCloud* cloud) {
-			std::ifstream input(file_name.c_str());
-			if (input.fail()) {
-                LOG(ERROR) << "could not open file: " << file_name;
-				return false;
-			}
-
-			io::LineInputStream in(input);
+            MemoryMappedFile file;
+            if (!file.open(file_name))
+                return false;
 
-			// get length of file
-            input.seekg(0, input.end);
-            std::streamoff length = input.tellg();
-            input.seekg(0, input.beg);
-            ProgressLogger progress(length, true, false);
-
-			dvec3 v;
-            std::vector<dvec3> points;
-			while (!input.eof()) {
-			    if (progress.is_canceled()) {
-                    LOG(WARNING) << "saving point cloud file cancelled";
+            // The text is split at line boundaries into chunks that are parsed in parallel. The chunks are processed
+            // in rounds, so the progress can be reported (and the loading can be canceled) from the calling thread.
+            const std::size_t chunk_size = 4 * 1024 * 1024;
+            const std::vector<const char*> chunks = split_lines(file.data(), file.data() + file.size(), file.size() / chunk_size + 1);
+            const std::size_t num_chunks = chunks.size() - 1;
+            std::vector< std::vector<dvec3> > chunk_points(num_chunks);
+
+            ProgressLogger progress(num_chunks, true, false);
+            const std::size_t round_size = parallel::num_threads() * 4;
+            for (std::size_t round = 0; round < num_chunks; round += round_size) {
+                if (progress.is_canceled()) {
+                    LOG(WARNING) << "loading point cloud file cancelled";
                     return false;
                 }
-				in.get_line();
-				if (in.current_line()[0] != '#') {
-					in >> v;
-					if (!in.fail()) {
-                        points.push_back(v);
-                        std::streamoff pos = input.tellg();
-                        progress.notify(pos);
-					}
-				}
-			}
-
-            if (Translator::instance()->status() == Translator::DISABLED) {
-                for (const auto& p : points)
-                    cloud->add_vertex(vec3(p.data()));
+                const std::size_t round_end = std::min(round + round_size, num_chunks);
+                parallel::for_each(round, round_end, [&](std::size_t c) {
+                    TextScanner scanner(chunks[c], chunks[c + 1]);
+                    std::vector<dvec3>& points = chunk_points[c];
+                    dvec3 p;
+                    while (scanner.next_line()) {
+                        if (*scanner.line_begin() == '#')
+                            continue;
+                        if (scanner.read(p.x) && scanner.read(p.y) && scanner.read(p.z))
+                            points.push_back(p);
+                    }
+                }, 1);
+                progress.notify(round_end);
             }
-            else if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
-                dvec3 origin = points[0];
-                Translator::instance()->set_translation(origin);
 
-                for (const auto &p: points)
-                    cloud->add_vertex(vec3(static_cast<float>(p.x - origin.x), static_cast<float>(p.y - origin.y), static_cast<float>(p.z - origin.z)));
-                auto trans = cloud->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
-                trans[0] = origin;
+            std::vector<std::size_t> offsets(num_chunks + 1, 0);
+            for (std::size_t c = 0; c < num_chunks; ++c)
+                offsets[c + 1] = offsets[c] + chunk_points[c].size();
+            if (offsets[num_chunks] == 0)
+                return false;
+
+            dvec3 origin(0, 0, 0);
+            if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
+                for (const auto& points : chunk_points) {
+                    if (!points.empty()) {
+                        origin = points[0];
+                        break;
+                    }
+                }
+                Translator::instance()->set_translation(origin);
                 LOG(INFO) << "model translated w.r.t. the first vertex (" << origin
                           << "), stored as ModelProperty<dvec3>(\"translation\")";
             }
             else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET) {
-                const dvec3 &origin = Translator::instance()->translation();
-                for (const auto &p: points)
-                    cloud->add_vertex(vec3(static_cast<float>(p.x - origin.x), static_cast<float>(p.y - origin.y), static_cast<float>(p.z - origin.z)));
-                auto trans = cloud->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
-                trans[0] = origin;
+                origin = Translator::instance()->translation();
                 LOG(INFO) << "model translated w.r.t. last known reference point (" << origin
                           << "), stored as ModelProperty<dvec3>(\"translation\")";
             }
 
+            cloud->resize(static_cast<unsigned int>(offsets[num_chunks]));
+            std::vector<vec3>& points = cloud->points();
+            parallel::for_each(0, num_chunks, [&](std::size_t c) {
+                vec3* dest = points.data() + offsets[c];
+                for (const auto& p : chunk_points[c])
+                    *dest++ = vec3(static_cast<float>(p.x - origin.x), static_cast<float>(p.y - origin.y), static_cast<float>(p.z - origin.z));
+            }, 1);
+
+            if (Translator::instance()->status() != Translator::DISABLED) {
+                auto trans = cloud->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
+                trans[0] = origin;
+            }
+
             return cloud->n_vertices() > 0;
 		}
 
@@ -0,0 +1,626 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/fileio/point_cloud_writer.h>
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/fileio/ply_reader_writer.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/parallel.h>
+#include <easy3d/util/logging.h>
+#include <3rd_party/lastools/LASlib/inc/laswriter.hpp>
+
+
+namespace easy3d {
+
+    namespace io {
+
+        namespace internal {
+
+            // a batch of points (in their original coordinates) and the attributes being written
+            struct PointBatch {
+                std::vector<dvec3> points;
+                std::vector<vec3> normals;
+                std::vector<vec3> colors;
+                std::vector<int> intensities;
+                std::vector<int> classifications;
+            };
+
+
+            // a binary output file with a write buffer
+            class BufferedFile {
+            public:
+                explicit BufferedFile(std::size_t capacity)
+                        : capacity_(std::max<std::size_t>(capacity, 64)), buffer_(new char[capacity_]), size_(0) {}
+
+                bool open(const std::string &file_name) {
+                    file_.open(file_name.c_str(), std::ios::binary | std::ios::trunc);
+                    return file_.is_open();
+                }
+
+                void write(const void *data, std::size_t size) {
+                    if (size_ + size > capacity_)
+                        flush();
+                    if (size > capacity_) {
+                        file_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+                        return;
+                    }
+                    std::memcpy(buffer_.get() + size_, data, size);
+                    size_ += size;
+                }
+
+                template<typename T>
+                void write(const T &value) { write(&value, sizeof(T)); }
+
+                void flush() {
+                    if (size_ > 0) {
+                        file_.write(buffer_.get(), static_cast<std::streamsize>(size_));
+                        size_ = 0;
+                    }
+                }
+
+                // overwrites the bytes starting at offset (e.g., to complete the header)
+                bool patch(std::streamoff offset, const void *data, std::size_t size) {
+                    flush();
+                    const std::streampos end = file_.tellp();
+                    file_.seekp(offset);
+                    file_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+                    file_.seekp(end);
+                    return file_.good();
+                }
+
+                // appends the content of another file
+                bool append_file(const std::string &file_name) {
+                    flush();
+                    std::ifstream input(file_name.c_str(), std::ios::binary);
+                    if (input.fail())
+                        return false;
+                    while (input) {
+                        input.read(buffer_.get(), static_cast<std::streamsize>(capacity_));
+                        file_.write(buffer_.get(), input.gcount());
+                    }
+                    return file_.good();
+                }
+
+                bool good() const { return file_.good(); }
+
+                bool close() {
+                    flush();
+                    const bool success = file_.good();
+                    file_.close();
+                    return success;
+                }
+
+            private:
+                std::ofstream file_;
+                std::size_t capacity_;
+                std::unique_ptr<char[]> buffer_;
+                std::size_t size_;
+            };
+
+
+            // the format-specific part of the writer
+            class PointStream {
+            public:
+                virtual ~PointStream() = default;
+                virtual bool write(const PointBatch &batch) = 0;
+                virtual bool close(std::size_t num_points) = 0;
+            };
+
+
+            // xyz: one point per line
+            class XyzStream : public PointStream {
+            public:
+                explicit XyzStream(std::size_t buffer_size) : file_(buffer_size) {}
+
+                bool open(const std::string &file_name) { return file_.open(file_name); }
+
+                bool write(const PointBatch &batch) override {
+                    char line[128];
+                    for (const auto &p : batch.points) {
+                        const int length = std::snprintf(line, sizeof(line), "%.16g %.16g %.16g\n", p.x, p.y, p.z);
+                        file_.write(line, static_cast<std::size_t>(length));
+                    }
+                    return file_.good();
+                }
+
+                bool close(std::size_t) override { return file_.close(); }
+
+            private:
+                BufferedFile file_;
+            };
+
+
+            // bxyz: the coordinates (as floats) of the points
+            class BxyzStream : public PointStream {
+            public:
+                explicit BxyzStream(std::size_t buffer_size) : file_(buffer_size) {}
+
+                bool open(const std::string &file_name) { return file_.open(file_name); }
+
+                bool write(const PointBatch &batch) override {
+                    for (const auto &p : batch.points)
+                        file_.write(vec3(static_cast<float>(p.x), static_cast<float>(p.y), static_cast<float>(p.z)));
+                    return file_.good();
+                }
+
+                bool close(std::size_t) override { return file_.close(); }
+
+            private:
+                BufferedFile file_;
+            };
+
+
+            // bin: three blocks storing the points, colors, and normals, each preceded by the number of its values.
+            // The points are written to the file directly and the other blocks are spooled into temporary files.
+            class BinStream : public PointStream {
+            public:
+                BinStream(std::size_t buffer_size, bool has_colors, bool has_normals)
+                        : file_(buffer_size), has_colors_(has_colors), has_normals_(has_normals) {
+                    if (has_colors_)
+                        colors_.reset(new BufferedFile(buffer_size));
+                    if (has_normals_)
+                        normals_.reset(new BufferedFile(buffer_size));
+                }
+
+                bool open(const std::string &file_name) {
+                    file_name_ = file_name;
+                    if (!file_.open(file_name))
+                        return false;
+                    if (colors_ && !colors_->open(file_name + ".colors.tmp"))
+                        return false;
+                    if (normals_ && !normals_->open(file_name + ".normals.tmp"))
+                        return false;
+                    file_.write(0);    // the number of points (patched when closing)
+                    return true;
+                }
+
+                bool write(const PointBatch &batch) override {
+                    for (const auto &p : batch.points)
+                        file_.write(vec3(static_cast<float>(p.x), static_cast<float>(p.y), static_cast<float>(p.z)));
+                    if (colors_)
+                        colors_->write(batch.colors.data(), batch.colors.size() * sizeof(vec3));
+                    if (normals_)
+                        normals_->write(batch.normals.data(), batch.normals.size() * sizeof(vec3));
+                    return file_.good() && (!colors_ || colors_->good()) && (!normals_ || normals_->good());
+                }
+
+                bool close(std::size_t num_points) override {
+                    bool success = true;
+                    if (num_points > static_cast<std::size_t>(INT_MAX)) {
+                        LOG(ERROR) << "too many points for the bin format: " << num_points;
+                        success = false;
+                    }
+
+                    const int num = static_cast<int>(std::min<std::size_t>(num_points, INT_MAX));
+                    success = file_.patch(0, &num, sizeof(int)) && success;
+                    success = append_block(colors_.get(), file_name_ + ".colors.tmp", num) && success;
+                    success = append_block(normals_.get(), file_name_ + ".normals.tmp", num) && success;
+                    return file_.close() && success;
+                }
+
+            private:
+                bool append_block(BufferedFile *block, const std::string &block_file, int num) {
+                    if (!block) {
+                        file_.write(0);
+                        return true;
+                    }
+                    const bool success = block->close();
+                    file_.write(num);
+                    const bool appended = file_.append_file(block_file);
+                    file_system::delete_file(block_file);
+                    return success && appended;
+                }
+
+            private:
+                std::string file_name_;
+                BufferedFile file_;
+                bool has_colors_;
+                bool has_normals_;
+                std::unique_ptr<BufferedFile> colors_;
+                std::unique_ptr<BufferedFile> normals_;
+            };
+
+
+            // binary ply (in the native byte order). The number of points in the header is padded with spaces, so it
+            // can be overwritten when closing.
+            class PlyStream : public PointStream {
+            public:
+                PlyStream(std::size_t buffer_size, unsigned int attributes)
+                        : file_(buffer_size), attributes_(attributes), count_offset_(0) {}
+
+                bool open(const std::string &file_name) {
+                    if (!file_.open(file_name))
+                        return false;
+
+                    std::string header = "ply\n";
+                    header += is_big_endian() ? "format binary_big_endian 1.0\n" : "format binary_little_endian 1.0\n";
+                    header += "comment Saved by Easy3D (liangliang.nan@gmail.com)\n";
+                    header += "element vertex ";
+                    count_offset_ = static_cast<std::streamoff>(header.size());
+                    header += std::string(20, ' ') + "\n";    // enough for any 64-bit number
+                    header += "property float x\nproperty float y\nproperty float z\n";
+                    if (attributes_ & PointCloudWriter::NORMAL)
+                        header += "property float nx\nproperty float ny\nproperty float nz\n";
+                    if (attributes_ & PointCloudWriter::COLOR)
+                        header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+                    if (attributes_ & PointCloudWriter::INTENSITY)
+                        header += "property int intensity\n";
+                    if (attributes_ & PointCloudWriter::CLASSIFICATION)
+                        header += "property int classification\n";
+                    header += "end_header\n";
+
+                    header[count_offset_] = '0';
+                    file_.write(header.data(), header.size());
+                    return file_.good();
+                }
+
+                bool write(const PointBatch &batch) override {
+                    for (std::size_t i = 0; i < batch.points.size(); ++i) {
+                        const dvec3 &p = batch.points[i];
+                        file_.write(vec3(static_cast<float>(p.x), static_cast<float>(p.y), static_cast<float>(p.z)));
+                        if (attributes_ & PointCloudWriter::NORMAL)
+                            file_.write(batch.normals[i]);
+                        if (attributes_ & PointCloudWriter::COLOR) {
+                            const vec3 &c = batch.colors[i];
+                            const unsigned char rgb[3] = {
+                                    static_cast<unsigned char>(c.x * 255),
+                                    static_cast<unsigned char>(c.y * 255),
+                                    static_cast<unsigned char>(c.z * 255)
+                            };
+                            file_.write(rgb, 3);
+                        }
+                        if (attributes_ & PointCloudWriter::INTENSITY)
+                            file_.write(batch.intensities[i]);
+                        if (attributes_ & PointCloudWriter::CLASSIFICATION)
+                            file_.write(batch.classifications[i]);
+                    }
+                    return file_.good();
+                }
+
+                bool close(std::size_t num_points) override {
+                    const std::string count = std::to_string(num_points);
+                    const bool success = file_.patch(count_offset_, count.data(), count.size());
+                    return file_.close() && success;
+                }
+
+            private:
+                BufferedFile file_;
+                unsigned int attributes_;
+                std::streamoff count_offset_;
+            };
+
+
+            // las/laz by LASlib, which buffers the points and completes the header when closing
+            class LasStream : public PointStream {
+            public:
+                explicit LasStream(unsigned int attributes) : attributes_(attributes), laswriter_(nullptr) {}
+
+                ~LasStream() override {
+                    if (laswriter_) {
+                        laswriter_->close();
+                        delete laswriter_;
+                    }
+                }
+
+                bool open(const std::string &file_name, const dvec3 &origin, double scale) {
+                    if (!(scale > 0)) {
+                        LOG(ERROR) << "invalid scale factor for the las/laz format: " << scale;
+                        return false;
+                    }
+
+                    LASwriteOpener laswriteopener;
+                    laswriteopener.set_file_name(file_name.c_str());
+                    if (!laswriteopener.active())
+                        return false;
+
+                    lasheader_.x_scale_factor = lasheader_.y_scale_factor = lasheader_.z_scale_factor = scale;
+                    lasheader_.x_offset = origin.x;
+                    lasheader_.y_offset = origin.y;
+                    lasheader_.z_offset = origin.z;
+                    if (attributes_ & PointCloudWriter::COLOR) {
+                        lasheader_.point_data_format = 2;
+                        lasheader_.point_data_record_length = 26;
+                    } else {
+                        lasheader_.point_data_format = 0;
+                        lasheader_.point_data_record_length = 20;
+                    }
+                    laspoint_.init(&lasheader_, lasheader_.point_data_format, lasheader_.point_data_record_length, nullptr);
+
+                    laswriter_ = laswriteopener.open(&lasheader_);
+                    return laswriter_ != nullptr;
+                }
+
+                bool write(const PointBatch &batch) override {
+                    // the coordinates are stored as 32-bit integers (relative to the offset and in units of the scale
+                    // factor). Reject the whole batch if any of them does not fit, instead of letting them wrap around.
+                    for (const auto &p : batch.points) {
+                        if (!fits_int32(p.x, lasheader_.x_offset, lasheader_.x_scale_factor) ||
+                            !fits_int32(p.y, lasheader_.y_offset, lasheader_.y_scale_factor) ||
+                            !fits_int32(p.z, lasheader_.z_offset, lasheader_.z_scale_factor)) {
+                            LOG(ERROR) << "point (" << p << ") is too far from the origin (" << lasheader_.x_offset
+                                       << " " << lasheader_.y_offset << " " << lasheader_.z_offset
+                                       << ") to be stored with a scale factor of " << lasheader_.x_scale_factor
+                                       << " (choose a closer origin or a larger scale factor)";
+                            return false;
+                        }
+                    }
+
+                    for (std::size_t i = 0; i < batch.points.size(); ++i) {
+                        const dvec3 &p = batch.points[i];
+                        laspoint_.coordinates[0] = p.x;
+                        laspoint_.coordinates[1] = p.y;
+                        laspoint_.coordinates[2] = p.z;
+                        laspoint_.compute_XYZ();
+                        if (attributes_ & PointCloudWriter::COLOR) {
+                            const vec3 &c = batch.colors[i];
+                            laspoint_.set_R(static_cast<unsigned short>(c.x * USHRT_MAX));
+                            laspoint_.set_G(static_cast<unsigned short>(c.y * USHRT_MAX));
+                            laspoint_.set_B(static_cast<unsigned short>(c.z * USHRT_MAX));
+                        }
+                        if (attributes_ & PointCloudWriter::INTENSITY)
+                            laspoint_.set_intensity(static_cast<U16>(std::min(std::max(batch.intensities[i], 0), USHRT_MAX)));
+                        if (attributes_ & PointCloudWriter::CLASSIFICATION) // the legacy point formats have 32 classes
+                            laspoint_.set_classification(static_cast<U8>(std::min(std::max(batch.classifications[i], 0), 31)));
+                        if (!laswriter_->write_point(&laspoint_))
+                            return false;
+                        laswriter_->update_inventory(&laspoint_);
+                    }
+                    return true;
+                }
+
+                bool close(std::size_t) override {
+                    laswriter_->update_header(&lasheader_, TRUE);
+                    const I64 bytes = laswriter_->close();
+                    delete laswriter_;
+                    laswriter_ = nullptr;
+                    return bytes > 0;
+                }
+
+            private:
+                // whether the quantized value of coordinate \p v (as computed by LASquantizer) fits in an I32
+                static bool fits_int32(double v, double offset, double scale) {
+                    const double q = (v - offset) / scale;
+                    return q >= static_cast<double>(INT_MIN) - 0.5 && q < static_cast<double>(INT_MAX) + 0.5;
+                }
+
+            private:
+                unsigned int attributes_;
+                LASheader lasheader_;
+                LASpoint laspoint_;
+                LASwriter *laswriter_;
+            };
+
+        } // namespace internal
+
+
+        PointCloudWriter::PointCloudWriter()
+                : buffer_size_(1 << 22)
+                , background_(false)
+                , las_scale_(0.001)
+                , attributes_(0)
+                , origin_(0, 0, 0)
+                , num_points_(0)
+                , failed_(false)
+                , stream_(nullptr)
+                , pool_(nullptr)
+        {
+        }
+
+
+        PointCloudWriter::~PointCloudWriter() {
+            if (stream_)
+                close();
+        }
+
+
+        bool PointCloudWriter::open(const std::string &file_name, unsigned int attributes, const dvec3 &origin) {
+            if (stream_) {
+                LOG(ERROR) << "a file is already open: " << file_name_;
+                return false;
+            }
+
+            const std::string &ext = file_system::extension(file_name, true);
+            unsigned int supported = 0;
+            if (ext == "ply")
+                supported = NORMAL | COLOR | INTENSITY | CLASSIFICATION;
+            else if (ext == "bin")
+                supported = NORMAL | COLOR;
+            else if (ext == "las" || ext == "laz")
+                supported = COLOR | INTENSITY | CLASSIFICATION;
+            else if (ext != "xyz" && ext != "bxyz") {
+                LOG(ERROR) << "unknown file format for writing points incrementally: " << ext;
+                return false;
+            }
+            LOG_IF((attributes & ~supported) != 0, WARNING)
+                    << "some of the requested attributes are not supported by the " << ext << " format (ignored)";
+            attributes &= supported;
+
+            internal::PointStream *stream = nullptr;
+            bool success = false;
+            if (ext == "ply") {
+                auto ply = new internal::PlyStream(buffer_size_, attributes);
+                success = ply->open(file_name);
+                stream = ply;
+            } else if (ext == "bin") {
+                auto bin = new internal::BinStream(buffer_size_, attributes & COLOR, attributes & NORMAL);
+                success = bin->open(file_name);
+                stream = bin;
+            } else if (ext == "las" || ext == "laz") {
+                auto las = new internal::LasStream(attributes);
+                success = las->open(file_name, origin, las_scale_);
+                stream = las;
+            } else if (ext == "xyz") {
+                auto xyz = new internal::XyzStream(buffer_size_);
+                success = xyz->open(file_name);
+                stream = xyz;
+            } else {
+                auto bxyz = new internal::BxyzStream(buffer_size_);
+                success = bxyz->open(file_name);
+                stream = bxyz;
+            }
+
+            if (!success) {
+                LOG(ERROR) << "could not create file: " << file_name;
+                delete stream;
+                return false;
+            }
+
+            stream_ = stream;
+            file_name_ = file_name;
+            attributes_ = attributes;
+            origin_ = origin;
+            num_points_ = 0;
+            failed_ = false;
+            if (background_)
+                pool_ = new ThreadPool(2);  // one worker thread
+            return true;
+        }
+
+
+        bool PointCloudWriter::append(std::size_t num, const vec3 *points, const vec3 *normals, const vec3 *colors,
+                                      const int *intensities, const int *classifications) {
+            return append(origin_, num, points, normals, colors, intensities, classifications);
+        }
+
+
+        bool PointCloudWriter::append(const PointCloud *cloud) {
+            if (!cloud) {
+                LOG(ERROR) << "null input point cloud pointer";
+                return false;
+            }
+
+            auto trans = cloud->get_model_property<dvec3>("translation");
+            auto normals = cloud->get_vertex_property<vec3>("v:normal");
+            auto colors = cloud->get_vertex_property<vec3>("v:color");
+            auto intensities = cloud->get_vertex_property<int>("v:intensity");
+            auto classifications = cloud->get_vertex_property<int>("v:classification");
+            return append(trans ? trans[0] : dvec3(0, 0, 0), cloud->n_vertices(), cloud->points().data(),
+                          normals ? normals.data() : nullptr,
+                          colors ? colors.data() : nullptr,
+                          intensities ? intensities.data() : nullptr,
+                          classifications ? classifications.data() : nullptr);
+        }
+
+
+        namespace internal {
+            template<typename T>
+            inline void copy_attribute(std::vector<T> &values, std::size_t num, const T *data) {
+                if (data)
+                    values.assign(data, data + num);
+                else
+                    values.assign(num, T());
+            }
+        }
+
+
+        bool PointCloudWriter::append(const dvec3 &translation, std::size_t num, const vec3 *points,
+                                      const vec3 *normals, const vec3 *colors, const int *intensities,
+                                      const int *classifications) {
+            if (!stream_) {
+                LOG(ERROR) << "no file is open for writing";
+                return false;
+            }
+            if (num == 0)
+                return !failed_;
+            if (!points) {
+                LOG(ERROR) << "null input points pointer";
+                return false;
+            }
+
+            // copy the batch, so the caller can reuse its arrays (and the batch can be written in the background)
+            auto batch = std::make_shared<internal::PointBatch>();
+            batch->points.resize(num);
+            for (std::size_t i = 0; i < num; ++i) {
+                const vec3 &p = points[i];
+                batch->points[i] = dvec3(p.x + translation.x, p.y + translation.y, p.z + translation.z);
+            }
+            if (attributes_ & NORMAL)
+                internal::copy_attribute(batch->normals, num, normals);
+            if (attributes_ & COLOR)
+                internal::copy_attribute(batch->colors, num, colors);
+            if (attributes_ & INTENSITY)
+                internal::copy_attribute(batch->intensities, num, intensities);
+            if (attributes_ & CLASSIFICATION)
+                internal::copy_attribute(batch->classifications, num, classifications);
+
+            num_points_ += num;
+            return write(batch);
+        }
+
+
+        bool PointCloudWriter::write(const std::shared_ptr<internal::PointBatch> &batch) {
+            if (!pool_) {
+                if (!stream_->write(*batch))
+                    failed_ = true;
+            } else {
+                // the batches are written in order, one at a time
+                wait();
+                internal::PointStream *stream = stream_;
+                pending_ = pool_->async([stream, batch]() -> bool { return stream->write(*batch); });
+            }
+            LOG_IF(failed_, ERROR) << "failed writing points to file: " << file_name_;
+            return !failed_;
+        }
+
+
+        bool PointCloudWriter::wait() {
+            if (pending_.valid() && !pending_.get())
+                failed_ = true;
+            return !failed_;
+        }
+
+
+        bool PointCloudWriter::close() {
+            if (!stream_) {
+                LOG(ERROR) << "no file is open for writing";
+                return false;
+            }
+
+            wait();
+            delete pool_;
+            pool_ = nullptr;
+
+            const bool success = stream_->close(num_points_) && !failed_;
+            delete stream_;
+            stream_ = nullptr;
+
+            if (success)
+                LOG(INFO) << num_points_ << " points written to file: " << file_name_;
+            else
+                LOG(ERROR) << "failed writing points to file: " << file_name_;
+            return success;
+        }
+
+    } // namespace io
+
+} // namespace easy3d
@@ -0,0 +1,170 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_FILEIO_POINT_CLOUD_WRITER_H
+#define EASY3D_FILEIO_POINT_CLOUD_WRITER_H
+
+#include <string>
+#include <memory>
+#include <future>
+
+#include <easy3d/core/types.h>
+
+
+namespace easy3d {
+
+    class PointCloud;
+    class ThreadPool;
+
+    namespace io {
+
+        namespace internal {
+            class PointStream;
+            struct PointBatch;
+        }
+
+        /**
+         * \brief Writes a point cloud to a file incrementally, i.e., without having the whole point cloud in memory.
+         * \class PointCloudWriter easy3d/fileio/point_cloud_writer.h
+         *
+         * \details The points are appended in batches (e.g., as they are produced by a scanner or a sampler), and
+         *      only the points of the current batch and the write buffer are kept in memory. The file format is
+         *      determined by the file extension:
+         *      - \c ply: binary PLY. The number of points in the header is patched when the writer is closed.
+         *      - \c las/laz: the header (number of points, bounding box) is updated when the writer is closed.
+         *      - \c xyz/bxyz: only the coordinates are written.
+         *      - \c bin: the colors and normals are spooled into temporary files and appended when the writer is
+         *        closed.
+         *
+         *      The attributes to be written are specified when the file is opened, because the header/layout of most
+         *      formats depends on them. An attribute not supported by the format is ignored (with a warning).
+         *
+         *      With background flushing, the batches are encoded and written to the file by a worker thread while
+         *      the calling thread produces the next batch.
+         *
+         *      Example usage:
+         *      \code
+         *      io::PointCloudWriter writer;
+         *      writer.set_background_flushing(true);
+         *      if (writer.open("scan.ply", io::PointCloudWriter::COLOR)) {
+         *          while (scanner.has_more())
+         *              writer.append(num, points, nullptr, colors);
+         *          writer.close();
+         *      }
+         *      \endcode
+         */
+        class PointCloudWriter {
+        public:
+            /// \brief The optional per-point attributes (combined by bitwise OR).
+            enum Attribute {
+                NORMAL = 1,         ///< supported by ply and bin
+                COLOR = 2,          ///< values in [0, 1]. Supported by ply, bin, and las/laz
+                INTENSITY = 4,      ///< supported by ply and las/laz
+                CLASSIFICATION = 8  ///< supported by ply and las/laz
+            };
+
+        public:
+            PointCloudWriter();
+            /// Closes the file if it is still open.
+            ~PointCloudWriter();
+
+            /// Sets the size (in bytes) of the write buffer. Default is 4 MB. Must be called before open().
+            void set_buffer_size(std::size_t size) { buffer_size_ = size; }
+            /// Enables/Disables writing the batches by a worker thread. Default is false. Must be called before open().
+            void set_background_flushing(bool b) { background_ = b; }
+            /// Sets the scale factor of the coordinates in \c las/laz files. Default is 0.001 (i.e., a millimeter if
+            /// the unit is a meter). Must be called before open(). The coordinates are stored as 32-bit integers
+            /// relative to the origin, so with the default scale the points must be within about 2.1e6 units of the
+            /// origin. A batch having a point out of this range is rejected (and the writer fails).
+            void set_las_scale(double scale) { las_scale_ = scale; }
+
+            /**
+             * \brief Creates the file \p file_name for writing.
+             * \param attributes The attributes to be written in addition to the coordinates, e.g., NORMAL | COLOR.
+             * \param origin The translation of the points, i.e., the original coordinates of the appended points are
+             *      the points + \p origin (see the "translation" model property of PointCloud).
+             * \return true on success.
+             */
+            bool open(const std::string &file_name, unsigned int attributes = 0, const dvec3 &origin = dvec3(0, 0, 0));
+            /// Returns whether a file is open.
+            bool is_open() const { return stream_ != nullptr; }
+
+            /**
+             * \brief Appends a batch of \p num points.
+             * \details The attributes are provided as arrays of \p num values. An attribute that has been requested in
+             *      open() but is not provided (i.e., nullptr) is written as zeros. The arrays are copied (or encoded)
+             *      before this function returns, so they can be reused for the next batch.
+             * \return false if writing has failed (in background mode, a failure may be reported by the next call).
+             */
+            bool append(std::size_t num, const vec3 *points, const vec3 *normals = nullptr,
+                        const vec3 *colors = nullptr, const int *intensities = nullptr,
+                        const int *classifications = nullptr);
+            /// Appends all points of \p cloud, together with its "v:normal", "v:color", "v:intensity", and
+            /// "v:classification" properties (if they exist). The "translation" of \p cloud is taken into account.
+            bool append(const PointCloud *cloud);
+
+            /// Writes the remaining data, completes the header, and closes the file.
+            /// \return true if all points have been successfully written.
+            bool close();
+
+            /// Returns the number of points appended so far.
+            std::size_t num_points() const { return num_points_; }
+            /// Returns the attributes that are being written (i.e., requested and supported by the format).
+            unsigned int attributes() const { return attributes_; }
+
+        private:
+            // the original coordinates of the points are points + translation
+            bool append(const dvec3 &translation, std::size_t num, const vec3 *points, const vec3 *normals,
+                        const vec3 *colors, const int *intensities, const int *classifications);
+            bool write(const std::shared_ptr<internal::PointBatch> &batch);
+            bool wait();
+
+        private:
+            std::size_t buffer_size_;
+            bool background_;
+            double las_scale_;
+
+            std::string file_name_;
+            unsigned int attributes_;
+            dvec3 origin_;
+            std::size_t num_points_;
+            bool failed_;
+
+            internal::PointStream *stream_;
+            ThreadPool *pool_;
+            std::future<bool> pending_;
+
+            // non-copyable
+            PointCloudWriter(const PointCloudWriter &) = delete;
+            PointCloudWriter &operator=(const PointCloudWriter &) = delete;
+        };
+
+    } // namespace io
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_FILEIO_POINT_CLOUD_WRITER_H
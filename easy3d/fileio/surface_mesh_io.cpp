@@ -46,6 +46,8 @@ namespace easy3d {
             success = io::load_ply(file_name, mesh);
         else if (ext == "sm")
             success = io::load_sm(file_name, mesh);
+        else if (ext == "lod")
+            success = io::load_lod(file_name, mesh);
         else if (ext == "obj")
             success = io::load_obj(file_name, mesh);
         else if (ext == "off")
@@ -101,6 +103,8 @@ namespace easy3d {
             success = io::save_ply(final_name, mesh, true);
         } else if (ext == "sm")
             success = io::save_sm(final_name, mesh);
+        else if (ext == "lod")
+            success = io::save_lod(final_name, mesh);
         else if (ext == "obj")
             success = io::save_obj(final_name, mesh);
         else if (ext == "off")
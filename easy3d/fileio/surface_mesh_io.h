@@ -29,6 +29,11 @@
 
 
 #include <string>
+#include <vector>
+#include <functional>
+#include <climits>
+
+#include <easy3d/core/types.h>
 
 
 namespace easy3d {
@@ -66,12 +71,34 @@ namespace easy3d {
 
 	namespace io {
 
-        /// Reads a surface mesh from a \p SM format file.
+        /// Reads a surface mesh from a \p SM format file (see MappedSurfaceMesh). All its properties are restored.
         bool load_sm(const std::string& file_name, SurfaceMesh* mesh);
-        /// Saves a surface mesh to a \p SM format file.
-        bool save_sm(const std::string& file_name, const SurfaceMesh* mesh);
+        /// Saves a surface mesh to a \p SM format file (see MappedSurfaceMesh). All its properties are stored, and the
+        /// data blocks are compressed if \p compress is true.
+        bool save_sm(const std::string& file_name, const SurfaceMesh* mesh, bool compress = false);
 
-        /// Reads a surface mesh from a \p PLY format file.
+        /**
+         * \brief Reads (a level of) a level-of-detail (LOD) pyramid from a \p LOD format file.
+         * \details The pyramid is stored from coarse to fine (see SurfaceMeshLOD), so a level with \p n_vertices
+         *      vertices is read without reading the vertices and faces of the finer levels. This allows displaying
+         *      the coarse levels of large models first, and refining them later by reading more of the file. The
+         *      resulting mesh has the vertex property "v:lod:parent", i.e., it is an LOD pyramid itself.
+         * \param n_vertices The number of vertices of the level. It is clamped to the range of the pyramid, so the
+         *      default reads the finest level, i.e., the full-resolution mesh.
+         */
+        bool load_lod(const std::string& file_name, SurfaceMesh* mesh, unsigned int n_vertices = UINT_MAX);
+        /**
+         * \brief Saves a level-of-detail (LOD) pyramid to a \p LOD format file.
+         * \details The mesh must be an LOD pyramid (see SurfaceMeshLOD), i.e., a triangle mesh with the vertex
+         *      property "v:lod:parent". The file starts with a header (a magic string, the version, a byte order
+         *      mark, the number of vertices, the number of vertices of the coarsest level, and the number of faces),
+         *      followed by the parents of all vertices, the vertex positions, and the vertex indices of the faces,
+         *      all in the order from coarse to fine. The data is stored in the byte order of the writing machine.
+         */
+        bool save_lod(const std::string& file_name, const SurfaceMesh* mesh);
+
+        /// Reads a surface mesh from a \p PLY format file. Binary files are read in bulk, i.e., the values are copied
+        /// directly into the properties of the mesh and the faces are constructed all at once.
         bool load_ply(const std::string& file_name, SurfaceMesh* mesh);
         /// Saves a surface mesh to a \p PLY format file.
         bool save_ply(const std::string& file_name, const SurfaceMesh* mesh, bool binary = true);
@@ -99,6 +126,19 @@ namespace easy3d {
         /// (all Z-coordinates are set to 0).
         bool load_geojson(const std::string& file_name, SurfaceMesh* mesh);
 
+        /**
+         * \brief Streams the vertices and faces of a surface mesh stored in a \p PLY, \p OFF, or \p OBJ format file.
+         * \details The vertices and faces are passed to the callbacks in the order they appear in the file, and
+         *      nothing is stored, so the memory consumption doesn't depend on the size of the file. This allows
+         *      processing meshes that don't fit into memory. The vertex indices of the faces start from 0. If a
+         *      callback is empty, the corresponding elements are skipped (and the file is not read further than
+         *      needed if possible).
+         * \return false if the file cannot be opened or parsed.
+         */
+        bool stream_surface_mesh(const std::string& file_name,
+                                 const std::function<void(const dvec3& p)>& vertex_callback,
+                                 const std::function<void(const std::vector<int>& vertices)>& face_callback);
+
 	} // namespace io
 
 } // namespace easy3d
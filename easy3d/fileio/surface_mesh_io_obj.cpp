@@ -853,6 +853,15 @@ namespace easy3d {
                 return false;
             }
 
+            // the deleted elements are not stored, and the vertices are indexed contiguously (the copy shares the data
+            // with the mesh)
+            SurfaceMesh collected;
+            if (mesh->has_garbage()) {
+                collected = *mesh;
+                collected.collect_garbage(true);   // the copy also inherits the deferred garbage collection
+                mesh = &collected;
+            }
+
             std::ofstream out(file_name.c_str());
             if (out.fail()) {
                 LOG(ERROR) << "could not open file: " << file_name;
@@ -29,11 +29,13 @@
 #include <easy3d/core/types.h>
 #include <easy3d/core/surface_mesh.h>
 #include <easy3d/core/surface_mesh_builder.h>
-#include <easy3d/util/line_stream.h>
+#include <easy3d/util/memory_mapped_file.h>
+#include <easy3d/util/text_scanner.h>
+#include <easy3d/util/parallel.h>
 #include <easy3d/util/logging.h>
 #include <easy3d/util/progress.h>
 
-#include <cstring> // for strlen()
+#include <fstream>
 
 
 namespace easy3d {
@@ -42,16 +44,12 @@ namespace easy3d {
 
         namespace internal {
             // Some OFF files may skip lines or may have comments starting with '#'
-            static void get_line(LineInputStream& in) {
-                in.get_line() ;
-                const char* p =  in.current_line().c_str();
-                while (!in.eof() && (
-                        (strlen(p) == 0 || !isprint(*p)) || // empty line
-                        (strlen(p) > 0 && p[0] == '#')
-                )) {
-                    in.get_line() ;
-                    p = in.current_line().c_str();
+            static bool get_line(TextScanner& scanner) {
+                while (scanner.next_line()) {
+                    if (!scanner.is_blank_or_comment())
+                        return true;
                 }
+                return false;
             }
         }
 
@@ -62,24 +60,19 @@ namespace easy3d {
 				return false;
 			}
 
-            std::ifstream in(file_name.c_str()) ;
-            if(in.fail()) {
-				LOG(ERROR) << "Could not open file: " << file_name;
-                return false ;
-            }
+            MemoryMappedFile file;
+            if (!file.open(file_name))
+                return false;
 
             mesh->clear();
 
-            SurfaceMeshBuilder builder(mesh);
-            builder.begin_surface();
-
             // Vertex index starts by 0 in off format.
 
-            LineInputStream input(in) ;
-            internal::get_line(input) ;
+            TextScanner header(file.data(), file.data() + file.size());
+            internal::get_line(header);
 
-            std::string magic ;
-            input >> magic ;
+            std::string magic;
+            header.read(magic);
 
             // NOFF is for Grimage "visual shapes".
             if(magic != "OFF" && magic != "NOFF") {
@@ -88,93 +81,130 @@ namespace easy3d {
             }
 
             if(magic != "NOFF") {
-                internal::get_line(input) ;
+                internal::get_line(header);
             }
 
             int nb_vertices, nb_facets, nb_edges;
-            input >> nb_vertices >> nb_facets >> nb_edges;
-            if (input.fail()) {
-				LOG(ERROR) << "An error in the file header: " << input.current_line();
+            if (!header.read(nb_vertices) || !header.read(nb_facets) || !header.read(nb_edges) ||
+                nb_vertices < 0 || nb_facets < 0) {
+				LOG(ERROR) << "An error in the file header: " << std::string(header.line_begin(), header.line_end());
                 return false;
             }
 
+            // The rest of the file is split at line boundaries into chunks. The lines of each chunk are first
+            // counted (in parallel), which tells which lines of a chunk are vertices and which are faces. Then the
+            // chunks are parsed in parallel.
+            const char* body = header.position();
+            const char* end = file.data() + file.size();
+            const std::size_t chunk_size = 4 * 1024 * 1024;
+            const std::vector<const char*> chunks = split_lines(body, end, static_cast<std::size_t>(end - body) / chunk_size + 1);
+            const std::size_t num_chunks = chunks.size() - 1;
+
+            std::vector<std::size_t> first_line(num_chunks + 1, 0);
+            parallel::for_each(0, num_chunks, [&](std::size_t c) {
+                TextScanner scanner(chunks[c], chunks[c + 1]);
+                std::size_t count = 0;
+                while (scanner.next_line()) {
+                    if (!scanner.is_blank_or_comment())
+                        ++count;
+                }
+                first_line[c + 1] = count;
+            }, 1);
+            for (std::size_t c = 0; c < num_chunks; ++c)
+                first_line[c + 1] += first_line[c];
+
+            // the faces of each chunk: the number of vertices of each face (-1 for an invalid face), and the indices
+            std::vector<dvec3> points(nb_vertices);
+            std::vector<unsigned char> valid_points(nb_vertices, 0);
+            std::vector< std::vector<int> > face_sizes(num_chunks);
+            std::vector< std::vector<int> > face_indices(num_chunks);
+            const std::size_t num_lines = static_cast<std::size_t>(nb_vertices) + static_cast<std::size_t>(nb_facets);
+            parallel::for_each(0, num_chunks, [&](std::size_t c) {
+                TextScanner scanner(chunks[c], chunks[c + 1]);
+                std::size_t line = first_line[c];
+                while (line < num_lines && scanner.next_line()) {
+                    if (scanner.is_blank_or_comment())
+                        continue;
+                    if (line < static_cast<std::size_t>(nb_vertices)) {
+                        dvec3& p = points[line];
+                        valid_points[line] = scanner.read(p.x) && scanner.read(p.y) && scanner.read(p.z);
+                    }
+                    else {
+                        int nv = 0;
+                        if (scanner.read(nv) && nv >= 0) {
+                            face_sizes[c].push_back(nv);
+                            for (int j = 0; j < nv; j++) {
+                                int index = -1;
+                                scanner.read(index);    // an invalid index (i.e., -1) will be rejected by the builder
+                                face_indices[c].push_back(index);
+                            }
+                        }
+                        else
+                            face_sizes[c].push_back(-1);
+                    }
+                    ++line;
+                }
+            }, 1);
+
             ProgressLogger progress(nb_vertices + nb_facets, true, false);
 
-            if (Translator::instance()->status() == Translator::DISABLED) {
-                vec3 p;
-                for (int i = 0; i < nb_vertices; i++) {
-                    internal::get_line(input);
-                    input >> p;
-                    if (!input.fail())
-                        builder.add_vertex(p);
-                    else
-                        LOG_N_TIMES(3, ERROR) << "failed reading the " << i << "_th vertex from file. " << COUNTER;
-                    progress.next();
-                }
-            } else if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
-                dvec3 p, origin;
+            // the edges and faces are allocated at once by add_faces()
+            mesh->reserve(nb_vertices, 0, 0);
+
+            SurfaceMeshBuilder builder(mesh);
+            builder.begin_surface();
+
+            dvec3 origin(0, 0, 0);
+            if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
                 for (int i = 0; i < nb_vertices; i++) {
-                    internal::get_line(input);
-                    input >> p;
-                    if (!input.fail()) {
-                        if (i == 0) { // the first point
-                            origin = p;
-                            Translator::instance()->set_translation(origin);
-                        }
-                        builder.add_vertex(vec3(static_cast<float>(p.x - origin.x), static_cast<float>(p.y - origin.y), static_cast<float>(p.z - origin.z)));
+                    if (valid_points[i]) { // the first point
+                        origin = points[i];
+                        break;
                     }
-                    else
-                        LOG_N_TIMES(3, ERROR) << "failed reading the " << i << "_th vertex from file. " << COUNTER;
-                    progress.next();
                 }
+                Translator::instance()->set_translation(origin);
+            } else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET)
+                origin = Translator::instance()->translation();
+
+            for (int i = 0; i < nb_vertices; i++) {
+                if (valid_points[i]) {
+                    const dvec3& p = points[i];
+                    builder.add_vertex(vec3(static_cast<float>(p.x - origin.x), static_cast<float>(p.y - origin.y), static_cast<float>(p.z - origin.z)));
+                }
+                else
+                    LOG_N_TIMES(3, ERROR) << "failed reading the " << i << "_th vertex from file. " << COUNTER;
+            }
+            progress.notify(nb_vertices);
+
+            if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
                 auto trans = mesh->add_model_property<dvec3>("translation", dvec3(0,0,0));
                 trans[0] = origin;
                 LOG(INFO) << "model translated w.r.t. the first vertex (" << trans[0] << "), stored as ModelProperty<dvec3>(\"translation\")";
             } else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET) {
-                const dvec3 &origin = Translator::instance()->translation();
-                dvec3 p;
-                for (int i = 0; i < nb_vertices; i++) {
-                    internal::get_line(input);
-                    input >> p;
-                    if (!input.fail())
-                        builder.add_vertex(vec3(static_cast<float>(p.x - origin.x), static_cast<float>(p.y - origin.y), static_cast<float>(p.z - origin.z)));
-                    else
-                        LOG_N_TIMES(3, ERROR) << "failed reading the " << i << "_th vertex from file. " << COUNTER;
-                    progress.next();
-                }
                 auto trans = mesh->add_model_property<dvec3>("translation", dvec3(0,0,0));
                 trans[0] = origin;
                 LOG(INFO) << "model translated w.r.t. last known reference point (" << origin << "), stored as ModelProperty<dvec3>(\"translation\")";
             }
 
-            for (int i = 0; i < nb_facets; i++) {
-                int nv;
-                internal::get_line(input);
-                input >> nv;
-
-                if (!input.fail()) {
-                    std::vector<SurfaceMesh::Vertex> vertices;
-                    for (int j = 0; j < nv; j++) {
-                        int index;
-                        input >> index;
-                        if (!input.fail()) {
-                            vertices.emplace_back(SurfaceMesh::Vertex(index));
-                        } else {
-                            LOG_N_TIMES(3, ERROR) << "failed reading the " << j << "_th vertex of the " << i
-                                                  << "_th face from file. " << COUNTER;
-                        }
-                    }
-                    builder.add_face(vertices);
-                } else
-                    LOG_N_TIMES(3, ERROR) << "failed reading the " << i << "_th face from file. " << COUNTER;
-
-                progress.next();
+            // gather the faces of all chunks and add them at once
+            std::vector<int> sizes, indices;
+            sizes.reserve(nb_facets);
+            int face_id = 0;
+            for (std::size_t c = 0; c < num_chunks; ++c) {
+                indices.insert(indices.end(), face_indices[c].begin(), face_indices[c].end());
+                std::vector<int>().swap(face_indices[c]);
+                for (int nv : face_sizes[c]) {
+                    if (nv >= 0)
+                        sizes.push_back(nv);
+                    else
+                        LOG_N_TIMES(3, ERROR) << "failed reading the " << face_id << "_th face from file. " << COUNTER;
+                    ++face_id;
+                }
             }
+            builder.add_faces(indices, sizes);
+            progress.notify(nb_vertices + nb_facets);
 
             // for mesh models, we can simply ignore the edges.
-//            for (int i = 0; i < nb_edges; i++) {
-//                // read the edges
-//            }
 
             builder.end_surface();
 
@@ -192,6 +222,15 @@ namespace easy3d {
 				return false;
 			}
 
+            // the deleted elements are not stored, and the vertices are indexed contiguously (the copy shares the data
+            // with the mesh)
+            SurfaceMesh collected;
+            if (mesh->has_garbage()) {
+                collected = *mesh;
+                collected.collect_garbage(true);   // the copy also inherits the deferred garbage collection
+                mesh = &collected;
+            }
+
             std::ofstream out(file_name.c_str()) ;
             if(out.fail()) {
 				LOG(ERROR) << "could not open file: " << file_name;
@@ -104,6 +104,136 @@ namespace easy3d {
 				}
 			}
 
+
+			// translates the model according to the status of the Translator
+			inline void translate(SurfaceMesh* mesh) {
+                if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
+                    auto& points = mesh->get_vertex_property<vec3>("v:point").vector();
+
+                    // the first point
+                    const vec3 p0 = points[0];
+                    const dvec3 origin(p0.data());
+                    Translator::instance()->set_translation(origin);
+
+                    for (auto& p: points)
+                        p -= p0;
+
+                    auto trans = mesh->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
+                    trans[0] = origin;
+                    LOG(INFO) << "model translated w.r.t. the first vertex (" << origin
+                              << "), stored as ModelProperty<dvec3>(\"translation\")";
+                } else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET) {
+                    const dvec3 &origin = Translator::instance()->translation();
+                    auto& points = mesh->get_vertex_property<vec3>("v:point").vector();
+                    for (auto& p: points) {
+                        p.x -= static_cast<float>(origin.x);
+                        p.y -= static_cast<float>(origin.y);
+                        p.z -= static_cast<float>(origin.z);
+                    }
+
+                    auto trans = mesh->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
+                    trans[0] = origin;
+                    LOG(INFO) << "model translated w.r.t. last known reference point (" << origin
+                              << "), stored as ModelProperty<dvec3>(\"translation\")";
+                }
+			}
+
+
+			// gives access to the storage of the vertex/face properties (created if not existing)
+			struct MeshVertexPropertyStorage {
+				SurfaceMesh* mesh;
+				template <typename T> T* data(const std::string& name) const {
+					return mesh->vertex_property<T>(name).vector().data();
+				}
+			};
+
+			struct MeshFacePropertyStorage {
+				SurfaceMesh* mesh;
+				template <typename T> T* data(const std::string& name) const {
+					return mesh->face_property<T>(name).vector().data();
+				}
+			};
+
+
+			// Reads a binary PLY file in bulk: the values are copied from the mapped file directly into the properties
+			// of the mesh, and the faces are constructed from a flat array of vertex indices. Returns false (without
+			// touching the mesh) if the file is not binary or it has data that only PlyReader can handle, e.g., edges,
+			// unknown elements, and list properties other than the vertex indices of the faces. Returns false (and
+			// the mesh is cleared) if reading the values fails.
+			bool load_ply_bulk(const std::string& file_name, SurfaceMesh* mesh)
+			{
+				BinaryPlyReader reader;
+				if (!reader.open(file_name))
+					return false;
+
+				const BinaryPlyReader::ElementLayout* element_vertex = reader.element("vertex");
+				const BinaryPlyReader::ElementLayout* element_face = reader.element("face");
+				if (!element_vertex || !element_face || element_vertex->num_instances == 0)
+					return false;
+
+				const BinaryPlyReader::Property* prop_indices = BinaryPlyReader::property(*element_face, "vertex_indices");
+				if (!prop_indices)
+					prop_indices = BinaryPlyReader::property(*element_face, "vertex_index");
+				if (!prop_indices || !prop_indices->is_list ||
+					prop_indices->type == BinaryPlyReader::FLOAT32 || prop_indices->type == BinaryPlyReader::FLOAT64)
+					return false;
+
+				for (const auto& e : reader.elements()) {
+					if (e.num_instances > 0 && e.name != "vertex" && e.name != "face")
+						return false;
+					for (const auto& p : e.properties) {
+						if (p.is_list && &p != prop_indices)
+							return false;
+					}
+				}
+
+				bool has_point = false;
+				for (const auto& field : BinaryPlyReader::fields(*element_vertex))
+					has_point |= (field.name == "point");
+				if (!has_point)
+					return false;   // PlyReader reports the error
+
+				// the faces are read first, so the mesh is not touched if that fails
+				std::vector<int> indices, sizes;
+				if (!reader.read_list(*element_face, prop_indices->name, indices, sizes))
+					return false;
+
+				mesh->clear();
+
+				SurfaceMeshBuilder builder(mesh);
+				builder.begin_surface();
+
+				// add vertices (the coordinates are read together with the other vertex properties)
+				const auto num_vertices = static_cast<unsigned int>(element_vertex->num_instances);
+				mesh->reserve(num_vertices, 0, 0);
+				for (unsigned int i = 0; i < num_vertices; ++i)
+					builder.add_vertex(vec3());
+
+				// NOTE: to properly handle non-manifold meshes, vertex properties must be added before adding the faces
+				if (!reader.read_fields(*element_vertex, "v:", MeshVertexPropertyStorage{mesh})) {
+					LOG(ERROR) << "failed reading the vertex properties: " << file_name;
+					mesh->clear();
+					return false;
+				}
+
+				// add faces
+				builder.add_faces(indices, sizes);
+				std::vector<int>().swap(indices);
+				std::vector<int>().swap(sizes);
+
+				if (mesh->n_faces() == element_face->num_instances) {
+					if (!reader.read_fields(*element_face, "f:", MeshFacePropertyStorage{mesh})) {
+						LOG(ERROR) << "failed reading the face properties: " << file_name;
+						mesh->clear();
+						return false;
+					}
+				} else if (!BinaryPlyReader::fields(*element_face).empty())
+					LOG(ERROR) << "face properties ignored because the number of faces (" << mesh->n_faces()
+							   << ") does not match the number of faces in the file (" << element_face->num_instances << ")";
+
+				builder.end_surface();
+				return true;
+			}
 		} // namespace internal
 
 
@@ -114,6 +244,11 @@ namespace easy3d {
 				return false;
 			}
 
+			if (internal::load_ply_bulk(file_name, mesh)) {
+				internal::translate(mesh);
+				return mesh->n_faces() > 0;
+			}
+
 			std::vector<Element> elements;
 			PlyReader reader;
 			if (!reader.read(file_name, elements))
@@ -197,28 +332,38 @@ namespace easy3d {
                 return SurfaceMesh::Halfedge();
             };
 
-            for (std::size_t i=0; i<face_vertex_indices.size(); ++i) {
-                const auto& indices = face_vertex_indices[i];
-				std::vector<SurfaceMesh::Vertex> vts;
-				for (auto id : indices)
-                    vts.emplace_back(SurfaceMesh::Vertex(id));
-                auto face = builder.add_face(vts);
-
-                // now let's add the texcoords (defined on halfedges)
-                if (face.is_valid() && prop_texcoords) {
-                    const auto& face_texcoords = face_halfedge_texcoords[i];
-                    if (face_texcoords.size() == vts.size() * 2) { // 2 coordinates per vertex
-                        auto begin = find_face_halfedge(mesh, face, builder.face_vertices()[0]);
-                        auto cur = begin;
-                        unsigned int texcord_idx = 0;
-                        do {
-                            prop_texcoords[cur] = vec2(face_texcoords[texcord_idx], face_texcoords[texcord_idx + 1]);
-                            texcord_idx += 2;
-                            cur = mesh->next(cur);
-                        } while (cur != begin);
+            if (!prop_texcoords) { // no attributes on the halfedges, so all faces can be added at once
+                std::vector<int> sizes(face_vertex_indices.size()), indices;
+                for (std::size_t i=0; i<face_vertex_indices.size(); ++i) {
+                    sizes[i] = static_cast<int>(face_vertex_indices[i].size());
+                    indices.insert(indices.end(), face_vertex_indices[i].begin(), face_vertex_indices[i].end());
+                }
+                builder.add_faces(indices, sizes);
+            }
+            else {
+                for (std::size_t i=0; i<face_vertex_indices.size(); ++i) {
+                    const auto& indices = face_vertex_indices[i];
+                    std::vector<SurfaceMesh::Vertex> vts;
+                    for (auto id : indices)
+                        vts.emplace_back(SurfaceMesh::Vertex(id));
+                    auto face = builder.add_face(vts);
+
+                    // now let's add the texcoords (defined on halfedges)
+                    if (face.is_valid() && prop_texcoords) {
+                        const auto& face_texcoords = face_halfedge_texcoords[i];
+                        if (face_texcoords.size() == vts.size() * 2) { // 2 coordinates per vertex
+                            auto begin = find_face_halfedge(mesh, face, builder.face_vertices()[0]);
+                            auto cur = begin;
+                            unsigned int texcord_idx = 0;
+                            do {
+                                prop_texcoords[cur] = vec2(face_texcoords[texcord_idx], face_texcoords[texcord_idx + 1]);
+                                texcord_idx += 2;
+                                cur = mesh->next(cur);
+                            } while (cur != begin);
+                        }
                     }
                 }
-			}
+            }
 
 			// now let's add the remained properties
 			for (const auto& e : elements) {
@@ -251,36 +396,7 @@ namespace easy3d {
 
 			builder.end_surface();
 
-            if (Translator::instance()->status() == Translator::TRANSLATE_USE_FIRST_POINT) {
-                auto& points = mesh->get_vertex_property<vec3>("v:point").vector();
-
-                // the first point
-                const vec3 p0 = points[0];
-                const dvec3 origin(p0.data());
-                Translator::instance()->set_translation(origin);
-
-                for (auto& p: points)
-                    p -= p0;
-
-                auto trans = mesh->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
-                trans[0] = origin;
-                LOG(INFO) << "model translated w.r.t. the first vertex (" << origin
-                          << "), stored as ModelProperty<dvec3>(\"translation\")";
-            } else if (Translator::instance()->status() == Translator::TRANSLATE_USE_LAST_KNOWN_OFFSET) {
-                const dvec3 &origin = Translator::instance()->translation();
-                auto& points = mesh->get_vertex_property<vec3>("v:point").vector();
-                for (auto& p: points) {
-                    p.x -= static_cast<float>(origin.x);
-                    p.y -= static_cast<float>(origin.y);
-                    p.z -= static_cast<float>(origin.z);
-                }
-
-                auto trans = mesh->add_model_property<dvec3>("translation", dvec3(0, 0, 0));
-                trans[0] = origin;
-                LOG(INFO) << "model translated w.r.t. last known reference point (" << origin
-                          << "), stored as ModelProperty<dvec3>(\"translation\")";
-            }
-
+            internal::translate(mesh);
             return mesh->n_faces() > 0;
 		}
 
@@ -338,6 +454,15 @@ namespace easy3d {
 				return false;
 			}
 
+            // the deleted elements are not stored, and the elements are indexed contiguously (the copy shares the data
+            // with the mesh)
+            SurfaceMesh collected;
+            if (mesh->has_garbage()) {
+                collected = *mesh;
+                collected.collect_garbage(true);   // the copy also inherits the deferred garbage collection
+                mesh = &collected;
+            }
+
 			std::vector<Element> elements;
 
 			//-----------------------------------------------------
@@ -24,12 +24,20 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  ********************************************************************/
 
+
 #include <easy3d/fileio/surface_mesh_io.h>
+#include <easy3d/fileio/surface_mesh_io_sm.h>
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
 
 #include <easy3d/core/surface_mesh.h>
+#include <easy3d/core/surface_mesh_builder.h>
+#include <easy3d/util/parallel.h>
 
 
 /** ----------------------------------------------------------
@@ -52,6 +60,279 @@ namespace easy3d {
 
     namespace io {
 
+        /// \cond
+        namespace internal {
+
+            const char sm_magic[8] = {'E', 'A', 'S', 'Y', '3', 'D', 'S', 'M'};
+
+            // the data blocks are aligned to a typical cache line
+            const std::size_t sm_block_alignment = 64;
+
+            const char lod_magic[8] = {'E', 'A', 'S', 'Y', '3', 'D', 'L', 'D'};
+            const uint32_t lod_version = 1;
+            // written in the byte order of the writer, so a reader of the other byte order sees 0x04030201
+            const uint32_t lod_byte_order = 0x01020304u;
+
+            struct LodHeader {
+                char magic[8];
+                uint32_t version;
+                uint32_t byte_order;
+                uint32_t num_vertices;
+                uint32_t num_base_vertices; // the vertices of the coarsest level
+                uint32_t num_faces;
+                uint32_t reserved;
+            };
+            static_assert(sizeof(LodHeader) == 32, "unexpected size of the LOD header");
+
+            const std::type_info &property_type(const SurfaceMesh *mesh, MappedSurfaceMesh::ElementType element,
+                                                const std::string &name) {
+                switch (element) {
+                    case MappedSurfaceMesh::VERTEX:   return mesh->get_vertex_property_type(name);
+                    case MappedSurfaceMesh::HALFEDGE: return mesh->get_halfedge_property_type(name);
+                    case MappedSurfaceMesh::EDGE:     return mesh->get_edge_property_type(name);
+                    case MappedSurfaceMesh::FACE:     return mesh->get_face_property_type(name);
+                    default:                          return mesh->get_model_property_type(name);
+                }
+            }
+
+            template<typename T>
+            Property<T> get_property(const SurfaceMesh *mesh, MappedSurfaceMesh::ElementType element,
+                                     const std::string &name) {
+                switch (element) {
+                    case MappedSurfaceMesh::VERTEX:   return mesh->get_vertex_property<T>(name);
+                    case MappedSurfaceMesh::HALFEDGE: return mesh->get_halfedge_property<T>(name);
+                    case MappedSurfaceMesh::EDGE:     return mesh->get_edge_property<T>(name);
+                    case MappedSurfaceMesh::FACE:     return mesh->get_face_property<T>(name);
+                    default:                          return mesh->get_model_property<T>(name);
+                }
+            }
+
+            // returns the property if it exists, otherwise it creates it first
+            template<typename T>
+            Property<T> property(SurfaceMesh *mesh, MappedSurfaceMesh::ElementType element, const std::string &name) {
+                switch (element) {
+                    case MappedSurfaceMesh::VERTEX:   return mesh->vertex_property<T>(name);
+                    case MappedSurfaceMesh::HALFEDGE: return mesh->halfedge_property<T>(name);
+                    case MappedSurfaceMesh::EDGE:     return mesh->edge_property<T>(name);
+                    case MappedSurfaceMesh::FACE:     return mesh->face_property<T>(name);
+                    default:                          return mesh->model_property<T>(name);
+                }
+            }
+
+            // collects the property 'name' as a block if it is of type T
+            struct BlockCollector {
+                const SurfaceMesh *mesh;
+                MappedSurfaceMesh::ElementType element;
+                const std::string &name;
+                std::vector<MappedSurfaceMesh::Block> &blocks;
+                std::vector< std::vector<char> > &buffers;   // the converted data (of boolean properties)
+
+                template<typename T>
+                bool apply() {
+                    if (property_type(mesh, element, name) != typeid(T))
+                        return false;
+                    const auto prop = get_property<T>(mesh, element, name);
+                    blocks.push_back({element, name, MappedSurfaceMesh::value_type<T>(), sizeof(T),
+                                      reinterpret_cast<const char *>(prop.vector().data()),
+                                      prop.vector().size() * sizeof(T)});
+                    return true;
+                }
+            };
+            template<>
+            bool BlockCollector::apply<bool>() {
+                if (property_type(mesh, element, name) != typeid(bool))
+                    return false;
+                const auto prop = get_property<bool>(mesh, element, name);
+                const std::vector<bool> &values = prop.vector();
+                buffers.emplace_back(values.begin(), values.end());
+                blocks.push_back({element, name, MappedSurfaceMesh::BOOL, 1, nullptr, values.size()});
+                return true;
+            }
+
+            // creates (or gets) the property 'name' of type T and resolves where its data goes
+            struct PropertyCreator {
+                SurfaceMesh *mesh;
+                MappedSurfaceMesh::ElementType element;
+                const std::string &name;
+                MappedSurfaceMesh::Destination destination;
+
+                template<typename T>
+                bool apply() {
+                    auto prop = property<T>(mesh, element, name);
+                    if (!prop)
+                        return false;
+                    std::vector<T> &values = prop.vector();
+                    destination.data = reinterpret_cast<char *>(values.data());
+                    destination.size = values.size() * sizeof(T);
+                    return true;
+                }
+            };
+            template<>
+            bool PropertyCreator::apply<bool>() {
+                auto prop = property<bool>(mesh, element, name);
+                if (!prop)
+                    return false;
+                destination.bool_values = &prop.vector();
+                destination.size = destination.bool_values->size();
+                return true;
+            }
+
+            // checks that a handle refers to an existing element (or is invalid)
+            inline bool in_range(int idx, std::size_t num) {
+                return idx >= -1 && (idx < 0 || static_cast<std::size_t>(idx) < num);
+            }
+
+            // checks that the connectivity only refers to existing elements, so the traversal of the mesh can't
+            // access memory out of bounds
+            bool valid_connectivity(const SurfaceMesh *mesh) {
+                const std::size_t nv = mesh->vertices_size();
+                const std::size_t nh = mesh->halfedges_size();
+                const std::size_t nf = mesh->faces_size();
+                const auto vconn = mesh->get_vertex_property<SurfaceMesh::VertexConnectivity>("v:connectivity");
+                const auto hconn = mesh->get_halfedge_property<SurfaceMesh::HalfedgeConnectivity>("h:connectivity");
+                const auto fconn = mesh->get_face_property<SurfaceMesh::FaceConnectivity>("f:connectivity");
+                if (!vconn || !hconn || !fconn)
+                    return false;
+
+                std::atomic<bool> valid(true);
+                parallel::for_each(0, nv, [&](std::size_t i) {
+                    if (!in_range(vconn[SurfaceMesh::Vertex(static_cast<int>(i))].halfedge_.idx(), nh))
+                        valid = false;
+                });
+                parallel::for_each(0, nh, [&](std::size_t i) {
+                    const auto &c = hconn[SurfaceMesh::Halfedge(static_cast<int>(i))];
+                    if (!in_range(c.vertex_.idx(), nv) || !in_range(c.face_.idx(), nf) ||
+                        !in_range(c.next_.idx(), nh) || !in_range(c.prev_.idx(), nh))
+                        valid = false;
+                });
+                parallel::for_each(0, nf, [&](std::size_t i) {
+                    if (!in_range(fconn[SurfaceMesh::Face(static_cast<int>(i))].halfedge_.idx(), nh))
+                        valid = false;
+                });
+                return valid;
+            }
+
+        }
+        /// \endcond
+
+
+        bool MappedSurfaceMesh::open(const std::string &file_name) {
+            if (!MappedPropertyFile::open(file_name, internal::sm_magic, VERSION, "an sm"))
+                return false;
+
+            for (const auto &prop : directory()) {
+                if (value_size<MappedSurfaceMesh>(prop.type) != prop.element_size) {
+                    LOG(ERROR) << "corrupted sm file (unexpected value size of " << element_name(prop.element)
+                               << " property '" << prop.name << "'): " << file_name;
+                    close();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+
+        bool MappedSurfaceMesh::load(SurfaceMesh *mesh) const {
+            if (!mesh) {
+                LOG(ERROR) << "null mesh pointer";
+                return false;
+            }
+            if (!is_open()) {
+                LOG(ERROR) << "no sm file is open";
+                return false;
+            }
+            if (n_elements(HALFEDGE) != 2 * n_elements(EDGE) || n_elements(MODEL) > 1 ||
+                n_elements(VERTEX) > INT_MAX || n_elements(EDGE) > INT_MAX / 2 || n_elements(FACE) > INT_MAX) {
+                LOG(ERROR) << "corrupted sm file (inconsistent numbers of elements): " << file_name();
+                return false;
+            }
+
+            mesh->clear();
+            mesh->resize(static_cast<unsigned int>(n_elements(VERTEX)),
+                         static_cast<unsigned int>(n_elements(EDGE)),
+                         static_cast<unsigned int>(n_elements(FACE)));
+
+            // create the properties first (which modifies the mesh), and then fill them in parallel
+            std::vector<Destination> destinations;
+            for (const auto &prop : directory()) {
+                internal::PropertyCreator creator = {mesh, prop.element, prop.name, {nullptr, 0, nullptr}};
+                if (!visit(prop.type, creator)) {
+                    LOG(ERROR) << element_name(prop.element) << " property '" << prop.name
+                               << "' exists but has a different type";
+                    return false;
+                }
+                destinations.push_back(creator.destination);
+            }
+
+            if (!read(destinations))
+                return false;
+
+            if (!internal::valid_connectivity(mesh)) {
+                LOG(ERROR) << "corrupted sm file (connectivity refers to non-existing elements): " << file_name();
+                mesh->clear();
+                return false;
+            }
+            return true;
+        }
+
+
+        bool MappedSurfaceMesh::save(const std::string &file_name, const SurfaceMesh *mesh, bool compress) {
+            if (!mesh) {
+                LOG(ERROR) << "null mesh pointer";
+                return false;
+            }
+
+            // the deleted elements are not stored (the copy shares the data with the mesh)
+            SurfaceMesh collected;
+            if (mesh->has_garbage()) {
+                collected = *mesh;
+                collected.collect_garbage(true);   // the copy also inherits the deferred garbage collection
+                mesh = &collected;
+            }
+
+            const std::vector<std::string> names[5] = {
+                    mesh->vertex_properties(), mesh->halfedge_properties(), mesh->edge_properties(),
+                    mesh->face_properties(), mesh->model_properties()
+            };
+            std::vector<Block> blocks;
+            std::vector< std::vector<char> > buffers;
+            for (int e = VERTEX; e <= MODEL; ++e) {
+                const auto element = static_cast<ElementType>(e);
+                for (const auto &name : names[e]) {
+                    if (name == "v:deleted" || name == "e:deleted" || name == "f:deleted")
+                        continue;   // all false
+                    if (name.size() > MAX_NAME_LENGTH) {
+                        LOG(WARNING) << element_name(element) << " property '" << name << "' ignored (name too long)";
+                        continue;
+                    }
+                    internal::BlockCollector collector = {mesh, element, name, blocks, buffers};
+                    bool collected_block = false;
+                    for (int t = BOOL; t <= FACE_CONNECTIVITY && !collected_block; ++t)
+                        collected_block = visit(static_cast<ValueType>(t), collector);
+                    if (!collected_block)
+                        LOG(WARNING) << element_name(element) << " property '" << name << "' ignored (unsupported type)";
+                }
+            }
+
+            // the converted data of the boolean properties (in the order they were collected)
+            std::size_t next_buffer = 0;
+            for (auto &block : blocks) {
+                if (block.type == BOOL)
+                    block.data = buffers[next_buffer++].data();
+            }
+
+            const std::size_t num_elements[5] = {
+                    mesh->vertices_size(), mesh->halfedges_size(), mesh->edges_size(), mesh->faces_size(),
+                    names[MODEL].empty() ? 0u : 1u
+            };
+            return MappedPropertyFile::save(file_name, internal::sm_magic, VERSION, internal::sm_block_alignment,
+                                            num_elements, blocks, compress);
+        }
+
+
+        //-----------------------------------------------------------------------------
+
+
         /// TODO: Translator not implemented
 
         bool load_sm(const std::string& file_name, SurfaceMesh* mesh)
@@ -68,6 +349,19 @@ namespace easy3d {
                 return false;
             }
 
+            // the files of version 2 (and later) start with a magic string
+            char magic[sizeof(internal::sm_magic)];
+            input.read(magic, sizeof(magic));
+            if (!input.fail() && std::memcmp(magic, internal::sm_magic, sizeof(magic)) == 0) {
+                input.close();
+                MappedSurfaceMesh file;
+                return file.open(file_name) && file.load(mesh) && mesh->n_faces() > 0;
+            }
+
+            // version 1: the connectivity, the points, and the (optional) vertex colors
+            input.clear();
+            input.seekg(0);
+
             // how many elements?
             unsigned int nv, ne, nh, nf;
             input.read((char*)&nv, sizeof(unsigned int));
@@ -104,13 +398,149 @@ namespace easy3d {
         //-----------------------------------------------------------------------------
 
 
-        bool save_sm(const std::string& file_name, const SurfaceMesh* mesh)
+
+
+        //-----------------------------------------------------------------------------
+
+
+        bool save_sm(const std::string& file_name, const SurfaceMesh* mesh, bool compress)
+        {
+            return MappedSurfaceMesh::save(file_name, mesh, compress);
+        }
+
+
+        //-----------------------------------------------------------------------------
+
+
+        bool load_lod(const std::string& file_name, SurfaceMesh* mesh, unsigned int n_vertices)
+        {
+            if (!mesh) {
+                LOG(ERROR) << "null mesh pointer";
+                return false;
+            }
+
+            // open file (in binary mode)
+            std::ifstream input(file_name.c_str(), std::fstream::binary);
+            if (input.fail()) {
+                LOG(ERROR) << "could not open file: " << file_name;
+                return false;
+            }
+
+            input.seekg(0, std::ios::end);
+            const uint64_t file_size = static_cast<uint64_t>(input.tellg());
+            input.seekg(0, std::ios::beg);
+
+            internal::LodHeader header;
+            input.read((char*)&header, sizeof(header));
+            if (input.fail() || std::memcmp(header.magic, internal::lod_magic, sizeof(header.magic)) != 0) {
+                LOG(ERROR) << "not an LOD file: " << file_name;
+                return false;
+            }
+            if (header.version > internal::lod_version) {
+                LOG(ERROR) << "unsupported LOD version (" << header.version << "): " << file_name;
+                return false;
+            }
+            if (header.byte_order != internal::lod_byte_order) {
+                LOG(ERROR) << "the LOD file was written on a machine of a different byte order: " << file_name;
+                return false;
+            }
+
+            // how many elements? The sizes are checked against the file before anything is allocated.
+            const unsigned int nv = header.num_vertices;
+            const unsigned int nb = header.num_base_vertices;
+            const unsigned int nf = header.num_faces;
+            const uint64_t expected_size = sizeof(header) + uint64_t(nv) * (sizeof(int) + sizeof(vec3)) +
+                                           uint64_t(nf) * 3 * sizeof(unsigned int);
+            if (nb > nv || expected_size != file_size) {
+                LOG(ERROR) << "corrupted LOD file (" << nv << " vertices, " << nf << " faces, but " << file_size
+                           << " bytes): " << file_name;
+                return false;
+            }
+            const unsigned int n = std::max(nb, std::min(n_vertices, nv));
+
+            // the parents of all vertices are needed to map the faces to the level, but only the positions of the
+            // vertices of the level are read
+            std::vector<int> parents(nv);
+            std::vector<vec3> points(n);
+            input.read((char*)parents.data(), static_cast<long>(nv * sizeof(int)));
+            input.read((char*)points.data(), static_cast<long>(n * sizeof(vec3)));
+            for (unsigned int i = 0; i < nv && !input.fail(); ++i) {
+                if (parents[i] >= static_cast<int>(i) || (parents[i] < 0) != (i < nb))
+                    input.setstate(std::ios::failbit);
+            }
+            if (input.fail()) {
+                LOG(ERROR) << "failed reading the vertices of the LOD file: " << file_name;
+                return false;
+            }
+
+            // the faces are sorted by the level at which they appear, so they are read until the first face that
+            // collapses at this level (i.e., the first one with two vertices mapped to the same ancestor)
+            input.seekg(static_cast<long>(sizeof(header) + uint64_t(nv) * (sizeof(int) + sizeof(vec3))));
+            std::vector<int> indices;
+            std::vector<unsigned int> chunk;
+            bool done = false;
+            for (unsigned int start = 0; start < nf && !done; start += 4096) {
+                const unsigned int num = std::min(4096u, nf - start);
+                chunk.resize(num * 3);
+                input.read((char*)chunk.data(), static_cast<long>(chunk.size() * sizeof(unsigned int)));
+                if (input.fail()) {
+                    LOG(ERROR) << "failed reading the faces of the LOD file: " << file_name;
+                    return false;
+                }
+                for (unsigned int i = 0; i < num && !done; ++i) {
+                    int ids[3];
+                    for (int k = 0; k < 3; ++k) {
+                        unsigned int id = chunk[i * 3 + k];
+                        if (id >= nv) {
+                            LOG(ERROR) << "vertex index out of range in the LOD file: " << file_name;
+                            return false;
+                        }
+                        while (id >= n)
+                            id = static_cast<unsigned int>(parents[id]);
+                        ids[k] = static_cast<int>(id);
+                    }
+                    if (ids[0] == ids[1] || ids[1] == ids[2] || ids[2] == ids[0])
+                        done = true;
+                    else
+                        indices.insert(indices.end(), ids, ids + 3);
+                }
+            }
+
+            mesh->clear();
+            SurfaceMeshBuilder builder(mesh);
+            builder.begin_surface();
+            for (const auto& p : points)
+                builder.add_vertex(p);
+            builder.add_faces(indices);
+            builder.end_surface(false);
+            if (mesh->n_vertices() != n) {
+                LOG(ERROR) << "the level of the LOD file is not manifold: " << file_name;
+                return false;
+            }
+
+            auto parent = mesh->add_vertex_property<int>("v:lod:parent");
+            parent.vector().assign(parents.begin(), parents.begin() + n);
+
+            return mesh->n_faces() > 0;
+        }
+
+
+        //-----------------------------------------------------------------------------
+
+
+        bool save_lod(const std::string& file_name, const SurfaceMesh* mesh)
         {
             if (!mesh) {
                 LOG(ERROR) << "null mesh pointer";
                 return false;
             }
 
+            const auto parent = mesh->get_vertex_property<int>("v:lod:parent");
+            if (!parent || mesh->has_garbage() || !mesh->is_triangle_mesh()) {
+                LOG(ERROR) << "the mesh is not an LOD pyramid (see SurfaceMeshLOD)";
+                return false;
+            }
+
             // open file (in binary mode)
             std::ofstream output(file_name.c_str(), std::fstream::binary);
             if (output.fail()) {
@@ -119,36 +549,36 @@ namespace easy3d {
             }
 
             // how many elements?
-            unsigned int nv, ne, nh, nf;
+            unsigned int nv, nb, nf;
             nv = mesh->n_vertices();
-            ne = mesh->n_edges();
             nf = mesh->n_faces();
-            nh = 2*ne;
+            nb = 0;
+            while (nb < nv && parent.vector()[nb] < 0)
+                ++nb;
 
-            output.write((char*)&nv, sizeof(unsigned int));
-            output.write((char*)&ne, sizeof(unsigned int));
-            output.write((char*)&nf, sizeof(unsigned int));
+            internal::LodHeader header;
+            std::memcpy(header.magic, internal::lod_magic, sizeof(header.magic));
+            header.version = internal::lod_version;
+            header.byte_order = internal::lod_byte_order;
+            header.num_vertices = nv;
+            header.num_base_vertices = nb;
+            header.num_faces = nf;
+            header.reserved = 0;
+            output.write((char*)&header, sizeof(header));
 
-            // get properties
-			auto vconn = mesh->get_vertex_property<SurfaceMesh::VertexConnectivity>("v:connectivity");
-            auto hconn = mesh->get_halfedge_property<SurfaceMesh::HalfedgeConnectivity>("h:connectivity");
-            auto fconn = mesh->get_face_property<SurfaceMesh::FaceConnectivity>("f:connectivity");
             auto point = mesh->get_vertex_property<vec3>("v:point");
-
-            // write properties to file
-            output.write((char*)vconn.data(), static_cast<long>(nv * sizeof(SurfaceMesh::VertexConnectivity)));
-            output.write((char*)hconn.data(), static_cast<long>(nh * sizeof(SurfaceMesh::HalfedgeConnectivity)));
-            output.write((char*)fconn.data(), static_cast<long>(nf * sizeof(SurfaceMesh::FaceConnectivity)));
+            output.write((char*)parent.data(), static_cast<long>(nv * sizeof(int)));
             output.write((char*)point.data(), static_cast<long>(nv * sizeof(vec3)));
 
-            // check for colors
-            auto color = mesh->get_vertex_property<vec3>("v:color");
-            bool has_colors = color;
-            output.write((char*)&has_colors, sizeof(bool));
-            if (has_colors)
-                output.write((char*)color.data(), static_cast<long>(nv * sizeof(vec3)));
+            std::vector<unsigned int> indices;
+            indices.reserve(nf * 3);
+            for (auto f : mesh->faces()) {
+                for (auto v : mesh->vertices(f))
+                    indices.push_back(v.idx());
+            }
+            output.write((char*)indices.data(), static_cast<long>(indices.size() * sizeof(unsigned int)));
 
-            return true;
+            return !output.fail();
         }
 
     }
@@ -0,0 +1,128 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_FILEIO_SURFACE_MESH_IO_SM_H
+#define EASY3D_FILEIO_SURFACE_MESH_IO_SM_H
+
+#include <string>
+
+#include <easy3d/core/surface_mesh.h>
+#include <easy3d/fileio/mapped_property_file.h>
+
+
+namespace easy3d {
+
+    namespace io {
+
+        /**
+         * \brief Read-only access to a surface mesh stored in the native binary (\c sm) format.
+         * \class MappedSurfaceMesh easy3d/fileio/surface_mesh_io_sm.h
+         *
+         * \details The \c sm format stores all the properties of all the elements (i.e., vertices, halfedges, edges,
+         *      faces, and the model), including the connectivity, so a mesh is restored exactly as it was saved. It is
+         *      designed to be memory mapped. An \c sm file is a MappedPropertyFile with the magic string "EASY3DSM",
+         *      and its data blocks are aligned to 64 bytes (i.e., a typical cache line).
+         *
+         *      Example usage:
+         *      \code
+         *      io::MappedSurfaceMesh file;
+         *      if (file.open(file_name)) {
+         *          const vec3* points = file.property<vec3>(io::MappedSurfaceMesh::VERTEX, "v:point");
+         *          if (points) {
+         *              // access points[0], ..., points[file.n_elements(io::MappedSurfaceMesh::VERTEX) - 1]
+         *          }
+         *      }
+         *      \endcode
+         *
+         * \note Properties of the following types are stored: bool, char, unsigned char, int, unsigned int, float,
+         *      double, vec2, vec3, vec4, dvec2, dvec3, dvec4, ivec2, ivec3, ivec4, mat3, mat4, the handles of
+         *      SurfaceMesh, and its connectivity types. Properties of other types are ignored. The version 1 files
+         *      (storing only the connectivity, the points, and the vertex colors) can still be read by load_sm().
+         */
+        class MappedSurfaceMesh : public MappedPropertyFile {
+        public:
+            /// the current version of the \c sm format.
+            static const uint32_t VERSION = 2;
+
+        public:
+            /// opens the \c sm file \p file_name. Only the header and the property directory are read.
+            /// \return true on success.
+            bool open(const std::string &file_name);
+
+            /**
+             * \brief Loads the entire mesh, i.e., all the properties stored in the file, to \p mesh.
+             * \details The data blocks are checked (by their checksums), decompressed, and copied in parallel. The
+             *      connectivity is checked to refer to existing elements only. The existing content of \p mesh is
+             *      cleared.
+             * \return true on success.
+             */
+            bool load(SurfaceMesh *mesh) const;
+
+            /// \brief Saves a surface mesh to an \c sm file.
+            /// \param compress If true, the data blocks are compressed (the blocks that can't be compressed are
+            ///     stored uncompressed). Compressed blocks can't be accessed directly in the mapped file.
+            static bool save(const std::string &file_name, const SurfaceMesh *mesh, bool compress = false);
+
+            /// calls \c visitor.apply<T>() with the type \c T of the value type \p type, including the handles and
+            /// the connectivity types of SurfaceMesh.
+            template<typename Visitor>
+            static bool visit(ValueType type, Visitor &visitor);
+        };
+
+
+        //-------------------------- IMPLEMENTATION ---------------------------
+
+        /// \cond
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<SurfaceMesh::Vertex>() { return VERTEX_HANDLE; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<SurfaceMesh::Halfedge>() { return HALFEDGE_HANDLE; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<SurfaceMesh::Edge>() { return EDGE_HANDLE; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<SurfaceMesh::Face>() { return FACE_HANDLE; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<SurfaceMesh::VertexConnectivity>() { return VERTEX_CONNECTIVITY; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<SurfaceMesh::HalfedgeConnectivity>() { return HALFEDGE_CONNECTIVITY; }
+        template<> inline MappedPropertyFile::ValueType MappedPropertyFile::value_type<SurfaceMesh::FaceConnectivity>() { return FACE_CONNECTIVITY; }
+        /// \endcond
+
+
+        template<typename Visitor>
+        bool MappedSurfaceMesh::visit(ValueType type, Visitor &visitor) {
+            switch (type) {
+                case VERTEX_HANDLE:         return visitor.template apply<SurfaceMesh::Vertex>();
+                case HALFEDGE_HANDLE:       return visitor.template apply<SurfaceMesh::Halfedge>();
+                case EDGE_HANDLE:           return visitor.template apply<SurfaceMesh::Edge>();
+                case FACE_HANDLE:           return visitor.template apply<SurfaceMesh::Face>();
+                case VERTEX_CONNECTIVITY:   return visitor.template apply<SurfaceMesh::VertexConnectivity>();
+                case HALFEDGE_CONNECTIVITY: return visitor.template apply<SurfaceMesh::HalfedgeConnectivity>();
+                case FACE_CONNECTIVITY:     return visitor.template apply<SurfaceMesh::FaceConnectivity>();
+                default:                    return MappedPropertyFile::visit(type, visitor);
+            }
+        }
+
+    } // namespace io
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_FILEIO_SURFACE_MESH_IO_SM_H
@@ -176,6 +176,9 @@ namespace easy3d {
 				// read number of triangles
 				read(in, nT);
 
+				// reserve memory (for a closed triangle mesh: #V ~ #T/2, #E ~ 3#T/2)
+				mesh->reserve(nT / 2, nT * 3 / 2, nT);
+
 				// read triangles
 				while (nT)
 				{
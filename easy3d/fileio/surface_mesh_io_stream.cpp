@@ -0,0 +1,292 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/fileio/surface_mesh_io.h>
+#include <easy3d/util/memory_mapped_file.h>
+#include <easy3d/util/text_scanner.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/logging.h>
+
+#include <cstring>
+
+#include <3rd_party/rply/rply.h>
+
+
+namespace easy3d {
+
+    namespace io {
+
+        namespace internal {
+
+            typedef std::function<void(const dvec3 &p)> VertexCallback;
+            typedef std::function<void(const std::vector<int> &vertices)> FaceCallback;
+
+            // Some OFF files may skip lines or may have comments starting with '#'
+            static bool next_content_line(TextScanner &scanner) {
+                while (scanner.next_line()) {
+                    if (!scanner.is_blank_or_comment())
+                        return true;
+                }
+                return false;
+            }
+
+
+            static bool stream_off(const std::string &file_name, const VertexCallback &vertex_callback,
+                                   const FaceCallback &face_callback) {
+                MemoryMappedFile file;
+                if (!file.open(file_name))
+                    return false;
+
+                TextScanner scanner(file.data(), file.data() + file.size());
+                next_content_line(scanner);
+
+                std::string magic;
+                scanner.read(magic);
+                if (magic != "OFF" && magic != "NOFF") {
+                    LOG(ERROR) << "Not an OFF file. Key word is: " << magic;
+                    return false;
+                }
+                if (magic != "NOFF")
+                    next_content_line(scanner);
+
+                int nb_vertices, nb_facets, nb_edges;
+                if (!scanner.read(nb_vertices) || !scanner.read(nb_facets) || !scanner.read(nb_edges) ||
+                    nb_vertices < 0 || nb_facets < 0) {
+                    LOG(ERROR) << "An error in the file header: "
+                               << std::string(scanner.line_begin(), scanner.line_end());
+                    return false;
+                }
+
+                dvec3 p;
+                for (int i = 0; i < nb_vertices; ++i) {
+                    if (!next_content_line(scanner)) {
+                        LOG(ERROR) << "unexpected end of file (" << i << " of " << nb_vertices << " vertices read)";
+                        return false;
+                    }
+                    if (!vertex_callback)
+                        continue;
+                    if (!scanner.read(p.x) || !scanner.read(p.y) || !scanner.read(p.z))
+                        LOG_N_TIMES(3, ERROR) << "failed reading the " << i << "_th vertex from file. " << COUNTER;
+                    vertex_callback(p);
+                }
+
+                if (!face_callback)
+                    return true;
+
+                std::vector<int> vertices;
+                for (int i = 0; i < nb_facets; ++i) {
+                    if (!next_content_line(scanner)) {
+                        LOG(ERROR) << "unexpected end of file (" << i << " of " << nb_facets << " faces read)";
+                        return false;
+                    }
+                    int nv = 0;
+                    if (!scanner.read(nv) || nv < 0) {
+                        LOG_N_TIMES(3, ERROR) << "failed reading the " << i << "_th face from file. " << COUNTER;
+                        continue;
+                    }
+                    vertices.resize(nv);
+                    for (int j = 0; j < nv; ++j) {
+                        vertices[j] = -1;
+                        scanner.read(vertices[j]);  // an invalid index (i.e., -1) is left to the caller
+                    }
+                    face_callback(vertices);
+                }
+                return true;
+            }
+
+
+            static bool stream_obj(const std::string &file_name, const VertexCallback &vertex_callback,
+                                   const FaceCallback &face_callback) {
+                MemoryMappedFile file;
+                if (!file.open(file_name))
+                    return false;
+
+                TextScanner scanner(file.data(), file.data() + file.size());
+                std::string keyword, corner;
+                std::vector<int> vertices;
+                dvec3 p;
+                int num_vertices = 0;
+                while (scanner.next_line()) {
+                    if (scanner.is_blank_or_comment() || !scanner.read(keyword))
+                        continue;
+
+                    if (keyword == "v") {
+                        ++num_vertices;
+                        if (vertex_callback) {
+                            if (!scanner.read(p.x) || !scanner.read(p.y) || !scanner.read(p.z))
+                                LOG_N_TIMES(3, ERROR) << "failed reading the " << num_vertices - 1
+                                                      << "_th vertex from file. " << COUNTER;
+                            vertex_callback(p);
+                        }
+                    } else if (keyword == "f" && face_callback) {
+                        // each corner is 'v', 'v/vt', 'v//vn', or 'v/vt/vn', and the indices are 1-based (negative
+                        // indices are relative to the end of the vertices read so far)
+                        vertices.clear();
+                        while (scanner.read(corner)) {
+                            int index = 0;
+                            if (!parse(corner.data(), corner.data() + corner.size(), index) || index == 0)
+                                vertices.push_back(-1);
+                            else
+                                vertices.push_back(index > 0 ? index - 1 : num_vertices + index);
+                        }
+                        face_callback(vertices);
+                    }
+                }
+                return true;
+            }
+
+
+            struct PlyStreamState {
+                const VertexCallback *vertex_callback;
+                const FaceCallback *face_callback;
+                long num_vertices;
+                int last_coordinate;    // the coordinate that comes last in the vertex properties
+                bool done;              // all the requested elements have been read
+                dvec3 point;
+                std::vector<int> vertices;
+            };
+
+
+            static bool stream_ply(const std::string &file_name, const VertexCallback &vertex_callback,
+                                   const FaceCallback &face_callback) {
+                PlyStreamState state;
+                state.vertex_callback = &vertex_callback;
+                state.face_callback = &face_callback;
+                state.num_vertices = 0;
+                state.last_coordinate = 2;
+                state.done = false;
+
+                // stopping after the vertices is reported as an error by rply
+                auto callback_error = [](p_ply ply, const char *message) {
+                    PlyStreamState *state = nullptr;
+                    ply_get_ply_user_data(ply, (void **) (&state), nullptr);
+                    if (!state || !state->done)
+                        LOG(ERROR) << message;
+                };
+
+                p_ply ply = ply_open(file_name.c_str(), callback_error, 0, &state);
+                if (!ply) {
+                    LOG(ERROR) << "failed to open ply file: " << file_name;
+                    return false;
+                }
+
+                if (!ply_read_header(ply)) {
+                    LOG(ERROR) << "failed to read ply header";
+                    ply_close(ply);
+                    return false;
+                }
+
+                auto callback_coordinate = [](p_ply_argument argument) -> int {
+                    PlyStreamState *state = nullptr;
+                    long coordinate = 0;
+                    ply_get_argument_user_data(argument, (void **) (&state), &coordinate);
+                    state->point[coordinate] = ply_get_argument_value(argument);
+                    if (coordinate == state->last_coordinate) {
+                        (*state->vertex_callback)(state->point);
+
+                        // stop reading if the faces are not needed
+                        long instance_index = 0;
+                        ply_get_argument_element(argument, nullptr, &instance_index);
+                        if (instance_index + 1 == state->num_vertices && !(*state->face_callback)) {
+                            state->done = true;
+                            return 0;
+                        }
+                    }
+                    return 1; // returns 1 if should continue processing file, 0 if should abort.
+                };
+
+                auto callback_face = [](p_ply_argument argument) -> int {
+                    PlyStreamState *state = nullptr;
+                    ply_get_argument_user_data(argument, (void **) (&state), nullptr);
+                    long length = 0, value_index = 0;
+                    ply_get_argument_property(argument, nullptr, &length, &value_index);
+                    if (value_index < 0) {  // the length of the list
+                        state->vertices.resize(length);
+                        if (length == 0)
+                            (*state->face_callback)(state->vertices);
+                        return 1;
+                    }
+                    state->vertices[value_index] = static_cast<int>(ply_get_argument_value(argument));
+                    if (value_index + 1 == length)
+                        (*state->face_callback)(state->vertices);
+                    return 1; // returns 1 if should continue processing file, 0 if should abort.
+                };
+
+                p_ply_element element = nullptr;
+                while ((element = ply_get_next_element(ply, element))) {
+                    long num_instances = 0;
+                    const char *element_name = nullptr;
+                    ply_get_element_info(element, &element_name, &num_instances);
+
+                    p_ply_property property = nullptr;
+                    while ((property = ply_get_next_property(element, property))) {
+                        const char *name = nullptr;
+                        e_ply_type type, length_type, value_type;
+                        ply_get_property_info(property, &name, &type, &length_type, &value_type);
+
+                        if (!strcmp(element_name, "vertex") && vertex_callback && type != PLY_LIST) {
+                            const int coordinate = !strcmp(name, "x") ? 0 : !strcmp(name, "y") ? 1 :
+                                                                            !strcmp(name, "z") ? 2 : -1;
+                            if (coordinate >= 0) {
+                                ply_set_read_cb(ply, element_name, name, callback_coordinate, &state, coordinate);
+                                state.last_coordinate = coordinate;
+                                state.num_vertices = num_instances;
+                            }
+                        } else if (!strcmp(element_name, "face") && face_callback && type == PLY_LIST &&
+                                   (!strcmp(name, "vertex_indices") || !strcmp(name, "vertex_index"))) {
+                            ply_set_read_cb(ply, element_name, name, callback_face, &state, 0);
+                        }
+                    }
+                }
+
+                const bool success = ply_read(ply) || state.done;
+                ply_close(ply);
+                if (!success)
+                    LOG(ERROR) << "error occurred while parsing ply file";
+                return success;
+            }
+
+        } // namespace internal
+
+
+        bool stream_surface_mesh(const std::string &file_name,
+                                 const std::function<void(const dvec3 &p)> &vertex_callback,
+                                 const std::function<void(const std::vector<int> &vertices)> &face_callback) {
+            const std::string &ext = file_system::extension(file_name, true);
+            if (ext == "ply")
+                return internal::stream_ply(file_name, vertex_callback, face_callback);
+            else if (ext == "off")
+                return internal::stream_off(file_name, vertex_callback, face_callback);
+            else if (ext == "obj")
+                return internal::stream_obj(file_name, vertex_callback, face_callback);
+
+            LOG(ERROR) << "streaming is not supported for this file format: " << ext;
+            return false;
+        }
+
+    } // namespace io
+
+} // namespace easy3d
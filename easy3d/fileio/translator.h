@@ -27,6 +27,8 @@
 #ifndef EASY3D_FILEIO_TRANSLATOR_H
 #define EASY3D_FILEIO_TRANSLATOR_H
 
+#include <atomic>
+
 #include <easy3d/core/types.h>
 
 
@@ -34,6 +36,9 @@ namespace easy3d {
 
     /**
      * \brief Manages the translation of all the models during the file IO.
+     * \details The translator is shared by all the file readers. The models loaded in the background (see AsyncLoader)
+     *      are loaded one after another if the translator is enabled, so each file reader sees the translation recorded
+     *      by the previous one.
      * \class Translator easy3d/fileio/translator.h
     */
 	class Translator
@@ -79,7 +84,7 @@ namespace easy3d {
         Translator() : status_(DISABLED) {}
 
     private:
-        Status status_;
+        std::atomic<Status> status_;
         dvec3  translation_;
 	};
 
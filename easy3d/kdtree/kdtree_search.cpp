@@ -25,6 +25,9 @@
  ********************************************************************/
 
 #include <easy3d/kdtree/kdtree_search.h>
+#include <algorithm>
+
+#include <easy3d/util/parallel.h>
 
 
 namespace easy3d {
@@ -39,4 +42,80 @@ namespace easy3d {
         (void)points;
     }
 
+
+    void KdTreeSearch::find_closest_k_points(const std::vector<vec3> &queries, int k, Neighbors &neighbors) const {
+        // the implementation is unknown, so it is not safe to run the queries in parallel
+        gather(queries.size(), [&](std::size_t i, std::vector<int> &indices, std::vector<float> &squared_distances) {
+            find_closest_k_points(queries[i], k, indices, squared_distances);
+        }, false, neighbors);
+    }
+
+
+    void KdTreeSearch::find_points_in_range(const std::vector<vec3> &queries, float squared_radius,
+                                            Neighbors &neighbors) const {
+        // the implementation is unknown, so it is not safe to run the queries in parallel
+        gather(queries.size(), [&](std::size_t i, std::vector<int> &indices, std::vector<float> &squared_distances) {
+            find_points_in_range(queries[i], squared_radius, indices, squared_distances);
+        }, false, neighbors);
+    }
+
+
+    void KdTreeSearch::gather(std::size_t num_queries, const SingleQuery &query, bool in_parallel,
+                              Neighbors &neighbors) {
+        neighbors.offsets.assign(num_queries + 1, 0);
+        neighbors.indices.clear();
+        neighbors.squared_distances.clear();
+        if (num_queries == 0)
+            return;
+
+        // each chunk of queries collects its results in its own buffers, which are then concatenated
+        struct Chunk {
+            std::vector<int> indices;
+            std::vector<float> squared_distances;
+        };
+        const std::size_t grain_size = parallel::default_grain_size(num_queries);
+        const std::size_t num_chunks = (num_queries + grain_size - 1) / grain_size;
+        std::vector<Chunk> chunks(num_chunks);
+
+        auto process = [&](std::size_t begin, std::size_t end) {
+            Chunk &chunk = chunks[begin / grain_size];
+            std::vector<int> indices;
+            std::vector<float> squared_distances;
+            for (std::size_t i = begin; i < end; ++i) {
+                indices.clear();
+                squared_distances.clear();
+                query(i, indices, squared_distances);
+                squared_distances.resize(indices.size());
+                chunk.indices.insert(chunk.indices.end(), indices.begin(), indices.end());
+                chunk.squared_distances.insert(chunk.squared_distances.end(), squared_distances.begin(), squared_distances.end());
+                neighbors.offsets[i + 1] = indices.size();
+            }
+        };
+
+        if (in_parallel)
+            parallel::for_each_range(0, num_queries, process, grain_size);
+        else {
+            for (std::size_t begin = 0; begin < num_queries; begin += grain_size)
+                process(begin, std::min(begin + grain_size, num_queries));
+        }
+
+        for (std::size_t i = 0; i < num_queries; ++i)
+            neighbors.offsets[i + 1] += neighbors.offsets[i];
+
+        neighbors.indices.resize(neighbors.offsets.back());
+        neighbors.squared_distances.resize(neighbors.offsets.back());
+        auto concatenate = [&](std::size_t c) {
+            const std::size_t offset = neighbors.offsets[c * grain_size];
+            std::copy(chunks[c].indices.begin(), chunks[c].indices.end(), neighbors.indices.begin() + offset);
+            std::copy(chunks[c].squared_distances.begin(), chunks[c].squared_distances.end(),
+                      neighbors.squared_distances.begin() + offset);
+        };
+        if (in_parallel)
+            parallel::for_each(0, num_chunks, concatenate, 1);
+        else {
+            for (std::size_t c = 0; c < num_chunks; ++c)
+                concatenate(c);
+        }
+    }
+
 } // namespace easy3d
@@ -29,6 +29,7 @@
 
 
 #include <vector>
+#include <functional>
 #include <easy3d/core/types.h>
 
 
@@ -75,9 +76,41 @@ namespace easy3d {
      *\endcode
      *
      * \attention KdTreeSearch_FLANN and KdTreeSearch_NanoFLANN are thread-safe. Others seem not (not tested yet).
+     *      For this reason, the batched queries (i.e., the queries taking a list of query points) run in parallel
+     *      with KdTreeSearch_FLANN and KdTreeSearch_NanoFLANN, and sequentially with the other implementations.
      */
 
     class KdTreeSearch {
+    public:
+        /**
+         * \brief The neighbors of a batch of query points, stored in the compressed sparse row (CSR) format.
+         * \details The neighbors of the i-th query point are indices[offsets[i]], ..., indices[offsets[i+1] - 1],
+         *      and their squared distances to the query point are stored in squared_distances at the same positions.
+         *      Usage example:
+         *      \code
+         *          KdTreeSearch::Neighbors neighbors;
+         *          kdtree.find_closest_k_points(cloud->points(), 16, neighbors);
+         *          for (std::size_t i = 0; i < neighbors.size(); ++i) {
+         *              for (std::size_t j = neighbors.offsets[i]; j < neighbors.offsets[i + 1]; ++j)
+         *                  std::cout << neighbors.indices[j] << ": " << neighbors.squared_distances[j] << std::endl;
+         *          }
+         *      \endcode
+         */
+        struct Neighbors {
+            std::vector<std::size_t> offsets;
+            std::vector<int> indices;
+            std::vector<float> squared_distances;
+
+            /// Returns the number of query points.
+            std::size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+            /// Returns the number of neighbors of the i-th query point.
+            std::size_t count(std::size_t i) const { return offsets[i + 1] - offsets[i]; }
+            /// Returns the indices of the neighbors of the i-th query point.
+            const int *indices_of(std::size_t i) const { return indices.data() + offsets[i]; }
+            /// Returns the squared distances of the neighbors of the i-th query point.
+            const float *squared_distances_of(std::size_t i) const { return squared_distances.data() + offsets[i]; }
+        };
+
     public:
         /**
          * \brief Constructor.
@@ -160,6 +193,43 @@ namespace easy3d {
          */
         virtual void find_points_in_range(const vec3 &p, float squared_radius, std::vector<int> &neighbors) const = 0;
         /// @}
+
+        /// @name Batched queries
+        /// @{
+
+        /**
+         * \brief Queries the K nearest neighbors for a batch of points.
+         * \param queries The query points.
+         * \param k The number of required neighbors. If the point set has less than \p k points, all the points are
+         *      returned.
+         * \param neighbors The neighbors found for all the query points. The neighbors of each query point are
+         *      sorted by increasing distance.
+         */
+        virtual void find_closest_k_points(const std::vector<vec3> &queries, int k, Neighbors &neighbors) const;
+
+        /**
+         * \brief Queries the nearest neighbors within a fixed range for a batch of points.
+         * \param queries The query points.
+         * \param squared_radius The search range (which is required to be \b squared).
+         * \param neighbors The neighbors found for all the query points.
+         */
+        virtual void find_points_in_range(const std::vector<vec3> &queries, float squared_radius,
+                                          Neighbors &neighbors) const;
+        /// @}
+
+    protected:
+        /// The function answering a single query. It overwrites the neighbors (and their squared distances) of the
+        /// i-th query point to the two arrays.
+        typedef std::function<void(std::size_t i, std::vector<int> &, std::vector<float> &)> SingleQuery;
+
+        /**
+         * \brief Answers a batch of queries by calling \p query for each query point, and gathers the results.
+         * \param num_queries The number of query points.
+         * \param query The function answering a single query.
+         * \param in_parallel \c true to process the queries in parallel (\p query must be thread-safe).
+         * \param neighbors The neighbors found for all the query points.
+         */
+        static void gather(std::size_t num_queries, const SingleQuery &query, bool in_parallel, Neighbors &neighbors);
     };
 
 } // namespace easy3d
@@ -214,4 +214,56 @@ namespace easy3d {
     }
 
 
+
+    void KdTreeSearch_ANN::find_closest_k_points(
+        const std::vector<vec3>& queries, int k, Neighbors& neighbors
+    )  const
+    {
+        // ANN is not thread-safe (it uses global variables during the search), so the queries are processed
+        // sequentially. But the results of each query are written directly to their final place.
+        const std::size_t num = queries.size();
+        const std::size_t kk = std::min<std::size_t>(static_cast<std::size_t>(k), static_cast<std::size_t>(points_num_));
+        neighbors.offsets.resize(num + 1);
+        neighbors.indices.resize(num * kk);
+        neighbors.squared_distances.resize(num * kk);
+        for (std::size_t i = 0; i <= num; ++i)
+            neighbors.offsets[i] = i * kk;
+        if (kk == 0)
+            return;
+
+        ANNcoord ann_p[3];
+        for (std::size_t i = 0; i < num; ++i) {
+            const vec3& p = queries[i];
+            ann_p[0] = p[0];
+            ann_p[1] = p[1];
+            ann_p[2] = p[2];
+            get_tree(tree_)->annkSearch(ann_p, static_cast<int>(kk),
+                                        neighbors.indices.data() + i * kk,
+                                        neighbors.squared_distances.data() + i * kk);
+        }
+    }
+
+
+    void KdTreeSearch_ANN::find_points_in_range(
+        const std::vector<vec3>& queries, float squared_radius, Neighbors& neighbors
+    )  const
+    {
+        // ANN is not thread-safe (it uses global variables during the search), so the queries are processed
+        // sequentially
+        gather(queries.size(), [&](std::size_t i, std::vector<int>& indices, std::vector<float>& squared_distances) {
+            ANNcoord ann_p[3];
+            ann_p[0] = queries[i][0];
+            ann_p[1] = queries[i][1];
+            ann_p[2] = queries[i][2];
+
+            indices.resize(k_for_radius_search_);
+            squared_distances.resize(k_for_radius_search_);
+            int n = get_tree(tree_)->annkFRSearch(ann_p, squared_radius, k_for_radius_search_, indices.data(), squared_distances.data());
+
+            const int num = std::min(n, k_for_radius_search_);
+            indices.resize(num);
+            squared_distances.resize(num);
+        }, false, neighbors);
+    }
+
 } // namespace easy3d
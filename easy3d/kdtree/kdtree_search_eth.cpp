@@ -25,6 +25,7 @@
  ********************************************************************/
 
 #include <easy3d/kdtree/kdtree_search_eth.h>
+#include <algorithm>
 #include <easy3d/core/point_cloud.h>
 
 #include <3rd_party/kdtree/ETH_Kd_Tree/kdTree.h>
@@ -246,4 +247,46 @@ namespace easy3d {
     }
 
 
+    void KdTreeSearch_ETH::find_closest_k_points(
+        const std::vector<vec3>& queries, int k, Neighbors& neighbors
+        )  const {
+            // the ETH kd-tree stores the results of a query in the tree itself (so it is not thread-safe), thus the
+            // queries are processed sequentially. But the results of each query are written directly to their
+            // final place.
+            const std::size_t num = queries.size();
+            const int kk = std::min(k, static_cast<int>(points_num_));
+            neighbors.offsets.resize(num + 1);
+            neighbors.indices.resize(num * kk);
+            neighbors.squared_distances.resize(num * kk);
+            for (std::size_t i = 0; i <= num; ++i)
+                neighbors.offsets[i] = i * kk;
+            if (kk <= 0)
+                return;
+
+            get_tree(tree_)->setNOfNeighbours( kk );
+            for (std::size_t i = 0; i < num; ++i) {
+                const vec3& p = queries[i];
+                get_tree(tree_)->queryPosition( kdtree::Vector3D(p.x, p.y, p.z) );
+
+                int* indices = neighbors.indices.data() + i * kk;
+                float* squared_distances = neighbors.squared_distances.data() + i * kk;
+                for (int j=0; j<kk; ++j) {
+                    indices[j] = get_tree(tree_)->getNeighbourPositionIndex(j);
+                    squared_distances[j] = get_tree(tree_)->getSquaredDistance(j);
+                }
+            }
+    }
+
+
+    void KdTreeSearch_ETH::find_points_in_range(
+        const std::vector<vec3>& queries, float squared_radius, Neighbors& neighbors
+        )  const {
+            // the ETH kd-tree stores the results of a query in the tree itself (so it is not thread-safe), thus the
+            // queries are processed sequentially
+            gather(queries.size(), [&](std::size_t i, std::vector<int>& indices, std::vector<float>& squared_distances) {
+                find_points_in_range(queries[i], squared_radius, indices, squared_distances);
+            }, false, neighbors);
+    }
+
+
 } // namespace easy3d
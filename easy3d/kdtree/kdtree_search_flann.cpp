@@ -25,7 +25,9 @@
  ********************************************************************/
 
 #include <easy3d/kdtree/kdtree_search_flann.h>
+#include <algorithm>
 #include <easy3d/core/point_cloud.h>
+#include <easy3d/util/parallel.h>
 
 #include <3rd_party/kdtree/FLANN/flann.hpp>
 
@@ -152,4 +154,39 @@ namespace easy3d {
     }
 
 
+
+    void KdTreeSearch_FLANN::find_closest_k_points(
+        const std::vector<vec3>& queries, int k, Neighbors& neighbors
+    )  const
+    {
+        // every query gets exactly k neighbors (unless the point cloud has less than k points), so FLANN can write
+        // the results of a chunk of queries directly to their final place
+        const std::size_t num = queries.size();
+        const std::size_t kk = std::min<std::size_t>(static_cast<std::size_t>(k), static_cast<std::size_t>(points_num_));
+        neighbors.offsets.resize(num + 1);
+        neighbors.indices.resize(num * kk);
+        neighbors.squared_distances.resize(num * kk);
+        for (std::size_t i = 0; i <= num; ++i)
+            neighbors.offsets[i] = i * kk;
+        if (kk == 0)
+            return;
+
+        parallel::for_each_range(0, num, [&](std::size_t begin, std::size_t end) {
+            flann::Matrix<float> query(const_cast<float*>(queries[begin].data()), end - begin, 3);
+            flann::Matrix<int> indices(neighbors.indices.data() + begin * kk, end - begin, kk);
+            flann::Matrix<float> dists(neighbors.squared_distances.data() + begin * kk, end - begin, kk);
+            get_tree(tree_)->knnSearch(query, indices, dists, kk, flann::SearchParams(checks_));
+        });
+    }
+
+
+    void KdTreeSearch_FLANN::find_points_in_range(
+        const std::vector<vec3>& queries, float squared_radius, Neighbors& neighbors
+    )  const
+    {
+        gather(queries.size(), [&](std::size_t i, std::vector<int>& indices, std::vector<float>& squared_distances) {
+            find_points_in_range(queries[i], squared_radius, indices, squared_distances);
+        }, true, neighbors);
+    }
+
 } // namespace easy3d
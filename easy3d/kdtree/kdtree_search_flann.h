@@ -144,6 +144,34 @@ namespace easy3d {
         ) const override;
         /// @}
 
+        /// @name Batched queries
+        /// @{
+
+        /**
+         * \brief Queries the K nearest neighbors for a batch of points.
+         * \param queries The query points.
+         * \param k The number of required neighbors.
+         * \param neighbors The neighbors found for all the query points.
+         * \note The queries are processed in parallel.
+         */
+        void find_closest_k_points(
+                const std::vector<vec3> &queries, int k,
+                Neighbors &neighbors
+        ) const override;
+
+        /**
+         * \brief Queries the nearest neighbors within a fixed range for a batch of points.
+         * \param queries The query points.
+         * \param squared_radius The search range (which is required to be \b squared).
+         * \param neighbors The neighbors found for all the query points.
+         * \note The queries are processed in parallel.
+         */
+        void find_points_in_range(
+                const std::vector<vec3> &queries, float squared_radius,
+                Neighbors &neighbors
+        ) const override;
+        /// @}
+
     protected:
         int points_num_;
         float *points_; // reference of the original point cloud data
@@ -26,6 +26,7 @@
 
 #include <easy3d/kdtree/kdtree_search_nanoflann.h>
 #include <easy3d/core/point_cloud.h>
+#include <easy3d/util/parallel.h>
 
 #include <3rd_party/kdtree/nanoflann/nanoflann.hpp>
 
@@ -45,7 +46,7 @@ namespace easy3d {
         // Since this is inlined and the "dim" argument is typically an immediate value, the
         //  "if/else's" are actually solved at compile time.
         inline float kdtree_get_pt(const size_t idx, const size_t dim) const {
-            return pts->at(idx)[dim];
+            return (*pts)[idx][dim];
         }
 
         // Optional bounding-box computation: return false to default to a standard bbox computation loop.
@@ -65,6 +66,31 @@ namespace easy3d {
         PointSet* pset_;
     };
 
+    // A result set for radius search. Different from nanoflann::RadiusResultSet, it writes the neighbors directly
+    // to the index and distance arrays (instead of an intermediate array of index-distance pairs).
+    struct RangeResultSet {
+        RangeResultSet(float squared_radius, std::vector<int> &indices, std::vector<float> &squared_distances)
+                : radius(squared_radius), idx(indices), dist(squared_distances) {
+            idx.clear();
+            dist.clear();
+        }
+
+        inline std::size_t size() const { return idx.size(); }
+        inline bool full() const { return true; }
+        inline float worstDist() const { return radius; }
+        inline bool addPoint(float d, int i) {
+            if (d < radius) {
+                idx.push_back(i);
+                dist.push_back(d);
+            }
+            return true;
+        }
+
+        const float radius;
+        std::vector<int> &idx;
+        std::vector<float> &dist;
+    };
+
     #define get_tree(x) (reinterpret_cast<const KdTree *>(x))
 
 
@@ -119,15 +145,16 @@ namespace easy3d {
         const vec3& p, int k, std::vector<int>& neighbors, std::vector<float>& squared_distances
     )  const
     {
-        std::vector<int> indices(k);
-        std::vector<float>	sqr_distances(k);
+        neighbors.resize(k);
+        squared_distances.resize(k);
 
         nanoflann::KNNResultSet<float, int> result_set(k);
-        result_set.init(&indices[0], &sqr_distances[0]);
+        result_set.init(neighbors.data(), squared_distances.data());
         get_tree(tree_)->findNeighbors(result_set, p, nanoflann::SearchParams(10));
 
-        neighbors = std::vector<int>(indices.begin(), indices.end());
-        squared_distances = sqr_distances;
+        // in case the point cloud has less than k points
+        neighbors.resize(result_set.size());
+        squared_distances.resize(result_set.size());
     }
 
 
@@ -143,18 +170,10 @@ namespace easy3d {
     void KdTreeSearch_NanoFLANN::find_points_in_range(
         const vec3& p, float squared_radius, std::vector<int>& neighbors, std::vector<float>& squared_distances
     )  const {
-        std::vector<std::pair<int , float> >   matches;
+        RangeResultSet result_set(squared_radius, neighbors, squared_distances);
         nanoflann::SearchParams params;
         params.sorted = false;
-        const std::size_t num = get_tree(tree_)->radiusSearch(p, squared_radius, matches, params);
-
-        neighbors.resize(num);
-        squared_distances.resize(num);
-        for (std::size_t i = 0; i < num; ++i) {
-            const std::pair<std::size_t, float>& e = matches[i];
-            neighbors[i] = static_cast<int>(e.first);
-            squared_distances[i] = e.second;
-        }
+        get_tree(tree_)->findNeighbors(result_set, p, params);
     }
 
 
@@ -167,4 +186,41 @@ namespace easy3d {
     }
 
 
+
+    void KdTreeSearch_NanoFLANN::find_closest_k_points(
+        const std::vector<vec3>& queries, int k, Neighbors& neighbors
+    )  const
+    {
+        // every query gets exactly k neighbors (unless the point cloud has less than k points), so the results of
+        // each query can be written directly to their final place
+        const std::size_t num = queries.size();
+        const std::size_t kk = std::min<std::size_t>(static_cast<std::size_t>(k), points_->size());
+        neighbors.offsets.resize(num + 1);
+        neighbors.indices.resize(num * kk);
+        neighbors.squared_distances.resize(num * kk);
+        for (std::size_t i = 0; i <= num; ++i)
+            neighbors.offsets[i] = i * kk;
+        if (kk == 0)
+            return;
+
+        parallel::for_each(0, num, [&](std::size_t i) {
+            nanoflann::KNNResultSet<float, int> result_set(kk);
+            result_set.init(neighbors.indices.data() + i * kk, neighbors.squared_distances.data() + i * kk);
+            get_tree(tree_)->findNeighbors(result_set, queries[i], nanoflann::SearchParams(10));
+        });
+    }
+
+
+    void KdTreeSearch_NanoFLANN::find_points_in_range(
+        const std::vector<vec3>& queries, float squared_radius, Neighbors& neighbors
+    )  const
+    {
+        nanoflann::SearchParams params;
+        params.sorted = false;
+        gather(queries.size(), [&](std::size_t i, std::vector<int>& indices, std::vector<float>& squared_distances) {
+            RangeResultSet result_set(squared_radius, indices, squared_distances);
+            get_tree(tree_)->findNeighbors(result_set, queries[i], params);
+        }, true, neighbors);
+    }
+
 } // namespace easy3d
@@ -61,8 +61,12 @@ namespace easy3d {
 
             void get_line() {
                 getline(in_, buffer_);
-                delete line_in_;
-                line_in_ = new std::istringstream(buffer_);
+                // the line stream is reused for all lines (only its content and state are reset)
+                if (line_in_)
+                    line_in_->str(buffer_);
+                else
+                    line_in_ = new std::istringstream(buffer_);
+                line_in_->clear();
             }
 
             std::istream &line() {
@@ -0,0 +1,163 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/util/memory_mapped_file.h>
+#include <easy3d/util/logging.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+
+namespace easy3d {
+
+    MemoryMappedFile::MemoryMappedFile()
+            : data_(nullptr), size_(0)
+#ifdef _WIN32
+            , file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(nullptr)
+#else
+            , file_descriptor_(-1)
+#endif
+    {
+    }
+
+
+    MemoryMappedFile::MemoryMappedFile(const std::string &file_name) : MemoryMappedFile() {
+        open(file_name);
+    }
+
+
+    MemoryMappedFile::~MemoryMappedFile() {
+        close();
+    }
+
+
+    bool MemoryMappedFile::open(const std::string &file_name) {
+        close();
+
+#ifdef _WIN32
+        file_handle_ = ::CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_handle_ == INVALID_HANDLE_VALUE) {
+            LOG(ERROR) << "could not open file: " << file_name;
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!::GetFileSizeEx(file_handle_, &file_size) || file_size.QuadPart == 0) {
+            LOG(ERROR) << "could not map file (empty or unknown size): " << file_name;
+            close();
+            return false;
+        }
+
+        mapping_handle_ = ::CreateFileMappingA(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_handle_) {
+            LOG(ERROR) << "could not map file: " << file_name;
+            close();
+            return false;
+        }
+
+        data_ = static_cast<const char *>(::MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+        if (!data_) {
+            LOG(ERROR) << "could not map file: " << file_name;
+            close();
+            return false;
+        }
+        size_ = static_cast<std::size_t>(file_size.QuadPart);
+#else
+        file_descriptor_ = ::open(file_name.c_str(), O_RDONLY);
+        if (file_descriptor_ == -1) {
+            LOG(ERROR) << "could not open file: " << file_name;
+            return false;
+        }
+
+        struct stat file_stat;
+        if (::fstat(file_descriptor_, &file_stat) == -1 || file_stat.st_size == 0) {
+            LOG(ERROR) << "could not map file (empty or unknown size): " << file_name;
+            close();
+            return false;
+        }
+
+        void *address = ::mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ, MAP_SHARED,
+                               file_descriptor_, 0);
+        if (address == MAP_FAILED) {
+            LOG(ERROR) << "could not map file: " << file_name;
+            close();
+            return false;
+        }
+        data_ = static_cast<const char *>(address);
+        size_ = static_cast<std::size_t>(file_stat.st_size);
+#endif // _WIN32
+
+        file_name_ = file_name;
+        return true;
+    }
+
+
+    void MemoryMappedFile::close() {
+#ifdef _WIN32
+        if (data_)
+            ::UnmapViewOfFile(data_);
+        if (mapping_handle_)
+            ::CloseHandle(mapping_handle_);
+        if (file_handle_ != INVALID_HANDLE_VALUE)
+            ::CloseHandle(file_handle_);
+        mapping_handle_ = nullptr;
+        file_handle_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_)
+            ::munmap(const_cast<char *>(data_), size_);
+        if (file_descriptor_ != -1)
+            ::close(file_descriptor_);
+        file_descriptor_ = -1;
+#endif // _WIN32
+
+        data_ = nullptr;
+        size_ = 0;
+        file_name_.clear();
+    }
+
+
+    void MemoryMappedFile::prefetch(std::size_t offset, std::size_t length) const {
+        if (!data_ || offset >= size_)
+            return;
+        if (length > size_ - offset)
+            length = size_ - offset;
+
+#ifndef _WIN32
+        // madvise() requires a page-aligned address
+        const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t begin = offset / page_size * page_size;
+        ::madvise(const_cast<char *>(data_) + begin, length + (offset - begin), MADV_WILLNEED);
+#endif
+    }
+
+} // namespace easy3d
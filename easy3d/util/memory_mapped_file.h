@@ -0,0 +1,104 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_UTIL_MEMORY_MAPPED_FILE_H
+#define EASY3D_UTIL_MEMORY_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+
+namespace easy3d {
+
+    /**
+     * \brief A read-only memory-mapped file.
+     * \details The content of the file is mapped into the address space of the process, so the data can be accessed
+     *      through a pointer without reading the file into memory first. The pages of the file are loaded by the
+     *      operating system on first access, so only the parts that are actually accessed consume physical memory.
+     *      Usage example:
+     *      \code
+     *          MemoryMappedFile file;
+     *          if (file.open(file_name)) {
+     *              const char* data = file.data();
+     *              // access data[0], ..., data[file.size() - 1]
+     *          }
+     *      \endcode
+     * \class MemoryMappedFile easy3d/util/memory_mapped_file.h
+     */
+    class MemoryMappedFile {
+    public:
+        /// default constructor.
+        MemoryMappedFile();
+        /// opens and maps the file \p file_name. Use is_open() to check if it succeeded.
+        explicit MemoryMappedFile(const std::string &file_name);
+        /// destructor. The file will be unmapped and closed.
+        ~MemoryMappedFile();
+
+        /// opens and maps the entire file \p file_name (read only). A previously opened file will be closed.
+        /// \return true on success.
+        bool open(const std::string &file_name);
+        /// unmaps and closes the file.
+        void close();
+
+        /// returns whether a file has been mapped.
+        bool is_open() const { return data_ != nullptr; }
+
+        /// returns the name of the mapped file.
+        const std::string &file_name() const { return file_name_; }
+        /// returns the pointer to the first byte of the mapped file (nullptr if no file is mapped).
+        const char *data() const { return data_; }
+        /// returns the size of the mapped file (in bytes).
+        std::size_t size() const { return size_; }
+
+        /**
+         * \brief Hints the operating system that the range [\p offset, \p offset + \p length) will be accessed soon.
+         * \details The pages of this range will be loaded in the background. This is only a hint and does nothing on
+         *      platforms that don't support it.
+         */
+        void prefetch(std::size_t offset, std::size_t length) const;
+
+    private:
+        // copying is not allowed
+        MemoryMappedFile(const MemoryMappedFile &);
+        MemoryMappedFile &operator=(const MemoryMappedFile &);
+
+    private:
+        std::string file_name_;
+        const char *data_;
+        std::size_t size_;
+
+#ifdef _WIN32
+        void *file_handle_;
+        void *mapping_handle_;
+#else
+        int   file_descriptor_;
+#endif
+    };
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_UTIL_MEMORY_MAPPED_FILE_H
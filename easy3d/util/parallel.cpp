@@ -0,0 +1,252 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/util/parallel.h>
+
+#include <chrono>
+
+
+namespace easy3d {
+
+    namespace internal {
+        // the pool and the index of the worker executing the current thread (if it is a worker thread)
+        thread_local const ThreadPool *current_pool = nullptr;
+        thread_local std::size_t current_worker = 0;
+    }
+
+
+    ThreadPool::ThreadPool(unsigned int num_threads) : num_pending_(0), stop_(false) {
+        if (num_threads == 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        const std::size_t num_workers = num_threads - 1;
+        for (std::size_t i = 0; i < num_workers; ++i)
+            queues_.emplace_back(new Queue);
+        for (std::size_t i = 0; i < num_workers; ++i)
+            workers_.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        sleep_condition_.notify_all();
+        for (auto &worker : workers_)
+            worker.join();
+    }
+
+
+    void ThreadPool::push(Queue &queue, std::function<void()> &&task) {
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(std::move(task));
+        }
+        ++num_pending_;
+    }
+
+
+    void ThreadPool::wake(bool all) {
+        // acquiring the mutex guarantees that a worker is either before checking its wake-up condition or waiting
+        { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+        if (all)
+            sleep_condition_.notify_all();
+        else
+            sleep_condition_.notify_one();
+    }
+
+
+    bool ThreadPool::execute_one(std::size_t home, bool include_async) {
+        std::function<void()> task;
+
+        // first try the front of the home queue, then steal from the back of the others
+        const std::size_t num_queues = queues_.size();
+        for (std::size_t k = 0; k < num_queues && !task; ++k) {
+            Queue &queue = *queues_[(home + k) % num_queues];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+                continue;
+            if (k == 0) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            } else {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+        }
+
+        if (!task && include_async) {
+            std::lock_guard<std::mutex> lock(async_queue_.mutex);
+            if (!async_queue_.tasks.empty()) {
+                task = std::move(async_queue_.tasks.front());
+                async_queue_.tasks.pop_front();
+            }
+        }
+
+        if (!task)
+            return false;
+
+        --num_pending_;
+        task();
+        return true;
+    }
+
+
+    void ThreadPool::worker_loop(std::size_t index) {
+        internal::current_pool = this;
+        internal::current_worker = index;
+
+        while (true) {
+            if (execute_one(index, true))
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_condition_.wait(lock, [this]() { return stop_ || num_pending_ > 0; });
+            if (stop_ && num_pending_ == 0)
+                return;
+        }
+    }
+
+
+    void ThreadPool::run(std::size_t num_tasks, const std::function<void(std::size_t)> &task) {
+        if (num_tasks == 0)
+            return;
+
+        // the tasks report their progress (and check their cancellation) as the calling thread does
+        ThreadProgress *progress = ThreadProgress::current();
+
+        if (workers_.empty() || num_tasks == 1) {
+            ThreadProgress::Scope scope(progress);
+            for (std::size_t i = 0; i < num_tasks; ++i)
+                task(i);
+            return;
+        }
+
+        struct Batch {
+            explicit Batch(std::size_t num) : remaining(num) {}
+            std::atomic<std::size_t> remaining;
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::exception_ptr error;
+        };
+        auto batch = std::make_shared<Batch>(num_tasks);
+
+        // distribute the tasks over the queues in contiguous blocks (neighboring tasks usually access neighboring
+        // data, so let each worker start with its own block)
+        const std::size_t num_queues = queues_.size();
+        for (std::size_t i = 0; i < num_tasks; ++i) {
+            Queue &queue = *queues_[i * num_queues / num_tasks];
+            push(queue, [batch, &task, i, progress]() {
+                try {
+                    ThreadProgress::Scope scope(progress);
+                    task(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    if (!batch->error)
+                        batch->error = std::current_exception();
+                }
+                if (--batch->remaining == 0) {
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    batch->finished.notify_all();
+                }
+            });
+        }
+        wake(true);
+
+        // help executing the tasks until all tasks of this batch have completed
+        const std::size_t home = (internal::current_pool == this) ? internal::current_worker : 0;
+        while (batch->remaining > 0) {
+            if (execute_one(home, false))
+                continue;
+            // all remaining tasks are being executed by other threads (or are nested tasks that have not been
+            // scheduled yet), so wait for a while and check again
+            std::unique_lock<std::mutex> lock(batch->mutex);
+            batch->finished.wait_for(lock, std::chrono::milliseconds(1), [&batch]() { return batch->remaining == 0; });
+        }
+
+        if (batch->error)
+            std::rethrow_exception(batch->error);
+    }
+
+
+    namespace parallel {
+
+        namespace internal {
+            std::mutex pool_mutex;
+            std::unique_ptr<ThreadPool> shared_pool;
+        }
+
+
+        void set_num_threads(unsigned int num) {
+            std::lock_guard<std::mutex> lock(internal::pool_mutex);
+            internal::shared_pool.reset(new ThreadPool(num));
+        }
+
+
+        unsigned int num_threads() {
+            return pool().num_threads();
+        }
+
+
+        ThreadPool &pool() {
+            std::lock_guard<std::mutex> lock(internal::pool_mutex);
+            if (!internal::shared_pool)
+                internal::shared_pool.reset(new ThreadPool(0));
+            return *internal::shared_pool;
+        }
+
+
+        std::size_t default_grain_size(std::size_t size) {
+            // at most 256 chunks, and at least 64 elements per chunk to amortize the scheduling overhead
+            const std::size_t max_chunks = 256;
+            const std::size_t min_grain = 64;
+            return std::max((size + max_chunks - 1) / max_chunks, min_grain);
+        }
+
+
+        void for_each_range(std::size_t begin, std::size_t end,
+                            const std::function<void(std::size_t, std::size_t)> &func,
+                            std::size_t grain_size) {
+            if (end <= begin)
+                return;
+
+            const std::size_t size = end - begin;
+            if (grain_size == 0)
+                grain_size = default_grain_size(size);
+            const std::size_t num_chunks = (size + grain_size - 1) / grain_size;
+
+            pool().run(num_chunks, [&](std::size_t chunk) {
+                const std::size_t chunk_begin = begin + chunk * grain_size;
+                const std::size_t chunk_end = std::min(chunk_begin + grain_size, end);
+                func(chunk_begin, chunk_end);
+            });
+        }
+
+    }
+
+}
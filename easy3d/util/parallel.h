@@ -0,0 +1,241 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_UTIL_PARALLEL_H
+#define EASY3D_UTIL_PARALLEL_H
+
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+
+#include <easy3d/util/progress.h>
+
+
+namespace easy3d {
+
+    /**
+     * \brief A light-weight work-stealing thread pool.
+     * \details Each worker thread owns a task queue. A worker takes tasks from the front of its own queue, and when
+     *      its queue runs dry, it steals tasks from the back of the queues of the other workers. A thread waiting for
+     *      a batch of tasks (see run()) keeps executing pending tasks instead of sleeping, so parallel loops can be
+     *      nested without deadlocks.
+     *      Usage example:
+     *      \code
+     *          ThreadPool pool(8);
+     *          std::vector<float> values(1000);
+     *          pool.run(values.size(), [&](std::size_t i) { values[i] = std::sqrt(float(i)); });
+     *          std::future<int> answer = pool.async([]() -> int { return 42; });
+     *      \endcode
+     * \note In most cases, you don't need to create your own pool. Use the functions in the \c parallel namespace,
+     *      which run on a shared pool whose size can be changed by parallel::set_num_threads().
+     * \class ThreadPool easy3d/util/parallel.h
+     */
+    class ThreadPool {
+    public:
+        /// \brief Creates a thread pool.
+        /// \param num_threads The number of threads executing the tasks, including the calling thread (which also
+        ///     executes tasks while it waits). So \c num_threads - 1 worker threads are created. A value of 0 means
+        ///     using all the hardware threads.
+        explicit ThreadPool(unsigned int num_threads = 0);
+        /// \brief Destructor. It waits for all scheduled tasks to complete.
+        ~ThreadPool();
+
+        /// \brief Returns the number of threads executing the tasks (including the calling thread).
+        unsigned int num_threads() const { return static_cast<unsigned int>(workers_.size()) + 1; }
+
+        /// \brief Executes \p task(i) for each i in [0, num_tasks) and waits until all of them have completed.
+        /// \details The calling thread participates in the execution. If any of the tasks throws an exception, the
+        ///     first exception is rethrown after all the tasks have completed.
+        void run(std::size_t num_tasks, const std::function<void(std::size_t)> &task);
+
+        /// \brief Schedules \p func for asynchronous execution by a worker thread.
+        /// \return A future holding the return value of \p func (or the exception it throws).
+        /// \note Asynchronous tasks are only executed by the worker threads. If the pool does not have any worker
+        ///     thread (i.e., num_threads() is 1), \p func is executed immediately by the calling thread.
+        template<typename Func>
+        auto async(Func &&func) -> std::future<decltype(func())>;
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()> > tasks;
+        };
+
+        void push(Queue &queue, std::function<void()> &&task);
+        void wake(bool all);
+        bool execute_one(std::size_t home, bool include_async);
+        void worker_loop(std::size_t index);
+
+    private:
+        std::vector<std::thread> workers_;
+        std::vector<std::unique_ptr<Queue> > queues_;   // one per worker thread
+        Queue async_queue_;
+
+        std::mutex sleep_mutex_;
+        std::condition_variable sleep_condition_;
+        std::atomic<std::size_t> num_pending_;
+        bool stop_;
+
+        // non-copyable
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+    };
+
+
+    /**
+     * \brief Parallel loops and reductions running on a shared work-stealing thread pool.
+     * \details A range [begin, end) is split into chunks whose boundaries depend only on the range and the grain size,
+     *      i.e., not on the number of threads or on the timing of the threads. Reductions combine the per-chunk
+     *      results in chunk order. Therefore, the results are deterministic and identical for any number of threads.
+     *      Usage example:
+     *      \code
+     *          parallel::set_num_threads(8);
+     *          parallel::for_each(0, normals.size(), [&](std::size_t i) {
+     *              normals[i].normalize();
+     *          });
+     *          float area = parallel::reduce(0, areas.size(), 0.0f,
+     *              [&](std::size_t begin, std::size_t end) -> float {
+     *                  float sum = 0.0f;
+     *                  for (std::size_t i = begin; i < end; ++i) sum += areas[i];
+     *                  return sum;
+     *              },
+     *              std::plus<float>()
+     *          );
+     *      \endcode
+     */
+    namespace parallel {
+
+        /// \brief Sets the number of threads used by the parallel algorithms of Easy3D.
+        /// \param num The number of threads. A value of 0 means using all the hardware threads (this is the
+        ///     default), and a value of 1 disables multithreading.
+        /// \attention Don't call this function while a parallel algorithm is running.
+        void set_num_threads(unsigned int num);
+
+        /// \brief Returns the number of threads used by the parallel algorithms of Easy3D.
+        unsigned int num_threads();
+
+        /// \brief Returns the shared thread pool.
+        ThreadPool &pool();
+
+        /// \brief Returns the default number of elements in a chunk for splitting a range of \p size elements.
+        /// \note The returned value depends only on \p size.
+        std::size_t default_grain_size(std::size_t size);
+
+        /// \brief Calls \p func(chunk_begin, chunk_end) for each chunk of the range [begin, end) in parallel.
+        /// \param grain_size The number of elements in a chunk. A value of 0 means using default_grain_size().
+        void for_each_range(std::size_t begin, std::size_t end,
+                            const std::function<void(std::size_t, std::size_t)> &func,
+                            std::size_t grain_size = 0);
+
+        /// \brief Calls \p func(i) for each i in the range [begin, end) in parallel.
+        /// \param grain_size The number of elements in a chunk. A value of 0 means using default_grain_size().
+        template<typename Func>
+        void for_each(std::size_t begin, std::size_t end, const Func &func, std::size_t grain_size = 0);
+
+        /// \brief Parallel reduction over the range [begin, end).
+        /// \param identity The initial value of the reduction.
+        /// \param func The function computing the partial result of a chunk, i.e., \p func(chunk_begin, chunk_end).
+        /// \param combine The function combining two partial results. The partial results are combined in chunk
+        ///     order, so the result does not depend on the number of threads.
+        /// \param grain_size The number of elements in a chunk. A value of 0 means using default_grain_size().
+        template<typename T, typename Func, typename Combine>
+        T reduce(std::size_t begin, std::size_t end, const T &identity, const Func &func, const Combine &combine,
+                 std::size_t grain_size = 0);
+
+    }
+
+
+
+    //-------------------------- IMPLEMENTATION ---------------------------
+
+
+    template<typename Func>
+    auto ThreadPool::async(Func &&func) -> std::future<decltype(func())> {
+        typedef decltype(func()) Result;
+        auto task = std::make_shared<std::packaged_task<Result()> >(std::forward<Func>(func));
+        std::future<Result> result = task->get_future();
+        if (workers_.empty())
+            (*task)();
+        else {
+            push(async_queue_, [task]() {
+                // an independent job: it doesn't report to the ProgressClient (see ThreadProgress)
+                ThreadProgress::Scope scope(nullptr);
+                (*task)();
+            });
+            wake(false);
+        }
+        return result;
+    }
+
+
+    namespace parallel {
+
+        template<typename Func>
+        void for_each(std::size_t begin, std::size_t end, const Func &func, std::size_t grain_size) {
+            for_each_range(begin, end, [&func](std::size_t chunk_begin, std::size_t chunk_end) {
+                for (std::size_t i = chunk_begin; i < chunk_end; ++i)
+                    func(i);
+            }, grain_size);
+        }
+
+
+        template<typename T, typename Func, typename Combine>
+        T reduce(std::size_t begin, std::size_t end, const T &identity, const Func &func, const Combine &combine,
+                 std::size_t grain_size) {
+            if (end <= begin)
+                return identity;
+
+            const std::size_t size = end - begin;
+            if (grain_size == 0)
+                grain_size = default_grain_size(size);
+            const std::size_t num_chunks = (size + grain_size - 1) / grain_size;
+
+            std::vector<T> partial(num_chunks, identity);
+            pool().run(num_chunks, [&](std::size_t chunk) {
+                const std::size_t chunk_begin = begin + chunk * grain_size;
+                const std::size_t chunk_end = std::min(chunk_begin + grain_size, end);
+                partial[chunk] = func(chunk_begin, chunk_end);
+            });
+
+            T result = identity;
+            for (const auto &value : partial)
+                result = combine(result, value);
+            return result;
+        }
+
+    }
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_UTIL_PARALLEL_H
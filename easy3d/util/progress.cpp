@@ -11,6 +11,7 @@
 #include <easy3d/util/progress.h>
 
 #include <cassert>
+#include <thread>
 #include <algorithm>	// for std::min and std::max
 
 
@@ -25,7 +26,13 @@ namespace easy3d {
 
             virtual void notify(std::size_t percent, bool update_viewer);
 
-            void set_client(ProgressClient *c) { client_ = c; }
+            void set_client(ProgressClient *c) {
+                client_ = c;
+                client_thread_ = std::this_thread::get_id();
+            }
+
+            // true if the calling thread is the one that created the client (i.e., usually the GUI thread)
+            bool is_client_thread() const { return client_ && std::this_thread::get_id() == client_thread_; }
 
             void push();
             void pop();
@@ -40,8 +47,9 @@ namespace easy3d {
             virtual ~Progress() = default;
 
             ProgressClient *client_;
+            std::thread::id client_thread_;
             int level_;
-            bool canceled_;
+            std::atomic<bool> canceled_;    // also checked by the loggers of the other threads
         };
 
         Progress* Progress::instance() {
@@ -82,13 +90,85 @@ namespace easy3d {
     //_________________________________________________________
 
 
+    namespace internal {
+        // the redirection of the calling thread
+        static thread_local ThreadProgress *thread_progress = nullptr;
+        // true if the calling thread is running a task spawned on the thread pool
+        static thread_local bool thread_spawned = false;
+    }
+
+
+    ThreadProgress::ThreadProgress(const std::function<void(std::size_t)> &notify, const std::atomic<bool> &canceled)
+            : notify_(notify)
+            , canceled_(canceled)
+            , previous_(internal::thread_progress)
+            , previous_spawned_(internal::thread_spawned)
+    {
+        internal::thread_progress = this;
+        internal::thread_spawned = false;   // this thread reports the progress of its own job
+    }
+
+
+    ThreadProgress::~ThreadProgress() {
+        internal::thread_progress = previous_;
+        internal::thread_spawned = previous_spawned_;
+    }
+
+
+    ThreadProgress *ThreadProgress::current() {
+        return internal::thread_progress;
+    }
+
+
+    bool ThreadProgress::is_spawned() {
+        return internal::thread_spawned;
+    }
+
+
+    ThreadProgress::Scope::Scope(ThreadProgress *progress)
+            : previous_(internal::thread_progress)
+            , previous_spawned_(internal::thread_spawned)
+    {
+        internal::thread_progress = progress;
+        internal::thread_spawned = true;
+    }
+
+
+    ThreadProgress::Scope::~Scope() {
+        internal::thread_progress = previous_;
+        internal::thread_spawned = previous_spawned_;
+    }
+
+    //_________________________________________________________
+
+
     ProgressLogger::ProgressLogger(std::size_t max_val, bool update_viewer, bool quiet)
             : max_val_(max_val)
             , cur_val_(0)
             , cur_percent_(0)
             , quiet_(quiet)
             , update_viewer_(update_viewer)
+            , thread_progress_(ThreadProgress::current())
+            , global_(false)
     {
+        // The loggers of the tasks spawned on the thread pool only check the cancellation (the progress of the job
+        // is reported by the spawning thread). The loggers of the threads other than the one of the ProgressClient
+        // don't report to it, because it is not thread-safe.
+        const bool spawned = ThreadProgress::is_spawned();
+        global_ = !thread_progress_ && !spawned && internal::Progress::instance()->is_client_thread();
+        if (spawned || (!thread_progress_ && !global_))
+            quiet_ = true;
+
+        // Remember the redirection at construction, so the progress is reported correctly even if a (parallel) task
+        // calls next() from another thread.
+        if (thread_progress_) {
+            if (!quiet_)
+                thread_progress_->notify(0);
+            return;
+        }
+
+        if (!global_)
+            return;
         internal::Progress::instance()->push();
         if (!quiet_) {
             internal::Progress::instance()->notify(0, update_viewer_);
@@ -98,6 +178,14 @@ namespace easy3d {
 
     ProgressLogger::~ProgressLogger() {
         // one more notification to make sure the progress reaches its end
+        if (thread_progress_) {
+            if (!quiet_)
+                thread_progress_->notify(100);
+            return;
+        }
+
+        if (!global_)
+            return;
         internal::Progress::instance()->notify(100, update_viewer_);
         internal::Progress::instance()->pop();
     }
@@ -116,6 +204,8 @@ namespace easy3d {
 
 
     bool ProgressLogger::is_canceled() const {
+        if (thread_progress_)
+            return thread_progress_->is_canceled();
         return internal::Progress::instance()->is_canceled();
     }
 
@@ -131,7 +221,10 @@ namespace easy3d {
         if (percent != cur_percent_) {
             cur_percent_ = percent;
             if (!quiet_) {
-                internal::Progress::instance()->notify(std::min<std::size_t>(cur_percent_, 100), update_viewer_);
+                if (thread_progress_)
+                    thread_progress_->notify(std::min<std::size_t>(cur_percent_, 100));
+                else if (global_)
+                    internal::Progress::instance()->notify(std::min<std::size_t>(cur_percent_, 100), update_viewer_);
             }
         }
     }
@@ -13,6 +13,8 @@
 
 
 #include <string>
+#include <atomic>
+#include <functional>
 
 
 namespace easy3d {
@@ -31,8 +33,75 @@ namespace easy3d {
 
     //_________________________________________________________
 
+    /**
+     * \brief Redirects the progress reported by the calling thread, e.g., a worker thread loading a model in the
+     *      background.
+     * \details While an instance is alive, the ProgressLoggers created by the same thread report their progress to
+     *      \p notify (instead of the ProgressClient, which is not thread-safe and usually updates the GUI), and their
+     *      is_canceled() returns the value of \p canceled. So a task running in the background can be monitored and
+     *      canceled without interfering with the progress of the other tasks.
+     *
+     *      The redirection is propagated to the tasks spawned by the thread on the thread pool (e.g., by
+     *      parallel::for_each()), see Scope. The ProgressLoggers created by these tasks only check the cancellation
+     *      flag, and they don't report any progress (the progress of the whole job is reported by the spawning thread).
+     * \class ThreadProgress easy3d/util/progress.h
+     */
+    class ThreadProgress {
+    public:
+        /// \param notify The function receiving the progress (in percent). It is called by the thread running the
+        ///     task, so it must be thread-safe.
+        /// \param canceled The flag for cooperative cancellation. It must outlive this instance.
+        ThreadProgress(const std::function<void(std::size_t percent)> &notify, const std::atomic<bool> &canceled);
+        ~ThreadProgress();
+
+        void notify(std::size_t percent) const { if (notify_) notify_(percent); }
+        bool is_canceled() const { return canceled_; }
+
+        /// Returns the instance of the calling thread (nullptr if the progress of the thread is not redirected).
+        static ThreadProgress *current();
+
+        /// Returns true if the calling thread is running a task spawned on the thread pool (see Scope).
+        static bool is_spawned();
+
+        /**
+         * \brief Marks the calling thread as running a task spawned by another thread, and redirects its progress to
+         *      the redirection of the spawning thread (which can be nullptr), while an instance is alive.
+         * \details The thread pool creates an instance for each task it executes. The ProgressLoggers created by a
+         *      spawned task don't report any progress, and they never access the (non thread-safe) ProgressClient.
+         */
+        class Scope {
+        public:
+            explicit Scope(ThreadProgress *progress);
+            ~Scope();
+
+        private:
+            ThreadProgress *previous_;
+            bool previous_spawned_;
+
+            // non-copyable
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+        };
+
+    private:
+        std::function<void(std::size_t)> notify_;
+        const std::atomic<bool> &canceled_;
+        ThreadProgress *previous_;
+        bool previous_spawned_;
+
+        // non-copyable
+        ThreadProgress(const ThreadProgress &) = delete;
+        ThreadProgress &operator=(const ThreadProgress &) = delete;
+    };
+
+    //_________________________________________________________
+
     /**
      * \brief An implementation of progress logging mechanism.
+     * \details The progress is reported to the ThreadProgress of the creating thread if its progress is redirected,
+     *      otherwise to the ProgressClient. As the ProgressClient is not thread-safe, only the loggers created by the
+     *      thread that created the ProgressClient (i.e., usually the GUI thread) report to it. The loggers created by
+     *      the other threads and by the tasks running on the thread pool are quiet.
      * \class ProgressLogger easy3d/util/progress.h
      */
     class ProgressLogger {
@@ -63,6 +132,8 @@ namespace easy3d {
         std::size_t cur_percent_;
         bool quiet_;
         bool update_viewer_;
+        ThreadProgress *thread_progress_;   // non-null if the progress of the creating thread is redirected
+        bool global_;                       // true if the progress is reported to the (global) ProgressClient
     };
 
     /// A simple progress indicator for console applications. Given percentage = 0.75, the output looks like
@@ -0,0 +1,252 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/util/text_scanner.h>
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <climits>
+#include <algorithm>
+
+
+namespace easy3d {
+
+    namespace io {
+
+        /// \cond
+        namespace internal {
+
+            inline bool is_blank(char c) {
+                return c == ' ' || c == '\t' || c == '\r';
+            }
+
+            inline bool is_digit(char c) {
+                return c >= '0' && c <= '9';
+            }
+
+            // the powers of ten that are exactly representable by a double
+            const double exact_powers_of_ten[] = {
+                    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            // Handles what the fast path can't: too many digits, huge/tiny exponents, "nan", "inf", etc.
+            const char *parse_slow(const char *first, const char *last, double &value) {
+                char buffer[128];
+                const std::size_t n = std::min<std::size_t>(static_cast<std::size_t>(last - first), sizeof(buffer) - 1);
+                std::memcpy(buffer, first, n);
+                buffer[n] = '\0';
+                char *end = nullptr;
+                value = std::strtod(buffer, &end);
+                if (end == buffer)
+                    return nullptr;
+                return first + (end - buffer);
+            }
+        }
+        /// \endcond
+
+
+        const char *parse(const char *first, const char *last, double &value) {
+            while (first < last && internal::is_blank(*first))
+                ++first;
+            if (first >= last)
+                return nullptr;
+
+            const char *p = first;
+            bool negative = false;
+            if (*p == '-' || *p == '+') {
+                negative = (*p == '-');
+                ++p;
+            }
+
+            // The number is mantissa * 10^exponent. If the mantissa has at most 19 significant digits (so it fits in
+            // 64 bits), is exactly representable by a double, and the exponent is small, the result of a single
+            // multiplication/division is correctly rounded (Clinger's fast path).
+            uint64_t mantissa = 0;
+            int num_digits = 0;
+            int exponent = 0;
+            bool has_digits = false;
+            for (; p < last && internal::is_digit(*p); ++p) {
+                has_digits = true;
+                const int d = *p - '0';
+                if (mantissa == 0 && d == 0)
+                    continue;
+                if (num_digits == 19)
+                    return internal::parse_slow(first, last, value);
+                mantissa = mantissa * 10 + d;
+                ++num_digits;
+            }
+            if (p < last && *p == '.') {
+                for (++p; p < last && internal::is_digit(*p); ++p) {
+                    has_digits = true;
+                    const int d = *p - '0';
+                    --exponent;
+                    if (mantissa == 0 && d == 0)
+                        continue;
+                    if (num_digits == 19)
+                        return internal::parse_slow(first, last, value);
+                    mantissa = mantissa * 10 + d;
+                    ++num_digits;
+                }
+            }
+            if (!has_digits)    // maybe "nan" or "inf"
+                return internal::parse_slow(first, last, value);
+
+            if (p < last && (*p == 'e' || *p == 'E')) {
+                const char *q = p + 1;
+                bool negative_exponent = false;
+                if (q < last && (*q == '-' || *q == '+')) {
+                    negative_exponent = (*q == '-');
+                    ++q;
+                }
+                if (q < last && internal::is_digit(*q)) {
+                    int e = 0;
+                    for (; q < last && internal::is_digit(*q); ++q) {
+                        if (e < 100000)
+                            e = e * 10 + (*q - '0');
+                    }
+                    exponent += negative_exponent ? -e : e;
+                    p = q;
+                }
+            }
+
+            if (mantissa == 0) {
+                value = negative ? -0.0 : 0.0;
+                return p;
+            }
+            if (mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+                return internal::parse_slow(first, last, value);
+
+            double v = static_cast<double>(mantissa);
+            if (exponent < 0)
+                v /= internal::exact_powers_of_ten[-exponent];
+            else
+                v *= internal::exact_powers_of_ten[exponent];
+            value = negative ? -v : v;
+            return p;
+        }
+
+
+        const char *parse(const char *first, const char *last, float &value) {
+            double v;
+            const char *p = parse(first, last, v);
+            if (p)
+                value = static_cast<float>(v);
+            return p;
+        }
+
+
+        const char *parse(const char *first, const char *last, int &value) {
+            while (first < last && internal::is_blank(*first))
+                ++first;
+
+            const char *p = first;
+            bool negative = false;
+            if (p < last && (*p == '-' || *p == '+')) {
+                negative = (*p == '-');
+                ++p;
+            }
+            if (p >= last || !internal::is_digit(*p))
+                return nullptr;
+
+            long long v = 0;
+            for (; p < last && internal::is_digit(*p); ++p) {
+                v = v * 10 + (*p - '0');
+                if (v > static_cast<long long>(INT_MAX) + 1)
+                    return nullptr;     // overflow
+            }
+            if (negative)
+                v = -v;
+            if (v > INT_MAX)
+                return nullptr;
+            value = static_cast<int>(v);
+            return p;
+        }
+
+
+        const char *parse(const char *first, const char *last, std::string &word) {
+            while (first < last && internal::is_blank(*first))
+                ++first;
+            const char *p = first;
+            while (p < last && !internal::is_blank(*p))
+                ++p;
+            if (p == first)
+                return nullptr;
+            word.assign(first, p);
+            return p;
+        }
+
+
+        bool TextScanner::next_line() {
+            if (next_ >= end_)
+                return false;
+
+            line_begin_ = next_;
+            const auto newline = static_cast<const char *>(std::memchr(next_, '\n', static_cast<std::size_t>(end_ - next_)));
+            if (newline) {
+                line_end_ = newline;
+                next_ = newline + 1;
+            } else {
+                line_end_ = end_;
+                next_ = end_;
+            }
+            if (line_end_ > line_begin_ && *(line_end_ - 1) == '\r')   // files created on Windows
+                --line_end_;
+            cursor_ = line_begin_;
+            return true;
+        }
+
+
+        bool TextScanner::is_blank_or_comment(char comment) const {
+            const char *p = line_begin_;
+            while (p < line_end_ && internal::is_blank(*p))
+                ++p;
+            return p == line_end_ || *p == comment;
+        }
+
+
+        std::vector<const char *> split_lines(const char *begin, const char *end, std::size_t num_chunks) {
+            std::vector<const char *> boundaries(1, begin);
+            const std::size_t size = static_cast<std::size_t>(end - begin);
+            for (std::size_t i = 1; i < num_chunks; ++i) {
+                const char *pos = begin + size / num_chunks * i;
+                if (pos <= boundaries.back())
+                    continue;
+                // move to the beginning of the next line (pos - 1 handles pos already being a line beginning)
+                const auto newline = static_cast<const char *>(std::memchr(pos - 1, '\n', static_cast<std::size_t>(end - pos + 1)));
+                if (!newline || newline + 1 >= end)
+                    break;
+                if (newline + 1 > boundaries.back())
+                    boundaries.push_back(newline + 1);
+            }
+            boundaries.push_back(end);
+            return boundaries;
+        }
+
+    } // namespace io
+
+} // namespace easy3d
@@ -0,0 +1,127 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#ifndef EASY3D_UTIL_TEXT_SCANNER_H
+#define EASY3D_UTIL_TEXT_SCANNER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+namespace easy3d {
+
+    namespace io {
+
+        /**
+         * \brief Parses a number from the characters in [\p first, \p last).
+         * \details Leading blanks (i.e., spaces, tabs, and carriage returns) are skipped. The parsing doesn't copy
+         *      the characters and doesn't need a null-terminated string, which allows parsing memory-mapped files
+         *      directly. Floating point numbers are parsed exactly (the rare cases not handled by the fast path
+         *      are delegated to std::strtod()).
+         * \return The pointer to the first character following the number, or nullptr if no number was found.
+         */
+        const char *parse(const char *first, const char *last, double &value);
+        /// \copydoc parse(const char *first, const char *last, double &value)
+        const char *parse(const char *first, const char *last, float &value);
+        /// \copydoc parse(const char *first, const char *last, double &value)
+        const char *parse(const char *first, const char *last, int &value);
+        /// \brief Parses a word (i.e., a sequence of non-blank characters) from the characters in [\p first, \p last).
+        /// \return The pointer to the first character following the word, or nullptr if no word was found.
+        const char *parse(const char *first, const char *last, std::string &word);
+
+
+        /**
+         * \brief A zero-copy line-by-line scanner for ASCII text stored in memory (e.g., a memory-mapped file).
+         * \details Different from LineInputStream, TextScanner doesn't copy the lines and doesn't allocate any
+         *      memory. Usage example:
+         *      \code
+         *          TextScanner scanner(file.data(), file.data() + file.size());
+         *          while (scanner.next_line()) {
+         *              if (scanner.is_blank_or_comment())
+         *                  continue;
+         *              double x, y, z;
+         *              if (scanner.read(x) && scanner.read(y) && scanner.read(z)) {
+         *                  // use x, y, z
+         *              }
+         *          }
+         *      \endcode
+         * \class TextScanner easy3d/util/text_scanner.h
+         */
+        class TextScanner {
+        public:
+            /// constructs a scanner for the text in [\p begin, \p end).
+            TextScanner(const char *begin, const char *end)
+                    : next_(begin), end_(end), line_begin_(begin), line_end_(begin), cursor_(begin) {}
+
+            /// moves to the next line.
+            /// \return false if there are no more lines.
+            bool next_line();
+
+            /// returns the first character of the current line.
+            const char *line_begin() const { return line_begin_; }
+            /// returns the end of the current line (the line break is not included).
+            const char *line_end() const { return line_end_; }
+            /// returns the beginning of the next line, i.e., how far the text has been scanned.
+            const char *position() const { return next_; }
+
+            /// returns whether the current line is empty, contains only blanks, or starts with \p comment.
+            bool is_blank_or_comment(char comment = '#') const;
+
+            /// reads the next value of the current line.
+            /// \return false if the line has no more values, or the next characters are not a number.
+            template<typename T>
+            bool read(T &value) {
+                const char *p = parse(cursor_, line_end_, value);
+                if (!p)
+                    return false;
+                cursor_ = p;
+                return true;
+            }
+
+        private:
+            const char *next_;          // the beginning of the next line
+            const char *end_;           // the end of the text
+            const char *line_begin_;
+            const char *line_end_;
+            const char *cursor_;        // the parsing position in the current line
+        };
+
+
+        /**
+         * \brief Splits the text [\p begin, \p end) into chunks of complete lines.
+         * \details The text is split into about \p num_chunks chunks of similar sizes, and each split position is
+         *      moved to the beginning of the next line. The chunks can then be parsed in parallel.
+         * \return The boundaries of the chunks: the i-th chunk is [result[i], result[i + 1]).
+         */
+        std::vector<const char *> split_lines(const char *begin, const char *end, std::size_t num_chunks);
+
+    } // namespace io
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_UTIL_TEXT_SCANNER_H
@@ -57,8 +57,6 @@
 #include <easy3d/fileio/graph_io.h>
 #include <easy3d/fileio/surface_mesh_io.h>
 #include <easy3d/fileio/poly_mesh_io.h>
-#include <easy3d/fileio/ply_reader_writer.h>
-#include <easy3d/fileio/point_cloud_io_ptx.h>
 #include <easy3d/util/dialog.h>
 #include <easy3d/util/file_system.h>
 #include <easy3d/util/logging.h>
@@ -107,6 +105,7 @@ namespace easy3d {
         , drawable_axes_(nullptr)
         , show_camera_path_(false)
         , model_idx_(-1)
+        , loader_(nullptr)
     {
         // Avoid locale-related number parsing issues.
         setlocale(LC_NUMERIC, "C");
@@ -571,6 +570,11 @@ namespace easy3d {
         if (!window_)
             return;
 
+        // cancel the models being loaded (and wait for the workers)
+        delete loader_;
+        loader_ = nullptr;
+        loading_models_.clear();
+
         delete camera_;
         delete kfi_;
         delete drawable_axes_;
@@ -1120,6 +1124,9 @@ namespace easy3d {
                     }
                 }
 
+                if (!loading_models_.empty())
+                    add_loaded_models();
+
                 pre_draw();
                 draw();
                 post_draw();
@@ -1210,37 +1217,59 @@ namespace easy3d {
             }
         }
 
-        const std::string &ext = file_system::extension(file_name, true);
-        bool is_ply_mesh = false;
-        if (ext == "ply")
-            is_ply_mesh = (io::PlyReader::num_instances(file_name, "face") > 0);
-
+        const std::vector<Model *> models = AsyncLoader::load_models(file_name);
         Model *model = nullptr;
-        if ((ext == "ply" && is_ply_mesh) || ext == "obj" || ext == "off" || ext == "stl" || ext == "sm" || ext == "geojson" || ext == "trilist") { // mesh
-            model = SurfaceMeshIO::load(file_name);
-        } else if (ext == "ply" && io::PlyReader::num_instances(file_name, "edge") > 0) {
-            model = GraphIO::load(file_name);
-        } else if (ext == "plm" || ext == "pm" || ext == "mesh") {
-            model = PolyMeshIO::load(file_name);
-        }
-        else { // point cloud
-            if (ext == "ptx") {
-                io::PointCloudIO_ptx serializer(file_name);
-                PointCloud *cloud = nullptr;
-                while ((cloud = serializer.load_next())) {
-                    model = add_model(cloud, create_default_drawables);
-                    update();
-                }
-                return model;   // returns the last cloud in the file.
-            } else
-                model = PointCloudIO::load(file_name);
+        for (auto m : models) {
+            model = add_model(m, create_default_drawables);
+            if (models.size() > 1)  // e.g., a PTX file with multiple point clouds
+                update();
         }
+        return model;   // returns the last model in the file.
+    }
+
+
+    AsyncLoader::Handle Viewer::add_model_async(const std::string &file_path, bool create_default_drawables) {
+        if (!loader_)
+            loader_ = new AsyncLoader;
+
+        // wake up the rendering loop when loading completes
+        AsyncLoader::Handle task = loader_->load(file_path, [this](const AsyncLoader::Handle &) { update(); });
+        loading_models_.emplace_back(task, create_default_drawables);
+        return task;
+    }
 
-        if (model) {
-            model->set_name(file_name);
-            add_model(model, create_default_drawables);
+
+    bool Viewer::add_loaded_models() {
+        for (auto it = loading_models_.begin(); it != loading_models_.end(); ++it) {
+            if (!it->first->is_done())
+                continue;
+
+            const AsyncLoader::Handle task = it->first;
+            const bool create_default_drawables = it->second;
+            loading_models_.erase(it);
+
+            bool added = false;
+            for (auto model : task->take()) {
+                bool exists = false;
+                for (auto m : models_) {
+                    if (m->name() == model->name()) {
+                        LOG(WARNING) << "model has already been added to the viewer: " << model->name();
+                        exists = true;
+                        break;
+                    }
+                }
+                if (exists)
+                    delete model;
+                else
+                    added = add_model(model, create_default_drawables) || added;
+            }
+
+            // the remaining ones will be added in the next frames
+            if (!loading_models_.empty())
+                update();
+            return added;
         }
-        return model;
+        return false;
     }
 
 
@@ -1371,7 +1400,7 @@ namespace easy3d {
         const std::string &default_path = resource::directory() + "/data/";
         const std::vector<std::string> &filters = {
                 "Surface Mesh (*.obj *.ply *.off *.stl *.sm *.geojson *.trilist)", "*.obj *.ply *.off *.stl *.sm *.geojson *.trilist",
-                "Point Cloud (*.bin *.ply *.xyz *.bxyz *.las *.laz *.vg *.bvg *.ptx)", "*.bin *.ply *.xyz *.bxyz *.las *.laz *.vg *.bvg *.ptx",
+                "Point Cloud (*.bin *.pcb *.ply *.xyz *.bxyz *.las *.laz *.vg *.bvg *.ptx)", "*.bin *.pcb *.ply *.xyz *.bxyz *.las *.laz *.vg *.bvg *.ptx",
                 "Polyhedral Mesh (*.plm *.pm *.mesh)", "*.plm *.pm *.mesh",
                 "Graph (*.ply)", "*.ply",
                 "All Files (*.*)", "*"
@@ -1402,8 +1431,8 @@ namespace easy3d {
         const std::string &title = "Please choose a file name";
         const std::vector<std::string> &filters = {
                 "Surface Mesh (*.obj *.ply *.off *.stl *.sm)", "*.obj *.ply *.off *.stl *.sm",
-                "Point Cloud (*.bin *.ply *.xyz *.bxyz *.las *.laz *.vg *.bvg)",
-                "*.bin *.ply *.xyz *.bxyz *.las *.laz *.vg *.bvg",
+                "Point Cloud (*.bin *.pcb *.ply *.xyz *.bxyz *.las *.laz *.vg *.bvg)",
+                "*.bin *.pcb *.ply *.xyz *.bxyz *.las *.laz *.vg *.bvg",
                 "Polyhedral Mesh (*.plm *.pm *.mesh)", "*.plm *.pm *.mesh",
                 "Graph (*.ply)", "*.ply",
                 "All Files (*.*)", "*"
@@ -32,6 +32,7 @@
 #include <vector>
 
 #include <easy3d/core/types.h>
+#include <easy3d/fileio/async_loader.h>
 
 
 struct GLFWwindow;
@@ -248,6 +249,19 @@ namespace easy3d {
          */
         Model* add_model(Model* model, bool create_default_drawables = true);
 
+        /**
+         * @brief Load a model from a file in the background, and add it to the viewer when loading completes.
+         * @details Unlike add_model(const std::string&, bool), this method returns immediately and the viewer keeps
+         *          rendering while the file is being parsed by a worker thread. The loaded model(s) will be added to
+         *          the viewer (and their drawables created) by the rendering thread at the beginning of a frame.
+         *          The returned handle can be used to query the progress of loading or to cancel it.
+         * @param file_name The string of the file name.
+         * @param create_default_drawables If true, the default drawables will be created.
+         * @return The handle of the loading task.
+         * @related add_model(const std::string&, bool), AsyncLoader.
+         */
+        AsyncLoader::Handle add_model_async(const std::string& file_name, bool create_default_drawables = true);
+
         /**
          * @brief Delete a model. The memory of the model will be released and its existing drawables
          *        also be deleted.
@@ -565,6 +579,10 @@ namespace easy3d {
         void copy_view();
         void paste_view();
 
+        // Add the models loaded in the background (at most one file per call, so frames are not stalled).
+        // Returns true if any model has been added.
+        bool add_loaded_models();
+
     protected:
 		GLFWwindow*	window_;
 		bool        should_exit_;
@@ -615,6 +633,10 @@ namespace easy3d {
 		std::vector<Model*> models_;
 		int model_idx_;
 
+        // models being loaded in the background
+        AsyncLoader* loader_;
+        std::vector< std::pair<AsyncLoader::Handle, bool> > loading_models_; // task, create_default_drawables
+
         // drawables independent of any model
         std::vector<Drawable*> drawables_;
 
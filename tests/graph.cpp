@@ -131,6 +131,31 @@ int test_graph() {
         }
     }
 
+    // delete a vertex (and its incident edges), and then remove the deleted elements
+    {
+        graph.defer_garbage_collection(true);
+        graph.delete_vertex(Graph::Vertex(3));
+        graph.collect_garbage();    // deferred: the handles remain valid
+        if (!graph.is_deleted(Graph::Vertex(3)) || graph.n_vertices() != 3 || graph.n_edges() != 2) {
+            LOG(ERROR) << "deleting vertex failed";
+            return EXIT_FAILURE;
+        }
+        graph.defer_garbage_collection(false);
+        std::cout << "after deleting vertex v3: " << graph.vertices_size() << " vertices, " << graph.edges_size()
+                  << " edges" << std::endl;
+        if (graph.vertices_size() != 3 || graph.edges_size() != 2 || graph.has_garbage()) {
+            LOG(ERROR) << "garbage collection failed";
+            return EXIT_FAILURE;
+        }
+        auto lengths = graph.get_edge_property<float>("e:length");
+        for (auto e : graph.edges()) {
+            if (graph.edge_length(e) != lengths[e] || graph.find_edge(graph.vertex(e, 0), graph.vertex(e, 1)) != e) {
+                LOG(ERROR) << "graph connectivity broken by garbage collection";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
     {
         // Read a graph specified by its file name
         const std::string file_name = resource::directory() + "/data/graph.ply";
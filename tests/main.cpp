@@ -33,6 +33,7 @@
 int test_timer();
 int test_signal();
 int test_console_style();
+int test_parallel();
 
 int test_linear_solvers();
 int test_spline();
@@ -90,6 +91,7 @@ int main(int argc, char* argv[]) {
     result += test_console_style();
     result += test_timer();
     result += test_signal();
+    result += test_parallel();
 
     result += test_linear_solvers();
     result += test_spline();
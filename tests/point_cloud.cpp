@@ -24,16 +24,123 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  ********************************************************************/
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
 #include <easy3d/core/point_cloud.h>
+#include <easy3d/core/property.h>
 #include <easy3d/core/random.h>
 #include <easy3d/fileio/point_cloud_io.h>
+#include <easy3d/fileio/point_cloud_io_pcb.h>
+#include <easy3d/fileio/point_cloud_writer.h>
+#include <easy3d/fileio/translator.h>
 #include <easy3d/util/resource.h>
 #include <easy3d/util/file_system.h>
 
+#include <3rd_party/lastools/LASlib/inc/lasreader.hpp>
+#include <3rd_party/lastools/LASlib/inc/laswriter.hpp>
+
 
 using namespace easy3d;
 
 
+// a point of an las/laz file decoded by LASlib (the reference for load_las())
+struct LasReferencePoint {
+    dvec3 position;
+    int intensity;
+    int classification;
+    double gps_time;
+};
+
+
+// writes a grid of points with varying attributes by LASlib. The points are of format 6, so the laz files are
+// compressed in layers and the attributes that are not needed can be skipped when reading.
+bool write_las_reference(const std::string &file_name, int num) {
+    LASheader header;
+    header.version_minor = 4;
+    header.header_size = 375;
+    header.offset_to_point_data = 375;
+    header.point_data_format = 6;
+    header.point_data_record_length = 30;
+    header.x_scale_factor = header.y_scale_factor = header.z_scale_factor = 0.001;
+    header.x_offset = 1000.0;
+    header.y_offset = 2000.0;
+    header.z_offset = 0.0;
+
+    LASpoint point;
+    point.init(&header, header.point_data_format, header.point_data_record_length, &header);
+
+    LASwriteOpener opener;
+    opener.set_file_name(file_name.c_str());
+    LASwriter *writer = opener.open(&header);
+    if (!writer)
+        return false;
+    for (int i = 0; i < num; ++i) {
+        point.coordinates[0] = 1000.0 + (i % 20) * 0.25;
+        point.coordinates[1] = 2000.0 + (i / 20) * 0.5;
+        point.coordinates[2] = (i % 7) * 0.125;
+        point.compute_XYZ();
+        point.set_intensity(static_cast<U16>(i * 37 % 65536));
+        point.set_extended_classification(static_cast<U8>(i % 5));
+        point.set_extended_return_number(1);
+        point.set_extended_number_of_returns(1);
+        point.set_gps_time(1000.0 + 0.5 * i);
+        writer->write_point(&point);
+        writer->update_inventory(&point);
+    }
+    writer->update_header(&header, TRUE);
+    writer->close();
+    delete writer;
+    return true;
+}
+
+
+// reads all the points of an las/laz file by LASlib
+bool read_las_reference(const std::string &file_name, std::vector<LasReferencePoint> &points) {
+    LASreadOpener opener;
+    opener.set_file_name(file_name.c_str());
+    LASreader *reader = opener.open();
+    if (!reader)
+        return false;
+    points.clear();
+    while (reader->read_point()) {
+        reader->point.compute_coordinates();
+        const LasReferencePoint p = {
+                dvec3(reader->point.coordinates[0], reader->point.coordinates[1], reader->point.coordinates[2]),
+                reader->point.get_intensity(), reader->point.get_extended_classification(),
+                reader->point.get_gps_time()
+        };
+        points.push_back(p);
+    }
+    reader->close();
+    delete reader;
+    return true;
+}
+
+
+// true if the points loaded by load_las() match the reference points (in the same order). The attributes that were
+// not loaded are not compared.
+bool match_las_reference(const PointCloud &cloud, const std::vector<LasReferencePoint> &expected) {
+    if (cloud.n_vertices() != expected.size())
+        return false;
+    const auto intensities = cloud.get_vertex_property<int>("v:intensity");
+    const auto classifications = cloud.get_vertex_property<int>("v:classification");
+    const auto gps_times = cloud.get_vertex_property<double>("v:gps_time");
+    for (auto v : cloud.vertices()) {
+        const LasReferencePoint &p = expected[v.idx()];
+        const vec3 position(static_cast<float>(p.position.x), static_cast<float>(p.position.y),
+                            static_cast<float>(p.position.z));
+        if (cloud.position(v) != position ||
+            (intensities && intensities[v] != p.intensity) ||
+            (classifications && classifications[v] != p.classification) ||
+            (gps_times && gps_times[v] != p.gps_time))
+            return false;
+    }
+    return true;
+}
+
+
 int test_point_cloud() {
 
 	// Create a point cloud
@@ -110,6 +217,278 @@ int test_point_cloud() {
                 std::cerr << "failed to delete the saved file" << std::endl;
         }
     }
-    
+
+    //  - save a point cloud to the chunked binary (pcb) format;
+    //  - access a single property of the file without loading the point cloud.
+    {
+        auto intensities = cloud.add_vertex_property<float>("v:intensity");
+        for (auto v : cloud.vertices())
+            intensities[v] = static_cast<float>(v.idx()) * 0.5f;
+        auto trans = cloud.add_model_property<dvec3>("translation");
+        trans[0] = dvec3(100000.0, 200000.0, 0.0);
+
+        const std::string file_name = "./cloud-copy.pcb";
+        if (!PointCloudIO::save(file_name, &cloud)) {
+            LOG(ERROR) << "failed to save the point cloud to a pcb file";
+            return EXIT_FAILURE;
+        }
+
+        {
+            io::MappedPointCloud file;
+            if (!file.open(file_name) || file.n_vertices() != cloud.n_vertices() || !file.has_translation() ||
+                file.translation() != trans[0]) {
+                LOG(ERROR) << "failed to open the pcb file (or its header is incorrect)";
+                return EXIT_FAILURE;
+            }
+            const float *values = file.vertex_property<float>("v:intensity");
+            if (!values || file.vertex_property<vec3>("v:intensity") ||
+                !std::equal(intensities.vector().begin(), intensities.vector().end(), values)) {
+                LOG(ERROR) << "incorrect vertex property 'v:intensity' in the pcb file";
+                return EXIT_FAILURE;
+            }
+            std::cout << "number of vertex properties in the pcb file: " << file.vertex_properties().size() << std::endl;
+        }
+
+        // the translator is disabled by default: the original coordinates are returned (without translation)
+        PointCloud *original = PointCloudIO::load(file_name);
+        bool success = original && !original->get_model_property<dvec3>("translation");
+        for (auto v : cloud.vertices()) {
+            if (!success)
+                break;
+            const vec3 &p = cloud.position(v);
+            const vec3 expected(static_cast<float>(p.x + trans[0].x), static_cast<float>(p.y + trans[0].y),
+                                static_cast<float>(p.z + trans[0].z));
+            success = original->position(PointCloud::Vertex(v.idx())) == expected;
+        }
+        delete original;
+
+        // the stored translation is kept if the translator is enabled
+        Translator::instance()->set_status(Translator::TRANSLATE_USE_FIRST_POINT);
+        PointCloud *copy = PointCloudIO::load(file_name);
+        Translator::instance()->set_status(Translator::DISABLED);
+        success = success && copy && copy->points() == cloud.points() &&
+                  copy->get_vertex_property<vec3>("v:color").vector() == cloud.get_vertex_property<vec3>("v:color").vector() &&
+                  copy->get_model_property<dvec3>("translation") &&
+                  copy->get_model_property<dvec3>("translation")[0] == trans[0];
+        delete copy;
+        file_system::delete_file(file_name);
+        if (!success) {
+            LOG(ERROR) << "the point cloud loaded from the pcb file differs from the original one";
+            return EXIT_FAILURE;
+        }
+        std::cout << "point cloud saved to and loaded from a pcb file" << std::endl;
+    }
+
+    //  - load only the points of a LAS file within a region, and only the requested attributes of them.
+    {
+        const std::string file_name = "./cloud-copy.las";
+        if (!io::save_las(file_name, &cloud)) {
+            LOG(ERROR) << "failed to save the point cloud to a las file";
+            return EXIT_FAILURE;
+        }
+
+        // the region is defined in the original coordinates, i.e., the translation is included
+        const dvec3 &trans = cloud.get_model_property<dvec3>("translation")[0];
+        io::LasOptions options;
+        options.attributes = io::LasOptions::INTENSITY | io::LasOptions::GPS_TIME;
+        options.use_region = true;
+        options.region_min = trans + dvec3(-0.5, -10.0, -1.0);
+        options.region_max = trans + dvec3(4.5, 10.0, 1.0);
+        options.chunk_size = 16;
+
+        PointCloud part;
+        const bool success = io::load_las(file_name, &part, options);
+        file_system::delete_file(file_name);
+        if (!success || part.n_vertices() != 50 || part.get_vertex_property<vec3>("v:color") ||
+            !part.get_vertex_property<int>("v:intensity") || !part.get_vertex_property<double>("v:gps_time")) {
+            LOG(ERROR) << "the points loaded from the las file do not match the region (or the attributes)";
+            return EXIT_FAILURE;
+        }
+        std::cout << part.n_vertices() << " points loaded from a las file" << std::endl;
+    }
+
+    //  - load las and laz files (written by LASlib) and compare the values with those decoded by LASlib;
+    //  - filter the points by a region and their classes, and skip the decompression of the unneeded attributes.
+    for (const std::string extension : {"las", "laz"}) {
+        const std::string file_name = "./cloud-reference." + extension;
+        std::vector<LasReferencePoint> reference;
+        if (!write_las_reference(file_name, 400) || !read_las_reference(file_name, reference) ||
+            reference.size() != 400) {
+            LOG(ERROR) << "failed to write (or read) the reference " << extension << " file by LASlib";
+            file_system::delete_file(file_name);
+            return EXIT_FAILURE;
+        }
+
+        // all the points with all the attributes
+        io::LasOptions options;
+        options.attributes = io::LasOptions::ALL;
+        options.chunk_size = 16;
+        PointCloud all;
+        bool success = io::load_las(file_name, &all, options) && match_las_reference(all, reference) &&
+                       all.get_vertex_property<int>("v:intensity") &&
+                       all.get_vertex_property<int>("v:classification") &&
+                       all.get_vertex_property<double>("v:gps_time");
+
+        // the points inside a region (its bounds are not on the grid) and of classes 1 and 3
+        options.attributes = io::LasOptions::INTENSITY | io::LasOptions::GPS_TIME;
+        options.use_region = true;
+        options.region_min = dvec3(1001.1, 2000.6, 0.0);
+        options.region_max = dvec3(1003.1, 2003.1, 0.45);
+        options.classifications = {1, 3};
+        std::vector<LasReferencePoint> expected;
+        for (const auto &p : reference) {
+            if (p.position.x >= options.region_min.x && p.position.x <= options.region_max.x &&
+                p.position.y >= options.region_min.y && p.position.y <= options.region_max.y &&
+                p.position.z >= options.region_min.z && p.position.z <= options.region_max.z &&
+                (p.classification == 1 || p.classification == 3))
+                expected.push_back(p);
+        }
+        PointCloud filtered;
+        success = success && !expected.empty() && io::load_las(file_name, &filtered, options) &&
+                  match_las_reference(filtered, expected) && filtered.get_vertex_property<int>("v:intensity") &&
+                  filtered.get_vertex_property<double>("v:gps_time") &&
+                  !filtered.get_vertex_property<int>("v:classification") &&
+                  !filtered.get_vertex_property<vec3>("v:color");
+
+        // the points inside the region (of all classes) with only the GPS time
+        options.attributes = io::LasOptions::GPS_TIME;
+        options.classifications.clear();
+        expected.clear();
+        for (const auto &p : reference) {
+            if (p.position.x >= options.region_min.x && p.position.x <= options.region_max.x &&
+                p.position.y >= options.region_min.y && p.position.y <= options.region_max.y &&
+                p.position.z >= options.region_min.z && p.position.z <= options.region_max.z)
+                expected.push_back(p);
+        }
+        PointCloud region;
+        success = success && io::load_las(file_name, &region, options) && match_las_reference(region, expected) &&
+                  region.get_vertex_property<double>("v:gps_time") && !region.get_vertex_property<int>("v:intensity");
+
+        file_system::delete_file(file_name);
+        if (!success) {
+            LOG(ERROR) << "the points loaded from the " << extension << " file differ from those decoded by LASlib";
+            return EXIT_FAILURE;
+        }
+        std::cout << filtered.n_vertices() << " (out of " << all.n_vertices() << ") points loaded from the "
+                  << extension << " file by region and classes" << std::endl;
+    }
+
+    //  - write a point cloud incrementally (i.e., batch by batch) without having all the points in memory.
+    for (const std::string extension : {"ply", "bin", "las", "laz"}) {
+        const std::string file_name = "./cloud-stream." + extension;
+        const auto &points = cloud.points();
+        auto colors = cloud.get_vertex_property<vec3>("v:color");
+        const dvec3 &trans = cloud.get_model_property<dvec3>("translation")[0];
+
+        io::PointCloudWriter writer;
+        writer.set_background_flushing(true);
+        bool success = writer.open(file_name, io::PointCloudWriter::COLOR, trans);
+        const std::size_t batch_size = 30;
+        for (std::size_t start = 0; success && start < points.size(); start += batch_size) {
+            const std::size_t num = std::min(batch_size, points.size() - start);
+            success = writer.append(num, points.data() + start, nullptr, colors.data() + start);
+        }
+        success = writer.close() && success;
+
+        // the colors are quantized to 8 bits (ply) or 16 bits (las/laz), and the las/laz coordinates to the scale
+        float color_tolerance = 0.0f;
+        if (extension == "ply")
+            color_tolerance = 1.0f / 255.0f;
+        else if (extension == "las" || extension == "laz")
+            color_tolerance = 1.0f / USHRT_MAX;
+
+        PointCloud *copy = PointCloudIO::load(file_name);
+        file_system::delete_file(file_name);
+        success = success && copy && copy->n_vertices() == cloud.n_vertices() &&
+                  copy->get_vertex_property<vec3>("v:color") && !copy->get_vertex_property<vec3>("v:normal");
+        if (success) {
+            auto copy_trans = copy->get_model_property<dvec3>("translation");
+            const dvec3 copy_origin = copy_trans ? copy_trans[0] : dvec3(0, 0, 0);
+            auto copy_colors = copy->get_vertex_property<vec3>("v:color");
+            for (auto v : cloud.vertices()) {
+                const vec3 &p = points[v.idx()];
+                const vec3 &q = copy->points()[v.idx()];
+                const dvec3 original(p.x + trans.x, p.y + trans.y, p.z + trans.z);
+                const dvec3 written(q.x + copy_origin.x, q.y + copy_origin.y, q.z + copy_origin.z);
+                if (distance(original, written) > 1e-3 ||
+                    std::abs(colors[v].x - copy_colors[v].x) > color_tolerance + 1e-6f ||
+                    std::abs(colors[v].y - copy_colors[v].y) > color_tolerance + 1e-6f ||
+                    std::abs(colors[v].z - copy_colors[v].z) > color_tolerance + 1e-6f) {
+                    success = false;
+                    break;
+                }
+            }
+        }
+        delete copy;
+        if (!success) {
+            LOG(ERROR) << "the point cloud written incrementally to the " << extension
+                       << " file differs from the original one";
+            return EXIT_FAILURE;
+        }
+        std::cout << writer.num_points() << " points written incrementally to the " << extension << " file"
+                  << std::endl;
+    }
+
+    //  - the las/laz coordinates are stored as 32-bit integers w.r.t. the origin: a batch with points too far away
+    //    is rejected (instead of the coordinates wrapping around).
+    {
+        const std::string file_name = "./cloud-stream-far.las";
+        const vec3 near_points[2] = {vec3(1.0f, 2.0f, 3.0f), vec3(4.0f, 5.0f, 6.0f)};
+        const vec3 far_points[2] = {vec3(1.0f, 2.0f, 3.0f), vec3(3.0e6f, 5.0f, 6.0f)};
+
+        io::PointCloudWriter writer;
+        bool success = writer.open(file_name) && writer.append(2, near_points);
+        const bool rejected = !writer.append(2, far_points);
+        success = !writer.close() && success && rejected;
+        file_system::delete_file(file_name);
+        if (!success) {
+            LOG(ERROR) << "points out of the range of the las format were not rejected";
+            return EXIT_FAILURE;
+        }
+        std::cout << "points out of the range of the las format rejected" << std::endl;
+    }
+
+    //  - the property arrays of a container grow together, and a property added later inherits the capacity.
+    {
+        PropertyContainer container;
+        auto indices = container.add<int>("v:index", -1);
+        auto positions = container.add<vec3>("v:position");
+        container.reserve(100);
+        const int *index_data = indices.data();
+        const vec3 *position_data = positions.data();
+        bool success = container.capacity() == 100 && indices.vector().capacity() >= 100 &&
+                       positions.vector().capacity() >= 100;
+
+        // no array reallocates on its own before the shared capacity is exhausted
+        for (int i = 0; i < 100; ++i) {
+            container.push_back();
+            indices[i] = i;
+        }
+        success = success && indices.data() == index_data && positions.data() == position_data;
+
+        // then all arrays grow together
+        container.push_back();
+        success = success && container.size() == 101 && container.capacity() >= 101 &&
+                  indices.vector().capacity() >= container.capacity() &&
+                  positions.vector().capacity() >= container.capacity() && indices[100] == -1;
+
+        container.resize(1000);
+        auto weights = container.add<float>("v:weight", 1.0f);
+        success = success && container.capacity() >= 1000 && indices.vector().size() == 1000 &&
+                  positions.vector().size() == 1000 && weights.vector().size() == 1000 &&
+                  weights.vector().capacity() >= container.capacity() && weights[999] == 1.0f;
+
+        // the property added after the growth doesn't reallocate either until the capacity is exhausted
+        const float *weight_data = weights.data();
+        while (container.size() < container.capacity())
+            container.push_back();
+        success = success && weights.data() == weight_data && indices[50] == 50;
+        if (!success) {
+            LOG(ERROR) << "the property arrays of a container do not share the capacity";
+            return EXIT_FAILURE;
+        }
+        std::cout << "the property arrays grow together (capacity: " << container.capacity() << ")" << std::endl;
+    }
+
     return EXIT_SUCCESS;
 }
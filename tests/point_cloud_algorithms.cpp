@@ -113,13 +113,28 @@ bool test_algo_point_cloud_poisson_reconstruction() {
     PoissonReconstruction algo;
     algo.set_depth(depth);
     std::cout << "Poisson surface reconstruction (depth = " << depth << ")..." << std::endl;
-    Model *surface = algo.apply(cloud);
+    SurfaceMesh *surface = algo.apply(cloud);
     delete cloud;
 
-    if (surface)
-        return true;
+    if (!surface)
+        return false;
 
-    return false;
+    // the mesh is built directly from the in-memory output, with the density values attached to the vertices
+    bool valid = surface->n_faces() > 0 && surface->get_vertex_property<float>("v:density");
+
+    // incremental trimming: any trim value can be applied without rebuilding the mesh
+    PoissonTrimmer trimmer(surface);
+    if (valid && trimmer.is_valid()) {
+        const float trim_value = 0.5f * (trimmer.min_density() + trimmer.max_density());
+        const std::size_t num = trimmer.apply(trim_value, 0.001f);
+        std::cout << "trimmed (trim value = " << trim_value << "): " << num << " faces kept" << std::endl;
+        SurfaceMesh *trimmed = trimmer.extract(trim_value, 0.001f);
+        valid = trimmed && trimmed->n_faces() == num && trimmer.apply(trimmer.min_density(), 0.0f) == surface->n_faces();
+        delete trimmed;
+    }
+
+    delete surface;
+    return valid;
 }
 
 
@@ -142,6 +157,55 @@ bool test_algo_point_cloud_delaunay_triangulation_2D() {
     Delaunay2 delaunay;
     delaunay.set_vertices(points);
 
+    // point location: the centroid of a triangle is located in the triangle (degenerate triangles are skipped, as
+    // their rounded centroids may actually be outside)
+    std::vector<vec2> centroids;
+    std::vector<int> expected;
+    for (unsigned int t = 0; t < delaunay.nb_triangles(); ++t) {
+        const vec2 &a = delaunay.vertex(delaunay.tri_vertex(t, 0));
+        const vec2 &b = delaunay.vertex(delaunay.tri_vertex(t, 1));
+        const vec2 &c = delaunay.vertex(delaunay.tri_vertex(t, 2));
+        const float area = std::abs((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x));
+        const float longest = std::max(distance2(a, b), std::max(distance2(b, c), distance2(c, a)));
+        if (area > 0.01f * longest) {
+            centroids.push_back((a + b + c) / 3.0f);
+            expected.push_back(static_cast<int>(t));
+        }
+    }
+    std::vector<int> triangles;
+    delaunay.locate(centroids, triangles);
+    std::size_t num_wrong = 0;
+    for (std::size_t t = 0; t < triangles.size(); ++t) {
+        if (triangles[t] != expected[t])
+            ++num_wrong;
+    }
+    if (num_wrong > 0) {
+        std::cerr << "Error: " << num_wrong << " points were not located in the right triangles" << std::endl;
+        delete cloud;
+        return false;
+    }
+
+    // the fallback of the walk (testing all triangles) finds the same triangles, and nothing outside the hull
+    Box2 box;
+    for (const auto &p : points)
+        box.grow(p);
+    std::vector<vec2> queries = {box.min_point() - vec2(1, 1), box.max_point() + vec2(1, 1)};
+    const std::size_t stride = std::max<std::size_t>(1, centroids.size() / 200);
+    for (std::size_t t = 0; t < centroids.size(); t += stride)
+        queries.push_back(centroids[t]);
+    std::vector<int> located;
+    delaunay.locate(queries, located);
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        const int scanned = delaunay.locate_exhaustively(queries[i].data());
+        const int truth = i < 2 ? -1 : expected[(i - 2) * stride];
+        if (scanned != located[i] || scanned != truth) {
+            std::cerr << "Error: testing all triangles located point " << i << " in triangle " << scanned
+                      << " (the walk found " << located[i] << ", expected " << truth << ")" << std::endl;
+            delete cloud;
+            return false;
+        }
+    }
+
     delete cloud;
     return true;
 }
@@ -161,6 +225,49 @@ bool test_algo_point_cloud_delaunay_triangulation_3D() {
     Delaunay3 delaunay;
     delaunay.set_vertices(points);
 
+    // each vertex is its own nearest vertex (or a duplicate of it)
+    std::vector<unsigned int> nearest;
+    delaunay.nearest_vertices(points, nearest);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        if (points[nearest[i]] != points[i]) {
+            std::cerr << "Error: wrong nearest vertex of vertex " << i << std::endl;
+            delete cloud;
+            return false;
+        }
+    }
+
+    // point location: the walk and its fallback (testing all tetrahedra) both find the tetrahedron of a centroid
+    // (degenerate tetrahedra are skipped), and nothing outside the hull
+    const Box3 &box = cloud->bounding_box();
+    std::vector<vec3> queries = {box.min_point() - vec3(1, 1, 1), box.max_point() + vec3(1, 1, 1)};
+    std::vector<int> expected = {-1, -1};
+    const unsigned int stride = std::max(1u, delaunay.nb_tets() / 200);
+    for (unsigned int t = 0; t < delaunay.nb_tets(); t += stride) {
+        const vec3 &a = delaunay.vertex(delaunay.tet_vertex(t, 0));
+        const vec3 &b = delaunay.vertex(delaunay.tet_vertex(t, 1));
+        const vec3 &c = delaunay.vertex(delaunay.tet_vertex(t, 2));
+        const vec3 &d = delaunay.vertex(delaunay.tet_vertex(t, 3));
+        const float volume = std::abs(dot(b - a, cross(c - a, d - a)));
+        const float longest = std::max(std::max(distance2(a, b), distance2(a, c)),
+                                       std::max(std::max(distance2(a, d), distance2(b, c)),
+                                                std::max(distance2(b, d), distance2(c, d))));
+        if (volume > 0.01f * longest * std::sqrt(longest)) {
+            queries.push_back((a + b + c + d) / 4.0f);
+            expected.push_back(static_cast<int>(t));
+        }
+    }
+    std::vector<int> located;
+    delaunay.locate(queries, located);
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        const int scanned = delaunay.locate_exhaustively(queries[i].data());
+        if (scanned != located[i] || scanned != expected[i]) {
+            std::cerr << "Error: point " << i << " was located in tetrahedron " << located[i] << " by the walk and "
+                      << scanned << " by testing all tetrahedra (expected " << expected[i] << ")" << std::endl;
+            delete cloud;
+            return false;
+        }
+    }
+
     delete cloud;
     return true;
 }
@@ -24,16 +24,89 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  ********************************************************************/
 
+#include <algorithm>
+#include <map>
+#include <tuple>
+
 #include <easy3d/core/surface_mesh.h>
 #include <easy3d/core/surface_mesh_builder.h>
 #include <easy3d/fileio/surface_mesh_io.h>
+#include <easy3d/fileio/surface_mesh_io_sm.h>
+#include <easy3d/fileio/async_loader.h>
+#include <easy3d/fileio/translator.h>
 #include <easy3d/util/resource.h>
 #include <easy3d/util/file_system.h>
+#include <easy3d/util/parallel.h>
 
 
 using namespace easy3d;
 
 
+// Builds a mesh from an indexed face array (all triangles if 'face_sizes' is empty) by SurfaceMeshBuilder, either all
+// at once by add_faces() or face by face by add_face().
+std::vector<SurfaceMesh::Face> build_from_face_array(SurfaceMesh &mesh, const std::vector<vec3> &points,
+                                                     const std::vector<int> &indices,
+                                                     const std::vector<int> &face_sizes, bool bulk) {
+    SurfaceMeshBuilder builder(&mesh);
+    builder.begin_surface();
+    for (const auto &p : points)
+        builder.add_vertex(p);
+
+    std::vector<SurfaceMesh::Face> faces;
+    if (bulk)
+        faces = builder.add_faces(indices, face_sizes);
+    else {
+        std::size_t offset = 0;
+        const std::size_t num_faces = face_sizes.empty() ? indices.size() / 3 : face_sizes.size();
+        for (std::size_t f = 0; f < num_faces; ++f) {
+            const std::size_t size = face_sizes.empty() ? 3 : static_cast<std::size_t>(face_sizes[f]);
+            std::vector<SurfaceMesh::Vertex> vertices;
+            for (std::size_t i = offset; i < offset + size; ++i)
+                vertices.emplace_back(SurfaceMesh::Vertex(indices[i]));
+            faces.push_back(builder.add_face(vertices));
+            offset += size;
+        }
+    }
+    builder.end_surface(false);
+    return faces;
+}
+
+
+// Checks if two meshes have the same vertex positions and the same halfedge structure. The halfedges may
+// be stored in a different order, and a vertex split at a non-manifold vertex may keep its index in a different
+// umbrella. So each vertex is identified by the first vertex at its position, and each halfedge by its two vertices,
+// its face, the target of its next halfedge, and the face of its opposite halfedge.
+bool have_same_structure(const SurfaceMesh &a, const SurfaceMesh &b) {
+    if (a.n_vertices() != b.n_vertices() || a.n_edges() != b.n_edges() || a.n_faces() != b.n_faces())
+        return false;
+
+    typedef std::tuple<int, int, int, int, int> HalfedgeRecord;
+    auto collect = [](const SurfaceMesh &mesh) -> std::vector<HalfedgeRecord> {
+        std::map<std::tuple<float, float, float>, int> first_vertex;
+        std::vector<int> origin(mesh.n_vertices());
+        for (auto v : mesh.vertices()) {
+            const vec3 &p = mesh.position(v);
+            origin[v.idx()] = first_vertex.insert(std::make_pair(std::make_tuple(p.x, p.y, p.z), v.idx())).first->second;
+        }
+        std::vector<HalfedgeRecord> records;
+        for (auto h : mesh.halfedges()) {
+            records.emplace_back(origin[mesh.source(h).idx()], origin[mesh.target(h).idx()], mesh.face(h).idx(),
+                                 origin[mesh.target(mesh.next(h)).idx()], mesh.face(mesh.opposite(h)).idx());
+        }
+        std::sort(records.begin(), records.end());
+        return records;
+    };
+    auto positions = [](const SurfaceMesh &mesh) -> std::vector<std::tuple<float, float, float> > {
+        std::vector<std::tuple<float, float, float> > result;
+        for (const auto &p : mesh.points())
+            result.emplace_back(p.x, p.y, p.z);
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    return positions(a) == positions(b) && collect(a) == collect(b);
+}
+
+
 int test_surface_mesh() {
 
 	// Easy3D provides two options to construct a surface mesh.
@@ -315,6 +388,359 @@ int test_surface_mesh() {
             std::cout << "the saved file has been deleted"  << std::endl;
         else
             std::cerr << "failed to delete the saved file" << std::endl;
+
+        // Construct a mesh from an indexed face array all at once, and compare it with the one built face by face.
+        std::vector<int> face_sizes, indices;
+        for (auto f : mesh->faces()) {
+            face_sizes.push_back(static_cast<int>(mesh->valence(f)));
+            for (auto v : mesh->vertices(f))
+                indices.push_back(v.idx());
+        }
+
+        SurfaceMesh copy, reference;
+        const auto faces = build_from_face_array(copy, mesh->points(), indices, face_sizes, true);
+        build_from_face_array(reference, mesh->points(), indices, face_sizes, false);
+
+        std::cout << "mesh constructed from indexed face array. " << std::endl;
+        std::cout << "\tvertices: " << copy.n_vertices() << std::endl;
+        std::cout << "\tedges: " << copy.n_edges() << std::endl;
+        std::cout << "\tfaces: " << copy.n_faces() << std::endl;
+        if (faces.size() != mesh->n_faces() || copy.n_vertices() != mesh->n_vertices() ||
+            copy.n_edges() != mesh->n_edges() || copy.n_faces() != mesh->n_faces() ||
+            !have_same_structure(copy, reference)) {
+            LOG(ERROR) << "the mesh constructed from indexed face array does not match the original one";
+            delete mesh;
+            return EXIT_FAILURE;
+        }
+
+        // The same for meshes that take the other paths of add_faces(): a bordered mesh with mixed polygon sizes
+        // (a 3 by 3 grid of quads, one of which is split into two triangles, and the middle row is merged into an
+        // octagon), faces on a non-manifold edge, two fans touching at a non-manifold vertex, and
+        // invalid faces (an out-of-range index and a repeated vertex).
+        std::vector<vec3> grid;
+        for (int j = 0; j < 4; ++j) {
+            for (int i = 0; i < 4; ++i)
+                grid.emplace_back(vec3(static_cast<float>(i), static_cast<float>(j), 0.0f));
+        }
+        struct Case {
+            std::string name;
+            std::vector<vec3> points;
+            std::vector<int> indices;
+            std::vector<int> face_sizes;
+        };
+        const std::vector<Case> cases = {
+                {"bordered, mixed polygons", grid,
+                        {0, 1, 5, 4,    1, 2, 6,    1, 6, 5,    2, 3, 7, 6,
+                         4, 5, 6, 7, 11, 10, 9, 8,    8, 9, 13, 12,    9, 10, 14, 13,    10, 11, 15, 14},
+                        {4, 3, 3, 4, 8, 4, 4, 4}},
+                {"non-manifold edge", {vec3(0, 0, 0), vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1)},
+                        {0, 1, 2,    1, 0, 3,    0, 1, 4,    4, 1, 2}, {}},
+                {"non-manifold vertex", {vec3(0, 0, 0), vec3(1, 0, 0), vec3(1, 1, 0), vec3(0, 1, 0),
+                                         vec3(-1, 0, 0), vec3(-1, -1, 0), vec3(0, -1, 0)},
+                        {0, 1, 2,    0, 2, 3,    0, 4, 5,    0, 5, 6}, {}},
+                {"invalid faces", grid,
+                        {0, 1, 5, 4,    1, 2, 99,    2, 3, 7, 6,    5, 6, 6,    1, 2, 6, 5},
+                        {4, 3, 4, 3, 4}}
+        };
+        for (const auto &c : cases) {
+            SurfaceMesh bulk, incremental;
+            const auto bulk_faces = build_from_face_array(bulk, c.points, c.indices, c.face_sizes, true);
+            const auto incremental_faces = build_from_face_array(incremental, c.points, c.indices, c.face_sizes, false);
+            bool same = (bulk_faces.size() == incremental_faces.size()) && have_same_structure(bulk, incremental);
+            for (std::size_t f = 0; same && f < bulk_faces.size(); ++f)
+                same = (bulk_faces[f] == incremental_faces[f]);
+            std::cout << "\t" << c.name << ": " << bulk.n_vertices() << " vertices, " << bulk.n_faces() << " faces"
+                      << std::endl;
+            if (!same) {
+                LOG(ERROR) << "the mesh constructed from indexed face array (" << c.name
+                           << ") does not match the one constructed face by face";
+                delete mesh;
+                return EXIT_FAILURE;
+            }
+        }
+
+        // a copy shares the property data with the original one until either of them is modified. Reading a copy
+        // doesn't duplicate its arrays, and the handles acquired before copying can't modify the copy.
+        auto quality = mesh->add_vertex_property<float>("v:quality", 1.0f);
+        SurfaceMesh snapshot = *mesh;
+        const SurfaceMesh &const_snapshot = snapshot;
+        const auto snapshot_points = snapshot.get_vertex_property<vec3>("v:point");
+        const auto snapshot_quality = snapshot.get_vertex_property<float>("v:quality");
+        const bool cheap = const_snapshot.position(SurfaceMesh::Vertex(0)) == snapshot_points[SurfaceMesh::Vertex(0)] &&
+                           snapshot_points.array().is_shared() && snapshot_quality.array().is_shared();
+        quality[SurfaceMesh::Vertex(0)] = 2.0f;
+        if (!cheap || quality.array().is_shared() || snapshot_quality[SurfaceMesh::Vertex(0)] != 1.0f ||
+            quality[SurfaceMesh::Vertex(0)] != 2.0f) {
+            LOG(ERROR) << "copying the mesh duplicated its arrays, or a handle acquired before copying modified it";
+            delete mesh;
+            return EXIT_FAILURE;
+        }
+        // the first modification may also come from several threads at once
+        SurfaceMesh second_snapshot = *mesh;
+        parallel::for_each(0, mesh->vertices_size(), [&](std::size_t i) {
+            quality[SurfaceMesh::Vertex(static_cast<int>(i))] = 3.0f;
+        });
+        const auto second_property = second_snapshot.get_vertex_property<float>("v:quality");
+        const auto &second_quality = second_property.vector();
+        if (second_quality[0] != 2.0f || std::count(second_quality.begin(), second_quality.end(), 1.0f) !=
+                                         static_cast<long>(mesh->vertices_size()) - 1) {
+            LOG(ERROR) << "writing a mesh from several threads modified its copy";
+            delete mesh;
+            return EXIT_FAILURE;
+        }
+        const vec3 p = mesh->position(SurfaceMesh::Vertex(0));
+        snapshot.position(SurfaceMesh::Vertex(0)) += vec3(1, 0, 0);
+        const std::size_t revision = snapshot.connectivity_revision();
+        if (revision == mesh->connectivity_revision()) {
+            LOG(ERROR) << "a copy of the mesh has the same connectivity revision as the original one";
+            delete mesh;
+            return EXIT_FAILURE;
+        }
+        snapshot.delete_face(SurfaceMesh::Face(0));
+        // the new revision is assigned once, even if it is queried by several threads at the same time
+        std::vector<std::size_t> revisions(1000, 0);
+        parallel::for_each(0, revisions.size(), [&](std::size_t i) {
+            revisions[i] = const_snapshot.connectivity_revision();
+        });
+        if (revisions[0] == revision || std::count(revisions.begin(), revisions.end(), revisions[0]) != 1000 ||
+            snapshot.connectivity_revision() != revisions[0]) {
+            LOG(ERROR) << "deleting a face did not change the connectivity revision (or it changed more than once)";
+            delete mesh;
+            return EXIT_FAILURE;
+        }
+        snapshot.collect_garbage();
+        if (mesh->position(SurfaceMesh::Vertex(0)) != p || mesh->n_faces() != copy.n_faces() ||
+            snapshot.n_faces() >= mesh->n_faces() || mesh->n_halfedges() != copy.n_halfedges()) {
+            LOG(ERROR) << "modifying a copy of the mesh changed the original one";
+            delete mesh;
+            return EXIT_FAILURE;
+        }
+        delete mesh;
+    }
+
+    //		- save a surface mesh with all its properties to the native binary (sm) format;
+    //		- access a single property of the file without loading the mesh.
+    {
+        const std::string file_name = resource::directory() + "/data/sphere.obj";
+        SurfaceMesh* mesh = SurfaceMeshIO::load(file_name);
+        if (!mesh) {
+            LOG(ERROR) << "failed to load model. Please make sure the file exists and format is correct.";
+            return EXIT_FAILURE;
+        }
+        auto quality = mesh->add_vertex_property<float>("v:quality");
+        for (auto v : mesh->vertices())
+            quality[v] = static_cast<float>(v.idx()) * 0.5f;
+        auto selected = mesh->add_face_property<bool>("f:selected");
+        for (auto f : mesh->faces())
+            selected[f] = (f.idx() % 3 == 0);
+
+        for (bool compress : {false, true}) {
+            const std::string save_file_name = "./sphere-copy.sm";
+            if (!io::save_sm(save_file_name, mesh, compress)) {
+                LOG(ERROR) << "failed to save the mesh to an sm file";
+                delete mesh;
+                return EXIT_FAILURE;
+            }
+
+            {
+                io::MappedSurfaceMesh file;
+                if (!file.open(save_file_name) || !file.verify() ||
+                    file.n_elements(io::MappedSurfaceMesh::VERTEX) != mesh->n_vertices() ||
+                    file.n_elements(io::MappedSurfaceMesh::FACE) != mesh->n_faces()) {
+                    LOG(ERROR) << "failed to open the sm file (or its header is incorrect)";
+                    delete mesh;
+                    return EXIT_FAILURE;
+                }
+                const float *values = file.property<float>(io::MappedSurfaceMesh::VERTEX, "v:quality");
+                if (!compress && (!values || !std::equal(quality.vector().begin(), quality.vector().end(), values))) {
+                    LOG(ERROR) << "incorrect vertex property 'v:quality' in the sm file";
+                    delete mesh;
+                    return EXIT_FAILURE;
+                }
+            }
+
+            SurfaceMesh copy;
+            const bool success = io::load_sm(save_file_name, &copy) &&
+                                 copy.n_faces() == mesh->n_faces() && copy.points() == mesh->points() &&
+                                 copy.get_vertex_property<float>("v:quality").vector() == quality.vector() &&
+                                 copy.get_face_property<bool>("f:selected").vector() == selected.vector() &&
+                                 copy.is_closed() == mesh->is_closed();
+            file_system::delete_file(save_file_name);
+            if (!success) {
+                LOG(ERROR) << "the mesh loaded from the sm file does not match the original one";
+                delete mesh;
+                return EXIT_FAILURE;
+            }
+        }
+
+        // a file whose connectivity refers to non-existing elements must be rejected
+        {
+            SurfaceMesh corrupted = *mesh;
+            auto hconn = corrupted.halfedge_property<SurfaceMesh::HalfedgeConnectivity>("h:connectivity");
+            hconn[SurfaceMesh::Halfedge(0)].next_ = SurfaceMesh::Halfedge(static_cast<int>(corrupted.halfedges_size()));
+            const std::string save_file_name = "./sphere-corrupted.sm";
+            SurfaceMesh copy;
+            const bool rejected = io::save_sm(save_file_name, &corrupted) && !io::load_sm(save_file_name, &copy);
+            file_system::delete_file(save_file_name);
+            if (!rejected) {
+                LOG(ERROR) << "an sm file with out-of-range connectivity was not rejected";
+                delete mesh;
+                return EXIT_FAILURE;
+            }
+        }
+        delete mesh;
+    }
+
+    //		- save a mesh whose garbage collection is deferred (the deleted elements are not written).
+    {
+        const std::string file_name = resource::directory() + "/data/sphere.obj";
+        SurfaceMesh* mesh = SurfaceMeshIO::load(file_name);
+        if (!mesh) {
+            LOG(ERROR) << "failed to load model. Please make sure the file exists and format is correct.";
+            return EXIT_FAILURE;
+        }
+        SurfaceMesh collected = *mesh;
+        collected.delete_vertex(SurfaceMesh::Vertex(0));
+        collected.collect_garbage();
+        mesh->defer_garbage_collection(true);
+        mesh->delete_vertex(SurfaceMesh::Vertex(0));
+        mesh->collect_garbage();    // deferred: the deleted elements remain
+
+        for (const std::string extension : {"off", "obj", "ply"}) {
+            const std::string save_file_name = "./sphere-deferred." + extension;
+            const bool saved = SurfaceMeshIO::save(save_file_name, mesh);
+            SurfaceMesh* copy = saved ? SurfaceMeshIO::load(save_file_name) : nullptr;
+            file_system::delete_file(save_file_name);
+            bool success = mesh->has_garbage() && copy && copy->n_vertices() == collected.n_vertices() &&
+                           copy->n_faces() == collected.n_faces();
+            for (auto v : collected.vertices()) {
+                if (!success)
+                    break;
+                success = distance(copy->position(v), collected.position(v)) < 1e-3f;   // obj has 6 digits
+            }
+            for (auto f : collected.faces()) {
+                if (!success)
+                    break;
+                std::vector<int> expected, written;
+                for (auto v : collected.vertices(f))
+                    expected.push_back(v.idx());
+                for (auto v : copy->vertices(f))
+                    written.push_back(v.idx());
+                // the cycles may start from different vertices
+                std::rotate(expected.begin(), std::min_element(expected.begin(), expected.end()), expected.end());
+                std::rotate(written.begin(), std::min_element(written.begin(), written.end()), written.end());
+                success = (written == expected);
+            }
+            delete copy;
+            if (!success) {
+                LOG(ERROR) << "the mesh with deferred garbage collection was not saved correctly to the " << extension
+                           << " file";
+                delete mesh;
+                return EXIT_FAILURE;
+            }
+        }
+        std::cout << "mesh with deferred garbage collection saved" << std::endl;
+        delete mesh;
+    }
+
+    //		- load a binary PLY file in bulk (directly into the properties) and compare it with an ASCII one.
+    {
+        const std::string file_name = resource::directory() + "/data/sphere.obj";
+        SurfaceMesh* mesh = SurfaceMeshIO::load(file_name);
+        if (!mesh) {
+            LOG(ERROR) << "failed to load model. Please make sure the file exists and format is correct.";
+            return EXIT_FAILURE;
+        }
+        auto quality = mesh->add_vertex_property<float>("v:quality");
+        for (auto v : mesh->vertices())
+            quality[v] = static_cast<float>(v.idx()) * 0.5f;
+        auto label = mesh->add_face_property<int>("f:label");
+        for (auto f : mesh->faces())
+            label[f] = f.idx() % 7 - 3;
+
+        const std::string binary_file_name = "./sphere-copy-binary.ply";
+        const std::string ascii_file_name = "./sphere-copy-ascii.ply";
+        SurfaceMesh binary_copy, ascii_copy;
+        const bool success = io::save_ply(binary_file_name, mesh, true) && io::save_ply(ascii_file_name, mesh, false) &&
+                             io::load_ply(binary_file_name, &binary_copy) && io::load_ply(ascii_file_name, &ascii_copy);
+        file_system::delete_file(binary_file_name);
+        file_system::delete_file(ascii_file_name);
+        if (!success || binary_copy.n_faces() != mesh->n_faces() || ascii_copy.n_faces() != mesh->n_faces() ||
+            binary_copy.points() != mesh->points() ||
+            binary_copy.get_vertex_property<float>("v:quality").vector() != quality.vector() ||
+            binary_copy.get_face_property<int>("f:label").vector() != label.vector() ||
+            ascii_copy.get_face_property<int>("f:label").vector() != label.vector()) {
+            LOG(ERROR) << "the mesh loaded from the PLY files does not match the original one";
+            delete mesh;
+            return EXIT_FAILURE;
+        }
+        delete mesh;
+    }
+
+    //		- load models in the background, and cancel a pending load.
+    {
+        const std::string file_name = resource::directory() + "/data/sphere.obj";
+        AsyncLoader loader(1);
+        AsyncLoader::Handle task = loader.load(file_name);
+        AsyncLoader::Handle canceled = loader.load(resource::directory() + "/data/bunny.ply");
+        canceled->cancel();
+
+        std::vector<Model*> models = task->take();
+        canceled->wait();
+        auto mesh = models.size() == 1 ? dynamic_cast<SurfaceMesh*>(models[0]) : nullptr;
+        const bool success = mesh && mesh->n_faces() > 0 && mesh->name() == file_system::convert_to_native_style(file_name) &&
+                             task->status() == AsyncLoader::Task::SUCCEEDED && task->progress() == 100 &&
+                             canceled->status() == AsyncLoader::Task::CANCELED && canceled->take().empty();
+        for (auto m : models)
+            delete m;
+        if (!success) {
+            LOG(ERROR) << "failed to load the model in the background (or to cancel the loading)";
+            return EXIT_FAILURE;
+        }
+        std::cout << "model loaded in the background" << std::endl;
+    }
+
+    //		- load models in the background while the translator is enabled (each is translated w.r.t. its own first
+    //		  point, as if the files were loaded one after another).
+    {
+        const std::vector<std::string> file_names = {
+                resource::directory() + "/data/fandisk.off", resource::directory() + "/data/bunny.ply"
+        };
+        std::vector<vec3> first_points;
+        for (const auto &name : file_names) {
+            SurfaceMesh *mesh = SurfaceMeshIO::load(name);
+            first_points.push_back(mesh ? mesh->position(SurfaceMesh::Vertex(0)) : vec3(0, 0, 0));
+            delete mesh;
+        }
+
+        Translator::instance()->set_status(Translator::TRANSLATE_USE_FIRST_POINT);
+        std::vector<Model*> models;
+        {
+            AsyncLoader loader(2);
+            std::vector<AsyncLoader::Handle> tasks;
+            for (const auto &name : file_names)
+                tasks.push_back(loader.load(name));
+            for (auto &task : tasks) {
+                std::vector<Model*> loaded = task->take();
+                models.push_back(loaded.size() == 1 ? loaded[0] : nullptr);
+            }
+        }
+        Translator::instance()->set_status(Translator::DISABLED);
+
+        bool success = true;
+        for (std::size_t i = 0; i < models.size(); ++i) {
+            auto mesh = dynamic_cast<SurfaceMesh*>(models[i]);
+            auto trans = mesh ? mesh->get_model_property<dvec3>("translation") : SurfaceMesh::ModelProperty<dvec3>();
+            // the OFF reader keeps the origin in double precision, so allow for the float rounding
+            success = success && trans && distance(trans[0], dvec3(first_points[i].data())) < 1e-5 &&
+                      mesh->position(SurfaceMesh::Vertex(0)) == vec3(0, 0, 0);
+            delete models[i];
+        }
+        if (!success) {
+            LOG(ERROR) << "the models loaded in the background were not translated w.r.t. their first points";
+            return EXIT_FAILURE;
+        }
+        std::cout << "models loaded in the background with the translator enabled" << std::endl;
     }
 
     return EXIT_SUCCESS;
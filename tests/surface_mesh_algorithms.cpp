@@ -24,15 +24,22 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  ********************************************************************/
 
+#include <algorithm>
+#include <fstream>
+#include <tuple>
+
 #include <easy3d/core/point_cloud.h>
 #include <easy3d/core/surface_mesh.h>
 #include <easy3d/core/poly_mesh.h>
+#include <easy3d/algo/sparse_solver.h>
 #include <easy3d/algo/surface_mesh_components.h>
 #include <easy3d/algo/surface_mesh_curvature.h>
 #include <easy3d/algo/surface_mesh_enumerator.h>
 #include <easy3d/algo/surface_mesh_fairing.h>
 #include <easy3d/algo/surface_mesh_geodesic.h>
 #include <easy3d/algo/surface_mesh_hole_filling.h>
+#include <easy3d/algo/surface_mesh_lod.h>
+#include <easy3d/algo/surface_mesh_out_of_core_simplification.h>
 #include <easy3d/algo/surface_mesh_parameterization.h>
 #include <easy3d/algo/surface_mesh_polygonization.h>
 #include <easy3d/algo/surface_mesh_remeshing.h>
@@ -45,8 +52,12 @@
 #include <easy3d/algo/surface_mesh_topology.h>
 #include <easy3d/algo/surface_mesh_triangulation.h>
 #include <easy3d/algo/surface_mesh_features.h>
+#include <easy3d/algo/triangle_mesh_bvh.h>
+#include <easy3d/algo/triangle_mesh_kdtree.h>
 #include <easy3d/fileio/surface_mesh_io.h>
 #include <easy3d/util/resource.h>
+#include <easy3d/util/parallel.h>
+#include <easy3d/util/file_system.h>
 
 #if HAS_CGAL
 #include <easy3d/algo_ext/surfacer.h>
@@ -55,6 +66,59 @@
 
 using namespace easy3d;
 
+
+// true if the two meshes have exactly the same vertex positions and faces (in the same order)
+bool are_identical_meshes(const SurfaceMesh &a, const SurfaceMesh &b) {
+    if (a.n_vertices() != b.n_vertices() || a.n_faces() != b.n_faces() || a.vertices_size() != b.vertices_size() ||
+        a.faces_size() != b.faces_size())
+        return false;
+    for (auto v : a.vertices()) {
+        if (a.is_deleted(v) != b.is_deleted(v) || a.position(v) != b.position(v))
+            return false;
+    }
+    for (auto f : a.faces()) {
+        if (b.is_deleted(f))
+            return false;
+        auto fa = a.vertices(f), fb = b.vertices(f);
+        auto ia = fa.begin(), ib = fb.begin();
+        for (; ia != fa.end() && ib != fb.end(); ++ia, ++ib) {
+            if (*ia != *ib)
+                return false;
+        }
+        if (ia != fa.end() || ib != fb.end())
+            return false;
+    }
+    return true;
+}
+
+
+// true if the two meshes have the same vertex positions and the same faces (given by the positions of their vertices,
+// with the same orientation), no matter the order of the vertices and faces
+bool have_same_geometry(const SurfaceMesh &a, const SurfaceMesh &b) {
+    typedef std::vector<std::tuple<float, float, float> > Polygon;
+    auto polygons = [](const SurfaceMesh &mesh) {
+        std::vector<Polygon> result;
+        for (auto f : mesh.faces()) {
+            Polygon polygon;
+            for (auto v : mesh.vertices(f)) {
+                const vec3 &p = mesh.position(v);
+                polygon.emplace_back(p.x, p.y, p.z);
+            }
+            // start from the smallest position, keeping the orientation
+            std::rotate(polygon.begin(), std::min_element(polygon.begin(), polygon.end()), polygon.end());
+            result.push_back(polygon);
+        }
+        for (auto v : mesh.vertices()) {
+            const vec3 &p = mesh.position(v);
+            result.push_back(Polygon(1, std::make_tuple(p.x, p.y, p.z)));
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    return a.n_vertices() == b.n_vertices() && a.n_faces() == b.n_faces() && polygons(a) == polygons(b);
+}
+
+
 bool test_algo_surface_mesh_components() {
     const std::string file = resource::directory() + "/data/house/house.obj";
     SurfaceMesh *mesh = SurfaceMeshIO::load(file);
@@ -227,6 +291,46 @@ bool test_algo_surface_mesh_geodesic() {
     SurfaceMeshGeodesic geodist(mesh);
     geodist.compute(seeds);
 
+    std::cout << "computing geodesic distances from multiple sets of seeds in parallel..." << std::endl;
+    const std::vector<std::vector<SurfaceMesh::Vertex> > seed_sets = {
+            seeds, {SurfaceMesh::Vertex(static_cast<int>(mesh->n_vertices() / 2))}
+    };
+    if (!geodist.compute(seed_sets, {"v:geodesic:first", "v:geodesic:middle"})) {
+        delete mesh;
+        return false;
+    }
+    auto first = mesh->get_vertex_property<float>("v:geodesic:first");
+    float max_dist = 0.0f;
+    for (auto v : mesh->vertices()) {
+        if (first[v] != geodist(v)) {
+            LOG(ERROR) << "geodesic distances computed in parallel differ from the sequential ones";
+            delete mesh;
+            return false;
+        }
+        if (first[v] < FLT_MAX)
+            max_dist = std::max(max_dist, first[v]);
+    }
+
+    if (mesh->is_triangle_mesh()) {
+        std::cout << "computing geodesic distance from the first vertex using the heat method..." << std::endl;
+        if (!geodist.compute_heat(seeds)) {
+            delete mesh;
+            return false;
+        }
+        double error = 0.0;
+        for (auto v : mesh->vertices()) {
+            if (first[v] < FLT_MAX)
+                error += std::abs(geodist(v) - first[v]);
+        }
+        error /= mesh->n_vertices() * max_dist;
+        std::cout << "mean difference from the fast marching (relative to the max distance): " << error << std::endl;
+        if (error > 0.05) {
+            LOG(ERROR) << "the heat method gives too different geodesic distances";
+            delete mesh;
+            return false;
+        }
+    }
+
     delete mesh;
     return true;
 }
@@ -337,6 +441,44 @@ bool test_algo_surface_mesh_polygonization() {
 }
 
 
+// the quality measures used to compare the parallel and the sequential remeshing
+struct RemeshingQuality {
+    float edge_length_spread;   // the standard deviation of the edge lengths relative to their mean
+    float valence_deviation[4]; // the fractions of vertices whose valence differs by 0, 1, 2, and more from the ideal
+    float hausdorff_distance;   // the (symmetric, vertex-to-surface) Hausdorff distance to the input
+};
+
+RemeshingQuality measure_remeshing_quality(const SurfaceMesh &result, const SurfaceMesh &input) {
+    RemeshingQuality quality;
+
+    double sum = 0.0, sum2 = 0.0;
+    for (auto e : result.edges()) {
+        const double l = result.edge_length(e);
+        sum += l;
+        sum2 += l * l;
+    }
+    const double mean = sum / result.n_edges();
+    const double variance = std::max(0.0, sum2 / result.n_edges() - mean * mean);
+    quality.edge_length_spread = static_cast<float>(std::sqrt(variance) / mean);
+
+    for (auto &f : quality.valence_deviation)
+        f = 0.0f;
+    for (auto v : result.vertices()) {
+        const int ideal = result.is_border(v) ? 4 : 6;
+        const int deviation = std::abs(static_cast<int>(result.valence(v)) - ideal);
+        quality.valence_deviation[std::min(deviation, 3)] += 1.0f / static_cast<float>(result.n_vertices());
+    }
+
+    const TriangleMeshBVH result_bvh(&result), input_bvh(&input);
+    quality.hausdorff_distance = 0.0f;
+    for (auto v : result.vertices())
+        quality.hausdorff_distance = std::max(quality.hausdorff_distance, input_bvh.nearest(result.position(v)).dist);
+    for (auto v : input.vertices())
+        quality.hausdorff_distance = std::max(quality.hausdorff_distance, result_bvh.nearest(input.position(v)).dist);
+    return quality;
+}
+
+
 bool test_algo_surface_mesh_remeshing() {
     const std::string file = resource::directory() + "/data/bunny.ply";
     SurfaceMesh *mesh = SurfaceMeshIO::load(file);
@@ -360,6 +502,34 @@ bool test_algo_surface_mesh_remeshing() {
             len += distance(mesh->position(mesh->vertex(eit, 0)),
                             mesh->position(mesh->vertex(eit, 1)));
         len /= static_cast<float>(mesh->n_edges());
+
+        std::cout << "parallel uniform remeshing..." << std::endl;
+        SurfaceMesh sequential(*mesh), parallel_once(*mesh), parallel_twice(*mesh);
+        SurfaceMeshRemeshing(&sequential).uniform_remeshing(len, 10, true, false);
+        SurfaceMeshRemeshing(&parallel_once).uniform_remeshing(len, 10, true, true);
+        SurfaceMeshRemeshing(&parallel_twice).uniform_remeshing(len, 10, true, true);
+        if (!parallel_once.is_triangle_mesh() || !are_identical_meshes(parallel_once, parallel_twice)) {
+            LOG(ERROR) << "two runs of the parallel remeshing gave different results";
+            delete mesh;
+            return false;
+        }
+
+        // the parallel remeshing is not the same as the sequential one, but it should be as good
+        const RemeshingQuality qs = measure_remeshing_quality(sequential, *mesh);
+        const RemeshingQuality qp = measure_remeshing_quality(parallel_once, *mesh);
+        bool similar_valences = true;
+        for (int i = 0; i < 4; ++i)
+            similar_valences &= std::abs(qp.valence_deviation[i] - qs.valence_deviation[i]) < 0.05f;
+        if (qp.edge_length_spread > 1.2f * qs.edge_length_spread + 0.01f || !similar_valences ||
+            qp.hausdorff_distance > 1.5f * qs.hausdorff_distance + 0.01f * len) {
+            LOG(ERROR) << "the parallel remeshing is of lower quality than the sequential one (edge length spread: "
+                       << qp.edge_length_spread << " vs. " << qs.edge_length_spread << ", regular vertices: "
+                       << qp.valence_deviation[0] << " vs. " << qs.valence_deviation[0] << ", Hausdorff distance: "
+                       << qp.hausdorff_distance << " vs. " << qs.hausdorff_distance << ")";
+            delete mesh;
+            return false;
+        }
+
         SurfaceMeshRemeshing(mesh).uniform_remeshing(len);
     }
 
@@ -413,11 +583,216 @@ bool test_algo_surface_mesh_simplification() {
     const float aspect_ratio = 10.0f;
 
     const unsigned int expected_vertex_number = static_cast<unsigned int>(mesh->n_vertices() * 0.5f);
+
+    std::cout << "parallel simplification of surface mesh..." << std::endl;
+    {
+        // the rounds are deterministic, so the result must not depend on the number of threads
+        const unsigned int num_threads = parallel::num_threads();
+        SurfaceMesh results[2] = {*mesh, *mesh};
+        const unsigned int threads[2] = {1, 4};
+        for (int i = 0; i < 2; ++i) {
+            parallel::set_num_threads(threads[i]);
+            SurfaceMeshSimplification ss(&results[i]);
+            ss.initialize(aspect_ratio, 0.0f, 0.0f, normal_deviation, 0.0f);
+            ss.simplify(expected_vertex_number, FLT_MAX, true);
+        }
+        parallel::set_num_threads(num_threads);
+
+        if (results[0].n_vertices() != expected_vertex_number) {
+            LOG(ERROR) << "parallel simplification resulted in " << results[0].n_vertices() << " vertices (expected "
+                       << expected_vertex_number << ")";
+            delete mesh;
+            return false;
+        }
+        if (!are_identical_meshes(results[0], results[1])) {
+            LOG(ERROR) << "parallel simplification with " << threads[0] << " and " << threads[1]
+                       << " threads gave different results";
+            delete mesh;
+            return false;
+        }
+    }
+
+    std::cout << "error-bounded simplification of surface mesh..." << std::endl;
+    {
+        const float diagonal = mesh->bounding_box().diagonal_length();
+        const float max_error = 1e-7f * diagonal * diagonal;
+        for (int mode = 0; mode < 2; ++mode) {
+            SurfaceMesh copy(*mesh);
+            SurfaceMeshSimplification ss(&copy);
+            ss.initialize(aspect_ratio, 0.0f, 0.0f, normal_deviation, 0.0f);
+            ss.simplify(expected_vertex_number, max_error, mode == 1);
+            if (copy.n_vertices() <= expected_vertex_number || ss.collapses().empty()) {
+                LOG(ERROR) << "error-bounded simplification resulted in " << copy.n_vertices() << " vertices";
+                delete mesh;
+                return false;
+            }
+
+            // replay the collapses on the quadrics of the input and check the error of each collapse
+            std::vector<Quadric> quadrics(mesh->vertices_size());
+            for (auto v : mesh->vertices()) {
+                for (auto f : mesh->faces(v))
+                    quadrics[v.idx()] += Quadric(mesh->compute_face_normal(f), mesh->position(v));
+            }
+            for (const auto &c : ss.collapses()) {
+                Quadric q = quadrics[c.v0.idx()];
+                q += quadrics[c.v1.idx()];
+                const double error = q(mesh->position(c.v1));
+                if (error > max_error * (1.0 + 1e-4)) {
+                    LOG(ERROR) << "a collapse of the " << (mode == 1 ? "parallel" : "sequential")
+                               << " simplification has error " << error << " (max error " << max_error << ")";
+                    delete mesh;
+                    return false;
+                }
+                quadrics[c.v1.idx()] += quadrics[c.v0.idx()];
+            }
+        }
+    }
+
+    // the simplification compacts the mesh even if its garbage collection is deferred
+    mesh->defer_garbage_collection(true);
     SurfaceMeshSimplification ss(mesh);
     ss.initialize(aspect_ratio, 0.0f, 0.0f, normal_deviation, 0.0f);
     ss.simplify(expected_vertex_number);
+    if (mesh->n_vertices() != expected_vertex_number || mesh->has_garbage() ||
+        mesh->vertices_size() != expected_vertex_number) {
+        LOG(ERROR) << "simplification resulted in " << mesh->n_vertices() << " vertices (expected "
+                   << expected_vertex_number << ")";
+        delete mesh;
+        return false;
+    }
+
+    delete mesh;
+    return true;
+}
+
+
+bool test_algo_surface_mesh_out_of_core_simplification() {
+    const std::string file = resource::directory() + "/data/bunny.ply";
+    SurfaceMesh *input = SurfaceMeshIO::load(file);
+    if (!input) {
+        std::cerr << "Error: failed to load model. Please make sure the file exists and format is correct."
+                  << std::endl;
+        return false;
+    }
+    Box3 box = input->bounding_box();
+    delete input;
+
+    auto stream = [&](const SurfaceMeshOutOfCoreSimplification::VertexCallback &vertex_callback,
+                      const SurfaceMeshOutOfCoreSimplification::FaceCallback &face_callback) {
+        return io::stream_surface_mesh(file, vertex_callback, face_callback);
+    };
+
+    // the result must be a triangle mesh without degenerate faces near the input
+    const float tolerance = 0.05f * box.diagonal_length();
+    box.grow(box.min_point() - vec3(tolerance));
+    box.grow(box.max_point() + vec3(tolerance));
+    auto is_valid_result = [&](const SurfaceMesh *mesh) {
+        if (!mesh || mesh->n_faces() == 0 || !mesh->is_triangle_mesh())
+            return false;
+        for (auto f : mesh->faces()) {
+            auto h = mesh->halfedge(f);
+            const auto a = mesh->target(h), b = mesh->target(mesh->next(h)), c = mesh->source(h);
+            if (a == b || b == c || c == a)
+                return false;
+        }
+        for (auto v : mesh->vertices()) {
+            if (mesh->is_isolated(v) || !box.contains(mesh->position(v)))
+                return false;
+        }
+        return true;
+    };
+
+    std::cout << "out-of-core simplification of surface mesh..." << std::endl;
+    SurfaceMesh *mesh = SurfaceMeshOutOfCoreSimplification::apply(stream, 64);
+    if (!is_valid_result(mesh)) {
+        LOG(ERROR) << "out-of-core simplification failed";
+        delete mesh;
+        return false;
+    }
+
+    // a tiny memory budget: the grid has to be coarsened while streaming
+    SurfaceMesh *coarsened = SurfaceMeshOutOfCoreSimplification::apply(stream, 64, 1);
+    if (!is_valid_result(coarsened) || coarsened->n_faces() >= mesh->n_faces()) {
+        LOG(ERROR) << "out-of-core simplification with a limited memory budget resulted in "
+                   << (coarsened ? coarsened->n_faces() : 0) << " faces (" << mesh->n_faces()
+                   << " faces without the limit)";
+        delete mesh;
+        delete coarsened;
+        return false;
+    }
+
+    delete mesh;
+    delete coarsened;
+    return true;
+}
+
+
+bool test_algo_surface_mesh_lod() {
+    const std::string file = resource::directory() + "/data/bunny.ply";
+    SurfaceMesh *mesh = SurfaceMeshIO::load(file);
+    if (!mesh) {
+        std::cerr << "Error: failed to load model. Please make sure the file exists and format is correct."
+                  << std::endl;
+        return false;
+    }
+
+    std::cout << "LOD pyramid of surface mesh..." << std::endl;
+    const float normal_deviation = 180.0f;
+    const float aspect_ratio = 10.0f;
+    const unsigned int level_vertex_number = mesh->n_vertices() / 4;
+
+    SurfaceMesh *pyramid = SurfaceMeshLOD::build(mesh, 100, aspect_ratio, normal_deviation);
+    if (!pyramid || pyramid->n_vertices() != mesh->n_vertices() || pyramid->n_faces() != mesh->n_faces()) {
+        LOG(ERROR) << "failed generating the LOD pyramid";
+        delete mesh;
+        delete pyramid;
+        return false;
+    }
+
+    // a level is the same as the result of simplifying the mesh to the same number of vertices
+    SurfaceMeshSimplification ss(mesh);
+    ss.initialize(aspect_ratio, 0.0f, 0.0f, normal_deviation, 0.0f);
+    ss.simplify(level_vertex_number);
+    SurfaceMesh *level = SurfaceMeshLOD::extract(pyramid, level_vertex_number);
+    if (!level || !have_same_geometry(*level, *mesh)) {
+        LOG(ERROR) << "the extracted level (" << (level ? level->n_faces() : 0) << " faces) differs from the "
+                   << "simplified mesh (" << mesh->n_faces() << " faces)";
+        delete mesh;
+        delete pyramid;
+        delete level;
+        return false;
+    }
+
+    std::cout << "saving/loading the LOD pyramid..." << std::endl;
+    const std::string lod_file = "./bunny-lod.lod";
+    SurfaceMesh loaded;
+    bool success = io::save_lod(lod_file, pyramid) && io::load_lod(lod_file, &loaded, level_vertex_number);
+    if (success) { // a truncated file must be rejected
+        std::ifstream input(lod_file.c_str(), std::fstream::binary);
+        std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        input.close();
+        std::ofstream output(lod_file.c_str(), std::fstream::binary);
+        output.write(data.data(), static_cast<long>(data.size() - 4));
+        output.close();
+        SurfaceMesh truncated;
+        if (io::load_lod(lod_file, &truncated)) {
+            LOG(ERROR) << "a truncated LOD file was loaded";
+            success = false;
+        }
+    }
+    file_system::delete_file(lod_file);
+    if (!success || !have_same_geometry(loaded, *level)) {
+        LOG(ERROR) << "the level loaded from the LOD file (" << loaded.n_faces() << " faces) differs from the "
+                   << "extracted one (" << level->n_faces() << " faces)";
+        delete mesh;
+        delete pyramid;
+        delete level;
+        return false;
+    }
 
     delete mesh;
+    delete pyramid;
+    delete level;
     return true;
 }
 
@@ -452,6 +827,34 @@ bool test_algo_surface_mesh_smoothing() {
 
         SurfaceMeshSmoothing smoother(mesh);
         smoother.implicit_smoothing(timestep, true, rescale);
+
+        std::cout << "repeated implicit smoothing (factorization vs. matrix-free)..." << std::endl;
+        SurfaceMesh copy(*mesh);
+        SurfaceMeshSmoothing smoother_mf(&copy);
+        for (int i = 0; i < 3; ++i) {
+            smoother.implicit_smoothing(timestep, true, rescale);
+            smoother_mf.implicit_smoothing(timestep, true, rescale, true);
+        }
+
+        float max_diff = 0.0f;
+        for (auto v : mesh->vertices())
+            max_diff = std::max(max_diff, distance(mesh->position(v), copy.position(v)));
+        if (max_diff > 1e-4f * mesh->bounding_box(true).diagonal_length()) {
+            LOG(ERROR) << "matrix-free smoothing differs from the factorized one (" << max_diff << ")";
+            delete mesh;
+            return false;
+        }
+
+        // a new smoother of the same mesh continues with the cached factorization
+        std::shared_ptr<SparseSolver> solver = SparseSolver::shared(mesh, "smoothing");
+        const int nnz = static_cast<int>(solver->matrix().nonZeros());
+        SurfaceMeshSmoothing(mesh).implicit_smoothing(timestep, true, rescale);
+        if (nnz == 0 || SparseSolver::shared(mesh, "smoothing") != solver ||
+            SparseSolver::shared(mesh, "fairing") == solver || SparseSolver::shared(&copy, "smoothing") == solver) {
+            LOG(ERROR) << "the cached sparse solver was not shared by mesh and system kind";
+            delete mesh;
+            return false;
+        }
     }
 
     delete mesh;
@@ -557,6 +960,41 @@ bool test_algo_surface_mesh_triangulation() {
 }
 
 
+bool test_algo_triangle_mesh_bvh() {
+    const std::string file = resource::directory() + "/data/sphere.obj";
+    SurfaceMesh *mesh = SurfaceMeshIO::load(file);
+    if (!mesh) {
+        std::cerr << "Error: failed to load model. Please make sure the file exists and format is correct."
+                  << std::endl;
+        return false;
+    }
+
+    std::cout << "building BVH..." << std::endl;
+    TriangleMeshBVH bvh(mesh);
+    TriangleMeshKdTree kdtree(mesh);
+    const vec3 center = bvh.bounding_box().center();
+
+    std::cout << "ray casting and closest-point queries..." << std::endl;
+    bool success = bvh.signed_distance(center) < 0.0f;
+    for (auto v : mesh->vertices()) {
+        // rays from the center towards the vertices hit the mesh
+        const vec3 &p = mesh->position(v);
+        TriangleMeshBVH::Hit hit;
+        success &= bvh.intersect(center, p - center, hit) && std::abs(hit.t - 1.0f) < 1e-3f;
+        success &= bvh.occluded(center, p - center) && !bvh.occluded(p + (p - center), p - center);
+
+        // the same closest points as the k-d tree
+        const vec3 q = center + (p - center) * 1.5f;
+        success &= std::abs(bvh.nearest(q).dist - kdtree.nearest(q).dist) < 1e-4f && bvh.signed_distance(q) > 0.0f;
+    }
+    if (!success)
+        std::cerr << "Error: BVH queries returned wrong results" << std::endl;
+
+    delete mesh;
+    return success;
+}
+
+
 #ifdef HAS_CGAL
 
 int test_surface_mesh_remesh_self_intersections() {
@@ -716,6 +1154,12 @@ int test_surface_mesh_algorithms() {
     if (!test_algo_surface_mesh_simplification())
         return EXIT_FAILURE;
 
+    if (!test_algo_surface_mesh_out_of_core_simplification())
+        return EXIT_FAILURE;
+
+    if (!test_algo_surface_mesh_lod())
+        return EXIT_FAILURE;
+
     if (!test_algo_surface_mesh_smoothing())
         return EXIT_FAILURE;
 
@@ -731,6 +1175,9 @@ int test_surface_mesh_algorithms() {
     if (!test_algo_surface_mesh_triangulation())
         return EXIT_FAILURE;
 
+    if (!test_algo_triangle_mesh_bvh())
+        return EXIT_FAILURE;
+
 #ifdef HAS_CGAL
     if (!test_surface_mesh_remesh_self_intersections())
         return EXIT_FAILURE;
@@ -25,6 +25,7 @@
  ********************************************************************/
 
 #include <iostream>
+#include <algorithm>
 
 #include <easy3d/core/point_cloud.h>
 #include <easy3d/kdtree/kdtree_search_ann.h>
@@ -38,7 +39,7 @@
 using namespace easy3d;
 
 
-void evaluate(const PointCloud* cloud, KdTreeSearch* tree) {
+bool evaluate(const PointCloud* cloud, KdTreeSearch* tree) {
     std::cout << "\tquerying closest vertex (for each point in the point cloud)...";
     StopWatch w;
     for (auto v : cloud->vertices())
@@ -61,6 +62,39 @@ void evaluate(const PointCloud* cloud, KdTreeSearch* tree) {
     for (auto v : cloud->vertices())
         tree->find_points_in_range(cloud->position(v), radius, neighbors);
     std::cout << " done. time = " << w.time_string() << std::endl;
+
+    std::cout << "\tbatched querying K(=16) closest vertex (for all points in the point cloud)...";
+    const std::vector<vec3>& points = cloud->points();
+    KdTreeSearch::Neighbors batch;
+    w.restart();
+    tree->find_closest_k_points(points, k, batch);
+    std::cout << " done. time = " << w.time_string() << std::endl;
+
+    // the batched queries must give the same results as the single queries
+    std::vector<float> squared_distances;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        tree->find_closest_k_points(points[i], k, neighbors, squared_distances);
+        if (batch.count(i) != neighbors.size() ||
+            !std::equal(neighbors.begin(), neighbors.end(), batch.indices_of(i))) {
+            LOG(ERROR) << "batched k-NN query differs from single query for point " << i;
+            return false;
+        }
+    }
+
+    std::cout << "\tbatched querying the nearest neighbors within a fixed range (for all points in the point cloud)...";
+    w.restart();
+    tree->find_points_in_range(points, radius, batch);
+    std::cout << " done. time = " << w.time_string() << std::endl;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        tree->find_points_in_range(points[i], radius, neighbors);
+        if (batch.count(i) != neighbors.size() ||
+            !std::equal(neighbors.begin(), neighbors.end(), batch.indices_of(i))) {
+            LOG(ERROR) << "batched range query differs from single query for point " << i;
+            return false;
+        }
+    }
+
+    return true;
 }
 
 
@@ -80,28 +114,32 @@ int test_kdtree() {
     StopWatch w;
     KdTreeSearch_ANN ann(cloud);
     std::cout << " done. time = " << w.time_string() << std::endl;
-    evaluate(cloud, &ann);
+    if (!evaluate(cloud, &ann))
+        return EXIT_FAILURE;
 
     std::cout << "------- kd-tree using ETH --------" << std::endl;
     std::cout << "\tconstructing kd-tree...";
     w.restart();
     KdTreeSearch_ETH eth(cloud);
     std::cout << " done. time = " << w.time_string() << std::endl;
-    evaluate(cloud, &eth);
+    if (!evaluate(cloud, &eth))
+        return EXIT_FAILURE;
 
     std::cout << "------- kd-tree using FLANN --------" << std::endl;
     std::cout << "\tconstructing kd-tree...";
     w.restart();
     KdTreeSearch_FLANN flann(cloud);
     std::cout << " done. time = " << w.time_string() << std::endl;
-    evaluate(cloud, &flann);
+    if (!evaluate(cloud, &flann))
+        return EXIT_FAILURE;
 
     std::cout << "------- kd-tree using NANOFLANN --------" << std::endl;
     std::cout << "\tconstructing kd-tree...";
     w.restart();
     KdTreeSearch_NanoFLANN nanoflann(cloud);
     std::cout << " done. time = " << w.time_string() << std::endl;
-    evaluate(cloud, &nanoflann);
+    if (!evaluate(cloud, &nanoflann))
+        return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
 }
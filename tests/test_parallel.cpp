@@ -0,0 +1,126 @@
+/********************************************************************
+ * Copyright (C) 2015 Liangliang Nan <liangliang.nan@gmail.com>
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++ library
+ *      for processing and rendering 3D data.
+ *      Journal of Open Source Software, 6(64), 3255, 2021.
+ * ------------------------------------------------------------------
+ *
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ ********************************************************************/
+
+#include <easy3d/util/parallel.h>
+#include <easy3d/util/stop_watch.h>
+#include <easy3d/util/progress.h>
+#include <iostream>
+#include <numeric>
+#include <cmath>
+
+
+using namespace easy3d;
+
+
+int test_parallel() {
+    std::cout << "testing parallel loops..." << std::endl;
+
+    const std::size_t num = 1000000;
+    std::vector<double> values(num);
+
+    // a parallel loop and its serial counterpart must give identical results
+    StopWatch w;
+    parallel::for_each(0, num, [&](std::size_t i) { values[i] = std::sqrt(static_cast<double>(i)); });
+    std::cout << "\tparallel loop (" << parallel::num_threads() << " threads) done. time = " << w.time_string() << std::endl;
+    for (std::size_t i = 0; i < num; ++i) {
+        if (values[i] != std::sqrt(static_cast<double>(i))) {
+            std::cerr << "\tparallel loop gave a wrong value at " << i << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // reductions must be deterministic for any number of threads
+    auto sum = [&]() -> double {
+        return parallel::reduce(0, num, 0.0, [&](std::size_t begin, std::size_t end) -> double {
+            return std::accumulate(values.begin() + begin, values.begin() + end, 0.0);
+        }, std::plus<double>());
+    };
+    const double reference = sum();
+    for (unsigned int threads : {1u, 2u, 3u, 8u}) {
+        parallel::set_num_threads(threads);
+        if (sum() != reference) {
+            std::cerr << "\tparallel reduction with " << threads << " threads is not deterministic" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    parallel::set_num_threads(0);
+
+    // nested loops must not deadlock
+    std::vector<int> counts(64, 0);
+    parallel::for_each(0, counts.size(), [&](std::size_t i) {
+        std::vector<int> inner(1000, 0);
+        parallel::for_each(0, inner.size(), [&](std::size_t j) { inner[j] = 1; }, 10);
+        counts[i] = std::accumulate(inner.begin(), inner.end(), 0);
+    }, 1);
+    for (auto c : counts) {
+        if (c != 1000) {
+            std::cerr << "\tnested parallel loops gave a wrong result" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // exceptions thrown by a task are rethrown in the calling thread
+    bool caught = false;
+    try {
+        parallel::for_each(0, 100, [](std::size_t i) { if (i == 42) throw std::runtime_error("42"); }, 1);
+    }
+    catch (const std::runtime_error &) {
+        caught = true;
+    }
+    if (!caught) {
+        std::cerr << "\tthe exception thrown in a parallel loop was lost" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the redirection of the progress is propagated to the tasks of a loop: their loggers see the cancellation of
+    // the job, but only the calling thread reports the progress
+    {
+        std::atomic<bool> canceled(true);
+        std::atomic<std::size_t> num_notified(0);
+        ThreadProgress progress([&](std::size_t) { ++num_notified; }, canceled);
+        std::atomic<std::size_t> num_canceled(0);
+        parallel::for_each(0, 1000, [&](std::size_t) {
+            ProgressLogger logger(10, false);
+            logger.next();
+            if (logger.is_canceled())
+                ++num_canceled;
+        }, 1);
+        if (num_canceled != 1000 || num_notified != 0) {
+            std::cerr << "	the redirection of the progress was not propagated to the tasks of a parallel loop" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // asynchronous tasks
+    ThreadPool pool(4);
+    auto answer = pool.async([]() -> int { return 42; });
+    if (answer.get() != 42) {
+        std::cerr << "\tasynchronous task gave a wrong result" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}